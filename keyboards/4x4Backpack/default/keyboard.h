@@ -9,7 +9,7 @@
  * Keyboard part, e.g. MASTER and SLAVE.
  * #define MASTER
  * #define SLAVE
- * This is defined in SEGGER Embedded Studio project file.
+ * This is defined by build, HALF of armgcc Makefile or SEGGER Embedded Studio project file.
  */
 
 // Key source, to specify key stroke came from which part of the keyboard.
@@ -26,6 +26,12 @@
 #define MATRIX_ROW_PINS {25, 26, 27, 28}
 #define MATRIX_COL_PINS {29, 30, 2, 3}
 
+// Matrix backend, direct GPIO by default. Uncomment for shift registers or I/O expander, and define its pins (see matrix.h).
+// #define MATRIX_BACKEND MATRIX_BACKEND_SPIM
+
+// Key positions, MATRIX_DEFINE maps keys into 1..KEY_POSITION_NUM. Keymap layer has a code per key position.
+#define KEY_POSITION_NUM (MATRIX_ROW_NUM * MATRIX_COL_NUM)
+
 // Master keyboard definition.
 #ifdef MASTER
 // If keyboard has slave side.
@@ -43,6 +49,5 @@
 
 extern const uint8_t ROWS[MATRIX_ROW_NUM];
 extern const uint8_t COLS[MATRIX_COL_NUM];
-extern const int8_t MATRIX[MATRIX_ROW_NUM][MATRIX_COL_NUM];
 
 #endif
@@ -6,7 +6,7 @@
 #include "../keycodes.h"
 #include "keyboard.h"
 
-const uint32_t KEYMAP[][MATRIX_COL_NUM * MATRIX_ROW_NUM * 2] = {
+const uint32_t KEYMAP[][KEY_POSITION_NUM] = {
     [_BS] = {
         KC_Q,    KC_W,    KC_E,    KC_R,
         KC_A,    KC_S,    KC_D,    KC_F,
@@ -9,12 +9,14 @@
  * Keyboard part, e.g. MASTER and SLAVE.
  * #define MASTER
  * #define SLAVE
- * This is defined in SEGGER Embedded Studio project file.
+ * This is defined by build, HALF of armgcc Makefile or SEGGER Embedded Studio project file.
  */
 
 // Key source, to specify key stroke came from which part of the keyboard.
 #define SOURCE_MASTER 1
-#define SOURCE_SLAVE  2
+#define SOURCE_SLAVE  2 // First slave, slave on link n uses SLAVE_SOURCE(n).
+
+#define SLAVE_SOURCE(link) (SOURCE_SLAVE + (link))
 
 #define MANUFACTURER_NAME "JPConstantineau.com"
 
@@ -31,12 +33,29 @@
 #define MATRIX_ROW_PINS {C6, D7, E6, B4}
 #define MATRIX_COL_PINS {F5, F6, F7, B1, B3, B2, B6}
 
+// Matrix backend, direct GPIO by default. Uncomment for shift registers or I/O expander, and define its pins (see matrix.h).
+// #define MATRIX_BACKEND MATRIX_BACKEND_SPIM
+
+// Key positions of each half, MATRIX_DEFINE of a half maps its keys into 1..KEY_POSITION_NUM.
+// Keymap layer has a code per key position of whole keyboard.
+#define MASTER_KEY_POSITION_NUM (MATRIX_ROW_NUM * MATRIX_COL_NUM)
+#define SLAVE_KEY_POSITION_NUM  (MATRIX_ROW_NUM * MATRIX_COL_NUM)
+#define KEY_POSITION_NUM        (MASTER_KEY_POSITION_NUM + SLAVE_KEY_POSITION_NUM)
+
+// Split link transport, BLE by default. Uncomment for wired halves (see kb_link_config.h).
+// #define KB_LINK_TRANSPORT KB_LINK_TRANSPORT_UARTE
+
 // Master keyboard definition.
 #ifdef MASTER
 // If keyboard has slave side.
 #define HAS_SLAVE
+#ifndef SLAVE_NUM
+#define SLAVE_NUM 1 // Number of slave halves & modules (e.g. numpad) linked to master, host sim raises it.
+#endif
 #define DEVICE_NAME MASTER_NAME
 #define SOURCE      SOURCE_MASTER
+#define KB_LINK_UARTE_TX_PIN D3
+#define KB_LINK_UARTE_RX_PIN D2
 #define MATRIX_DEFINE                 \
     {                                 \
         {1,  2,  3,  4,  5,  6,  7},  \
@@ -50,6 +69,8 @@
 #ifdef SLAVE
 #define DEVICE_NAME SLAVE_NAME
 #define SOURCE      SOURCE_SLAVE
+#define KB_LINK_UARTE_TX_PIN D2
+#define KB_LINK_UARTE_RX_PIN D3
 #define MATRIX_DEFINE                 \
     {                                 \
         {14, 13, 12, 11, 10, 9,  8},  \
@@ -61,6 +82,5 @@
 
 extern const uint8_t ROWS[MATRIX_ROW_NUM];
 extern const uint8_t COLS[MATRIX_COL_NUM];
-extern const int8_t MATRIX[MATRIX_ROW_NUM][MATRIX_COL_NUM];
 
 #endif
@@ -6,7 +6,7 @@
 #include "../keycodes.h"
 #include "keyboard.h"
 
-const uint32_t KEYMAP[][MATRIX_COL_NUM * MATRIX_ROW_NUM * 2] = {
+const uint32_t KEYMAP[][KEY_POSITION_NUM] = {
     [_BS] = {
         KC_TAB,  KC_Q,    KC_W,    KC_E,    KC_R,    KC_T,    KC_ESC,  XXXXXXX, KC_Y,    KC_U,    KC_I,    KC_O,    KC_P,    KC_BSPC,
         KC_LCTL, KC_A,    KC_S,    KC_D,    KC_F,    KC_G,    XXXXXXX, XXXXXXX, KC_H,    KC_J,    KC_K,    KC_L,    KC_SCLN, KC_QUOT,
@@ -39,4 +39,7 @@ const uint32_t KEYMAP[][MATRIX_COL_NUM * MATRIX_ROW_NUM * 2] = {
     }
 };
 
+// Combos, keys pressed together within COMBO_TERM send combo code instead (see combo.h). Keys are MATRIX_DEFINE indexes.
+// #define COMBO_DEFINE {COMBO(KC_ESC, 24, 25), COMBO(KC_ENT, 18, 19)}
+
 #endif
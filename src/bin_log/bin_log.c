@@ -0,0 +1,98 @@
+#include "bin_log.h"
+
+#if BIN_LOG_ENABLED
+#include <stddef.h>
+
+#include "app_timer.h"
+#include "app_util.h"
+#include "app_util_platform.h"
+
+#define TICK_MASK  0xFFFFFF // RTC of app_timer is 24 bits.
+#define ID_SHIFT   24
+#define INDEX_MASK (BIN_LOG_BUFSIZE - 1)
+
+STATIC_ASSERT(BIN_LOG_BUFSIZE >= 2 * BIN_LOG_RECORD_MAX && (BIN_LOG_BUFSIZE & INDEX_MASK) == 0);
+STATIC_ASSERT(BIN_LOG_ID_NUM <= UINT8_MAX + 1);
+
+#define X(id, arg_num, format) arg_num,
+static const uint8_t m_arg_nums[BIN_LOG_ID_NUM] = {BIN_LOG_FORMATS};
+#undef X
+
+static uint8_t m_buffer[BIN_LOG_BUFSIZE];
+static uint32_t m_head = 0; // Bytes written, free running.
+static uint32_t m_tail = 0; // Bytes taken, free running.
+static uint32_t m_dropped = 0;
+
+static void word_write(uint32_t word) {
+    for (int i = 0; i < sizeof(word); i++) {
+        m_buffer[m_head++ & INDEX_MASK] = (uint8_t)(word >> (i * 8));
+    }
+}
+
+static void record_write(bin_log_id_t id, uint32_t tick, uint32_t const *p_args, uint8_t arg_num) {
+    word_write(((uint32_t)id << ID_SHIFT) | (tick & TICK_MASK));
+
+    for (int i = 0; i < arg_num; i++) {
+        word_write(p_args[i]);
+    }
+}
+
+// Called from interrupts of any priority, so record is written in one critical region.
+void bin_log_put(bin_log_id_t id, uint32_t const *p_args, uint8_t arg_num) {
+    uint32_t tick = app_timer_cnt_get();
+    uint32_t len = (1 + arg_num) * sizeof(uint32_t);
+
+    CRITICAL_REGION_ENTER();
+
+    // Pending drop count goes first, as its own record.
+    if (m_dropped > 0) {
+        len += 2 * sizeof(uint32_t);
+    }
+
+    if (BIN_LOG_BUFSIZE - (m_head - m_tail) < len) {
+        m_dropped++;
+    } else {
+        if (m_dropped > 0) {
+            record_write(BIN_LOG_DROPPED, tick, &m_dropped, 1);
+            m_dropped = 0;
+        }
+
+        record_write(id, tick, p_args, arg_num);
+    }
+
+    CRITICAL_REGION_EXIT();
+}
+
+uint32_t bin_log_peek(uint8_t *p_data, uint32_t size) {
+    uint32_t head;
+    uint32_t len = 0;
+
+    CRITICAL_REGION_ENTER();
+    head = m_head;
+    CRITICAL_REGION_EXIT();
+
+    // Records up to head are complete, puts only add after them.
+    while (m_tail + len < head) {
+        uint8_t id = m_buffer[(m_tail + len + 3) & INDEX_MASK];
+        uint32_t record_len = (1 + m_arg_nums[id]) * sizeof(uint32_t);
+
+        if (len + record_len > size) {
+            break;
+        }
+
+        for (uint32_t i = 0; i < record_len; i++) {
+            p_data[len + i] = m_buffer[(m_tail + len + i) & INDEX_MASK];
+        }
+
+        len += record_len;
+    }
+
+    return len;
+}
+
+void bin_log_consume(uint32_t len) {
+    CRITICAL_REGION_ENTER();
+    m_tail += len;
+    CRITICAL_REGION_EXIT();
+}
+#endif
@@ -0,0 +1,78 @@
+#ifndef _BIN_LOG_H_
+#define _BIN_LOG_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../firmware_config.h"
+#include "bin_log_formats.h"
+
+/*
+ * Binary log of keystroke path, enabled by BIN_LOG_ENABLED. A record is format ID & args, kept in a ring of
+ * BIN_LOG_BUFSIZE bytes and drained in idle to RTT up channel BIN_LOG_RTT_CHANNEL, formatted on host by tools/bin_log.
+ * Record, little endian: uint32 of format ID (bits 24-31) & app_timer RTC tick (bits 0-23), then uint32 of each arg.
+ * Full ring drops new records and counts them, BIN_LOG_DROPPED record gives the count once there is room again.
+ * RTT drain is in bin_log_rtt.c.
+ */
+#define X(id, arg_num, format) id,
+typedef enum bin_log_id_e {
+    BIN_LOG_FORMATS
+    BIN_LOG_ID_NUM
+} bin_log_id_t;
+#undef X
+
+// Arg count of each format, <id>_ARG_NUM, checked at compile time by BIN_LOG_<n> macros.
+#define X(id, arg_num, format) id##_ARG_NUM = arg_num,
+enum {
+    BIN_LOG_FORMATS
+};
+#undef X
+
+#define BIN_LOG_ARG_MAX    3
+#define BIN_LOG_RECORD_MAX ((1 + BIN_LOG_ARG_MAX) * sizeof(uint32_t))
+
+// Inits RTT channel, logs still go to ring before it.
+void bin_log_init(void);
+
+#if BIN_LOG_ENABLED
+void bin_log_put(bin_log_id_t id, uint32_t const *p_args, uint8_t arg_num);
+// Copies whole records from ring without taking them, returns bytes copied.
+uint32_t bin_log_peek(uint8_t *p_data, uint32_t size);
+// Takes bytes copied by bin_log_peek from ring.
+void bin_log_consume(uint32_t len);
+// Drains ring to RTT, returns true while records are left and RTT takes them.
+bool bin_log_process(void);
+
+#define BIN_LOG_0(id)                     \
+    do {                                  \
+        STATIC_ASSERT(id##_ARG_NUM == 0); \
+        bin_log_put(id, NULL, 0);         \
+    } while (0)
+#define BIN_LOG_1(id, a)                           \
+    do {                                           \
+        STATIC_ASSERT(id##_ARG_NUM == 1);          \
+        uint32_t bin_log_args[] = {(uint32_t)(a)}; \
+        bin_log_put(id, bin_log_args, 1);          \
+    } while (0)
+#define BIN_LOG_2(id, a, b)                                       \
+    do {                                                          \
+        STATIC_ASSERT(id##_ARG_NUM == 2);                         \
+        uint32_t bin_log_args[] = {(uint32_t)(a), (uint32_t)(b)}; \
+        bin_log_put(id, bin_log_args, 2);                         \
+    } while (0)
+#define BIN_LOG_3(id, a, b, c)                                                   \
+    do {                                                                         \
+        STATIC_ASSERT(id##_ARG_NUM == 3);                                        \
+        uint32_t bin_log_args[] = {(uint32_t)(a), (uint32_t)(b), (uint32_t)(c)}; \
+        bin_log_put(id, bin_log_args, 3);                                        \
+    } while (0)
+#define BIN_LOG_PROCESS() bin_log_process()
+#else
+#define BIN_LOG_0(id)
+#define BIN_LOG_1(id, a)
+#define BIN_LOG_2(id, a, b)
+#define BIN_LOG_3(id, a, b, c)
+#define BIN_LOG_PROCESS() false
+#endif
+
+#endif
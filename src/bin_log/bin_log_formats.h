@@ -0,0 +1,26 @@
+#ifndef _BIN_LOG_FORMATS_H_
+#define _BIN_LOG_FORMATS_H_
+
+/*
+ * Formats of binary log, X(id, arg_num, format). Firmware keeps only ID & args, host decoder (tools/bin_log)
+ * formats them, so strings stay out of flash. IDs are one byte, add new formats at end to keep old captures readable.
+ * Shared with host decoder, so only plain C here.
+ */
+#define BIN_LOG_FORMATS                                                                            \
+    X(BIN_LOG_DROPPED, 1, "Binary log; dropped: %u records.")                                      \
+    X(BIN_LOG_HIDS_REPORT, 1, "HIDs report; ret: 0x%X.")                                           \
+    X(BIN_LOG_HIDS_QUEUE, 1, "HIDs report queue: %u")                                              \
+    X(BIN_LOG_REPORT_GENERATE, 1, "generate_hid_report_task; len: %u")                             \
+    X(BIN_LOG_SLAVE_KEY_INDEX_RX, 2, "Receive key index from slave link; link: %u, len: %u.")      \
+    X(BIN_LOG_SLAVE_KEY_STATE_RX, 2, "Receive key state from slave link; link: %u, len: %u.")      \
+    X(BIN_LOG_SLAVE_KEY_EVENT, 3, "process_slave_key_index_task; source: %u, key: %u, press: %u.") \
+    X(BIN_LOG_SLAVE_KEY_STATE, 2, "process_slave_key_state_task; source: %u, len: %u.")            \
+    X(BIN_LOG_KB_LINK_HVX, 1, "sd_ble_gatts_hvx; ret: 0x%X.")                                      \
+    X(BIN_LOG_KB_LINK_NOTIFICATION, 0, "Receive notification.")                                    \
+    X(BIN_LOG_POWER_STATE, 2, "Power state; %u -> %u.")                                            \
+    X(BIN_LOG_GPIOTE_PORT, 0, "GPIOTE PORT evt.")                                                  \
+    X(BIN_LOG_WAKE_LATENCY, 2, "Wake to report latency: %u us, max: %u us.")                       \
+    X(BIN_LOG_LATENCY_DISABLED, 0, "Slave latency disabled.")                                      \
+    X(BIN_LOG_LATENCY_ENABLED, 0, "Slave latency enabled.")
+
+#endif
@@ -0,0 +1,32 @@
+#include "bin_log.h"
+
+#if BIN_LOG_ENABLED
+#include "SEGGER_RTT.h"
+
+#define CHUNK_SIZE (4 * BIN_LOG_RECORD_MAX)
+
+static char m_rtt_buffer[BIN_LOG_RTT_BUFSIZE];
+#endif
+
+void bin_log_init(void) {
+#if BIN_LOG_ENABLED
+    // Skip mode writes all of a chunk or none of it, so records are never cut while host is slow or away.
+    SEGGER_RTT_ConfigUpBuffer(BIN_LOG_RTT_CHANNEL, "bin_log", m_rtt_buffer, sizeof(m_rtt_buffer), SEGGER_RTT_MODE_NO_BLOCK_SKIP);
+#endif
+}
+
+#if BIN_LOG_ENABLED
+bool bin_log_process(void) {
+    uint8_t chunk[CHUNK_SIZE];
+    uint32_t len = bin_log_peek(chunk, sizeof(chunk));
+
+    if (len == 0 || SEGGER_RTT_Write(BIN_LOG_RTT_CHANNEL, chunk, len) != len) {
+        // Records stay in ring until RTT has room, ring counts drops once full.
+        return false;
+    }
+
+    bin_log_consume(len);
+
+    return true;
+}
+#endif
@@ -0,0 +1,336 @@
+#include "combo.h"
+
+#include <string.h>
+
+typedef struct held_key_s {
+    key_index_t index;
+    uint8_t source;
+} held_key_t;
+
+typedef struct active_combo_s {
+    uint16_t combo;
+    uint8_t source;
+    bool is_released;  // Combo release went out with first release of its keys.
+    combo_mask_t keys; // Its keys still pressed.
+} active_combo_t;
+
+static combo_init_t m_init;
+static combo_mask_t m_combo_keys; // Keys in any combo.
+
+// Index in buffer of init.
+static combo_mask_t *m_p_masks;  // Keys of combo.
+static uint32_t *m_p_key_sets;   // Combos of key position, set of key index i at (i - 1) * m_set_words.
+static uint32_t *m_p_candidates; // Combos which hold all held back keys.
+static uint16_t m_set_words;
+
+// Held back presses in order, their keys are a subset of some combo, so no more than COMBO_KEY_MAX.
+static held_key_t m_held[COMBO_KEY_MAX];
+static uint8_t m_held_num = 0;
+static uint8_t m_held_peak = 0;
+static combo_mask_t m_held_mask;
+static uint32_t m_held_time; // Press time of first held back key.
+static uint32_t m_time = 0;  // Last time given, for events flushed without one.
+
+static active_combo_t m_active[COMBO_ACTIVE_MAX];
+static uint8_t m_active_num = 0;
+
+static bool mask_test(combo_mask_t const mask, key_index_t index) {
+    if (index == 0 || index > KEY_POSITION_NUM) {
+        return false;
+    }
+
+    return (mask[(index - 1) / 32] & (1UL << ((index - 1) % 32))) != 0;
+}
+
+static void mask_set(combo_mask_t mask, key_index_t index) {
+    mask[(index - 1) / 32] |= 1UL << ((index - 1) % 32);
+}
+
+static void mask_clear(combo_mask_t mask, key_index_t index) {
+    mask[(index - 1) / 32] &= ~(1UL << ((index - 1) % 32));
+}
+
+static bool mask_is_empty(combo_mask_t const mask) {
+    uint32_t bits = 0;
+
+    for (int w = 0; w < COMBO_MASK_WORDS; w++) {
+        bits |= mask[w];
+    }
+
+    return bits == 0;
+}
+
+void combo_init(combo_init_t const *p_init) {
+    m_init = *p_init;
+
+    memset(m_combo_keys, 0, sizeof(m_combo_keys));
+    memset(m_held_mask, 0, sizeof(m_held_mask));
+    m_held_num = 0;
+    m_held_peak = 0;
+    m_active_num = 0;
+    m_time = 0;
+
+    m_set_words = COMBO_SET_WORDS(m_init.combo_num);
+    m_p_masks = (combo_mask_t *)m_init.p_buffer;
+    m_p_key_sets = m_init.p_buffer + m_init.combo_num * COMBO_MASK_WORDS;
+    m_p_candidates = m_p_key_sets + KEY_POSITION_NUM * m_set_words;
+
+    memset(m_init.p_buffer, 0, COMBO_BUFFER_WORDS(m_init.combo_num) * sizeof(uint32_t));
+
+    for (uint16_t combo = 0; combo < m_init.combo_num; combo++) {
+        for (int i = 0; i < COMBO_KEY_MAX; i++) {
+            key_index_t index = m_init.p_combos[combo].keys[i];
+
+            if (index > 0 && index <= KEY_POSITION_NUM) {
+                mask_set(m_p_masks[combo], index);
+                mask_set(m_combo_keys, index);
+                m_p_key_sets[(index - 1) * m_set_words + combo / 32] |= 1UL << (combo % 32);
+            }
+        }
+    }
+}
+
+static uint32_t const *key_set(key_index_t index) {
+    return &m_p_key_sets[(index - 1) * m_set_words];
+}
+
+// Candidates which also hold key, false and candidates kept if none does.
+static bool candidates_narrow(key_index_t index) {
+    uint32_t const *p_set = key_set(index);
+    uint32_t any = 0;
+
+    for (uint16_t w = 0; w < m_set_words; w++) {
+        any |= m_p_candidates[w] & p_set[w];
+    }
+
+    if (any == 0) {
+        return false;
+    }
+
+    for (uint16_t w = 0; w < m_set_words; w++) {
+        m_p_candidates[w] &= p_set[w];
+    }
+
+    return true;
+}
+
+/*
+ * Candidates hold all held back keys, candidate which misses none of its keys is exact. First exact combo is
+ * returned, -1 if none. Can grow is set if some candidate still misses keys.
+ */
+static int32_t match(bool *p_can_grow) {
+    int32_t exact = -1;
+
+    *p_can_grow = false;
+
+    for (uint16_t w = 0; w < m_set_words; w++) {
+        uint32_t bits = m_p_candidates[w];
+
+        while (bits != 0) {
+            uint16_t combo = w * 32 + __builtin_ctz(bits);
+            uint32_t missing = 0;
+
+            bits &= bits - 1;
+
+            for (int i = 0; i < COMBO_MASK_WORDS; i++) {
+                missing |= m_p_masks[combo][i] & ~m_held_mask[i];
+            }
+
+            if (missing != 0) {
+                *p_can_grow = true;
+            } else if (exact < 0) {
+                exact = combo;
+            }
+
+            if (exact >= 0 && *p_can_grow) {
+                return exact;
+            }
+        }
+    }
+
+    return exact;
+}
+
+static void evt_send(key_event_t event, uint8_t source, uint32_t time, bool is_replay) {
+    combo_evt_t evt = {
+        .event = event,
+        .source = source,
+        .time = time,
+        .is_replay = is_replay
+    };
+
+    m_init.evt_handler(&evt);
+}
+
+static void held_clear(void) {
+    m_held_num = 0;
+    memset(m_held_mask, 0, sizeof(m_held_mask));
+}
+
+static void fire(uint16_t combo, uint8_t source, uint32_t time, bool is_replay) {
+    active_combo_t *p_active = &m_active[m_active_num++];
+
+    p_active->combo = combo;
+    p_active->source = source;
+    p_active->is_released = false;
+    memcpy(p_active->keys, m_p_masks[combo], sizeof(p_active->keys));
+
+    held_clear();
+    evt_send(KEY_EVENT(COMBO_KEY_INDEX(combo), true), source, time, is_replay);
+}
+
+static void held_send(uint32_t time) {
+    for (uint8_t i = 0; i < m_held_num; i++) {
+        evt_send(KEY_EVENT(m_held[i].index, true), m_held[i].source, time, true);
+    }
+
+    held_clear();
+}
+
+// Wait for held back keys ends, exact combo fires, else keys go out as they were pressed.
+static void held_resolve(uint32_t time) {
+    bool can_grow;
+    int32_t exact;
+
+    if (m_held_num == 0) {
+        return;
+    }
+
+    exact = match(&can_grow);
+
+    if (exact >= 0 && m_active_num < COMBO_ACTIVE_MAX) {
+        fire(exact, m_held[m_held_num - 1].source, time, true);
+        return;
+    }
+
+    held_send(time);
+}
+
+static void press(key_index_t index, uint8_t source, uint32_t time) {
+    bool can_grow;
+    int32_t exact;
+
+    if (!mask_test(m_combo_keys, index)) {
+        // Key in no combo breaks wait, it goes out after held back keys and isn't delayed itself.
+        bool is_replay = m_held_num > 0;
+
+        held_resolve(time);
+        evt_send(KEY_EVENT(index, true), source, time, is_replay);
+        return;
+    }
+
+    if (mask_test(m_held_mask, index)) {
+        held_resolve(time);
+    }
+
+    if (m_held_num > 0 && !candidates_narrow(index)) {
+        // Key can't join held back keys, they go out and key may start a combo of its own.
+        held_resolve(time);
+    }
+
+    if (m_held_num == 0) {
+        m_held_time = time;
+        memcpy(m_p_candidates, key_set(index), m_set_words * sizeof(uint32_t));
+    }
+
+    m_held[m_held_num].index = index;
+    m_held[m_held_num].source = source;
+    m_held_num++;
+    mask_set(m_held_mask, index);
+    exact = match(&can_grow);
+
+    if (m_held_num > m_held_peak) {
+        m_held_peak = m_held_num;
+    }
+
+    if (exact >= 0 && !can_grow) {
+        held_resolve(time);
+    }
+}
+
+static void release(key_index_t index, uint8_t source, uint32_t time, bool is_replay) {
+    for (uint8_t i = 0; i < m_active_num; i++) {
+        active_combo_t *p_active = &m_active[i];
+
+        if (!mask_test(p_active->keys, index)) {
+            continue;
+        }
+
+        mask_clear(p_active->keys, index);
+
+        if (!p_active->is_released) {
+            if (m_held_num > 0) {
+                // Keys held back meanwhile go out first, e.g. combo of shift must stay on for them.
+                held_resolve(time);
+                is_replay = true;
+            }
+
+            p_active->is_released = true;
+            evt_send(KEY_EVENT(COMBO_KEY_INDEX(p_active->combo), false), p_active->source, time, is_replay);
+        }
+
+        if (mask_is_empty(p_active->keys)) {
+            *p_active = m_active[--m_active_num];
+        }
+        return;
+    }
+
+    if (mask_test(m_held_mask, index)) {
+        // Held back key released before combo completed, press goes out first.
+        held_resolve(time);
+        release(index, source, time, true);
+        return;
+    }
+
+    if (m_held_num > 0) {
+        // Release of key pressed before wait breaks it too, e.g. shift must stay on for held back key.
+        held_resolve(time);
+        is_replay = true;
+    }
+
+    evt_send(KEY_EVENT(index, false), source, time, is_replay);
+}
+
+void combo_process(key_event_t event, uint8_t source, uint32_t time) {
+    combo_timeout(time);
+
+    if (KEY_EVENT_IS_PRESS(event)) {
+        press(KEY_EVENT_INDEX(event), source, time);
+    } else {
+        release(KEY_EVENT_INDEX(event), source, time, false);
+    }
+}
+
+void combo_timeout(uint32_t time) {
+    m_time = time;
+
+    if (m_held_num > 0 && time - m_held_time >= m_init.combo_term) {
+        held_resolve(time);
+    }
+}
+
+bool combo_deadline_get(uint32_t *p_time) {
+    if (m_held_num == 0) {
+        return false;
+    }
+
+    *p_time = m_held_time + m_init.combo_term;
+
+    return true;
+}
+
+void combo_flush(void) {
+    held_send(m_time);
+
+    for (uint8_t i = 0; i < m_active_num; i++) {
+        if (!m_active[i].is_released) {
+            evt_send(KEY_EVENT(COMBO_KEY_INDEX(m_active[i].combo), false), m_active[i].source, m_time, true);
+        }
+    }
+
+    m_active_num = 0;
+}
+
+uint8_t combo_held_peak(void) {
+    return m_held_peak;
+}
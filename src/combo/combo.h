@@ -0,0 +1,75 @@
+#ifndef _COMBO_H_
+#define _COMBO_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "keyboard.h"
+#include "../key_event.h"
+
+/*
+ * Combo engine, keys of a combo pressed together within combo term send combo code instead of their own.
+ * Index built at init holds a bitmask over key positions per combo and a set of combos per key position. Held back
+ * keys keep a candidate set, the combos which hold all of them; a press ANDs it with set of its key, so cost per
+ * event is a few words of AND, then a mask compare per surviving candidate, however many combos the keymap has.
+ * Press of key which is in no combo goes out right away, without latency. Press of
+ * key which may still complete a combo is held back, until a combo is complete, combo term ends or an event of
+ * another key breaks it; then held back keys go out as they are, so order of events is kept.
+ * Combo that matches exactly and can't grow into a longer one fires at once, else it fires when the wait ends.
+ * Fired combo comes out as press of virtual key position COMBO_KEY_INDEX(combo), past keymap positions, and is
+ * released with first release of its keys; releases of its other keys are dropped.
+ */
+#define COMBO_KEY_MAX    4                                // Keys of a combo, unused are 0.
+#define COMBO_MASK_WORDS ((KEY_POSITION_NUM + 31) / 32)  // 32-bit words of key position mask.
+#define COMBO_ACTIVE_MAX 4                                // Fired combos whose keys are still pressed.
+
+#define COMBO_SET_WORDS(combo_num)    (((combo_num) + 31) / 32) // 32-bit words of a set of combos.
+// Index of combo_num combos; mask per combo, set per key position & candidate set.
+#define COMBO_BUFFER_WORDS(combo_num) \
+    ((combo_num) * COMBO_MASK_WORDS + (KEY_POSITION_NUM + 1) * COMBO_SET_WORDS(combo_num))
+
+// Combo code & key indexes, e.g. COMBO(KC_ESC, 16, 17).
+#define COMBO(code, ...) {(code), {__VA_ARGS__}}
+
+#define COMBO_KEY_INDEX(combo)     ((key_index_t)(KEY_POSITION_NUM + 1 + (combo)))
+#define IS_COMBO_KEY_INDEX(index)  ((index) > KEY_POSITION_NUM)
+#define COMBO_OF_KEY_INDEX(index)  ((uint16_t)((index) - KEY_POSITION_NUM - 1))
+
+typedef struct combo_s {
+    uint32_t code;
+    key_index_t keys[COMBO_KEY_MAX];
+} combo_t;
+
+typedef uint32_t combo_mask_t[COMBO_MASK_WORDS];
+
+typedef struct combo_evt_s {
+    key_event_t event;
+    uint8_t source;
+    uint32_t time;  // Time event came out, so held back events keep time non-decreasing.
+    bool is_replay; // Event was held back, other events may come out with it at once.
+} combo_evt_t;
+
+typedef void (*combo_evt_handler_t)(combo_evt_t const *p_evt);
+
+typedef struct combo_init_s {
+    combo_t const *p_combos;
+    uint16_t combo_num;
+    uint32_t *p_buffer;  // COMBO_BUFFER_WORDS(combo_num) words for index, filled by init.
+    uint32_t combo_term; // In ms, from first held back press.
+    combo_evt_handler_t evt_handler;
+} combo_init_t;
+
+void combo_init(combo_init_t const *p_init);
+// Time is in ms of a clock wrapping at 32 bits, non-decreasing across calls.
+void combo_process(key_event_t event, uint8_t source, uint32_t time);
+// Held back keys which reached combo term by time fire their combo or go out.
+void combo_timeout(uint32_t time);
+// Time held back keys reach combo term, false if no key is held back.
+bool combo_deadline_get(uint32_t *p_time);
+// Held back keys go out & fired combos are released, e.g. before keys are changed behind engine. Keys still pressed
+// are plain keys until released.
+void combo_flush(void);
+// Most keys held back at once since init.
+uint8_t combo_held_peak(void);
+
+#endif
@@ -0,0 +1,334 @@
+#define NRF_LOG_MODULE_NAME config_cache
+#define NRF_LOG_LEVEL       CONFIG_CACHE_LOG_LEVEL
+
+#include "config_cache.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "app_error.h"
+#include "app_scheduler.h"
+#include "app_timer.h"
+#include "nrf_log.h"
+
+#include "../firmware_config.h"
+
+NRF_LOG_MODULE_REGISTER();
+
+typedef struct cache_record_s {
+    fds_record_t const *p_record;
+    fds_record_desc_t desc;
+    bool found;     // Record is in flash, next write is an update.
+    bool dirty;     // Changed since last write.
+    bool in_flight; // Write is queued in FDS.
+    bool retry;     // Write couldn't be queued, retried on next FDS event.
+} cache_record_t;
+
+APP_TIMER_DEF(m_flush_timer_id);
+
+static cache_record_t m_records[CONFIG_CACHE_RECORD_NUM];
+static uint8_t m_record_num = 0;
+static bool m_flush_timer_running = false;
+static bool m_gc_running = false;
+static bool m_gc_requested = false; // GC couldn't start or waits for writes in flight.
+static config_cache_sync_handler_t m_sync_handler = NULL; // Waits for every change to be in flash.
+static config_cache_stats_t m_stats;
+
+static void record_flush(cache_record_t *p_cache_record);
+static bool record_equals_flash(cache_record_t *p_cache_record);
+static bool in_flight_any(void);
+static void sync_check(void);
+static void gc_check(void);
+static void gc_start(void);
+static void flush_timeout_handler(void *p_context);
+static void flush_task(void *p_data, uint16_t size);
+static void fds_evt_handler(fds_evt_t const *p_evt);
+
+void config_cache_init(void) {
+    ret_code_t err_code;
+
+    NRF_LOG_INFO("config_cache_init.");
+
+    err_code = app_timer_create(&m_flush_timer_id, APP_TIMER_MODE_SINGLE_SHOT, flush_timeout_handler);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = fds_register(fds_evt_handler);
+    APP_ERROR_CHECK(err_code);
+
+    m_record_num = 0;
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+uint8_t config_cache_record_add(fds_record_t const *p_record, fds_record_desc_t const *p_desc) {
+    cache_record_t *p_cache_record;
+
+    APP_ERROR_CHECK_BOOL(m_record_num < CONFIG_CACHE_RECORD_NUM);
+
+    p_cache_record = &m_records[m_record_num];
+    memset(p_cache_record, 0, sizeof(cache_record_t));
+
+    p_cache_record->p_record = p_record;
+
+    if (p_desc != NULL) {
+        p_cache_record->desc = *p_desc;
+        p_cache_record->found = true;
+    }
+
+    return m_record_num++;
+}
+
+void config_cache_record_dirty(uint8_t record_id) {
+    ret_code_t err_code;
+    cache_record_t *p_cache_record = &m_records[record_id];
+
+    m_stats.change_count++;
+
+    if (p_cache_record->dirty) {
+        // Pending write will carry this change too.
+        m_stats.avoided_count++;
+    }
+
+    p_cache_record->dirty = true;
+
+    if (!m_flush_timer_running) {
+        // Not restarted by later changes, so busy keyboard still writes within the delay.
+        err_code = app_timer_start(m_flush_timer_id, APP_TIMER_TICKS(CONFIG_CACHE_FLUSH_DELAY), NULL);
+        APP_ERROR_CHECK(err_code);
+
+        m_flush_timer_running = true;
+    }
+}
+
+void config_cache_flush(void) {
+    ret_code_t err_code;
+    bool has_dirty = false;
+
+    for (int i = 0; i < m_record_num; i++) {
+        if (m_records[i].dirty) {
+            record_flush(&m_records[i]);
+        }
+
+        has_dirty |= m_records[i].dirty;
+    }
+
+    if (!has_dirty && m_flush_timer_running) {
+        err_code = app_timer_stop(m_flush_timer_id);
+        APP_ERROR_CHECK(err_code);
+
+        m_flush_timer_running = false;
+    }
+
+    sync_check();
+}
+
+void config_cache_sync(config_cache_sync_handler_t handler) {
+    m_sync_handler = handler;
+
+    config_cache_flush();
+}
+
+void config_cache_idle(void) {
+    if (m_record_num == 0) {
+        // FDS is not loaded yet.
+        return;
+    }
+
+    config_cache_flush();
+    gc_check();
+
+    NRF_LOG_INFO("Config cache; changes: %d, writes: %d, avoided: %d, gc: %d.", m_stats.change_count, m_stats.write_count, m_stats.avoided_count, m_stats.gc_count);
+}
+
+const config_cache_stats_t *config_cache_stats_get(void) {
+    return &m_stats;
+}
+
+static void record_flush(cache_record_t *p_cache_record) {
+    ret_code_t err_code;
+
+    if (p_cache_record->in_flight) {
+        // Data is read by FDS when write runs, record stays dirty and is written on next flush.
+        return;
+    }
+
+    if (p_cache_record->found && record_equals_flash(p_cache_record)) {
+        // E.g. device was switched and switched back.
+        NRF_LOG_DEBUG("Record 0x%X unchanged.", p_cache_record->p_record->key);
+
+        m_stats.avoided_count++;
+        p_cache_record->dirty = false;
+        p_cache_record->retry = false;
+        return;
+    }
+
+    if (p_cache_record->found) {
+        err_code = fds_record_update(&p_cache_record->desc, p_cache_record->p_record);
+    } else {
+        err_code = fds_record_write(&p_cache_record->desc, p_cache_record->p_record);
+    }
+
+    if (err_code == FDS_ERR_NO_SPACE_IN_FLASH) {
+        NRF_LOG_INFO("No space for record 0x%X, collecting garbage.", p_cache_record->p_record->key);
+
+        p_cache_record->retry = true;
+        gc_start();
+        return;
+    }
+
+    if (err_code == FDS_ERR_NO_SPACE_IN_QUEUES) {
+        p_cache_record->retry = true;
+        return;
+    }
+
+    APP_ERROR_CHECK(err_code);
+
+    m_stats.write_count++;
+    p_cache_record->dirty = false;
+    p_cache_record->retry = false;
+    p_cache_record->in_flight = true;
+}
+
+static bool record_equals_flash(cache_record_t *p_cache_record) {
+    ret_code_t err_code;
+    fds_flash_record_t flash_record;
+    bool equals;
+
+    err_code = fds_record_open(&p_cache_record->desc, &flash_record);
+
+    if (err_code != FDS_SUCCESS) {
+        return false;
+    }
+
+    equals = flash_record.p_header->length_words == p_cache_record->p_record->data.length_words
+          && memcmp(flash_record.p_data, p_cache_record->p_record->data.p_data, p_cache_record->p_record->data.length_words * sizeof(uint32_t)) == 0;
+
+    err_code = fds_record_close(&p_cache_record->desc);
+    APP_ERROR_CHECK(err_code);
+
+    return equals;
+}
+
+static bool in_flight_any(void) {
+    for (int i = 0; i < m_record_num; i++) {
+        if (m_records[i].in_flight) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void sync_check(void) {
+    config_cache_sync_handler_t handler = m_sync_handler;
+
+    if (handler == NULL || in_flight_any()) {
+        return;
+    }
+
+    for (int i = 0; i < m_record_num; i++) {
+        if (m_records[i].dirty) {
+            return;
+        }
+    }
+
+    m_sync_handler = NULL;
+    handler();
+}
+
+static void gc_check(void) {
+    ret_code_t err_code;
+    fds_stat_t stat;
+
+    if (in_flight_any()) {
+        // Check again once writes are done, they leave stale records behind.
+        m_gc_requested = true;
+        return;
+    }
+
+    err_code = fds_stat(&stat);
+    APP_ERROR_CHECK(err_code);
+
+    NRF_LOG_DEBUG("FDS stat; valid: %d, dirty: %d, freeable words: %d.", stat.valid_records, stat.dirty_records, stat.freeable_words);
+
+    if (stat.dirty_records >= CONFIG_CACHE_GC_DIRTY_RECORDS) {
+        gc_start();
+    }
+}
+
+static void gc_start(void) {
+    ret_code_t err_code;
+
+    if (m_gc_running) {
+        return;
+    }
+
+    err_code = fds_gc();
+
+    // Queue may be full, GC is requested again on next FDS event.
+    m_gc_running = err_code == FDS_SUCCESS;
+    m_gc_requested = !m_gc_running;
+}
+
+static void flush_timeout_handler(void *p_context) {
+    UNUSED_PARAMETER(p_context);
+    ret_code_t err_code;
+
+    err_code = app_sched_event_put(NULL, 0, flush_task);
+    APP_ERROR_CHECK(err_code);
+}
+
+static void flush_task(void *p_data, uint16_t size) {
+    UNUSED_PARAMETER(p_data);
+    UNUSED_PARAMETER(size);
+
+    NRF_LOG_INFO("Flush delay elapsed.");
+
+    m_flush_timer_running = false;
+    config_cache_flush();
+}
+
+static void fds_evt_handler(fds_evt_t const *p_evt) {
+    switch (p_evt->id) {
+        case FDS_EVT_WRITE:
+        case FDS_EVT_UPDATE:
+            for (int i = 0; i < m_record_num; i++) {
+                if (m_records[i].in_flight && p_evt->write.file_id == m_records[i].p_record->file_id && p_evt->write.record_key == m_records[i].p_record->key) {
+                    m_records[i].in_flight = false;
+
+                    if (p_evt->result == FDS_SUCCESS) {
+                        m_records[i].found = true;
+                    } else {
+                        NRF_LOG_WARNING("Record 0x%X write failed; result: 0x%X.", m_records[i].p_record->key, p_evt->result);
+
+                        m_records[i].dirty = true;
+                    }
+                }
+            }
+            break;
+
+        case FDS_EVT_GC:
+            // Peer manager runs GC too, any GC frees stale records.
+            NRF_LOG_INFO("FDS garbage collected.");
+
+            m_stats.gc_count++;
+            m_gc_running = false;
+            break;
+
+        default:
+            return;
+    }
+
+    // Retry what was blocked by full queue or flash, sync writes changes made while their record was in flight.
+    for (int i = 0; i < m_record_num; i++) {
+        if ((m_records[i].retry || (m_sync_handler != NULL && m_records[i].dirty)) && !m_gc_running) {
+            record_flush(&m_records[i]);
+        }
+    }
+
+    if (m_gc_requested && !in_flight_any()) {
+        m_gc_requested = false;
+        gc_check();
+    }
+
+    sync_check();
+}
@@ -0,0 +1,36 @@
+#ifndef _CONFIG_CACHE_H_
+#define _CONFIG_CACHE_H_
+
+#include <stdint.h>
+
+#include "fds.h"
+
+/*
+ * Write-behind cache of FDS records, record data stays in RAM of its owner.
+ * A change only marks its record dirty, dirty records are written when keyboard goes idle
+ * or CONFIG_CACHE_FLUSH_DELAY after first change at latest, so flash writes stay off typing path.
+ * Garbage collection runs on idle once CONFIG_CACHE_GC_DIRTY_RECORDS stale records piled up.
+ */
+typedef struct config_cache_stats_s {
+    uint32_t change_count;  // Changes marked by record owners.
+    uint32_t write_count;   // Flash writes done.
+    uint32_t avoided_count; // Changes merged into pending write or equal to flash content.
+    uint32_t gc_count;      // Garbage collections done.
+} config_cache_stats_t;
+
+typedef void (*config_cache_sync_handler_t)(void);
+
+void config_cache_init(void);
+// p_desc is descriptor of record found in flash, NULL if record is not written yet. Returns record id.
+uint8_t config_cache_record_add(fds_record_t const *p_record, fds_record_desc_t const *p_desc);
+void config_cache_record_dirty(uint8_t record_id);
+void config_cache_flush(void);
+/*
+ * Dirty records are written right away, also those changed while an earlier write of theirs is in flight. Handler is
+ * called once no record is dirty or in flight, so every change made before the call is in flash, e.g. to reset.
+ */
+void config_cache_sync(config_cache_sync_handler_t handler);
+void config_cache_idle(void);
+const config_cache_stats_t *config_cache_stats_get(void);
+
+#endif
@@ -0,0 +1,168 @@
+#define NRF_LOG_MODULE_NAME conn_latency
+#define NRF_LOG_LEVEL       CONN_LATENCY_LOG_LEVEL
+
+#include "conn_latency.h"
+
+#include <string.h>
+
+#include "app_error.h"
+#include "app_scheduler.h"
+#include "app_timer.h"
+#include "ble_err.h"
+#include "ble.h"
+#include "nrf_log.h"
+#include "nrf_sdh_ble.h"
+
+#include "../bin_log/bin_log.h"
+#include "../firmware_config.h"
+
+NRF_LOG_MODULE_REGISTER();
+
+APP_TIMER_DEF(m_idle_timer_id);
+
+static uint16_t m_conn_handle = BLE_CONN_HANDLE_INVALID;
+static bool m_latency_disabled = false;
+static conn_latency_stats_t m_stats;
+
+static void latency_disable_set(bool disable);
+static void idle_timeout_handler(void *p_context);
+static void idle_task(void *p_data, uint16_t size);
+static void ble_evt_handler(ble_evt_t const *p_ble_evt, void *p_context);
+
+NRF_SDH_BLE_OBSERVER(m_conn_latency_obs, CONN_LATENCY_BLE_OBSERVER_PRIO, ble_evt_handler, NULL);
+
+void conn_latency_init(void) {
+    ret_code_t err_code;
+
+    NRF_LOG_INFO("conn_latency_init.");
+
+    err_code = app_timer_create(&m_idle_timer_id, APP_TIMER_MODE_SINGLE_SHOT, idle_timeout_handler);
+    APP_ERROR_CHECK(err_code);
+
+    m_conn_handle = BLE_CONN_HANDLE_INVALID;
+    m_latency_disabled = false;
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+static void latency_disable_set(bool disable) {
+    ret_code_t err_code;
+    ble_opt_t opt;
+
+    if (m_conn_handle == BLE_CONN_HANDLE_INVALID || m_latency_disabled == disable) {
+        return;
+    }
+
+    memset(&opt, 0, sizeof(opt));
+    opt.gap_opt.slave_latency_disable.conn_handle = m_conn_handle;
+    opt.gap_opt.slave_latency_disable.disable = disable;
+
+    err_code = sd_ble_opt_set(BLE_GAP_OPT_SLAVE_LATENCY_DISABLE, &opt);
+
+    if (err_code == BLE_ERROR_INVALID_CONN_HANDLE) {
+        // Disconnect event is on its way.
+        return;
+    }
+    APP_ERROR_CHECK(err_code);
+
+    m_latency_disabled = disable;
+}
+
+void conn_latency_key_edge(void) {
+    ret_code_t err_code;
+
+    if (m_conn_handle == BLE_CONN_HANDLE_INVALID) {
+        return;
+    }
+
+    // Push back enabling of slave latency while keys keep changing.
+    err_code = app_timer_stop(m_idle_timer_id);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = app_timer_start(m_idle_timer_id, APP_TIMER_TICKS(CONN_LATENCY_IDLE_DELAY), NULL);
+    APP_ERROR_CHECK(err_code);
+
+    if (m_latency_disabled) {
+        return;
+    }
+
+    BIN_LOG_0(BIN_LOG_LATENCY_DISABLED);
+
+    latency_disable_set(true);
+    m_stats.disable_count++;
+}
+
+static void idle_timeout_handler(void *p_context) {
+    UNUSED_PARAMETER(p_context);
+    ret_code_t err_code;
+
+    // Change SoftDevice option in main context, along with key edges.
+    err_code = app_sched_event_put(NULL, 0, idle_task);
+    APP_ERROR_CHECK(err_code);
+}
+
+static void idle_task(void *p_data, uint16_t size) {
+    UNUSED_PARAMETER(p_data);
+    UNUSED_PARAMETER(size);
+
+    if (!m_latency_disabled) {
+        return;
+    }
+
+    BIN_LOG_0(BIN_LOG_LATENCY_ENABLED);
+
+    latency_disable_set(false);
+}
+
+void conn_latency_host_set(uint16_t conn_handle, ble_gap_conn_params_t const *p_conn_params) {
+    if (conn_handle == m_conn_handle) {
+        return;
+    }
+
+    // Previous host is parked, it has its own slave latency.
+    latency_disable_set(false);
+
+    m_conn_handle = conn_handle;
+    m_latency_disabled = false;
+    memset(&m_stats, 0, sizeof(m_stats));
+
+    if (p_conn_params != NULL) {
+        m_stats.conn_params = *p_conn_params;
+    }
+}
+
+const conn_latency_stats_t *conn_latency_stats_get(void) {
+    return &m_stats;
+}
+
+static void ble_evt_handler(ble_evt_t const *p_ble_evt, void *p_context) {
+    UNUSED_PARAMETER(p_context);
+
+    ble_gap_evt_t const *p_gap_evt = &p_ble_evt->evt.gap_evt;
+
+    switch (p_ble_evt->header.evt_id) {
+        case BLE_GAP_EVT_CONN_PARAM_UPDATE:
+            if (p_gap_evt->conn_handle != m_conn_handle) {
+                break;
+            }
+
+            m_stats.conn_params = p_gap_evt->params.conn_param_update.conn_params;
+            m_stats.update_count++;
+
+            NRF_LOG_INFO("Host conn params; interval: %d, latency: %d, updates: %d.", m_stats.conn_params.max_conn_interval, m_stats.conn_params.slave_latency, m_stats.update_count);
+            break;
+
+        case BLE_GAP_EVT_DISCONNECTED:
+            if (p_gap_evt->conn_handle != m_conn_handle) {
+                break;
+            }
+
+            NRF_LOG_INFO("Host link; updates: %d, latency wake ups: %d.", m_stats.update_count, m_stats.disable_count);
+
+            m_conn_handle = BLE_CONN_HANDLE_INVALID;
+            m_latency_disabled = false;
+            break;
+
+        default:
+            break;
+    }
+}
@@ -0,0 +1,25 @@
+#ifndef _CONN_LATENCY_H_
+#define _CONN_LATENCY_H_
+
+#include <stdint.h>
+
+#include "ble_gap.h"
+
+/*
+ * Host link runs with slave latency while idle, skipping up to SLAVE_LATENCY connection events.
+ * Pending key edge disables slave latency, so report goes out on next connection event instead of after skipped ones.
+ * Slave latency is enabled again CONN_LATENCY_IDLE_DELAY after last key edge.
+ */
+typedef struct conn_latency_stats_s {
+    ble_gap_conn_params_t conn_params; // Last negotiated parameters.
+    uint32_t update_count;             // Parameters updates since host was set.
+    uint32_t disable_count;            // Key edges which woke up link since host was set.
+} conn_latency_stats_t;
+
+void conn_latency_init(void);
+// Follow link of current host, p_conn_params may be NULL if not known yet.
+void conn_latency_host_set(uint16_t conn_handle, ble_gap_conn_params_t const *p_conn_params);
+void conn_latency_key_edge(void);
+const conn_latency_stats_t *conn_latency_stats_get(void);
+
+#endif
@@ -4,16 +4,25 @@
 #include "app_timer.h"
 #include "app_util.h"
 
+#include "key_event.h"
+
 // BLE parameters.
-#define APP_BLE_OBSERVER_PRIO 3 // Application's BLE observer priority. You shouldn't need to modify this value.
-#define APP_BLE_CONN_CFG_TAG  1 // A tag identifying the SoftDevice BLE configuration.
+#define APP_BLE_OBSERVER_PRIO          3 // Application's BLE observer priority. You shouldn't need to modify this value.
+#define APP_BLE_CONN_CFG_TAG           1 // A tag identifying the SoftDevice BLE configuration.
+#define CONN_LATENCY_BLE_OBSERVER_PRIO 2 // Host connection latency manager's BLE observer priority.
 
 // GAP parameters.
-#define SLAVE_LATENCY    6                                // Slave latency.
-#define CONN_SUP_TIMEOUT MSEC_TO_UNITS(2000, UNIT_10_MS)  // Connection supervisory timeout (2000 ms).
+#define SLAVE_LATENCY           6                               // Slave latency, used while idle; key edge disables it on host link.
+#define CONN_LATENCY_IDLE_DELAY 200                             // In ms, time after last key edge before slave latency is used again.
+#define CONN_SUP_TIMEOUT        MSEC_TO_UNITS(2000, UNIT_10_MS) // Connection supervisory timeout (2000 ms).
 // For master.
 #define MASTER_MIN_CONN_INTERVAL MSEC_TO_UNITS(7.5, UNIT_1_25_MS) // Minimum connection interval for master part.
 #define MASTER_MAX_CONN_INTERVAL MSEC_TO_UNITS(10, UNIT_1_25_MS)  // Maximum connection interval for master part.
+// For hosts which are connected but not current, kept to switch hosts without reconnecting.
+#define PARKED_MIN_CONN_INTERVAL MSEC_TO_UNITS(100, UNIT_1_25_MS)  // Minimum connection interval for parked host.
+#define PARKED_MAX_CONN_INTERVAL MSEC_TO_UNITS(200, UNIT_1_25_MS)  // Maximum connection interval for parked host.
+#define PARKED_SLAVE_LATENCY     4                                 // Slave latency for parked host.
+#define PARKED_CONN_SUP_TIMEOUT  MSEC_TO_UNITS(6000, UNIT_10_MS)   // Supervisory timeout for parked host, must exceed (1 + latency) * interval * 2.
 // For slave.
 #define SLAVE_MIN_CONN_INTERVAL  MSEC_TO_UNITS(10, UNIT_1_25_MS)   // Minimum connection interval for slave part.
 #define SLAVE_MAX_CONN_INTERVAL  MSEC_TO_UNITS(12.5, UNIT_1_25_MS) // Maximum connection interval for slave part.
@@ -24,6 +33,7 @@
 #define MASTER_ADV_FAST_DURATION MSEC_TO_UNITS(30000, UNIT_10_MS)  // The advertising duration of fast advertising in units of 10 milliseconds.
 #define MASTER_ADV_SLOW_INTERVAL MSEC_TO_UNITS(100, UNIT_0_625_MS) // Slow advertising interval (in units of 0.625 ms. This value corresponds to 100 ms).
 #define MASTER_ADV_SLOW_DURATION MSEC_TO_UNITS(30000, UNIT_10_MS)  // The advertising duration of slow advertising in units of 10 milliseconds.
+#define RECONNECT_BACKOFF_STEPS  3                                 // Slow advertising restarts with doubled interval after timeout, then waits for key activity.
 
 // For slave.
 #define SLAVE_ADV_FAST_INTERVAL MSEC_TO_UNITS(25, UNIT_0_625_MS) // Fast advertising interval (in units of 0.625 ms. This value corresponds to 25 ms.).
@@ -33,6 +43,8 @@
 #define SCAN_INTERVAL MSEC_TO_UNITS(50, UNIT_0_625_MS) // 50 ms.
 #define SCAN_WINDOW   MSEC_TO_UNITS(30, UNIT_0_625_MS) // 30 ms.
 #define SCAN_DURATION MSEC_TO_UNITS(30000, UNIT_10_MS) // 30 seconds.
+#define SLAVE_SCAN_BACKOFF_STEPS  4                               // Scan restarts on timeout with doubled interval, up to 1/16 of SCAN_WINDOW / SCAN_INTERVAL duty.
+#define SLAVE_SCAN_BURST_DURATION MSEC_TO_UNITS(5000, UNIT_10_MS) // Scan at base duty on key activity, 5 seconds.
 
 // Connection parameters.
 #define FIRST_CONN_PARAMS_UPDATE_DELAY APP_TIMER_TICKS(3000)  // Time from initiating event (connect or start of notification) to first time sd_ble_gap_conn_param_update is called (3 seconds).
@@ -67,18 +79,47 @@
 #define DEAD_BEEF 0xDEADBEEF // Value used as error code on stack dump, can be used to identify stack location on stack unwind.
 
 // Scheduler parameters.
-#define SCHED_MAX_EVENT_DATA_SIZE APP_TIMER_SCHED_EVENT_DATA_SIZE // Maximum size of scheduler events.
+// Failed put resets keyboard or drops slave key events, so queue holds worst-case burst put before main context drains
+// it. Handled event keeps its slot until its handler returns, so a timeout and the task it puts count together. Link
+// counts are of sdk_config.h, peak use is in profiler dump.
+#define SCHED_MAX_EVENT_DATA_SIZE MAX(APP_TIMER_SCHED_EVENT_DATA_SIZE, (SLAVE_KEY_NUM + 1) * sizeof(key_event_t)) // Maximum size of scheduler events, slave key events are sent after their link.
+#define SCHED_MAIN_TIMERS         3                                                                      // Matrix scan, put again while its task waits, & key timeout.
+#define SCHED_LOW_POWER_TIMERS    1                                                                      // System OFF countdown.
+#define SCHED_CONN_LATENCY_TIMERS 1                                                                      // Slave latency idle.
+#define SCHED_CONFIG_CACHE_TIMERS 1                                                                      // Flush delay.
+#define SCHED_PROFILER_TIMERS     PROFILER_ENABLED                                                       // Dump.
+#define SCHED_SLAVE_TIMERS        NRF_SDH_BLE_CENTRAL_LINK_COUNT                                         // Resync timeout of each slave link.
+#define SCHED_TIMERS              (SCHED_MAIN_TIMERS + SCHED_LOW_POWER_TIMERS + SCHED_CONN_LATENCY_TIMERS + SCHED_CONFIG_CACHE_TIMERS + SCHED_PROFILER_TIMERS + SCHED_SLAVE_TIMERS)
+#define SCHED_TIMER_BURST         (2 * SCHED_TIMERS + NRF_SDH_BLE_PERIPHERAL_LINK_COUNT)                 // Timeouts with their task; conn params of host links.
+#define SCHED_SDH_BURST           (NRF_SDH_BLE_TOTAL_LINK_COUNT + 1)                                     // SoftDevice event polls, one per link & SoC events.
+#define SCHED_SLAVE_RX_BURST      (2 * NRF_SDH_BLE_CENTRAL_LINK_COUNT)                                   // Key index & state of each slave link, slave queues one notification.
+#define SCHED_KEY_BURST           3                                                                      // Wake scan, key translation & HID report, each queued once.
+#define SCHED_BOOT_BURST          2                                                                      // Flash data load & peers refresh.
+#define SCHED_BURST               (SCHED_TIMER_BURST + SCHED_SDH_BURST + SCHED_SLAVE_RX_BURST + SCHED_KEY_BURST + SCHED_BOOT_BURST)
 #ifdef SVCALL_AS_NORMAL_FUNCTION
-#define SCHED_QUEUE_SIZE 20 // Maximum number of events in the scheduler queue. More is needed in case of Serialization.
+#define SCHED_QUEUE_SIZE (2 * SCHED_BURST) // Maximum number of events in the scheduler queue. More is needed in case of Serialization.
 #else
-#define SCHED_QUEUE_SIZE 10 // Maximum number of events in the scheduler queue.
+#define SCHED_QUEUE_SIZE SCHED_BURST // Maximum number of events in the scheduler queue.
 #endif
 
 // Devices connection parameters.
 #define CONFIG_FILE_ID        0x41C6
 #define DEVICE_CONNECTION_KEY 0x4816
+#define SLAVE_HANDLES_KEY     0x4817
+
+// Config cache parameters, see config_cache.h.
+#define CONFIG_CACHE_RECORD_NUM       2     // Device connection & slave handles.
+#define CONFIG_CACHE_FLUSH_DELAY      30000 // In ms, longest time a change waits for idle keyboard before it is written.
+#define CONFIG_CACHE_GC_DIRTY_RECORDS 16    // Stale records which trigger garbage collection on idle.
+
+// Keymap store parameters, see keymap_store.h.
+#define KEYMAP_STORE_CHUNK_MAX           16 // In bytes, codes per upload chunk. With offset it fits default ATT MTU.
+#define KEYMAP_STORE_CHUNK_BUFFER_NUM    4  // Uploaded chunks waiting for flash write.
+#define KEYMAP_STORE_FLASH_PAGES         2  // Pages of both slots, master linker script leaves them out of FLASH.
+#define KEYMAP_SERVICE_BLE_OBSERVER_PRIO 2
 
 // Firmware parameters.
+#define DEVICE_NUM     3 // Host devices, switched by KC_DVC1..3. Each one may stay connected.
 #define KEY_NUM        20
 #define SLAVE_KEY_NUM  10
 #define HID_BUFFER_NUM 5
@@ -88,7 +129,55 @@
 #define SCAN_DELAY_TICKS     APP_TIMER_TICKS(SCAN_DELAY)
 #define KEY_PRESS_DEBOUNCE   10
 #define KEY_RELEASE_DEBOUNCE 15
-#define OPERATION_DELAY      1 // In ms, 1ms should be enough.
-#define LOW_POWER_MODE_DELAY 1000 // In ms.
+#define OPERATION_DELAY      1   // In ms, 1ms should be enough.
+#define SLAVE_RESYNC_TIMEOUT 500 // In ms, how long slave keys are held after link loss while waiting for resync.
+
+// Power tier parameters, idle time is counted from last matrix activity.
+#define SLOW_SCAN_MODE_DELAY  200  // In ms, idle time before matrix is scanned every SLOW_SCAN_DELAY.
+#define SLOW_SCAN_DELAY       24   // In ms.
+#define SLOW_SCAN_DELAY_TICKS APP_TIMER_TICKS(SLOW_SCAN_DELAY)
+#define LOW_POWER_MODE_DELAY  1000 // In ms, idle time before scan stops and matrix waits for key press.
+#define SYSTEM_OFF_MODE_DELAY 30   // In minutes, time in low power mode before System OFF, 0 disables it.
+
+// Matrix bus backend parameters, see matrix.h. Pins & expander address are in keyboard.h.
+#define MATRIX_SPIM_INSTANCE  1
+#define MATRIX_SPIM_FREQUENCY NRF_SPIM_FREQ_4M
+#define MATRIX_TWIM_INSTANCE  0 // Other peripheral ID than SPIM, so both may be used.
+#define MATRIX_TWIM_FREQUENCY NRF_TWIM_FREQ_400K
+
+// Tap-hold parameters, see tap_hold.h.
+#define TAPPING_TERM       200                             // In ms, tap-hold key held this long is hold.
+#define TAP_HOLD_POLICY    TAP_HOLD_POLICY_PERMISSIVE_HOLD // TAP_HOLD_POLICY_* flags, to decide hold before tapping term.
+#define TAP_HOLD_QUEUE_LEN 16                              // Key events held back while tap-hold key is undecided.
+
+// Combo parameters, see combo.h. Combos are defined by COMBO_DEFINE of keymap.h.
+#define COMBO_TERM 50 // In ms, keys of a combo are pressed within it.
+#define COMBO_MAX  32 // Combos of keymap, RAM of index is COMBO_BUFFER_WORDS(COMBO_MAX) words.
+
+// Log levels per module; 0 off, 1 error, 2 warning, 3 info, 4 debug. Capped by NRF_LOG_DEFAULT_LEVEL in sdk_config.
+// Logs on keystroke path go to binary log (BIN_LOG_ENABLED) instead, other debug logs compile out unless raised to 4.
+#define MAIN_LOG_LEVEL         3
+#define KB_LINK_LOG_LEVEL      3
+#define LOW_POWER_LOG_LEVEL    3
+#define CONN_LATENCY_LOG_LEVEL 3
+#define RECONNECT_LOG_LEVEL    3
+#define SLAVE_SCAN_LOG_LEVEL   3
+#define CONFIG_CACHE_LOG_LEVEL 3
+#define KEYMAP_STORE_LOG_LEVEL 3
+#define MATRIX_LOG_LEVEL       3
+
+// Profiler parameters.
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED       0     // Account CPU active time per subsystem, dump it to log & keymap service. Set by make PROFILER.
+#endif
+#define PROFILER_DUMP_INTERVAL 10000 // In ms.
+
+// Binary log parameters.
+#ifndef BIN_LOG_ENABLED
+#define BIN_LOG_ENABLED     0   // Keystroke path diagnostics as format ID & args, drained to RTT, decoded by tools/bin_log.
+#endif
+#define BIN_LOG_BUFSIZE     512 // In bytes, power of 2.
+#define BIN_LOG_RTT_CHANNEL 1   // RTT up channel, 0 is nrf_log RTT backend.
+#define BIN_LOG_RTT_BUFSIZE 256 // In bytes.
 
 #endif
@@ -1,10 +1,22 @@
+#define NRF_LOG_MODULE_NAME kb_link
+#define NRF_LOG_LEVEL       KB_LINK_LOG_LEVEL
+
 #include "kb_link.h"
 
 #include "nrf_log.h"
 
+#include "../bin_log/bin_log.h"
 #include "../firmware_config.h"
 
+NRF_LOG_MODULE_REGISTER();
+
+// Key messages are notified without MTU exchange.
+STATIC_ASSERT(KB_LINK_KEY_MSG_MAX_LEN <= BLE_GATT_ATT_MTU_DEFAULT - 3);
+
 static uint32_t key_index_characteristics_add(kb_link_t *p_kb_link, const kb_link_init_t *p_kb_link_init);
+static uint32_t key_state_characteristics_add(kb_link_t *p_kb_link);
+static uint32_t control_characteristics_add(kb_link_t *p_kb_link);
+static void on_write(kb_link_t *p_kb_link, ble_evt_t const *p_ble_evt);
 
 uint32_t kb_link_init(kb_link_t *p_kb_link, const kb_link_init_t *p_kb_link_init) {
     VERIFY_PARAM_NOT_NULL(p_kb_link);
@@ -15,6 +27,7 @@ uint32_t kb_link_init(kb_link_t *p_kb_link, const kb_link_init_t *p_kb_link_init
 
     // Initialize service structure
     p_kb_link->conn_handle = BLE_CONN_HANDLE_INVALID;
+    p_kb_link->evt_handler = p_kb_link_init->evt_handler;
 
     // Add KB link service uuid
     ble_uuid128_t base_uuid = {KB_LINK_SERVICE_BASE_UUID};
@@ -29,7 +42,15 @@ uint32_t kb_link_init(kb_link_t *p_kb_link, const kb_link_init_t *p_kb_link_init
     VERIFY_SUCCESS(err_code);
 
     // Add key index characteristics
-    return key_index_characteristics_add(p_kb_link, p_kb_link_init);
+    err_code = key_index_characteristics_add(p_kb_link, p_kb_link_init);
+    VERIFY_SUCCESS(err_code);
+
+    // Add key state characteristics
+    err_code = key_state_characteristics_add(p_kb_link);
+    VERIFY_SUCCESS(err_code);
+
+    // Add control characteristics
+    return control_characteristics_add(p_kb_link);
 }
 
 static uint32_t key_index_characteristics_add(kb_link_t *p_kb_link, const kb_link_init_t *p_kb_link_init) {
@@ -37,7 +58,7 @@ static uint32_t key_index_characteristics_add(kb_link_t *p_kb_link, const kb_lin
 
     add_char_params.uuid = KB_LINK_KEY_INDEX_CHAR_UUID;
     add_char_params.uuid_type = p_kb_link->uuid_type;
-    add_char_params.max_len = SLAVE_KEY_NUM;
+    add_char_params.max_len = KB_LINK_KEY_MSG_MAX_LEN;
     add_char_params.p_init_value = p_kb_link_init->key_index;
     add_char_params.init_len = p_kb_link_init->len;
     add_char_params.is_var_len = true;
@@ -50,6 +71,40 @@ static uint32_t key_index_characteristics_add(kb_link_t *p_kb_link, const kb_lin
     return characteristic_add(p_kb_link->service_handle, &add_char_params, &p_kb_link->key_index_char_handles);
 }
 
+// Snapshot of all keys currently held on this side, read by master after (re)connection to resync.
+static uint32_t key_state_characteristics_add(kb_link_t *p_kb_link) {
+    ble_add_char_params_t add_char_params = {0};
+
+    add_char_params.uuid = KB_LINK_KEY_STATE_CHAR_UUID;
+    add_char_params.uuid_type = p_kb_link->uuid_type;
+    add_char_params.max_len = KB_LINK_KEY_MSG_MAX_LEN;
+    add_char_params.p_init_value = NULL;
+    add_char_params.init_len = 0;
+    add_char_params.is_var_len = true;
+    add_char_params.read_access = SEC_OPEN;
+    add_char_params.write_access = SEC_NO_ACCESS;
+    add_char_params.char_props.read = 1;
+
+    return characteristic_add(p_kb_link->service_handle, &add_char_params, &p_kb_link->key_state_char_handles);
+}
+
+// Downstream channel, master writes commands (without response) to it.
+static uint32_t control_characteristics_add(kb_link_t *p_kb_link) {
+    ble_add_char_params_t add_char_params = {0};
+
+    add_char_params.uuid = KB_LINK_CONTROL_CHAR_UUID;
+    add_char_params.uuid_type = p_kb_link->uuid_type;
+    add_char_params.max_len = KB_LINK_CONTROL_MAX_LEN;
+    add_char_params.p_init_value = NULL;
+    add_char_params.init_len = 0;
+    add_char_params.is_var_len = true;
+    add_char_params.read_access = SEC_NO_ACCESS;
+    add_char_params.write_access = SEC_OPEN;
+    add_char_params.char_props.write_wo_resp = 1;
+
+    return characteristic_add(p_kb_link->service_handle, &add_char_params, &p_kb_link->control_char_handles);
+}
+
 void kb_link_on_ble_evt(ble_evt_t const *p_ble_evt, void *p_context) {
     kb_link_t *p_kb_link_service = (kb_link_t *)p_context;
 
@@ -57,7 +112,7 @@ void kb_link_on_ble_evt(ble_evt_t const *p_ble_evt, void *p_context) {
         return;
     }
 
-    NRF_LOG_INFO("KB link evt; evt: 0x%X.", p_ble_evt->header.evt_id);
+    NRF_LOG_DEBUG("KB link evt; evt: 0x%X.", p_ble_evt->header.evt_id);
 
     switch (p_ble_evt->header.evt_id) {
         case BLE_GAP_EVT_CONNECTED:
@@ -72,17 +127,33 @@ void kb_link_on_ble_evt(ble_evt_t const *p_ble_evt, void *p_context) {
             p_kb_link_service->conn_handle = BLE_CONN_HANDLE_INVALID;
             break;
 
+        case BLE_GATTS_EVT_WRITE:
+            on_write(p_kb_link_service, p_ble_evt);
+            break;
+
         default:
             // No implementation needed.
             break;
     }
 }
 
+static void on_write(kb_link_t *p_kb_link, ble_evt_t const *p_ble_evt) {
+    ble_gatts_evt_write_t const *p_evt_write = &p_ble_evt->evt.gatts_evt.params.write;
+
+    if (p_kb_link->evt_handler != NULL && p_evt_write->handle == p_kb_link->control_char_handles.value_handle && p_evt_write->len > 0) {
+        kb_link_evt_t kb_link_evt;
+
+        kb_link_evt.evt_type = KB_LINK_EVT_CONTROL;
+        kb_link_evt.p_data = p_evt_write->data;
+        kb_link_evt.len = p_evt_write->len;
+
+        p_kb_link->evt_handler(p_kb_link, &kb_link_evt);
+    }
+}
+
 uint32_t kb_link_key_index_update(kb_link_t *p_kb_link, uint8_t *p_key_index, uint8_t len) {
     VERIFY_PARAM_NOT_NULL(p_kb_link);
 
-    NRF_LOG_INFO("kb_link_key_index_update.");
-
     uint32_t err_code;
     ble_gatts_value_t gatts_value = {0};
 
@@ -102,8 +173,20 @@ uint32_t kb_link_key_index_update(kb_link_t *p_kb_link, uint8_t *p_key_index, ui
         hvx_params.p_data = gatts_value.p_value;
 
         err_code = sd_ble_gatts_hvx(p_kb_link->conn_handle, &hvx_params);
-        NRF_LOG_INFO("sd_ble_gatts_hvx; ret: 0x%X.", err_code);
+        BIN_LOG_1(BIN_LOG_KB_LINK_HVX, err_code);
     }
 
     return err_code;
 }
+
+uint32_t kb_link_key_state_update(kb_link_t *p_kb_link, uint8_t *p_key_state, uint8_t len) {
+    VERIFY_PARAM_NOT_NULL(p_kb_link);
+
+    ble_gatts_value_t gatts_value = {0};
+
+    gatts_value.len = len;
+    gatts_value.p_value = p_key_state;
+
+    // Only update the value, master reads it on demand.
+    return sd_ble_gatts_value_set(p_kb_link->conn_handle, p_kb_link->key_state_char_handles.value_handle, &gatts_value);
+}
@@ -13,9 +13,24 @@
                          kb_link_on_ble_evt,        \
                          &_name)
 
+typedef enum kb_link_evt_type_e {
+    KB_LINK_EVT_CONTROL
+} kb_link_evt_type_t;
+
+typedef struct kb_link_evt_s {
+    kb_link_evt_type_t evt_type;
+    uint8_t const *p_data;
+    uint8_t len;
+} kb_link_evt_t;
+
+typedef struct kb_link_s kb_link_t;
+
+typedef void (*kb_link_evt_handler_t)(kb_link_t *p_kb_link, kb_link_evt_t const *p_evt);
+
 typedef struct kb_link_init_s {
     uint8_t *key_index;
     uint8_t len;
+    kb_link_evt_handler_t evt_handler;
 } kb_link_init_t;
 
 typedef struct kb_link_s {
@@ -23,6 +38,9 @@ typedef struct kb_link_s {
     uint16_t service_handle;
     uint8_t uuid_type;
     ble_gatts_char_handles_t key_index_char_handles;
+    ble_gatts_char_handles_t key_state_char_handles;
+    ble_gatts_char_handles_t control_char_handles;
+    kb_link_evt_handler_t evt_handler;
 } kb_link_t;
 
 uint32_t kb_link_init(kb_link_t *p_kb_link, kb_link_init_t const *p_kb_link_init);
@@ -31,4 +49,6 @@ void kb_link_on_ble_evt(ble_evt_t const *p_ble_evt, void *p_context);
 
 uint32_t kb_link_key_index_update(kb_link_t *p_kb_link, uint8_t *p_key_index, uint8_t len);
 
+uint32_t kb_link_key_state_update(kb_link_t *p_kb_link, uint8_t *p_key_state, uint8_t len);
+
 #endif
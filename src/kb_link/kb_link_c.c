@@ -1,8 +1,19 @@
+#define NRF_LOG_MODULE_NAME kb_link_c
+#define NRF_LOG_LEVEL       KB_LINK_LOG_LEVEL
+
 #include "kb_link_c.h"
 
 #include "nrf_log.h"
 
+#include "../bin_log/bin_log.h"
+#include "../firmware_config.h"
+
+NRF_LOG_MODULE_REGISTER();
+
 static void on_hvx(kb_link_c_t *p_kb_link_c, ble_evt_t const *p_ble_evt);
+static void on_write_rsp(kb_link_c_t *p_kb_link_c, ble_evt_t const *p_ble_evt);
+static void on_read_rsp(kb_link_c_t *p_kb_link_c, ble_evt_t const *p_ble_evt);
+static void on_handles_invalid(kb_link_c_t *p_kb_link_c, ble_evt_t const *p_ble_evt);
 static uint32_t cccd_configure(uint16_t conn_handle, uint16_t cccd_handle, bool enable);
 
 uint32_t kb_link_c_init(kb_link_c_t *p_kb_link_c, kb_link_c_init_t *p_kb_link_init) {
@@ -23,6 +34,8 @@ uint32_t kb_link_c_init(kb_link_c_t *p_kb_link_c, kb_link_c_init_t *p_kb_link_in
     p_kb_link_c->evt_handler = p_kb_link_init->evt_handler;
     p_kb_link_c->handles.key_index_handle = BLE_CONN_HANDLE_INVALID;
     p_kb_link_c->handles.key_index_cccd_handle = BLE_CONN_HANDLE_INVALID;
+    p_kb_link_c->handles.key_state_handle = BLE_CONN_HANDLE_INVALID;
+    p_kb_link_c->handles.control_handle = BLE_CONN_HANDLE_INVALID;
 
     return ble_db_discovery_evt_register(&ble_uuid);
 }
@@ -42,11 +55,19 @@ void kb_link_c_on_ble_evt(ble_evt_t const *p_ble_evt, void * p_context) {
 
     switch (p_ble_evt->header.evt_id) {
         case BLE_GATTC_EVT_HVX:
-            NRF_LOG_INFO("Receive notification.");
+            BIN_LOG_0(BIN_LOG_KB_LINK_NOTIFICATION);
 
             on_hvx(p_kb_link_c, p_ble_evt);
             break;
 
+        case BLE_GATTC_EVT_WRITE_RSP:
+            on_write_rsp(p_kb_link_c, p_ble_evt);
+            break;
+
+        case BLE_GATTC_EVT_READ_RSP:
+            on_read_rsp(p_kb_link_c, p_ble_evt);
+            break;
+
         case BLE_GAP_EVT_DISCONNECTED:
             NRF_LOG_INFO("Disconnected");
 
@@ -54,6 +75,8 @@ void kb_link_c_on_ble_evt(ble_evt_t const *p_ble_evt, void * p_context) {
                 p_kb_link_c->conn_handle = BLE_CONN_HANDLE_INVALID;
                 p_kb_link_c->handles.key_index_handle = BLE_CONN_HANDLE_INVALID;
                 p_kb_link_c->handles.key_index_cccd_handle = BLE_CONN_HANDLE_INVALID;
+                p_kb_link_c->handles.key_state_handle = BLE_CONN_HANDLE_INVALID;
+                p_kb_link_c->handles.control_handle = BLE_CONN_HANDLE_INVALID;
 
                 if (p_kb_link_c->evt_handler != NULL) {
                     kb_link_c_evt_t kb_link_c_evt;
@@ -82,6 +105,57 @@ static void on_hvx(kb_link_c_t *p_kb_link_c, ble_evt_t const *p_ble_evt) {
     }
 }
 
+static void on_write_rsp(kb_link_c_t *p_kb_link_c, ble_evt_t const *p_ble_evt) {
+    if (p_kb_link_c->handles.key_index_cccd_handle != BLE_CONN_HANDLE_INVALID && p_kb_link_c->evt_handler != NULL && p_ble_evt->evt.gattc_evt.params.write_rsp.handle == p_kb_link_c->handles.key_index_cccd_handle) {
+        if (p_ble_evt->evt.gattc_evt.gatt_status != BLE_GATT_STATUS_SUCCESS) {
+            on_handles_invalid(p_kb_link_c, p_ble_evt);
+            return;
+        }
+
+        kb_link_c_evt_t kb_link_c_evt = {0};
+
+        kb_link_c_evt.evt_type = KB_LINK_C_EVT_KEY_INDEX_NOTIF_ENABLED;
+        kb_link_c_evt.conn_handle = p_ble_evt->evt.gattc_evt.conn_handle;
+
+        p_kb_link_c->evt_handler(p_kb_link_c, &kb_link_c_evt);
+    }
+}
+
+static void on_read_rsp(kb_link_c_t *p_kb_link_c, ble_evt_t const *p_ble_evt) {
+    if (p_kb_link_c->handles.key_state_handle != BLE_CONN_HANDLE_INVALID && p_kb_link_c->evt_handler != NULL && p_ble_evt->evt.gattc_evt.params.read_rsp.handle == p_kb_link_c->handles.key_state_handle) {
+        if (p_ble_evt->evt.gattc_evt.gatt_status != BLE_GATT_STATUS_SUCCESS) {
+            on_handles_invalid(p_kb_link_c, p_ble_evt);
+            return;
+        }
+
+        kb_link_c_evt_t kb_link_c_evt = {0};
+
+        kb_link_c_evt.evt_type = KB_LINK_C_EVT_KEY_STATE;
+        kb_link_c_evt.conn_handle = p_ble_evt->evt.gattc_evt.conn_handle;
+        kb_link_c_evt.len = p_ble_evt->evt.gattc_evt.params.read_rsp.len;
+        kb_link_c_evt.p_data = (uint8_t *)p_ble_evt->evt.gattc_evt.params.read_rsp.data;
+
+        p_kb_link_c->evt_handler(p_kb_link_c, &kb_link_c_evt);
+    }
+}
+
+// Peer rejected a request on an assigned handle, e.g. handles were restored from a stale cache.
+static void on_handles_invalid(kb_link_c_t *p_kb_link_c, ble_evt_t const *p_ble_evt) {
+    kb_link_c_evt_t kb_link_c_evt = {0};
+
+    NRF_LOG_INFO("Invalid handles; gatt status: 0x%X.", p_ble_evt->evt.gattc_evt.gatt_status);
+
+    p_kb_link_c->handles.key_index_handle = BLE_CONN_HANDLE_INVALID;
+    p_kb_link_c->handles.key_index_cccd_handle = BLE_CONN_HANDLE_INVALID;
+    p_kb_link_c->handles.key_state_handle = BLE_CONN_HANDLE_INVALID;
+    p_kb_link_c->handles.control_handle = BLE_CONN_HANDLE_INVALID;
+
+    kb_link_c_evt.evt_type = KB_LINK_C_EVT_HANDLES_INVALID;
+    kb_link_c_evt.conn_handle = p_ble_evt->evt.gattc_evt.conn_handle;
+
+    p_kb_link_c->evt_handler(p_kb_link_c, &kb_link_c_evt);
+}
+
 void kb_link_c_on_db_disc_evt(kb_link_c_t *p_kb_link_c, ble_db_discovery_evt_t *p_evt) {
     NRF_LOG_INFO("kb_link_c_on_db_disc_evt.");
 
@@ -98,6 +172,14 @@ void kb_link_c_on_db_disc_evt(kb_link_c_t *p_kb_link_c, ble_db_discovery_evt_t *
                     kb_link_c_evt.handles.key_index_cccd_handle = p_chars[i].cccd_handle;
                     break;
 
+                case KB_LINK_KEY_STATE_CHAR_UUID:
+                    kb_link_c_evt.handles.key_state_handle = p_chars[i].characteristic.handle_value;
+                    break;
+
+                case KB_LINK_CONTROL_CHAR_UUID:
+                    kb_link_c_evt.handles.control_handle = p_chars[i].characteristic.handle_value;
+                    break;
+
                 default:
                     break;
             }
@@ -122,6 +204,40 @@ uint32_t kb_link_c_key_index_notif_enable(kb_link_c_t *p_kb_link_c) {
     return cccd_configure(p_kb_link_c->conn_handle, p_kb_link_c->handles.key_index_cccd_handle, true);
 }
 
+uint32_t kb_link_c_key_state_read(kb_link_c_t *p_kb_link_c) {
+    VERIFY_PARAM_NOT_NULL(p_kb_link_c);
+
+    if (p_kb_link_c->conn_handle == BLE_CONN_HANDLE_INVALID || p_kb_link_c->handles.key_state_handle == BLE_CONN_HANDLE_INVALID) {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    return sd_ble_gattc_read(p_kb_link_c->conn_handle, p_kb_link_c->handles.key_state_handle, 0);
+}
+
+uint32_t kb_link_c_control_send(kb_link_c_t *p_kb_link_c, uint8_t const *p_data, uint8_t len) {
+    VERIFY_PARAM_NOT_NULL(p_kb_link_c);
+    VERIFY_PARAM_NOT_NULL(p_data);
+
+    if (p_kb_link_c->conn_handle == BLE_CONN_HANDLE_INVALID || p_kb_link_c->handles.control_handle == BLE_CONN_HANDLE_INVALID) {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    if (len > KB_LINK_CONTROL_MAX_LEN) {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+
+    ble_gattc_write_params_t const write_params = {
+        .write_op = BLE_GATT_OP_WRITE_CMD,
+        .flags = BLE_GATT_EXEC_WRITE_FLAG_PREPARED_WRITE,
+        .handle = p_kb_link_c->handles.control_handle,
+        .offset = 0,
+        .len = len,
+        .p_value = p_data
+    };
+
+    return sd_ble_gattc_write(p_kb_link_c->conn_handle, &write_params);
+}
+
 static uint32_t cccd_configure(uint16_t conn_handle, uint16_t cccd_handle, bool enable) {
     uint8_t buffer[BLE_CCCD_VALUE_LEN];
 
@@ -148,6 +264,8 @@ uint32_t kb_link_c_handles_assign(kb_link_c_t *p_kb_link_c, uint16_t conn_handle
     if (p_peer_handles != NULL) {
         p_kb_link_c->handles.key_index_handle = p_peer_handles->key_index_handle;
         p_kb_link_c->handles.key_index_cccd_handle = p_peer_handles->key_index_cccd_handle;
+        p_kb_link_c->handles.key_state_handle = p_peer_handles->key_state_handle;
+        p_kb_link_c->handles.control_handle = p_peer_handles->control_handle;
     }
 
     return NRF_SUCCESS;
@@ -14,15 +14,28 @@
                          kb_link_c_on_ble_evt,      \
                          &_name)
 
+#define KB_LINK_C_ARRAY_DEF(_name, _cnt)                 \
+    static kb_link_c_t _name[_cnt];                      \
+    NRF_SDH_BLE_OBSERVERS(_name ## _obs,                 \
+                          KB_LINK_BLE_OBSERVER_PRIO,     \
+                          kb_link_c_on_ble_evt,          \
+                          &_name,                        \
+                          _cnt)
+
 typedef enum kb_link_c_evt_type_e {
     KB_LINK_C_EVT_DISCOVERY_COMPLETE,
+    KB_LINK_C_EVT_KEY_INDEX_NOTIF_ENABLED,
     KB_LINK_C_EVT_KEY_INDEX_UPDATE,
+    KB_LINK_C_EVT_KEY_STATE,
+    KB_LINK_C_EVT_HANDLES_INVALID,
     KB_LINK_C_EVT_DISCONNECTED
 } kb_link_c_evt_type_t;
 
 typedef struct kb_link_c_handles_s {
     uint16_t key_index_handle;
     uint16_t key_index_cccd_handle;
+    uint16_t key_state_handle;
+    uint16_t control_handle;
 } kb_link_c_handles_t;
 
 typedef struct kb_link_c_evt_s {
@@ -56,6 +69,10 @@ void kb_link_c_on_db_disc_evt(kb_link_c_t *p_kb_link_c, ble_db_discovery_evt_t *
 
 uint32_t kb_link_c_key_index_notif_enable(kb_link_c_t *p_kb_link_c);
 
+uint32_t kb_link_c_key_state_read(kb_link_c_t *p_kb_link_c);
+
+uint32_t kb_link_c_control_send(kb_link_c_t *p_kb_link_c, uint8_t const *p_data, uint8_t len);
+
 uint32_t kb_link_c_handles_assign(kb_link_c_t *p_kb_link_c, uint16_t conn_handle, kb_link_c_handles_t const *p_peer_handles);
 
 #endif
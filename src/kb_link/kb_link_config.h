@@ -1,6 +1,9 @@
 #ifndef _KB_LINK_CONIFG_H_
 #define _KB_LINK_CONIFG_H_
 
+#include "keyboard.h"
+#include "../key_event.h"
+
 // Priority for KB link event in SoftDevice.
 #define KB_LINK_BLE_OBSERVER_PRIO 2
 
@@ -9,6 +12,40 @@
 
 // Service & characteristics UUIDs
 #define KB_LINK_SERVICE_UUID        0xF36B
-#define KB_LINK_KEY_INDEX_CHAR_UUID 0xC74B
+#define KB_LINK_KEY_INDEX_CHAR_UUID 0xC750 // 16-bit key events, 0xC74B had 8-bit signed key indexes.
+#define KB_LINK_KEY_STATE_CHAR_UUID 0xC751 // 16-bit key indexes, 0xC74C had 8-bit ones.
+#define KB_LINK_CONTROL_CHAR_UUID   0xC74D
+
+// Control commands, sent from master to slave. First byte is command, followed by its arguments.
+#define KB_LINK_CONTROL_CMD_STATE 0x01 // Args: active layer, host LED bits (see OUTPUT_REPORT_BIT_MASK_CAPS_LOCK).
+#define KB_LINK_CONTROL_CMD_SLEEP 0x02 // No args, enter low power mode now.
+#define KB_LINK_CONTROL_MAX_LEN   3
+
+// Key index & key state messages, up to SLAVE_KEY_NUM (firmware_config.h) key events or key indexes.
+#define KB_LINK_KEY_MSG_MAX_LEN (SLAVE_KEY_NUM * sizeof(key_event_t))
+
+// Split link transports, keyboard selects one by defining KB_LINK_TRANSPORT in keyboard.h.
+#define KB_LINK_TRANSPORT_GATT     0 // BLE, through KB link service.
+#define KB_LINK_TRANSPORT_UARTE    1 // Wired, framed over UARTE (e.g. TRRS cable). Needs NRFX_UARTE_ENABLED and no UART log backend.
+#define KB_LINK_TRANSPORT_LOOPBACK 2 // In memory pipe, frames are pumped by a host harness.
+
+#ifndef KB_LINK_TRANSPORT
+#define KB_LINK_TRANSPORT KB_LINK_TRANSPORT_GATT
+#endif
+
+#if KB_LINK_TRANSPORT == KB_LINK_TRANSPORT_GATT
+#define KB_LINK_GATT
+#endif
+
+// Frame parameters for wired & loopback transports.
+#define KB_LINK_FRAME_SYNC        0xA5
+#define KB_LINK_FRAME_PAYLOAD_MAX 20 // Fits KB_LINK_KEY_MSG_MAX_LEN.
+
+// UARTE parameters.
+#define KB_LINK_UARTE_BAUDRATE      NRF_UARTE_BAUDRATE_250000
+#define KB_LINK_UARTE_TX_QUEUE_SIZE 4
+
+// Loopback parameters.
+#define KB_LINK_LOOPBACK_QUEUE_SIZE 8
 
 #endif
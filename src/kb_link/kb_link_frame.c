@@ -0,0 +1,81 @@
+#include "kb_link_frame.h"
+
+#include <string.h>
+
+#include "crc16.h"
+#include "sdk_errors.h"
+
+uint32_t kb_link_frame_encode(uint8_t *p_frame, uint8_t msg, uint8_t const *p_data, uint8_t len) {
+    if (len > KB_LINK_FRAME_PAYLOAD_MAX) {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+
+    memset(p_frame, 0, KB_LINK_FRAME_LEN);
+
+    p_frame[0] = KB_LINK_FRAME_SYNC;
+    p_frame[1] = msg;
+    p_frame[2] = len;
+
+    if (len > 0) {
+        memcpy(&p_frame[KB_LINK_FRAME_HEADER_LEN], p_data, len);
+    }
+
+    uint16_t crc = crc16_compute(p_frame, KB_LINK_FRAME_LEN - KB_LINK_FRAME_CRC_LEN, NULL);
+
+    p_frame[KB_LINK_FRAME_LEN - 2] = crc & 0xFF;
+    p_frame[KB_LINK_FRAME_LEN - 1] = crc >> 8;
+
+    return NRF_SUCCESS;
+}
+
+bool kb_link_frame_decode(uint8_t const *p_frame, uint8_t *p_msg, uint8_t const **pp_data, uint8_t *p_len) {
+    if (p_frame[0] != KB_LINK_FRAME_SYNC || p_frame[2] > KB_LINK_FRAME_PAYLOAD_MAX) {
+        return false;
+    }
+
+    uint16_t crc = crc16_compute(p_frame, KB_LINK_FRAME_LEN - KB_LINK_FRAME_CRC_LEN, NULL);
+
+    if (p_frame[KB_LINK_FRAME_LEN - 2] != (crc & 0xFF) || p_frame[KB_LINK_FRAME_LEN - 1] != (crc >> 8)) {
+        return false;
+    }
+
+    *p_msg = p_frame[1];
+    *p_len = p_frame[2];
+    *pp_data = &p_frame[KB_LINK_FRAME_HEADER_LEN];
+
+    return true;
+}
+
+void kb_link_frame_rx_reset(kb_link_frame_rx_t *p_rx) {
+    p_rx->len = 0;
+}
+
+uint8_t *kb_link_frame_rx_next(kb_link_frame_rx_t *p_rx, uint8_t *p_len) {
+    *p_len = p_rx->len == 0 ? 1 : KB_LINK_FRAME_LEN - p_rx->len;
+
+    return &p_rx->frame[p_rx->len];
+}
+
+bool kb_link_frame_rx_done(kb_link_frame_rx_t *p_rx, uint8_t *p_msg, uint8_t const **pp_data, uint8_t *p_len) {
+    if (p_rx->len == 0) {
+        p_rx->len = p_rx->frame[0] == KB_LINK_FRAME_SYNC ? 1 : 0;
+        return false;
+    }
+
+    p_rx->len = 0;
+
+    if (kb_link_frame_decode(p_rx->frame, p_msg, pp_data, p_len)) {
+        return true;
+    }
+
+    // Frame is broken, e.g. a byte was lost and it ran into next frame, whose sync byte may be in it.
+    for (uint8_t i = 1; i < KB_LINK_FRAME_LEN; i++) {
+        if (p_rx->frame[i] == KB_LINK_FRAME_SYNC) {
+            p_rx->len = KB_LINK_FRAME_LEN - i;
+            memmove(p_rx->frame, &p_rx->frame[i], p_rx->len);
+            break;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,36 @@
+#ifndef _KB_LINK_FRAME_H_
+#define _KB_LINK_FRAME_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "kb_link_config.h"
+
+/*
+ * Fixed size frame used by wired transports.
+ * | sync | msg | len | payload (KB_LINK_FRAME_PAYLOAD_MAX) | crc16 (little endian) |
+ */
+#define KB_LINK_FRAME_HEADER_LEN 3
+#define KB_LINK_FRAME_CRC_LEN    2
+#define KB_LINK_FRAME_LEN        (KB_LINK_FRAME_HEADER_LEN + KB_LINK_FRAME_PAYLOAD_MAX + KB_LINK_FRAME_CRC_LEN)
+
+/*
+ * Receiver of wired transports, it hunts for sync byte alone, then takes rest of frame in one transfer. Frame that
+ * fails to decode is searched for a later sync byte, so a lost byte costs little more than the frame it belongs to.
+ */
+typedef struct kb_link_frame_rx_s {
+    uint8_t frame[KB_LINK_FRAME_LEN];
+    uint8_t len; // Bytes of frame received, 0 while hunting.
+} kb_link_frame_rx_t;
+
+uint32_t kb_link_frame_encode(uint8_t *p_frame, uint8_t msg, uint8_t const *p_data, uint8_t len);
+
+bool kb_link_frame_decode(uint8_t const *p_frame, uint8_t *p_msg, uint8_t const **pp_data, uint8_t *p_len);
+
+void kb_link_frame_rx_reset(kb_link_frame_rx_t *p_rx);
+// Buffer & length of next receive transfer.
+uint8_t *kb_link_frame_rx_next(kb_link_frame_rx_t *p_rx, uint8_t *p_len);
+// Next receive transfer is done, true with decoded frame once one is complete. Data is valid until next transfer.
+bool kb_link_frame_rx_done(kb_link_frame_rx_t *p_rx, uint8_t *p_msg, uint8_t const **pp_data, uint8_t *p_len);
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef _KB_LINK_TRANSPORT_H_
+#define _KB_LINK_TRANSPORT_H_
+
+#include <stdint.h>
+
+#include "kb_link_config.h"
+
+/*
+ * Transport of the split link. Halves only exchange messages through this interface,
+ * backend is selected at build time by KB_LINK_TRANSPORT.
+ */
+typedef enum kb_link_msg_e {
+    KB_LINK_MSG_KEY_INDEX = 1, // Slave to master, key events of changed keys.
+    KB_LINK_MSG_KEY_STATE,     // Slave to master, key indexes of held keys.
+    KB_LINK_MSG_CONTROL,       // Master to slave, control command.
+    KB_LINK_MSG_HELLO = 0x80   // Wired & loopback backends, half booted; never passed to handler.
+} kb_link_msg_t;
+
+typedef enum kb_link_transport_evt_type_e {
+    KB_LINK_TRANSPORT_EVT_CONNECTED,
+    KB_LINK_TRANSPORT_EVT_DISCONNECTED,
+    KB_LINK_TRANSPORT_EVT_RX
+} kb_link_transport_evt_type_t;
+
+typedef struct kb_link_transport_evt_s {
+    kb_link_transport_evt_type_t evt_type;
+    uint8_t link; // Index of link on master (0 to SLAVE_NUM - 1), always 0 on slave.
+    kb_link_msg_t msg;
+    uint8_t const *p_data;
+    uint8_t len;
+} kb_link_transport_evt_t;
+
+typedef void (*kb_link_transport_evt_handler_t)(kb_link_transport_evt_t const *p_evt);
+
+typedef struct kb_link_transport_s {
+    uint32_t (*init)(void *p_context, kb_link_transport_evt_handler_t evt_handler);
+    uint32_t (*send)(uint8_t link, kb_link_msg_t msg, uint8_t const *p_data, uint8_t len);
+} kb_link_transport_t;
+
+extern const kb_link_transport_t kb_link_transport_gatt;
+extern const kb_link_transport_t kb_link_transport_uarte;
+extern const kb_link_transport_t kb_link_transport_loopback;
+
+#if KB_LINK_TRANSPORT == KB_LINK_TRANSPORT_UARTE
+#define KB_LINK_TRANSPORT_INSTANCE kb_link_transport_uarte
+#elif KB_LINK_TRANSPORT == KB_LINK_TRANSPORT_LOOPBACK
+#define KB_LINK_TRANSPORT_INSTANCE kb_link_transport_loopback
+#else
+#define KB_LINK_TRANSPORT_INSTANCE kb_link_transport_gatt
+#endif
+
+// GATT backend, fed with events of KB link service (slave) or KB link clients (master).
+// On master, context is array of SLAVE_NUM clients and link is index of client in it.
+struct kb_link_evt_s;
+struct kb_link_c_s;
+struct kb_link_c_evt_s;
+
+void kb_link_transport_gatt_on_kbl_evt(struct kb_link_evt_s const *p_evt);
+void kb_link_transport_gatt_on_kbl_c_evt(struct kb_link_c_s const *p_kb_link_c, struct kb_link_c_evt_s const *p_evt);
+
+// Wired & loopback backends only have link 0. They send hello at init, hello from a half already connected means it
+// was reset, it comes out as disconnect & connect, so halves resync.
+// Loopback backend, host harness moves frames between both halves, as whole frames or as bytes off a wire.
+uint32_t kb_link_transport_loopback_fetch(uint8_t *p_frame);
+uint32_t kb_link_transport_loopback_inject(uint8_t const *p_frame);
+void kb_link_transport_loopback_inject_bytes(uint8_t const *p_data, uint32_t len);
+void kb_link_transport_loopback_disconnect(void);
+
+#endif
@@ -0,0 +1,116 @@
+#include "kb_link_transport.h"
+
+#include "sdk_macros.h"
+
+#include "keyboard.h"
+
+#ifdef MASTER
+#include "kb_link_c.h"
+
+static kb_link_c_t *m_p_kb_link_c; // Array of SLAVE_NUM clients.
+#endif
+
+#ifdef SLAVE
+#include "kb_link.h"
+
+static kb_link_t *m_p_kb_link;
+#endif
+
+static kb_link_transport_evt_handler_t m_evt_handler;
+
+static uint32_t gatt_init(void *p_context, kb_link_transport_evt_handler_t evt_handler) {
+    VERIFY_PARAM_NOT_NULL(p_context);
+
+#ifdef MASTER
+    m_p_kb_link_c = (kb_link_c_t *)p_context;
+#endif
+#ifdef SLAVE
+    m_p_kb_link = (kb_link_t *)p_context;
+#endif
+    m_evt_handler = evt_handler;
+
+    return NRF_SUCCESS;
+}
+
+static uint32_t gatt_send(uint8_t link, kb_link_msg_t msg, uint8_t const *p_data, uint8_t len) {
+#ifdef MASTER
+    if (link >= SLAVE_NUM) {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+#else
+    if (link != 0) {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+#endif
+
+    switch (msg) {
+#ifdef MASTER
+        case KB_LINK_MSG_CONTROL:
+            return kb_link_c_control_send(&m_p_kb_link_c[link], p_data, len);
+#endif
+#ifdef SLAVE
+        case KB_LINK_MSG_KEY_INDEX:
+            return kb_link_key_index_update(m_p_kb_link, (uint8_t *)p_data, len);
+
+        case KB_LINK_MSG_KEY_STATE:
+            return kb_link_key_state_update(m_p_kb_link, (uint8_t *)p_data, len);
+#endif
+
+        default:
+            return NRF_ERROR_NOT_SUPPORTED;
+    }
+}
+
+static void evt_send(kb_link_transport_evt_type_t evt_type, uint8_t link, kb_link_msg_t msg, uint8_t const *p_data, uint8_t len) {
+    if (m_evt_handler != NULL) {
+        kb_link_transport_evt_t evt;
+
+        evt.evt_type = evt_type;
+        evt.link = link;
+        evt.msg = msg;
+        evt.p_data = p_data;
+        evt.len = len;
+
+        m_evt_handler(&evt);
+    }
+}
+
+#ifdef SLAVE
+void kb_link_transport_gatt_on_kbl_evt(kb_link_evt_t const *p_evt) {
+    if (p_evt->evt_type == KB_LINK_EVT_CONTROL) {
+        evt_send(KB_LINK_TRANSPORT_EVT_RX, 0, KB_LINK_MSG_CONTROL, p_evt->p_data, p_evt->len);
+    }
+}
+#endif
+
+#ifdef MASTER
+void kb_link_transport_gatt_on_kbl_c_evt(kb_link_c_t const *p_kb_link_c, kb_link_c_evt_t const *p_evt) {
+    uint8_t link = p_kb_link_c - m_p_kb_link_c;
+
+    switch (p_evt->evt_type) {
+        case KB_LINK_C_EVT_KEY_INDEX_NOTIF_ENABLED:
+            evt_send(KB_LINK_TRANSPORT_EVT_CONNECTED, link, 0, NULL, 0);
+            break;
+
+        case KB_LINK_C_EVT_KEY_INDEX_UPDATE:
+            evt_send(KB_LINK_TRANSPORT_EVT_RX, link, KB_LINK_MSG_KEY_INDEX, p_evt->p_data, p_evt->len);
+            break;
+
+        case KB_LINK_C_EVT_KEY_STATE:
+            evt_send(KB_LINK_TRANSPORT_EVT_RX, link, KB_LINK_MSG_KEY_STATE, p_evt->p_data, p_evt->len);
+            break;
+
+        case KB_LINK_C_EVT_DISCONNECTED:
+            evt_send(KB_LINK_TRANSPORT_EVT_DISCONNECTED, link, 0, NULL, 0);
+            break;
+
+        default:
+            break;
+    }
+}
+#endif
+
+const kb_link_transport_t kb_link_transport_gatt = {
+    .init = gatt_init,
+    .send = gatt_send
+};
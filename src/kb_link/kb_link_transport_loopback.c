@@ -0,0 +1,152 @@
+#include "kb_link_transport.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "sdk_errors.h"
+
+#include "kb_link_frame.h"
+
+/*
+ * Sent frames wait in an outbox until fetched, received frames are injected. Nothing here touches hardware,
+ * so a host harness can pump frames between master and slave built for the host and time them
+ * (tools/kb_link_bench). Bytes are injected through the same receiver as UARTE backend.
+ */
+static kb_link_transport_evt_handler_t m_evt_handler;
+static bool m_connected = false;
+static kb_link_frame_rx_t m_rx;
+
+static uint8_t m_outbox[KB_LINK_LOOPBACK_QUEUE_SIZE][KB_LINK_FRAME_LEN];
+static uint8_t m_outbox_start = 0;
+static uint8_t m_outbox_count = 0;
+
+static uint32_t loopback_send(uint8_t link, kb_link_msg_t msg, uint8_t const *p_data, uint8_t len);
+
+static uint32_t loopback_init(void *p_context, kb_link_transport_evt_handler_t evt_handler) {
+    (void)p_context;
+
+    m_evt_handler = evt_handler;
+    m_connected = false;
+    m_outbox_start = 0;
+    m_outbox_count = 0;
+    kb_link_frame_rx_reset(&m_rx);
+
+    return loopback_send(0, KB_LINK_MSG_HELLO, NULL, 0);
+}
+
+static uint32_t loopback_send(uint8_t link, kb_link_msg_t msg, uint8_t const *p_data, uint8_t len) {
+    if (link != 0) {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    if (m_outbox_count >= KB_LINK_LOOPBACK_QUEUE_SIZE) {
+        return NRF_ERROR_RESOURCES;
+    }
+
+    uint32_t err_code = kb_link_frame_encode(m_outbox[(m_outbox_start + m_outbox_count) % KB_LINK_LOOPBACK_QUEUE_SIZE], msg, p_data, len);
+
+    if (err_code == NRF_SUCCESS) {
+        m_outbox_count++;
+    }
+
+    return err_code;
+}
+
+uint32_t kb_link_transport_loopback_fetch(uint8_t *p_frame) {
+    if (m_outbox_count == 0) {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    memcpy(p_frame, m_outbox[m_outbox_start], KB_LINK_FRAME_LEN);
+
+    m_outbox_count--;
+    m_outbox_start = (m_outbox_start + 1) % KB_LINK_LOOPBACK_QUEUE_SIZE;
+
+    return NRF_SUCCESS;
+}
+
+static void on_frame(uint8_t msg, uint8_t const *p_data, uint8_t len) {
+    kb_link_transport_evt_t evt = {0};
+
+    if (m_evt_handler == NULL) {
+        return;
+    }
+
+    if (m_connected && msg == KB_LINK_MSG_HELLO) {
+        m_connected = false;
+
+        evt.evt_type = KB_LINK_TRANSPORT_EVT_DISCONNECTED;
+        m_evt_handler(&evt);
+    }
+
+    if (!m_connected) {
+        m_connected = true;
+
+        evt.evt_type = KB_LINK_TRANSPORT_EVT_CONNECTED;
+        m_evt_handler(&evt);
+    }
+
+    if (msg != KB_LINK_MSG_HELLO) {
+        evt.evt_type = KB_LINK_TRANSPORT_EVT_RX;
+        evt.msg = (kb_link_msg_t)msg;
+        evt.p_data = p_data;
+        evt.len = len;
+
+        m_evt_handler(&evt);
+    }
+}
+
+uint32_t kb_link_transport_loopback_inject(uint8_t const *p_frame) {
+    uint8_t msg;
+    uint8_t len;
+    uint8_t const *p_data;
+
+    if (!kb_link_frame_decode(p_frame, &msg, &p_data, &len)) {
+        return NRF_ERROR_INVALID_DATA;
+    }
+
+    on_frame(msg, p_data, len);
+
+    return NRF_SUCCESS;
+}
+
+void kb_link_transport_loopback_inject_bytes(uint8_t const *p_data, uint32_t len) {
+    while (len > 0) {
+        uint8_t msg;
+        uint8_t frame_len;
+        uint8_t const *p_frame_data;
+        uint8_t want;
+        uint8_t *p_buf = kb_link_frame_rx_next(&m_rx, &want);
+
+        if (want > len) {
+            // Transfer isn't done yet, rest of it comes with next bytes.
+            memcpy(p_buf, p_data, len);
+            m_rx.len += len;
+            return;
+        }
+
+        memcpy(p_buf, p_data, want);
+        p_data += want;
+        len -= want;
+
+        if (kb_link_frame_rx_done(&m_rx, &msg, &p_frame_data, &frame_len)) {
+            on_frame(msg, p_frame_data, frame_len);
+        }
+    }
+}
+
+void kb_link_transport_loopback_disconnect(void) {
+    if (m_connected && m_evt_handler != NULL) {
+        kb_link_transport_evt_t evt = {0};
+
+        m_connected = false;
+
+        evt.evt_type = KB_LINK_TRANSPORT_EVT_DISCONNECTED;
+        m_evt_handler(&evt);
+    }
+}
+
+const kb_link_transport_t kb_link_transport_loopback = {
+    .init = loopback_init,
+    .send = loopback_send
+};
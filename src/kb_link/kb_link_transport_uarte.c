@@ -0,0 +1,184 @@
+#define NRF_LOG_MODULE_NAME kb_link_uarte
+#define NRF_LOG_LEVEL       KB_LINK_LOG_LEVEL
+
+#include "kb_link_transport.h"
+
+#if KB_LINK_TRANSPORT == KB_LINK_TRANSPORT_UARTE
+
+#include "app_util_platform.h"
+#include "nrf_log.h"
+#include "nrfx_uarte.h"
+#include "sdk_macros.h"
+
+#include "keyboard.h"
+#include "../firmware_config.h"
+#include "kb_link_frame.h"
+
+NRF_LOG_MODULE_REGISTER();
+
+#if NRF_LOG_BACKEND_UART_ENABLED
+#error "UARTE is used by KB link, disable NRF_LOG_BACKEND_UART_ENABLED."
+#endif
+
+STATIC_ASSERT(KB_LINK_KEY_MSG_MAX_LEN <= KB_LINK_FRAME_PAYLOAD_MAX);
+
+/*
+ * Receiving alternates between hunting for the sync byte (1 byte transfer) and receiving the rest of the frame
+ * in a single DMA transfer, see kb_link_frame_rx_t.
+ */
+static const nrfx_uarte_t m_uarte = NRFX_UARTE_INSTANCE(0);
+static kb_link_transport_evt_handler_t m_evt_handler;
+static bool m_connected = false;
+
+static kb_link_frame_rx_t m_rx;
+
+static uint8_t m_tx_frames[KB_LINK_UARTE_TX_QUEUE_SIZE][KB_LINK_FRAME_LEN];
+static uint8_t m_tx_start = 0;
+static uint8_t m_tx_count = 0;
+static bool m_tx_busy = false;
+
+static void uarte_evt_handler(nrfx_uarte_event_t const *p_event, void *p_context);
+static uint32_t uarte_send(uint8_t link, kb_link_msg_t msg, uint8_t const *p_data, uint8_t len);
+static void rx_next(void);
+static void tx_next(void);
+
+static uint32_t uarte_init(void *p_context, kb_link_transport_evt_handler_t evt_handler) {
+    UNUSED_PARAMETER(p_context);
+
+    ret_code_t err_code;
+    nrfx_uarte_config_t config = NRFX_UARTE_DEFAULT_CONFIG;
+
+    NRF_LOG_INFO("KB link UARTE init.");
+
+    m_evt_handler = evt_handler;
+    m_connected = false;
+
+    config.pseltxd = KB_LINK_UARTE_TX_PIN;
+    config.pselrxd = KB_LINK_UARTE_RX_PIN;
+    config.baudrate = KB_LINK_UARTE_BAUDRATE;
+
+    err_code = nrfx_uarte_init(&m_uarte, &config, uarte_evt_handler);
+    VERIFY_SUCCESS(err_code);
+
+    kb_link_frame_rx_reset(&m_rx);
+    rx_next();
+
+    // Other half may be connected from before this half was reset, hello makes it resync.
+    return uarte_send(0, KB_LINK_MSG_HELLO, NULL, 0);
+}
+
+static uint32_t uarte_send(uint8_t link, kb_link_msg_t msg, uint8_t const *p_data, uint8_t len) {
+    uint32_t err_code = NRF_SUCCESS;
+
+    if (link != 0) {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    CRITICAL_REGION_ENTER();
+
+    if (m_tx_count < KB_LINK_UARTE_TX_QUEUE_SIZE) {
+        uint8_t end = (m_tx_start + m_tx_count) % KB_LINK_UARTE_TX_QUEUE_SIZE;
+
+        err_code = kb_link_frame_encode(m_tx_frames[end], msg, p_data, len);
+
+        if (err_code == NRF_SUCCESS) {
+            m_tx_count++;
+
+            if (!m_tx_busy) {
+                tx_next();
+            }
+        }
+    } else {
+        err_code = NRF_ERROR_RESOURCES;
+    }
+
+    CRITICAL_REGION_EXIT();
+
+    return err_code;
+}
+
+static void tx_next(void) {
+    if (m_tx_count > 0 && nrfx_uarte_tx(&m_uarte, m_tx_frames[m_tx_start], KB_LINK_FRAME_LEN) == NRFX_SUCCESS) {
+        m_tx_busy = true;
+    }
+}
+
+static void rx_next(void) {
+    uint8_t len;
+    uint8_t *p_buf = kb_link_frame_rx_next(&m_rx, &len);
+
+    APP_ERROR_CHECK(nrfx_uarte_rx(&m_uarte, p_buf, len));
+}
+
+static void on_rx_done(void) {
+    uint8_t msg;
+    uint8_t len;
+    uint8_t const *p_data;
+
+    if (kb_link_frame_rx_done(&m_rx, &msg, &p_data, &len) && m_evt_handler != NULL) {
+        kb_link_transport_evt_t evt = {0};
+
+        if (m_connected && msg == KB_LINK_MSG_HELLO) {
+            // Other half was reset, state it had is gone.
+            m_connected = false;
+
+            evt.evt_type = KB_LINK_TRANSPORT_EVT_DISCONNECTED;
+            m_evt_handler(&evt);
+        }
+
+        if (!m_connected) {
+            // Wire has no connection procedure, first valid frame means the other half is up.
+            m_connected = true;
+
+            evt.evt_type = KB_LINK_TRANSPORT_EVT_CONNECTED;
+            m_evt_handler(&evt);
+        }
+
+        if (msg != KB_LINK_MSG_HELLO) {
+            evt.evt_type = KB_LINK_TRANSPORT_EVT_RX;
+            evt.msg = (kb_link_msg_t)msg;
+            evt.p_data = p_data;
+            evt.len = len;
+
+            // Handler must consume data before returning, buffer is reused for next frame.
+            m_evt_handler(&evt);
+        }
+    }
+
+    rx_next();
+}
+
+static void uarte_evt_handler(nrfx_uarte_event_t const *p_event, void *p_context) {
+    UNUSED_PARAMETER(p_context);
+
+    switch (p_event->type) {
+        case NRFX_UARTE_EVT_RX_DONE:
+            on_rx_done();
+            break;
+
+        case NRFX_UARTE_EVT_TX_DONE:
+            m_tx_busy = false;
+            m_tx_count--;
+            m_tx_start = (m_tx_start + 1) % KB_LINK_UARTE_TX_QUEUE_SIZE;
+
+            tx_next();
+            break;
+
+        case NRFX_UARTE_EVT_ERROR:
+            NRF_LOG_INFO("KB link UARTE error; mask: 0x%X.", p_event->data.error.error_mask);
+
+            kb_link_frame_rx_reset(&m_rx);
+            rx_next();
+            break;
+
+        default:
+            break;
+    }
+}
+
+const kb_link_transport_t kb_link_transport_uarte = {
+    .init = uarte_init,
+    .send = uarte_send
+};
+
+#endif
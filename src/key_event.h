@@ -0,0 +1,22 @@
+#ifndef _KEY_EVENT_H_
+#define _KEY_EVENT_H_
+
+#include <stdint.h>
+
+/*
+ * Key index & key event, carried from matrix through KB link to translation.
+ * Key index is 1 based key position in keymap layer, numbered across all halves by MATRIX_DEFINE, 0 is no key.
+ * Key event is key index with edge flag in top bit, so press & release of every position fit 16 bits.
+ * On KB link, key events and key indexes are sent as arrays of little endian 16-bit words.
+ */
+typedef uint16_t key_index_t;
+typedef uint16_t key_event_t;
+
+#define KEY_INDEX_MAX     0x7FFF
+#define KEY_EVENT_RELEASE 0x8000
+
+#define KEY_EVENT(index, is_press) ((key_event_t)((index) | ((is_press) ? 0 : KEY_EVENT_RELEASE)))
+#define KEY_EVENT_INDEX(event)     ((key_index_t)((event) & KEY_INDEX_MAX))
+#define KEY_EVENT_IS_PRESS(event)  (((event) & KEY_EVENT_RELEASE) == 0)
+
+#endif
@@ -21,6 +21,13 @@
 #define IS_LAYER(code) (KC_LAYER_BASE <= (code) && (code) <= KC_LAYER_F)
 #define LAYER(code)    ((code) - KC_LAYER_BASE)
 
+// Tap-hold keys, tap sends key code, hold applies modifiers (MT) or layer (LT) until release. Decided by tap_hold.h.
+#define MT(mod_code, code)   (KC_MOD_TAP | (mod_code) | (code))
+#define LT(layer_code, code) (KC_LAYER_TAP | ((layer_code) << 8) | (code))
+#define IS_TAP_HOLD(code)    (((code) & (KC_MOD_TAP | KC_LAYER_TAP)) != 0)
+#define TAP_CODE(code)       ((code) & 0xFF)
+#define HOLD_CODE(code)      (((code) & KC_LAYER_TAP) ? ((code) >> 8) & 0xFF : (code) & 0xFF00) // Layer or modifier code.
+
 /*
  * Short names for ease of definition of keymap
  */
@@ -430,6 +437,12 @@ enum special_keycodes {
     KC_LAYER_F,
 };
 
+// Tap-hold keycodes, flags above modifiers of key code.
+enum tap_hold_keycodes {
+    KC_MOD_TAP   = 0x10000,
+    KC_LAYER_TAP = 0x20000,
+};
+
 // Modifier keycodes
 enum modifier_keycodes {
     /*
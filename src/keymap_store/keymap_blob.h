@@ -0,0 +1,30 @@
+#ifndef _KEYMAP_BLOB_H_
+#define _KEYMAP_BLOB_H_
+
+#include <stdint.h>
+
+#include "keyboard.h"
+
+/*
+ * Keymap blob, as produced by host tool (tools/keymap_compiler) and stored in flash.
+ * Header is followed by layer_num layers of KEYMAP_KEY_NUM codes, all little endian.
+ * Shared with host tool, so only plain C here.
+ */
+#define KEYMAP_BLOB_MAGIC   0x4B4D4150 // "KMAP".
+#define KEYMAP_BLOB_VERSION 2
+#define KEYMAP_KEY_NUM      KEY_POSITION_NUM // Codes per layer, key positions of all halves.
+#define KEYMAP_LAYER_MAX    16               // Layers reachable through KC_L1..KC_LF.
+
+// Header fits one ATT write with its command byte. Version 1 had 16-bit version and 8-bit key_num.
+typedef struct keymap_blob_header_s {
+    uint8_t version;    // KEYMAP_BLOB_VERSION.
+    uint8_t layer_num;
+    uint16_t key_num;   // KEYMAP_KEY_NUM of keyboard blob was built for.
+    uint32_t crc;       // CRC32 of codes.
+    uint32_t sequence;  // Set by firmware on commit, newer blob has higher sequence.
+    uint32_t magic;     // KEYMAP_BLOB_MAGIC, written last so torn header is never valid.
+} keymap_blob_header_t;
+
+#define KEYMAP_BLOB_SIZE(layer_num) (sizeof(keymap_blob_header_t) + (layer_num) * KEYMAP_KEY_NUM * sizeof(uint32_t))
+
+#endif
@@ -0,0 +1,243 @@
+#define NRF_LOG_MODULE_NAME keymap_service
+#define NRF_LOG_LEVEL       KEYMAP_STORE_LOG_LEVEL
+
+#include "keymap_service.h"
+
+#include <string.h>
+
+#include "app_util.h"
+#include "nrf_log.h"
+
+#include "keymap_store.h"
+
+NRF_LOG_MODULE_REGISTER();
+
+static uint32_t control_characteristics_add(keymap_service_t *p_keymap_service);
+static uint32_t data_characteristics_add(keymap_service_t *p_keymap_service);
+#if PROFILER_ENABLED
+static uint32_t profiler_characteristics_add(keymap_service_t *p_keymap_service);
+#endif
+static void on_rw_authorize_request(keymap_service_t *p_keymap_service, ble_evt_t const *p_ble_evt);
+static keymap_store_status_t on_control(ble_gatts_evt_write_t const *p_evt_write);
+static keymap_store_status_t on_data(ble_gatts_evt_write_t const *p_evt_write);
+
+uint32_t keymap_service_init(keymap_service_t *p_keymap_service) {
+    VERIFY_PARAM_NOT_NULL(p_keymap_service);
+
+    uint32_t err_code;
+    ble_uuid_t ble_uuid;
+
+    // Initialize service structure
+    p_keymap_service->conn_handle = BLE_CONN_HANDLE_INVALID;
+
+    // Add keymap service uuid
+    ble_uuid128_t base_uuid = {KEYMAP_SERVICE_BASE_UUID};
+    err_code = sd_ble_uuid_vs_add(&base_uuid, &p_keymap_service->uuid_type);
+    VERIFY_SUCCESS(err_code);
+
+    ble_uuid.type = p_keymap_service->uuid_type;
+    ble_uuid.uuid = KEYMAP_SERVICE_UUID;
+
+    // Add keymap service
+    err_code = sd_ble_gatts_service_add(BLE_GATTS_SRVC_TYPE_PRIMARY, &ble_uuid, &p_keymap_service->service_handle);
+    VERIFY_SUCCESS(err_code);
+
+    // Add control characteristics
+    err_code = control_characteristics_add(p_keymap_service);
+    VERIFY_SUCCESS(err_code);
+
+    // Add data characteristics
+    err_code = data_characteristics_add(p_keymap_service);
+    VERIFY_SUCCESS(err_code);
+
+#if PROFILER_ENABLED
+    // Add profiler characteristics
+    err_code = profiler_characteristics_add(p_keymap_service);
+    VERIFY_SUCCESS(err_code);
+#endif
+
+    return NRF_SUCCESS;
+}
+
+// Writes are authorized, so store status goes back in write response. Bonded hosts only.
+static uint32_t control_characteristics_add(keymap_service_t *p_keymap_service) {
+    ble_add_char_params_t add_char_params = {0};
+
+    add_char_params.uuid = KEYMAP_CONTROL_CHAR_UUID;
+    add_char_params.uuid_type = p_keymap_service->uuid_type;
+    add_char_params.max_len = KEYMAP_CONTROL_MAX_LEN;
+    add_char_params.p_init_value = NULL;
+    add_char_params.init_len = 0;
+    add_char_params.is_var_len = true;
+    add_char_params.is_defered_write = true;
+    add_char_params.read_access = SEC_NO_ACCESS;
+    add_char_params.write_access = SEC_JUST_WORKS;
+    add_char_params.cccd_write_access = SEC_JUST_WORKS;
+    add_char_params.char_props.write = 1;
+    add_char_params.char_props.notify = 1;
+
+    return characteristic_add(p_keymap_service->service_handle, &add_char_params, &p_keymap_service->control_char_handles);
+}
+
+static uint32_t data_characteristics_add(keymap_service_t *p_keymap_service) {
+    ble_add_char_params_t add_char_params = {0};
+
+    add_char_params.uuid = KEYMAP_DATA_CHAR_UUID;
+    add_char_params.uuid_type = p_keymap_service->uuid_type;
+    add_char_params.max_len = KEYMAP_DATA_MAX_LEN;
+    add_char_params.p_init_value = NULL;
+    add_char_params.init_len = 0;
+    add_char_params.is_var_len = true;
+    add_char_params.is_defered_write = true;
+    add_char_params.read_access = SEC_NO_ACCESS;
+    add_char_params.write_access = SEC_JUST_WORKS;
+    add_char_params.char_props.write = 1;
+
+    return characteristic_add(p_keymap_service->service_handle, &add_char_params, &p_keymap_service->data_char_handles);
+}
+
+#if PROFILER_ENABLED
+// Value is kept by SoftDevice, so long reads of packed counters need no authorization round trip.
+static uint32_t profiler_characteristics_add(keymap_service_t *p_keymap_service) {
+    ble_add_char_params_t add_char_params = {0};
+
+    add_char_params.uuid = KEYMAP_PROFILER_CHAR_UUID;
+    add_char_params.uuid_type = p_keymap_service->uuid_type;
+    add_char_params.max_len = KEYMAP_PROFILER_MAX_LEN;
+    add_char_params.p_init_value = NULL;
+    add_char_params.init_len = 0;
+    add_char_params.is_var_len = true;
+    add_char_params.read_access = SEC_JUST_WORKS;
+    add_char_params.write_access = SEC_NO_ACCESS;
+    add_char_params.char_props.read = 1;
+
+    return characteristic_add(p_keymap_service->service_handle, &add_char_params, &p_keymap_service->profiler_char_handles);
+}
+#endif
+
+void keymap_service_on_ble_evt(ble_evt_t const *p_ble_evt, void *p_context) {
+    keymap_service_t *p_keymap_service = (keymap_service_t *)p_context;
+
+    if (p_ble_evt == NULL || p_keymap_service == NULL) {
+        return;
+    }
+
+    switch (p_ble_evt->header.evt_id) {
+        case BLE_GAP_EVT_DISCONNECTED:
+            if (p_ble_evt->evt.gap_evt.conn_handle == p_keymap_service->conn_handle) {
+                // Host left in the middle of upload, keep active keymap.
+                keymap_store_upload_abort();
+
+                p_keymap_service->conn_handle = BLE_CONN_HANDLE_INVALID;
+            }
+            break;
+
+        case BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST:
+            on_rw_authorize_request(p_keymap_service, p_ble_evt);
+            break;
+
+        default:
+            // No implementation needed.
+            break;
+    }
+}
+
+static void on_rw_authorize_request(keymap_service_t *p_keymap_service, ble_evt_t const *p_ble_evt) {
+    uint32_t err_code;
+    ble_gatts_evt_rw_authorize_request_t const *p_request = &p_ble_evt->evt.gatts_evt.params.authorize_request;
+    ble_gatts_evt_write_t const *p_evt_write = &p_request->request.write;
+    ble_gatts_rw_authorize_reply_params_t reply = {0};
+    uint16_t status;
+
+    if (p_request->type != BLE_GATTS_AUTHORIZE_TYPE_WRITE) {
+        return;
+    }
+
+    if (p_evt_write->handle == p_keymap_service->control_char_handles.value_handle) {
+        p_keymap_service->conn_handle = p_ble_evt->evt.gatts_evt.conn_handle;
+        status = p_evt_write->op == BLE_GATTS_OP_WRITE_REQ ? on_control(p_evt_write) : KEYMAP_STORE_INVALID;
+    } else if (p_evt_write->handle == p_keymap_service->data_char_handles.value_handle) {
+        status = p_evt_write->op == BLE_GATTS_OP_WRITE_REQ ? on_data(p_evt_write) : KEYMAP_STORE_INVALID;
+    } else {
+        return;
+    }
+
+    NRF_LOG_DEBUG("Keymap write; handle: 0x%X, status: %u.", p_evt_write->handle, status);
+
+    reply.type = BLE_GATTS_AUTHORIZE_TYPE_WRITE;
+    reply.params.write.gatt_status = status == KEYMAP_STORE_SUCCESS ? BLE_GATT_STATUS_SUCCESS : BLE_GATT_STATUS_ATTERR_APP_BEGIN + status;
+
+    err_code = sd_ble_gatts_rw_authorize_reply(p_ble_evt->evt.gatts_evt.conn_handle, &reply);
+    NRF_LOG_DEBUG("sd_ble_gatts_rw_authorize_reply; ret: 0x%X.", err_code);
+}
+
+static keymap_store_status_t on_control(ble_gatts_evt_write_t const *p_evt_write) {
+    keymap_blob_header_t header;
+
+    if (p_evt_write->len == 0) {
+        return KEYMAP_STORE_INVALID;
+    }
+
+    switch (p_evt_write->data[0]) {
+        case KEYMAP_CONTROL_CMD_BEGIN:
+            if (p_evt_write->len != 1 + sizeof(header)) {
+                return KEYMAP_STORE_INVALID;
+            }
+
+            // Write data is not word aligned.
+            memcpy(&header, &p_evt_write->data[1], sizeof(header));
+
+            return keymap_store_upload_begin(&header);
+
+        case KEYMAP_CONTROL_CMD_COMMIT:
+            return keymap_store_upload_commit();
+
+        case KEYMAP_CONTROL_CMD_ABORT:
+            keymap_store_upload_abort();
+            return KEYMAP_STORE_SUCCESS;
+
+        default:
+            return KEYMAP_STORE_INVALID;
+    }
+}
+
+static keymap_store_status_t on_data(ble_gatts_evt_write_t const *p_evt_write) {
+    if (p_evt_write->len <= 2) {
+        return KEYMAP_STORE_INVALID;
+    }
+
+    return keymap_store_upload_write(uint16_decode(p_evt_write->data), &p_evt_write->data[2], p_evt_write->len - 2);
+}
+
+uint32_t keymap_service_status_send(keymap_service_t *p_keymap_service, uint8_t cmd, uint8_t status) {
+    VERIFY_PARAM_NOT_NULL(p_keymap_service);
+
+    uint8_t data[2] = {cmd, status};
+    uint16_t len = sizeof(data);
+    ble_gatts_hvx_params_t hvx_params = {0};
+
+    if (p_keymap_service->conn_handle == BLE_CONN_HANDLE_INVALID) {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    hvx_params.handle = p_keymap_service->control_char_handles.value_handle;
+    hvx_params.type = BLE_GATT_HVX_NOTIFICATION;
+    hvx_params.p_len = &len;
+    hvx_params.p_data = data;
+
+    return sd_ble_gatts_hvx(p_keymap_service->conn_handle, &hvx_params);
+}
+
+#if PROFILER_ENABLED
+uint32_t keymap_service_profiler_set(keymap_service_t *p_keymap_service, profiler_snapshot_t const *p_snapshot) {
+    VERIFY_PARAM_NOT_NULL(p_keymap_service);
+
+    uint8_t data[KEYMAP_PROFILER_MAX_LEN];
+    ble_gatts_value_t gatts_value = {0};
+
+    gatts_value.len = profiler_snapshot_encode(p_snapshot, data);
+    gatts_value.p_value = data;
+
+    return sd_ble_gatts_value_set(BLE_CONN_HANDLE_INVALID, p_keymap_service->profiler_char_handles.value_handle, &gatts_value);
+}
+#endif
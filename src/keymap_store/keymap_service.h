@@ -0,0 +1,64 @@
+#ifndef _KEYMAP_SERVICE_H_
+#define _KEYMAP_SERVICE_H_
+
+#include "ble_srv_common.h"
+#include "ble.h"
+#include "nrf_sdh_ble.h"
+
+#include "../firmware_config.h"
+#include "../profiler/profiler.h"
+#include "keymap_blob.h"
+
+#define KEYMAP_SERVICE_DEF(_name)                          \
+    static keymap_service_t _name;                         \
+    NRF_SDH_BLE_OBSERVER(_name ## _obs,                    \
+                         KEYMAP_SERVICE_BLE_OBSERVER_PRIO, \
+                         keymap_service_on_ble_evt,        \
+                         &_name)
+
+// Base UUID of KB link, vendor UUID table has one entry for both services.
+#define KEYMAP_SERVICE_BASE_UUID {0xC0, 0x18, 0x85, 0x13, 0xA8, 0xF8, 0x04, 0xA0, 0xF6, 0x44, 0x06, 0xAF, 0x00, 0x00, 0x66, 0x0D}
+
+// Service & characteristics UUIDs
+#define KEYMAP_SERVICE_UUID       0xF36C
+#define KEYMAP_CONTROL_CHAR_UUID  0xC74E
+#define KEYMAP_DATA_CHAR_UUID     0xC74F
+#define KEYMAP_PROFILER_CHAR_UUID 0xC750
+
+/*
+ * Keymap upload, from host (tools/keymap_compiler) to keymap store.
+ * Control write: command byte followed by its arguments. Done upload steps are notified as command & keymap_store_status_t.
+ * Data write: offset of chunk in codes (uint16, little endian) followed by whole words of codes.
+ * Writes are answered with ATT error BLE_GATT_STATUS_ATTERR_APP_BEGIN + keymap_store_status_t when they fail, e.g. busy.
+ */
+#define KEYMAP_CONTROL_CMD_BEGIN  0x01 // Args: keymap blob header. Notified once slot is erased.
+#define KEYMAP_CONTROL_CMD_COMMIT 0x02 // No args. Notified once keymap is active.
+#define KEYMAP_CONTROL_CMD_ABORT  0x03 // No args.
+#define KEYMAP_CONTROL_MAX_LEN    (1 + sizeof(keymap_blob_header_t))
+#define KEYMAP_DATA_MAX_LEN       (2 + KEYMAP_STORE_CHUNK_MAX)
+
+// Profiler read (PROFILER_ENABLED only): last dump of profiler counters, as packed by profiler_snapshot_encode.
+#define KEYMAP_PROFILER_MAX_LEN PROFILER_SNAPSHOT_LEN
+
+typedef struct keymap_service_s {
+    uint16_t conn_handle; // Link of last upload command.
+    uint16_t service_handle;
+    uint8_t uuid_type;
+    ble_gatts_char_handles_t control_char_handles;
+    ble_gatts_char_handles_t data_char_handles;
+#if PROFILER_ENABLED
+    ble_gatts_char_handles_t profiler_char_handles;
+#endif
+} keymap_service_t;
+
+uint32_t keymap_service_init(keymap_service_t *p_keymap_service);
+
+void keymap_service_on_ble_evt(ble_evt_t const *p_ble_evt, void *p_context);
+
+uint32_t keymap_service_status_send(keymap_service_t *p_keymap_service, uint8_t cmd, uint8_t status);
+
+#if PROFILER_ENABLED
+uint32_t keymap_service_profiler_set(keymap_service_t *p_keymap_service, profiler_snapshot_t const *p_snapshot);
+#endif
+
+#endif
@@ -0,0 +1,350 @@
+#define NRF_LOG_MODULE_NAME keymap_store
+#define NRF_LOG_LEVEL       KEYMAP_STORE_LOG_LEVEL
+
+#include "keymap_store.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "app_error.h"
+#include "crc32.h"
+#include "nordic_common.h"
+#include "nrf_fstorage_sd.h"
+#include "nrf_fstorage.h"
+#include "nrf_log.h"
+#include "nrf.h"
+#include "sdk_common.h"
+
+#include "keymap.h"
+#include "../combo/combo.h"
+#include "../firmware_config.h"
+
+NRF_LOG_MODULE_REGISTER();
+
+#define PAGE_SIZE     4096
+#define SLOT_PAGE_NUM CEIL_DIV(KEYMAP_BLOB_SIZE(KEYMAP_LAYER_MAX), PAGE_SIZE) // Whole flash pages, so large keyboards get more.
+#define SLOT_SIZE     (SLOT_PAGE_NUM * PAGE_SIZE)
+#define SLOT_NUM      2
+
+#define CODES_SIZE(layer_num) ((layer_num) * KEYMAP_KEY_NUM * sizeof(uint32_t))
+
+STATIC_ASSERT(CODES_SIZE(KEYMAP_LAYER_MAX) <= UINT16_MAX); // Upload offset is 16 bits.
+STATIC_ASSERT(sizeof(keymap_blob_header_t) % sizeof(uint32_t) == 0);
+STATIC_ASSERT(KEYMAP_STORE_CHUNK_MAX % sizeof(uint32_t) == 0);
+STATIC_ASSERT(SLOT_NUM * SLOT_PAGE_NUM <= KEYMAP_STORE_FLASH_PAGES); // Else slots overlap application flash.
+
+// Combos are compiled in, their codes follow keymap positions on every layer (see COMBO_KEY_INDEX).
+#ifdef COMBO_DEFINE
+static const combo_t m_combos[] = COMBO_DEFINE;
+#define COMBO_NUM ARRAY_SIZE(m_combos)
+#else
+static const combo_t *const m_combos = NULL;
+#define COMBO_NUM 0
+#endif
+
+STATIC_ASSERT(COMBO_NUM <= COMBO_MAX);
+STATIC_ASSERT(KEYMAP_KEY_NUM + COMBO_MAX <= KEY_INDEX_MAX);
+
+typedef enum upload_state_e {
+    UPLOAD_IDLE,
+    UPLOAD_ERASING,
+    UPLOAD_RECEIVING,
+    UPLOAD_COMMITTING
+} upload_state_t;
+
+static void fstorage_evt_handler(nrf_fstorage_evt_t *p_evt);
+
+// Bounds are set in keymap_store_init, right below FDS pages.
+NRF_FSTORAGE_DEF(nrf_fstorage_t m_fstorage) = {
+    .evt_handler = fstorage_evt_handler
+};
+
+static keymap_store_evt_handler_t m_evt_handler;
+
+// Active keymap, codes are read in place from flash.
+static uint32_t const *m_p_codes = &KEYMAP[0][0];
+static uint8_t m_layer_num = ARRAY_SIZE(KEYMAP);
+static int8_t m_active_slot = -1; // Compiled KEYMAP.
+static uint32_t m_active_sequence = 0;
+
+// Upload.
+static upload_state_t m_upload_state = UPLOAD_IDLE;
+static uint8_t m_upload_slot;
+static keymap_blob_header_t m_upload_header; // Written from here on commit.
+static bool m_upload_failed;
+
+// fstorage reads chunk when its write runs, so chunks are kept until then.
+static uint32_t m_chunks[KEYMAP_STORE_CHUNK_BUFFER_NUM][KEYMAP_STORE_CHUNK_MAX / sizeof(uint32_t)];
+static uint8_t m_chunk_next = 0;
+static uint8_t m_chunk_pending = 0;
+
+static void flash_bounds_set(void);
+static uint32_t slot_addr(uint8_t slot);
+static keymap_blob_header_t const *slot_header(uint8_t slot);
+static uint32_t const *slot_codes(uint8_t slot);
+static bool header_valid(keymap_blob_header_t const *p_header);
+static bool slot_valid(uint8_t slot);
+static void slot_activate(uint8_t slot);
+static void evt_send(keymap_store_evt_type_t evt_type, keymap_store_status_t status);
+
+void keymap_store_init(keymap_store_evt_handler_t evt_handler) {
+    ret_code_t err_code;
+
+    NRF_LOG_INFO("keymap_store_init.");
+
+    m_evt_handler = evt_handler;
+
+    flash_bounds_set();
+
+    err_code = nrf_fstorage_init(&m_fstorage, &nrf_fstorage_sd, NULL);
+    APP_ERROR_CHECK(err_code);
+
+    for (uint8_t slot = 0; slot < SLOT_NUM; slot++) {
+        if (slot_valid(slot) && (m_active_slot < 0 || slot_header(slot)->sequence > m_active_sequence)) {
+            slot_activate(slot);
+        }
+    }
+
+    if (m_active_slot < 0) {
+        NRF_LOG_INFO("Keymap; compiled, layers: %u.", m_layer_num);
+    }
+}
+
+static void flash_bounds_set(void) {
+    // Same end of flash as FDS uses.
+    uint32_t const bootloader_addr = NRF_UICR->NRFFW[0];
+    uint32_t end_addr = bootloader_addr != 0xFFFFFFFF ? bootloader_addr : NRF_FICR->CODESIZE * NRF_FICR->CODEPAGESIZE;
+
+    end_addr -= FDS_VIRTUAL_PAGES * FDS_VIRTUAL_PAGE_SIZE * sizeof(uint32_t);
+
+    m_fstorage.end_addr = end_addr;
+    m_fstorage.start_addr = end_addr - SLOT_NUM * SLOT_SIZE;
+}
+
+static uint32_t slot_addr(uint8_t slot) {
+    return m_fstorage.start_addr + slot * SLOT_SIZE;
+}
+
+static keymap_blob_header_t const *slot_header(uint8_t slot) {
+    return (keymap_blob_header_t const *)slot_addr(slot);
+}
+
+static uint32_t const *slot_codes(uint8_t slot) {
+    return (uint32_t const *)(slot_addr(slot) + sizeof(keymap_blob_header_t));
+}
+
+static bool header_valid(keymap_blob_header_t const *p_header) {
+    return p_header->version == KEYMAP_BLOB_VERSION && p_header->key_num == KEYMAP_KEY_NUM && p_header->layer_num > 0 && p_header->layer_num <= KEYMAP_LAYER_MAX;
+}
+
+static bool slot_valid(uint8_t slot) {
+    keymap_blob_header_t const *p_header = slot_header(slot);
+
+    if (p_header->magic != KEYMAP_BLOB_MAGIC || !header_valid(p_header)) {
+        return false;
+    }
+
+    return crc32_compute((uint8_t const *)slot_codes(slot), CODES_SIZE(p_header->layer_num), NULL) == p_header->crc;
+}
+
+static void slot_activate(uint8_t slot) {
+    keymap_blob_header_t const *p_header = slot_header(slot);
+
+    m_p_codes = slot_codes(slot);
+    m_layer_num = p_header->layer_num;
+    m_active_slot = slot;
+    m_active_sequence = p_header->sequence;
+
+    NRF_LOG_INFO("Keymap; slot: %u, sequence: %d, layers: %u.", slot, m_active_sequence, m_layer_num);
+}
+
+uint32_t keymap_store_code(uint8_t layer, uint16_t index) {
+    if (layer >= m_layer_num || index >= KEYMAP_KEY_NUM + COMBO_NUM) {
+        return KC_NO;
+    }
+
+    if (index >= KEYMAP_KEY_NUM) {
+        return m_combos[index - KEYMAP_KEY_NUM].code;
+    }
+
+    return m_p_codes[layer * KEYMAP_KEY_NUM + index];
+}
+
+void keymap_store_combos_get(combo_t const **pp_combos, uint16_t *p_combo_num) {
+    *pp_combos = m_combos;
+    *p_combo_num = COMBO_NUM;
+}
+
+keymap_store_status_t keymap_store_upload_begin(keymap_blob_header_t const *p_header) {
+    ret_code_t err_code;
+
+    if (m_upload_state == UPLOAD_ERASING || m_upload_state == UPLOAD_COMMITTING || m_chunk_pending > 0) {
+        return KEYMAP_STORE_BUSY;
+    }
+
+    if (!header_valid(p_header)) {
+        NRF_LOG_WARNING("Upload header invalid; version: %u, layers: %u, keys: %u.", p_header->version, p_header->layer_num, p_header->key_num);
+        return KEYMAP_STORE_INVALID;
+    }
+
+    // Active slot is left untouched until new keymap is complete.
+    m_upload_header = *p_header;
+    m_upload_slot = m_active_slot == 0 ? 1 : 0;
+    m_upload_failed = false;
+
+    err_code = nrf_fstorage_erase(&m_fstorage, slot_addr(m_upload_slot), SLOT_PAGE_NUM, NULL);
+
+    if (err_code == NRF_ERROR_NO_MEM) {
+        return KEYMAP_STORE_BUSY;
+    } else if (err_code != NRF_SUCCESS) {
+        return KEYMAP_STORE_FLASH_ERROR;
+    }
+
+    m_upload_state = UPLOAD_ERASING;
+
+    NRF_LOG_INFO("Upload begin; slot: %u, layers: %u.", m_upload_slot, m_upload_header.layer_num);
+
+    return KEYMAP_STORE_SUCCESS;
+}
+
+keymap_store_status_t keymap_store_upload_write(uint16_t offset, uint8_t const *p_data, uint8_t len) {
+    ret_code_t err_code;
+    uint32_t *p_chunk;
+
+    if (m_upload_state != UPLOAD_RECEIVING) {
+        return m_upload_state == UPLOAD_ERASING ? KEYMAP_STORE_BUSY : KEYMAP_STORE_INVALID;
+    }
+
+    if (len == 0 || len > KEYMAP_STORE_CHUNK_MAX || len % sizeof(uint32_t) != 0 || offset % sizeof(uint32_t) != 0 || offset + len > CODES_SIZE(m_upload_header.layer_num)) {
+        return KEYMAP_STORE_INVALID;
+    }
+
+    if (m_chunk_pending >= KEYMAP_STORE_CHUNK_BUFFER_NUM) {
+        return KEYMAP_STORE_BUSY;
+    }
+
+    p_chunk = m_chunks[m_chunk_next];
+    memcpy(p_chunk, p_data, len);
+
+    err_code = nrf_fstorage_write(&m_fstorage, (uint32_t)slot_codes(m_upload_slot) + offset, p_chunk, len, NULL);
+
+    if (err_code == NRF_ERROR_NO_MEM) {
+        return KEYMAP_STORE_BUSY;
+    } else if (err_code != NRF_SUCCESS) {
+        return KEYMAP_STORE_FLASH_ERROR;
+    }
+
+    // Writes complete in order, so buffers are released in order too.
+    m_chunk_next = (m_chunk_next + 1) % KEYMAP_STORE_CHUNK_BUFFER_NUM;
+    m_chunk_pending++;
+
+    return KEYMAP_STORE_SUCCESS;
+}
+
+keymap_store_status_t keymap_store_upload_commit(void) {
+    ret_code_t err_code;
+    uint32_t crc;
+
+    if (m_upload_state != UPLOAD_RECEIVING) {
+        return m_upload_state == UPLOAD_IDLE ? KEYMAP_STORE_INVALID : KEYMAP_STORE_BUSY;
+    }
+
+    if (m_chunk_pending > 0) {
+        return KEYMAP_STORE_BUSY;
+    }
+
+    if (m_upload_failed) {
+        m_upload_state = UPLOAD_IDLE;
+        return KEYMAP_STORE_FLASH_ERROR;
+    }
+
+    // Check codes as they landed in flash, not as they were sent.
+    crc = crc32_compute((uint8_t const *)slot_codes(m_upload_slot), CODES_SIZE(m_upload_header.layer_num), NULL);
+
+    if (crc != m_upload_header.crc) {
+        NRF_LOG_WARNING("Upload CRC mismatch; expected: 0x%X, got: 0x%X.", m_upload_header.crc, crc);
+
+        m_upload_state = UPLOAD_IDLE;
+        return KEYMAP_STORE_CRC_ERROR;
+    }
+
+    m_upload_header.sequence = m_active_sequence + 1;
+    m_upload_header.magic = KEYMAP_BLOB_MAGIC;
+
+    err_code = nrf_fstorage_write(&m_fstorage, slot_addr(m_upload_slot), &m_upload_header, sizeof(m_upload_header), NULL);
+
+    if (err_code == NRF_ERROR_NO_MEM) {
+        return KEYMAP_STORE_BUSY;
+    } else if (err_code != NRF_SUCCESS) {
+        return KEYMAP_STORE_FLASH_ERROR;
+    }
+
+    m_upload_state = UPLOAD_COMMITTING;
+
+    return KEYMAP_STORE_SUCCESS;
+}
+
+void keymap_store_upload_abort(void) {
+    if (m_upload_state == UPLOAD_COMMITTING) {
+        // Header is on its way to flash, keymap gets swapped anyway.
+        return;
+    }
+
+    if (m_upload_state != UPLOAD_IDLE) {
+        NRF_LOG_INFO("Upload aborted.");
+    }
+
+    m_upload_state = UPLOAD_IDLE;
+}
+
+static void evt_send(keymap_store_evt_type_t evt_type, keymap_store_status_t status) {
+    keymap_store_evt_t evt;
+
+    if (m_evt_handler == NULL) {
+        return;
+    }
+
+    evt.evt_type = evt_type;
+    evt.status = status;
+
+    m_evt_handler(&evt);
+}
+
+static void fstorage_evt_handler(nrf_fstorage_evt_t *p_evt) {
+    switch (p_evt->id) {
+        case NRF_FSTORAGE_EVT_ERASE_RESULT:
+            if (m_upload_state != UPLOAD_ERASING) {
+                // Aborted meanwhile.
+                return;
+            }
+
+            if (p_evt->result == NRF_SUCCESS) {
+                m_upload_state = UPLOAD_RECEIVING;
+                evt_send(KEYMAP_STORE_EVT_BEGIN, KEYMAP_STORE_SUCCESS);
+            } else {
+                m_upload_state = UPLOAD_IDLE;
+                evt_send(KEYMAP_STORE_EVT_BEGIN, KEYMAP_STORE_FLASH_ERROR);
+            }
+            break;
+
+        case NRF_FSTORAGE_EVT_WRITE_RESULT:
+            if (p_evt->p_src != &m_upload_header) {
+                m_chunk_pending--;
+                m_upload_failed |= p_evt->result != NRF_SUCCESS;
+                return;
+            }
+
+            m_upload_state = UPLOAD_IDLE;
+
+            if (p_evt->result == NRF_SUCCESS && slot_valid(m_upload_slot)) {
+                slot_activate(m_upload_slot);
+                evt_send(KEYMAP_STORE_EVT_COMMIT, KEYMAP_STORE_SUCCESS);
+            } else {
+                evt_send(KEYMAP_STORE_EVT_COMMIT, KEYMAP_STORE_FLASH_ERROR);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
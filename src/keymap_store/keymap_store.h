@@ -0,0 +1,45 @@
+#ifndef _KEYMAP_STORE_H_
+#define _KEYMAP_STORE_H_
+
+#include <stdint.h>
+
+#include "keymap_blob.h"
+#include "../combo/combo.h"
+
+/*
+ * Runtime keymap, read in place from flash.
+ * Two flash slots below FDS pages hold keymap blobs, valid blob with highest sequence is active.
+ * Upload goes to the other slot, its header is written only after CRC of codes matched, so swap is atomic.
+ * Without valid blob, compiled KEYMAP is used. Combos of keymap.h are always compiled ones.
+ */
+typedef enum keymap_store_status_e {
+    KEYMAP_STORE_SUCCESS,
+    KEYMAP_STORE_BUSY,      // Flash operation ongoing, retry later.
+    KEYMAP_STORE_INVALID,   // Bad header, chunk or upload state.
+    KEYMAP_STORE_CRC_ERROR, // Uploaded codes don't match header CRC.
+    KEYMAP_STORE_FLASH_ERROR
+} keymap_store_status_t;
+
+typedef enum keymap_store_evt_type_e {
+    KEYMAP_STORE_EVT_BEGIN,  // Upload slot is erased, chunks may be written.
+    KEYMAP_STORE_EVT_COMMIT  // Uploaded keymap is active.
+} keymap_store_evt_type_t;
+
+typedef struct keymap_store_evt_s {
+    keymap_store_evt_type_t evt_type;
+    keymap_store_status_t status;
+} keymap_store_evt_t;
+
+typedef void (*keymap_store_evt_handler_t)(keymap_store_evt_t const *p_evt);
+
+void keymap_store_init(keymap_store_evt_handler_t evt_handler);
+// Code of key index in layer, KC_NO for layer which doesn't exist. Index past keymap positions is a combo.
+uint32_t keymap_store_code(uint8_t layer, uint16_t index);
+void keymap_store_combos_get(combo_t const **pp_combos, uint16_t *p_combo_num);
+keymap_store_status_t keymap_store_upload_begin(keymap_blob_header_t const *p_header);
+// Offset is in bytes from first code, chunk is whole words.
+keymap_store_status_t keymap_store_upload_write(uint16_t offset, uint8_t const *p_data, uint8_t len);
+keymap_store_status_t keymap_store_upload_commit(void);
+void keymap_store_upload_abort(void);
+
+#endif
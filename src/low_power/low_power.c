@@ -1,55 +1,148 @@
+#define NRF_LOG_MODULE_NAME low_power
+#define NRF_LOG_LEVEL       LOW_POWER_LOG_LEVEL
+
 #include "low_power.h"
 
 #include "app_error.h"
-#include "nrf_gpio.h"
+#include "app_scheduler.h"
+#include "app_util_platform.h"
+#include "nrf_gpiote.h"
 #include "nrf_log.h"
-#include "nrfx_gpiote.h"
+#include "nrf_pwr_mgmt.h"
 
-#include "../config/keyboard.h"
+#include "../bin_log/bin_log.h"
 #include "../firmware_config.h"
+#include "../matrix/matrix.h"
+
+NRF_LOG_MODULE_REGISTER();
+
+#define OFF_TIMER_INTERVAL APP_TIMER_TICKS(60000) // System OFF countdown ticks every minute.
+#define WAKE_IRQ_PRIORITY  APP_IRQ_PRIORITY_LOW
+
+APP_TIMER_DEF(m_off_timer_id);
 
 static const app_timer_id_t *m_p_scan_timer_id;
+static app_sched_event_handler_t m_scan_task;
+static low_power_evt_handler_t m_evt_handler;
+
+static volatile low_power_state_t m_state = LOW_POWER_STATE_ACTIVE;
+static uint32_t m_idle_time = 0;             // In ms, time without activity while scanning.
+static volatile uint32_t m_off_counter = 0;  // In minutes, time left in sense mode before System OFF.
+
+// Wake up latency, from PORT event until first report is sent.
+static uint32_t m_wake_tick = 0;
+static volatile bool m_wake_report_pending = false;
+static uint32_t m_wake_latency_last_us = 0;
+static uint32_t m_wake_latency_max_us = 0;
 
-static void gpiote_evt_handler(nrfx_gpiote_pin_t pin, nrf_gpiote_polarity_t action);
+static void state_set(low_power_state_t state);
+static void scan_restart(uint32_t ticks);
+static void sense_enable(void);
+static void sense_disable(void);
+static void wake_up(void);
+static void off_timeout_handler(void *p_context);
+static void system_off_task(void *p_data, uint16_t size);
 
-void low_power_mode_init(const app_timer_id_t *p_scan_timer_id) {
+void low_power_mode_init(const app_timer_id_t *p_scan_timer_id, app_sched_event_handler_t scan_task, low_power_evt_handler_t evt_handler) {
     ret_code_t err_code;
 
     NRF_LOG_INFO("low_power_mode_init.");
 
     m_p_scan_timer_id = p_scan_timer_id;
+    m_scan_task = scan_task;
+    m_evt_handler = evt_handler;
 
-    // Init GPIOTE module.
-    if (!nrfx_gpiote_is_init()) {
-        err_code = nrfx_gpiote_init();
-        APP_ERROR_CHECK(err_code);
+    m_state = LOW_POWER_STATE_ACTIVE;
+    m_idle_time = 0;
+    m_wake_report_pending = false;
+
+    // Init wake up through GPIOTE PORT event, it's shared by all rows so matrix size is not limited by GPIOTE channels.
+    nrf_gpiote_int_disable(NRF_GPIOTE_INT_PORT_MASK);
+    nrf_gpiote_event_clear(NRF_GPIOTE_EVENTS_PORT);
+
+    NVIC_SetPriority(GPIOTE_IRQn, WAKE_IRQ_PRIORITY);
+    NVIC_ClearPendingIRQ(GPIOTE_IRQn);
+    NVIC_EnableIRQ(GPIOTE_IRQn);
+
+    // Init System OFF timer.
+    err_code = app_timer_create(&m_off_timer_id, APP_TIMER_MODE_REPEATED, off_timeout_handler);
+    APP_ERROR_CHECK(err_code);
+}
+
+static void state_set(low_power_state_t state) {
+    if (m_state == state) {
+        return;
     }
 
-    // Init GPIOTE pins.
-    nrfx_gpiote_in_config_t config = NRFX_GPIOTE_RAW_CONFIG_IN_SENSE_LOTOHI(false);
+    BIN_LOG_2(BIN_LOG_POWER_STATE, m_state, state);
 
-    for (int i = 0; i < MATRIX_ROW_NUM; i++) {
-        err_code = nrfx_gpiote_in_init(ROWS[i], &config, gpiote_evt_handler);
-        APP_ERROR_CHECK(err_code);
+    m_state = state;
+
+    if (m_evt_handler != NULL) {
+        m_evt_handler(state);
     }
 }
 
-static void gpiote_evt_handler(nrfx_gpiote_pin_t pin, nrf_gpiote_polarity_t action) {
+static void scan_restart(uint32_t ticks) {
     ret_code_t err_code;
 
-    NRF_LOG_INFO("GPIOTE evt.");
+    err_code = app_timer_stop(*m_p_scan_timer_id);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = app_timer_start(*m_p_scan_timer_id, ticks, NULL);
+    APP_ERROR_CHECK(err_code);
+}
+
+static void sense_enable(void) {
+    matrix_sense_arm();
+
+    nrf_gpiote_event_clear(NRF_GPIOTE_EVENTS_PORT);
+    nrf_gpiote_int_enable(NRF_GPIOTE_INT_PORT_MASK);
 
-    for (int i = 0; i < MATRIX_ROW_NUM; i++) {
-        nrfx_gpiote_in_event_disable(ROWS[i]);
+    if (matrix_sense_missed()) {
+        NVIC_SetPendingIRQ(GPIOTE_IRQn);
     }
+}
+
+static void sense_disable(void) {
+    nrf_gpiote_int_disable(NRF_GPIOTE_INT_PORT_MASK);
+
+    matrix_sense_disarm();
+
+    nrf_gpiote_event_clear(NRF_GPIOTE_EVENTS_PORT);
+}
+
+void GPIOTE_IRQHandler(void) {
+    nrf_gpiote_event_clear(NRF_GPIOTE_EVENTS_PORT);
 
-    for (int i = 0; i < MATRIX_COL_NUM; i++) {
-        nrf_gpio_pin_clear(COLS[i]);
+    if (m_state != LOW_POWER_STATE_SENSE) {
+        // Entering System OFF, keep sense armed to wake up chip.
+        return;
     }
 
-    // Start scan timer.
-    err_code = app_timer_start(*m_p_scan_timer_id, SCAN_DELAY_TICKS, NULL);
+    BIN_LOG_0(BIN_LOG_GPIOTE_PORT);
+
+    sense_disable();
+    wake_up();
+}
+
+static void wake_up(void) {
+    ret_code_t err_code;
+
+    m_wake_tick = app_timer_cnt_get();
+    m_wake_report_pending = true;
+
+    err_code = app_timer_stop(m_off_timer_id);
+    APP_ERROR_CHECK(err_code);
+
+    // Scan now instead of one scan delay later, then start scan timer.
+    err_code = app_sched_event_put(&m_wake_tick, sizeof(m_wake_tick), m_scan_task);
     APP_ERROR_CHECK(err_code);
+
+    m_idle_time = 0;
+    scan_restart(SCAN_DELAY_TICKS);
+
+    state_set(LOW_POWER_STATE_ACTIVE);
 }
 
 void low_power_mode_start() {
@@ -57,14 +150,140 @@ void low_power_mode_start() {
 
     NRF_LOG_INFO("low_power_mode_start.");
 
+    if (matrix_pressed_any()) {
+        // Held key keeps its row high, so that row could sense only its release and a press on it would be lost.
+        // Keep scanning slowly until all keys are released.
+        m_idle_time = 0;
+
+        if (m_state != LOW_POWER_STATE_SLOW_SCAN) {
+            scan_restart(SLOW_SCAN_DELAY_TICKS);
+            state_set(LOW_POWER_STATE_SLOW_SCAN);
+        }
+        return;
+    }
+
     err_code = app_timer_stop(*m_p_scan_timer_id);
     APP_ERROR_CHECK(err_code);
 
-    for (int i = 0; i < MATRIX_ROW_NUM; i++) {
-        nrfx_gpiote_in_event_enable(ROWS[i], true);
+    m_idle_time = 0;
+
+    if (!matrix_sense_available()) {
+        // Matrix backend can't wake up chip, so sense mode keeps scanning slowly and never goes to System OFF.
+        state_set(LOW_POWER_STATE_SENSE);
+        scan_restart(SLOW_SCAN_DELAY_TICKS);
+        return;
+    }
+
+    m_off_counter = SYSTEM_OFF_MODE_DELAY;
+
+    if (SYSTEM_OFF_MODE_DELAY > 0) {
+        err_code = app_timer_stop(m_off_timer_id);
+        APP_ERROR_CHECK(err_code);
+
+        err_code = app_timer_start(m_off_timer_id, OFF_TIMER_INTERVAL, NULL);
+        APP_ERROR_CHECK(err_code);
+    }
+
+    state_set(LOW_POWER_STATE_SENSE);
+
+    // Arm sense last, key press may wake up right away.
+    sense_enable();
+}
+
+void low_power_mode_scan_done(bool has_activity) {
+    if (m_state == LOW_POWER_STATE_SENSE && !matrix_sense_available()) {
+        if (has_activity) {
+            wake_up();
+        }
+        return;
+    }
+
+    if (m_state == LOW_POWER_STATE_SENSE) {
+        // Scan was queued before sense mode started and left columns low, arm sense again.
+        sense_disable();
+        sense_enable();
+        return;
+    }
+
+    if (!has_activity) {
+        // Wake up didn't lead to a report, e.g. held key was released.
+        m_wake_report_pending = false;
+    }
+
+    if (has_activity) {
+        m_idle_time = 0;
+
+        if (m_state == LOW_POWER_STATE_SLOW_SCAN) {
+            scan_restart(SCAN_DELAY_TICKS);
+            state_set(LOW_POWER_STATE_ACTIVE);
+        }
+        return;
+    }
+
+    m_idle_time += m_state == LOW_POWER_STATE_SLOW_SCAN ? SLOW_SCAN_DELAY : SCAN_DELAY;
+
+    if (m_idle_time >= LOW_POWER_MODE_DELAY) {
+        low_power_mode_start();
+    } else if (m_idle_time >= SLOW_SCAN_MODE_DELAY && m_state == LOW_POWER_STATE_ACTIVE) {
+        scan_restart(SLOW_SCAN_DELAY_TICKS);
+        state_set(LOW_POWER_STATE_SLOW_SCAN);
+    }
+}
+
+void low_power_mode_activity(void) {
+    // Activity which doesn't come from matrix (e.g. slave keys) keeps keyboard scanning and postpones System OFF.
+    m_idle_time = 0;
+    m_off_counter = SYSTEM_OFF_MODE_DELAY;
+}
+
+void low_power_wake_report_sent(void) {
+    if (!m_wake_report_pending) {
+        return;
+    }
+
+    m_wake_report_pending = false;
+
+    uint32_t ticks = app_timer_cnt_diff_compute(app_timer_cnt_get(), m_wake_tick);
+
+    m_wake_latency_last_us = ROUNDED_DIV((uint64_t)ticks * 1000000 * (APP_TIMER_CONFIG_RTC_FREQUENCY + 1), APP_TIMER_CLOCK_FREQ);
+    m_wake_latency_max_us = MAX(m_wake_latency_max_us, m_wake_latency_last_us);
+
+    BIN_LOG_2(BIN_LOG_WAKE_LATENCY, m_wake_latency_last_us, m_wake_latency_max_us);
+}
+
+void low_power_wake_latency_get(uint32_t *p_last_us, uint32_t *p_max_us) {
+    *p_last_us = m_wake_latency_last_us;
+    *p_max_us = m_wake_latency_max_us;
+}
+
+static void off_timeout_handler(void *p_context) {
+    UNUSED_PARAMETER(p_context);
+    ret_code_t err_code;
+
+    if (m_off_counter > 0) {
+        m_off_counter--;
     }
 
-    for (int i = 0; i < MATRIX_COL_NUM; i++) {
-        nrf_gpio_pin_set(COLS[i]);
+    if (m_off_counter == 0) {
+        err_code = app_timer_stop(m_off_timer_id);
+        APP_ERROR_CHECK(err_code);
+
+        err_code = app_sched_event_put(NULL, 0, system_off_task);
+        APP_ERROR_CHECK(err_code);
     }
 }
+
+static void system_off_task(void *p_data, uint16_t size) {
+    UNUSED_PARAMETER(p_data);
+    UNUSED_PARAMETER(size);
+
+    if (m_state != LOW_POWER_STATE_SENSE) {
+        // Woken up meanwhile.
+        return;
+    }
+
+    state_set(LOW_POWER_STATE_OFF);
+
+    // Rows keep their sense configuration, so key press (or release of held key) wakes up chip through reset.
+    nrf_pwr_mgmt_shutdown(NRF_PWR_MGMT_SHUTDOWN_GOTO_SYSOFF);
+}
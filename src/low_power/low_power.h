@@ -1,9 +1,31 @@
 #ifndef _LOW_POWER_H_
 #define _LOW_POWER_H_
 
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "app_scheduler.h"
 #include "app_timer.h"
 
-void low_power_mode_init(const app_timer_id_t *p_scan_timer_id);
+// Power tiers, ordered from most to least power hungry.
+typedef enum low_power_state_e {
+    LOW_POWER_STATE_ACTIVE,    // Matrix is scanned every SCAN_DELAY.
+    LOW_POWER_STATE_SLOW_SCAN, // Matrix is scanned every SLOW_SCAN_DELAY.
+    LOW_POWER_STATE_SENSE,     // Scan is stopped, key press wakes matrix through GPIOTE.
+    LOW_POWER_STATE_OFF        // System OFF, key press resets chip.
+} low_power_state_t;
+
+typedef void (*low_power_evt_handler_t)(low_power_state_t state);
+
+// Scan task is scheduled right on wake up with tick of wake up as data (size > 0), key presses found by it skip debounce.
+void low_power_mode_init(const app_timer_id_t *p_scan_timer_id, app_sched_event_handler_t scan_task, low_power_evt_handler_t evt_handler);
+// Stops scan until key press wakes matrix, while a key is held it scans slowly instead.
 void low_power_mode_start();
+void low_power_mode_scan_done(bool has_activity);
+void low_power_mode_activity(void);
+// First report after wake up went out, its latency from wake up is kept.
+void low_power_wake_report_sent(void);
+// Wake to report latency of last wake up and most since init, in us.
+void low_power_wake_latency_get(uint32_t *p_last_us, uint32_t *p_max_us);
 
 #endif
@@ -1,3 +1,6 @@
+#define NRF_LOG_MODULE_NAME main
+#define NRF_LOG_LEVEL       MAIN_LOG_LEVEL
+
 #include <stdint.h>
 #include <string.h>
 
@@ -6,6 +9,7 @@
 #include "app_timer.h"
 #include "ble_advdata.h"
 #include "ble_advertising.h"
+#include "ble_conn_params.h"
 #include "ble_conn_state.h"
 #include "ble_dis.h"
 #include "ble_err.h"
@@ -17,7 +21,6 @@
 #include "nordic_common.h"
 #include "nrf_ble_gatt.h"
 #include "nrf_delay.h"
-#include "nrf_gpio.h"
 #include "nrf_log_ctrl.h"
 #include "nrf_log.h"
 #include "nrf_sdh_ble.h"
@@ -27,56 +30,76 @@
 #include "peer_manager_handler.h"
 #include "peer_manager.h"
 
-#include "config/keyboard.h"
-#include "config/keymap.h"
+#include "keyboard.h"
+#include "bin_log/bin_log.h"
+#include "combo/combo.h"
+#include "config_cache/config_cache.h"
+#include "conn_latency/conn_latency.h"
 #include "error_handler/error_handler.h"
 #include "firmware_config.h"
+#include "keymap_store/keymap_service.h"
+#include "keymap_store/keymap_store.h"
 #include "low_power/low_power.h"
+#include "matrix/matrix.h"
+#include "profiler/profiler.h"
+#include "reconnect/reconnect.h"
 #include "shared/shared.h"
+#include "slave_sync/slave_sync.h"
+#include "tap_hold/tap_hold.h"
 
 #ifdef HAS_SLAVE
+#include "kb_link/kb_link_transport.h"
+
+#ifdef KB_LINK_GATT
 #include "ble_db_discovery.h"
 #include "nrf_ble_scan.h"
 
 #include "kb_link/kb_link_c.h"
+#include "slave_scan/slave_scan.h"
 #endif
+#endif
+
+NRF_LOG_MODULE_REGISTER();
 
 /*
  * Variables declaration.
  */
 // nRF52 variables.
 APP_TIMER_DEF(m_scan_timer_id);
+APP_TIMER_DEF(m_key_timer_id);
 NRF_BLE_GATT_DEF(m_gatt);
 BLE_ADVERTISING_DEF(m_advertising);
 BLE_HIDS_DEF(m_hids, NRF_SDH_BLE_TOTAL_LINK_COUNT, INPUT_REPORT_KEYS_MAX_LEN, OUTPUT_REPORT_MAX_LEN, FEATURE_REPORT_MAX_LEN);
+KEYMAP_SERVICE_DEF(m_keymap_service);
 
-#ifdef HAS_SLAVE
+#if defined(HAS_SLAVE) && defined(KB_LINK_GATT)
 NRF_BLE_SCAN_DEF(m_scan);
-BLE_DB_DISCOVERY_DEF(m_db_disc);
-KB_LINK_C_DEF(m_kb_link_c);
+BLE_DB_DISCOVERY_ARRAY_DEF(m_db_disc, SLAVE_NUM);
+KB_LINK_C_ARRAY_DEF(m_kb_link_c, SLAVE_NUM);
+
+// Each slave takes one central link, raising link count needs more RAM for SoftDevice.
+STATIC_ASSERT(SLAVE_NUM <= NRF_SDH_BLE_CENTRAL_LINK_COUNT);
 #endif
 
 static uint16_t m_conn_handle = BLE_CONN_HANDLE_INVALID; // Handle of the current connection.
 static pm_peer_id_t m_peer_id = PM_PEER_ID_INVALID;      // Device reference handle to the current bonded central.
 static ble_uuid_t m_adv_uuid = {BLE_UUID_HUMAN_INTERFACE_DEVICE_SERVICE, BLE_UUID_TYPE_BLE};
-static bool volatile m_fds_initialized = false;
+static bool m_flash_data_loaded = false; // Device connection is loaded, advertising may start.
+
+// Host links, one per device. Hosts other than current one stay connected on parked (slow) links.
+static uint16_t m_host_conn_handles[DEVICE_NUM] = {[0 ... DEVICE_NUM - 1] = BLE_CONN_HANDLE_INVALID};
+static uint8_t m_adv_device = 0; // Device whose address is advertised.
 
 // HID variables.
-static bool m_hids_in_boot_mode = false; // Current protocol mode.
-static bool m_caps_lock_on = false;      // Variable to indicate if Caps Lock is turned on.
+static bool m_hids_in_boot_mode[DEVICE_NUM]; // Protocol mode of each host, report mode on connection.
+static bool m_caps_lock_on[DEVICE_NUM]; // Caps Lock of each host, slave shows the one of current device.
+static bool m_host_release_pending[DEVICE_NUM]; // Release report to host left on switch waits for room in its queue.
 
 // Firmware variables.
-const uint8_t ROWS[MATRIX_ROW_NUM] = MATRIX_ROW_PINS;
-const uint8_t COLS[MATRIX_COL_NUM] = MATRIX_COL_PINS;
-const int8_t MATRIX[MATRIX_ROW_NUM][MATRIX_COL_NUM] = MATRIX_DEFINE;
-
-static bool m_key_pressed[MATRIX_ROW_NUM][MATRIX_COL_NUM] = {false};
-static int m_debounce[MATRIX_ROW_NUM][MATRIX_COL_NUM];
-static int m_low_power_mode_counter = LOW_POWER_MODE_DELAY;
-
 typedef struct key_s {
-    int8_t index;
+    key_index_t index;
     uint8_t source;
+    bool is_hold; // Tap-hold key decided as hold.
     bool translated;
     bool has_modifiers;
     bool is_key;
@@ -87,14 +110,35 @@ typedef struct key_s {
 static key_t2 m_keys[KEY_NUM];
 static int m_key_count = 0;
 
+static uint32_t m_combo_buffer[COMBO_BUFFER_WORDS(COMBO_MAX)];
+
 static bool m_translate_key_index_task_queued = false;
 static bool m_generate_hid_report_task_queued = false;
 
+#ifdef HAS_SLAVE
+static const kb_link_transport_t *m_p_slave_link = &KB_LINK_TRANSPORT_INSTANCE;
+
+// Slave link, one per slave half or module. Keys from link n are registered with SLAVE_SOURCE(n), key & layer state
+// of each link is kept by slave_sync.
+typedef struct slave_link_s {
+    app_timer_t resync_timer_data;
+    app_timer_id_t resync_timer_id;
+#ifdef KB_LINK_GATT
+    ble_gap_addr_t addr; // Address of connected slave.
+    bool handles_from_cache;
+#endif
+} slave_link_t;
+
+static slave_link_t m_slave_links[SLAVE_NUM];
+#endif
+
+static uint8_t m_layer = _BASE_LAYER; // Layer resolved by last translation.
+
 // Device connection.
 typedef struct device_connection_s {
     uint8_t current_device;
-    uint8_t addrs[3];
-    pm_peer_id_t peer_ids[3];
+    uint8_t addrs[DEVICE_NUM];
+    pm_peer_id_t peer_ids[DEVICE_NUM];
     uint16_t padding; // Not used, needed to ensure size of this structure is multiple of 4 bytes.
 } device_connection_t;
 
@@ -112,7 +156,31 @@ static const fds_record_t m_device_connection_record = {
 };
 
 static fds_record_desc_t m_device_connection_record_desc = {0};
-static bool m_reset_device_connection_update = false;
+static uint8_t m_device_connection_cache_id;
+
+// Live device switch.
+static bool m_device_switch_timing = false; // Waiting for new host to secure connection.
+static uint32_t m_device_switch_tick = 0;
+
+#if defined(HAS_SLAVE) && defined(KB_LINK_GATT)
+// Cached KB link handles, to skip service discovery when the same slave reconnects.
+typedef struct slave_handles_s {
+    ble_gap_addr_t addr;
+    kb_link_c_handles_t handles;
+} slave_handles_t;
+
+static slave_handles_t m_slave_handles[SLAVE_NUM]; // Invalidated in kbl_c_init.
+
+static const fds_record_t m_slave_handles_record = {
+    .file_id = CONFIG_FILE_ID,
+    .key = SLAVE_HANDLES_KEY,
+    .data.p_data = m_slave_handles,
+    .data.length_words = (sizeof(m_slave_handles) + 3) / sizeof(uint32_t) // length_words is multiple of 4 bytes.
+};
+
+static fds_record_desc_t m_slave_handles_record_desc = {0};
+static uint8_t m_slave_handles_cache_id;
+#endif
 
 // HID buffer
 typedef struct buffer_s {
@@ -130,6 +198,8 @@ static buffer_t m_buffer = {0};
 // nRF52 functions.
 static void timers_init(void);
 static void scan_timeout_handler(void *p_context);
+static void key_timeout_handler(void *p_context);
+static void low_power_evt_handler(low_power_state_t state);
 static void ble_stack_init(void);
 static void ble_evt_handler(ble_evt_t const *p_ble_evt, void *p_context);
 static void gatt_init(void);
@@ -137,40 +207,73 @@ static void dis_init(void);
 static void hids_init(void);
 static void hids_evt_handler(ble_hids_t *p_hids, ble_hids_evt_t *p_evt);
 static void on_hid_rep_char_write(ble_hids_evt_t *p_evt);
+static void keymap_init(void);
+static void keymap_store_evt_handler(keymap_store_evt_t const *p_evt);
+static void profiler_dump_handler(profiler_snapshot_t const *p_snapshot);
 static void advertising_init(void);
 static void adv_evt_handler(ble_adv_evt_t ble_adv_evt);
 static void identities_set(pm_peer_id_list_skip_t skip);
 static void peer_manager_init(void);
 static void pm_evt_handler(pm_evt_t const *p_evt);
-static void gap_address_init(void);
 static void flash_data_init(void);
+static void flash_data_load_task(void *p_data, uint16_t size);
 static void fds_evt_handler(fds_evt_t const * p_evt);
 static void reset_device(void);
-static void peers_refresh(void);
-static void set_whitelist(void);
+static void system_reset(void);
+static void device_address_set(uint8_t device);
+static void device_switch(uint8_t device);
+static void device_advertise(uint8_t device);
+static void device_advertise_next(void);
+static uint8_t host_device_find(uint16_t conn_handle);
+static void host_conn_params_set(uint8_t device, bool parked);
+static void peers_refresh_task(void *p_data, uint16_t size);
+static void set_whitelist(uint8_t device);
 static void advertising_start(void);
 static void timers_start(void);
 static void hids_send_keyboard_report(uint8_t *p_report);
+static void hids_send_release_report(uint8_t device);
 #ifdef HAS_SLAVE
+#ifdef KB_LINK_GATT
 static void db_discovery_init(void);
 static void db_disc_handler(ble_db_discovery_evt_t *p_evt);
 static void kbl_c_init(void);
 static void kbl_c_evt_handler(kb_link_c_t *p_kb_link_c, kb_link_c_evt_t const * p_evt);
+static kb_link_c_t *kbl_c_find(uint16_t conn_handle);
+static void kbl_c_handles_ready(kb_link_c_t *p_kb_link_c, uint16_t conn_handle, kb_link_c_handles_t const *p_handles);
+static slave_handles_t *slave_handles_find(ble_gap_addr_t const *p_addr);
+static void slave_handles_save(uint8_t link, ble_gap_addr_t const *p_addr, kb_link_c_handles_t const *p_handles);
 static void scan_init(void);
+static void scan_evt_handler(scan_evt_t const *p_scan_evt);
 static void scan_start(void);
 #endif
+static void slave_link_init(void);
+static void slave_link_evt_handler(kb_link_transport_evt_t const *p_evt);
+static void slave_resync_timeout_handler(void *p_context);
+static void slave_state_send(void);
+static void slave_sleep_send(void);
+#endif
 
 // Firmware functions.
 static void firmware_init(void);
 static void scan_matrix_task(void *p_data, uint16_t size);
-static void update_key_index(int8_t index, uint8_t source);
+static uint32_t time_ms_get(void);
+static void combo_evt_handler(combo_evt_t const *p_evt);
+static bool tap_hold_key_check(key_index_t index, uint8_t source);
+static void tap_hold_evt_handler(tap_hold_evt_t const *p_evt);
+static void key_timer_update(void);
+static void key_timeout_task(void *p_data, uint16_t size);
+static void update_key_index(key_event_t event, uint8_t source, bool is_hold);
+static uint8_t layer_resolve(void);
 static void put_translate_key_index_task(void);
 static void translate_key_index_task(void *p_data, uint16_t size);
+static void key_index_translate(void);
 static void put_generate_hid_report_task(void);
 static void generate_hid_report_task(void *p_data, uint16_t size);
+static void hid_report_generate(void);
 #ifdef HAS_SLAVE
 static void process_slave_key_index_task(void *p_data, uint16_t size);
 static void clear_slave_key_index_task(void *p_data, uint16_t size);
+static void process_slave_key_state_task(void *p_data, uint16_t size);
 #endif
 
 int main(void) {
@@ -178,9 +281,11 @@ int main(void) {
     // nRF52.
 
     log_init();
+    bin_log_init();
     NRF_LOG_INFO("entered main");
     NRF_LOG_FLUSH();
     timers_init();
+    profiler_init(profiler_dump_handler);
     power_management_init();
     ble_stack_init();
     conn_evt_length_ext_init();
@@ -189,31 +294,31 @@ int main(void) {
     gatt_init();
     dis_init();
     hids_init();
+    keymap_init();
+    conn_latency_init();
 #ifdef HAS_SLAVE
+#ifdef KB_LINK_GATT
     db_discovery_init();
     kbl_c_init();
     scan_init();
 #endif
+    slave_link_init();
+#endif
 
     // Init advertising after all services.
     advertising_init();
     conn_params_init();
     peer_manager_init();
-    gap_address_init();
-    peers_refresh();
-    set_whitelist(); // Set whitelist once when device newly started.
+    boot_stage_mark("stack");
 
-    // Firmware.
-    pins_init();
+    // Firmware, matrix is scanned while flash data is loading.
     firmware_init();
-    low_power_mode_init(&m_scan_timer_id);
-
-    // Start.
-    advertising_start();
-#ifdef HAS_SLAVE
-    scan_start();
-#endif
+    low_power_mode_init(&m_scan_timer_id, scan_matrix_task, low_power_evt_handler);
     timers_start();
+    boot_stage_mark("matrix");
+
+    // Start, advertising follows once flash data is loaded (see flash_data_load_task).
+    flash_data_init();
 
     NRF_LOG_INFO("main; started.");
 
@@ -235,6 +340,20 @@ static void timers_init(void) {
     // Matrix scan timer
     err_code = app_timer_create(&m_scan_timer_id, APP_TIMER_MODE_REPEATED, scan_timeout_handler);
     APP_ERROR_CHECK(err_code);
+
+    // Combo & tap-hold decision timer
+    err_code = app_timer_create(&m_key_timer_id, APP_TIMER_MODE_SINGLE_SHOT, key_timeout_handler);
+    APP_ERROR_CHECK(err_code);
+
+#ifdef HAS_SLAVE
+    // Slave resync timers
+    for (int i = 0; i < SLAVE_NUM; i++) {
+        m_slave_links[i].resync_timer_id = &m_slave_links[i].resync_timer_data;
+
+        err_code = app_timer_create(&m_slave_links[i].resync_timer_id, APP_TIMER_MODE_SINGLE_SHOT, slave_resync_timeout_handler);
+        APP_ERROR_CHECK(err_code);
+    }
+#endif
 }
 
 static void scan_timeout_handler(void *p_context) {
@@ -246,6 +365,27 @@ static void scan_timeout_handler(void *p_context) {
     APP_ERROR_CHECK(err_code);
 }
 
+static void key_timeout_handler(void *p_context) {
+    UNUSED_PARAMETER(p_context);
+
+    ret_code_t err_code;
+
+    err_code = app_sched_event_put(NULL, 0, key_timeout_task);
+    APP_ERROR_CHECK(err_code);
+}
+
+static void low_power_evt_handler(low_power_state_t state) {
+    if (state == LOW_POWER_STATE_SENSE) {
+        // No key is typed, write config changes back now.
+        config_cache_idle();
+
+#ifdef HAS_SLAVE
+        // Whole keyboard is idle, let slave sleep too instead of waiting for its own delay.
+        slave_sleep_send();
+#endif
+    }
+}
+
 static void ble_stack_init(void) {
     ret_code_t err_code;
 
@@ -257,10 +397,15 @@ static void ble_stack_init(void) {
     err_code = nrf_sdh_ble_default_cfg_set(APP_BLE_CONN_CFG_TAG, &ram_start);
     APP_ERROR_CHECK(err_code);
 
+    uint32_t app_ram_start = ram_start;
+
     // Enable BLE stack.
     err_code = nrf_sdh_ble_enable(&ram_start);
     APP_ERROR_CHECK(err_code);
 
+    // SoftDevice returns RAM start it needs for link counts of sdk_config.h, RAM_START of linker script is trimmed to it.
+    NRF_LOG_INFO("RAM start; app: 0x%X, SoftDevice needs: 0x%X.", app_ram_start, ram_start);
+
     // Register a handler for BLE events.
     NRF_SDH_BLE_OBSERVER(m_ble_observer, APP_BLE_OBSERVER_PRIO, ble_evt_handler, NULL);
 }
@@ -274,20 +419,59 @@ static void ble_evt_handler(ble_evt_t const *p_ble_evt, void *p_context) {
         case BLE_GAP_EVT_CONNECTED:
             NRF_LOG_INFO("Connected.");
             if (p_ble_evt->evt.gap_evt.params.connected.role == BLE_GAP_ROLE_PERIPH) {
-                NRF_LOG_INFO("As peripheral.");
+                NRF_LOG_INFO("As peripheral; device: %u.", m_adv_device);
                 NRF_LOG_INFO("Conn params; conn interval: %i, conn sup timeout: %i.", p_ble_evt->evt.gap_evt.params.connected.conn_params.min_conn_interval * 1.25, p_ble_evt->evt.gap_evt.params.connected.conn_params.conn_sup_timeout * 10);
 
-                m_conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
+                // Host connected to advertised address.
+                m_host_conn_handles[m_adv_device] = p_ble_evt->evt.gap_evt.conn_handle;
+                m_hids_in_boot_mode[m_adv_device] = false;
+                reconnect_on_connected();
+
+                if (m_adv_device == m_device_connection.current_device) {
+                    m_conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
+                    conn_latency_host_set(m_conn_handle, &p_ble_evt->evt.gap_evt.params.connected.conn_params);
+                } else {
+                    host_conn_params_set(m_adv_device, true);
+                }
+
+                // Reconnect remaining bonded hosts.
+                device_advertise_next();
             }
-#ifdef HAS_SLAVE
+#if defined(HAS_SLAVE) && defined(KB_LINK_GATT)
             else if (p_ble_evt->evt.gap_evt.params.connected.role == BLE_GAP_ROLE_CENTRAL) {
                 NRF_LOG_INFO("As central.");
 
-                err_code = kb_link_c_handles_assign(&m_kb_link_c, p_ble_evt->evt.gap_evt.conn_handle, NULL);
-                APP_ERROR_CHECK(err_code);
+                kb_link_c_t *p_kb_link_c = kbl_c_find(BLE_CONN_HANDLE_INVALID);
 
-                err_code = ble_db_discovery_start(&m_db_disc, p_ble_evt->evt.gap_evt.conn_handle);
-                APP_ERROR_CHECK(err_code);
+                if (p_kb_link_c == NULL) {
+                    // All slave links are in use.
+                    err_code = sd_ble_gap_disconnect(p_ble_evt->evt.gap_evt.conn_handle, BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION);
+                    APP_ERROR_CHECK(err_code);
+                } else {
+                    uint8_t link = p_kb_link_c - m_kb_link_c;
+                    slave_handles_t *p_slave_handles = slave_handles_find(&p_ble_evt->evt.gap_evt.params.connected.peer_addr);
+
+                    NRF_LOG_INFO("Slave link: %d.", link);
+
+                    m_slave_links[link].addr = p_ble_evt->evt.gap_evt.params.connected.peer_addr;
+                    m_slave_links[link].handles_from_cache = p_slave_handles != NULL;
+
+                    if (p_slave_handles != NULL) {
+                        // Known slave, reuse its handles. They are validated by enabling notification.
+                        NRF_LOG_INFO("Use cached KB link handles.");
+
+                        kbl_c_handles_ready(p_kb_link_c, p_ble_evt->evt.gap_evt.conn_handle, &p_slave_handles->handles);
+                    } else {
+                        err_code = kb_link_c_handles_assign(p_kb_link_c, p_ble_evt->evt.gap_evt.conn_handle, NULL);
+                        APP_ERROR_CHECK(err_code);
+
+                        err_code = ble_db_discovery_start(&m_db_disc[link], p_ble_evt->evt.gap_evt.conn_handle);
+                        APP_ERROR_CHECK(err_code);
+                    }
+
+                    // Look for remaining slaves.
+                    scan_start();
+                }
             }
 #endif
             break;
@@ -302,14 +486,25 @@ static void ble_evt_handler(ble_evt_t const *p_ble_evt, void *p_context) {
             NRF_LOG_INFO("Conn params update; conn interval: %i, conn sup timeout: %i.", p_ble_evt->evt.gap_evt.params.conn_param_update.conn_params.min_conn_interval * 1.25, p_ble_evt->evt.gap_evt.params.conn_param_update.conn_params.conn_sup_timeout * 10);
             break;
 
-        case BLE_GAP_EVT_DISCONNECTED:
+        case BLE_GAP_EVT_DISCONNECTED: {
             NRF_LOG_INFO("Disconnected; reason: 0x%X.", p_ble_evt->evt.gap_evt.params.disconnected.reason);
 
-            if (p_ble_evt->evt.gap_evt.conn_handle == m_conn_handle) {
-                m_conn_handle = BLE_CONN_HANDLE_INVALID;
-                m_peer_id = PM_PEER_ID_INVALID;
+            uint8_t device = host_device_find(p_ble_evt->evt.gap_evt.conn_handle);
+
+            if (device < DEVICE_NUM) {
+                m_host_conn_handles[device] = BLE_CONN_HANDLE_INVALID;
+                m_host_release_pending[device] = false;
+
+                if (p_ble_evt->evt.gap_evt.conn_handle == m_conn_handle) {
+                    m_conn_handle = BLE_CONN_HANDLE_INVALID;
+                    m_peer_id = PM_PEER_ID_INVALID;
+                    conn_latency_host_set(BLE_CONN_HANDLE_INVALID, NULL);
+                }
+
+                device_advertise_next();
             }
-            break;
+        }
+        break;
 
         case BLE_GAP_EVT_PHY_UPDATE_REQUEST: {
             NRF_LOG_DEBUG("PHY update request.");
@@ -340,11 +535,16 @@ static void ble_evt_handler(ble_evt_t const *p_ble_evt, void *p_context) {
             APP_ERROR_CHECK(err_code);
             break;
 
-        case BLE_GATTS_EVT_HVN_TX_COMPLETE:
+        case BLE_GATTS_EVT_HVN_TX_COMPLETE: {
+            uint8_t device = host_device_find(p_ble_evt->evt.gatts_evt.conn_handle);
+
             if (p_ble_evt->evt.gatts_evt.conn_handle == m_conn_handle && m_buffer.count > 0) {
                 hids_send_keyboard_report(NULL);
+            } else if (device < DEVICE_NUM && m_host_release_pending[device]) {
+                hids_send_release_report(device);
             }
-            break;
+        }
+        break;
 
         default:
             // No implementation needed.
@@ -495,19 +695,26 @@ static void hids_init(void) {
 }
 
 static void hids_evt_handler(ble_hids_t *p_hids, ble_hids_evt_t *p_evt) {
+    // Protocol mode is written by each host for its own link.
+    uint8_t device = p_evt->p_ble_evt != NULL ? host_device_find(p_evt->p_ble_evt->evt.gatts_evt.conn_handle) : DEVICE_NUM;
+
     NRF_LOG_INFO("HIDs evt; evt: 0x%X.", p_evt->evt_type);
 
     switch (p_evt->evt_type) {
         case BLE_HIDS_EVT_BOOT_MODE_ENTERED:
-            NRF_LOG_INFO("Boot mode entered.");
+            NRF_LOG_INFO("Boot mode entered; device: %u.", device);
 
-            m_hids_in_boot_mode = true;
+            if (device < DEVICE_NUM) {
+                m_hids_in_boot_mode[device] = true;
+            }
             break;
 
         case BLE_HIDS_EVT_REPORT_MODE_ENTERED:
-            NRF_LOG_INFO("Report mode entered.");
+            NRF_LOG_INFO("Report mode entered; device: %u.", device);
 
-            m_hids_in_boot_mode = false;
+            if (device < DEVICE_NUM) {
+                m_hids_in_boot_mode[device] = false;
+            }
             break;
 
         case BLE_HIDS_EVT_REP_CHAR_WRITE:
@@ -527,6 +734,13 @@ static void hids_evt_handler(ble_hids_t *p_hids, ble_hids_evt_t *p_evt) {
 }
 
 static void on_hid_rep_char_write(ble_hids_evt_t *p_evt) {
+    uint16_t conn_handle = p_evt->p_ble_evt != NULL ? p_evt->p_ble_evt->evt.gatts_evt.conn_handle : m_conn_handle;
+    uint8_t device = host_device_find(conn_handle);
+
+    if (device >= DEVICE_NUM) {
+        return;
+    }
+
     if (p_evt->params.char_write.char_id.rep_type == BLE_HIDS_REP_TYPE_OUTPUT) {
         ret_code_t err_code;
         uint8_t report_val;
@@ -536,25 +750,62 @@ static void on_hid_rep_char_write(ble_hids_evt_t *p_evt) {
             // This code assumes that the output report is one byte long. Hence the following static assert is made.
             STATIC_ASSERT(OUTPUT_REPORT_MAX_LEN == 1);
 
-            err_code = ble_hids_outp_rep_get(&m_hids, report_index, OUTPUT_REPORT_MAX_LEN, 0, m_conn_handle, &report_val);
+            err_code = ble_hids_outp_rep_get(&m_hids, report_index, OUTPUT_REPORT_MAX_LEN, 0, conn_handle, &report_val);
             APP_ERROR_CHECK(err_code);
 
-            // Set Caps Lock indicator here.
-            if (!m_caps_lock_on && ((report_val & OUTPUT_REPORT_BIT_MASK_CAPS_LOCK) != 0)) {
+            // Set Caps Lock indicator here, LEDs of parked host are kept for when it's switched to.
+            if (!m_caps_lock_on[device] && ((report_val & OUTPUT_REPORT_BIT_MASK_CAPS_LOCK) != 0)) {
                 // Caps Lock is turned On.
-                NRF_LOG_INFO("Caps Lock is turned On!");
+                NRF_LOG_INFO("Caps Lock is turned On; device: %u.", device);
 
-                m_caps_lock_on = true;
-            } else if (m_caps_lock_on && ((report_val & OUTPUT_REPORT_BIT_MASK_CAPS_LOCK) == 0)) {
+                m_caps_lock_on[device] = true;
+            } else if (m_caps_lock_on[device] && ((report_val & OUTPUT_REPORT_BIT_MASK_CAPS_LOCK) == 0)) {
                 // Caps Lock is turned Off.
-                NRF_LOG_INFO("Caps Lock is turned Off!");
+                NRF_LOG_INFO("Caps Lock is turned Off; device: %u.", device);
 
-                m_caps_lock_on = false;
+                m_caps_lock_on[device] = false;
             }
+
+#ifdef HAS_SLAVE
+            slave_state_send();
+#endif
         }
     }
 }
 
+static void keymap_init(void) {
+    ret_code_t err_code;
+
+    err_code = keymap_service_init(&m_keymap_service);
+    APP_ERROR_CHECK(err_code);
+
+    // Keymap is read in place from flash, compiled one is used until a keymap is uploaded.
+    keymap_store_init(keymap_store_evt_handler);
+}
+
+static void keymap_store_evt_handler(keymap_store_evt_t const *p_evt) {
+    ret_code_t err_code;
+    uint8_t cmd = p_evt->evt_type == KEYMAP_STORE_EVT_BEGIN ? KEYMAP_CONTROL_CMD_BEGIN : KEYMAP_CONTROL_CMD_COMMIT;
+
+    NRF_LOG_INFO("Keymap upload; cmd: %u, status: %u.", cmd, p_evt->status);
+
+    // Host may have dropped notifications, it can retry the command.
+    err_code = keymap_service_status_send(&m_keymap_service, cmd, p_evt->status);
+    NRF_LOG_DEBUG("keymap_service_status_send; ret: 0x%X.", err_code);
+}
+
+// Counters of last dump are read by host through keymap service.
+static void profiler_dump_handler(profiler_snapshot_t const *p_snapshot) {
+#if PROFILER_ENABLED
+    ret_code_t err_code;
+
+    err_code = keymap_service_profiler_set(&m_keymap_service, p_snapshot);
+    APP_ERROR_CHECK(err_code);
+#else
+    UNUSED_PARAMETER(p_snapshot);
+#endif
+}
+
 static void advertising_init(void) {
     ret_code_t err_code;
     ble_advertising_init_t init = {0};
@@ -567,6 +818,7 @@ static void advertising_init(void) {
     init.srdata.name_type = BLE_ADVDATA_FULL_NAME;
 
     init.config.ble_adv_whitelist_enabled = true;
+    init.config.ble_adv_directed_high_duty_enabled = true;
     init.config.ble_adv_fast_enabled = true;
     init.config.ble_adv_fast_interval = MASTER_ADV_FAST_INTERVAL;
     init.config.ble_adv_fast_timeout = MASTER_ADV_FAST_DURATION;
@@ -581,6 +833,8 @@ static void advertising_init(void) {
     APP_ERROR_CHECK(err_code);
 
     ble_advertising_conn_cfg_tag_set(&m_advertising, APP_BLE_CONN_CFG_TAG);
+
+    reconnect_init(&m_advertising, &init.config);
 }
 
 static void adv_evt_handler(const ble_adv_evt_t ble_adv_evt) {
@@ -588,7 +842,13 @@ static void adv_evt_handler(const ble_adv_evt_t ble_adv_evt) {
 
     NRF_LOG_INFO("ADV evt; evt: 0x%X.", ble_adv_evt);
 
+    reconnect_on_adv_evt(ble_adv_evt);
+
     switch (ble_adv_evt) {
+        case BLE_ADV_EVT_DIRECTED_HIGH_DUTY:
+            NRF_LOG_INFO("High duty directed advertising.");
+            break;
+
         case BLE_ADV_EVT_FAST:
             NRF_LOG_INFO("Fast advertising.");
             break;
@@ -677,13 +937,23 @@ static void pm_evt_handler(pm_evt_t const *p_evt) {
     pm_handler_on_pm_evt(p_evt);
     pm_handler_flash_clean(p_evt);
 
-    ret_code_t err_code;
-
     switch (p_evt->evt_id) {
         case PM_EVT_CONN_SEC_SUCCEEDED:
             NRF_LOG_INFO("Connection secured.");
 
+            if (p_evt->conn_handle != m_conn_handle) {
+                break;
+            }
+
             m_peer_id = p_evt->peer_id;
+
+            if (m_device_switch_timing) {
+                m_device_switch_timing = false;
+
+                uint32_t ticks = app_timer_cnt_diff_compute(app_timer_cnt_get(), m_device_switch_tick);
+
+                NRF_LOG_INFO("Device switch time: %d ms.", ROUNDED_DIV((uint64_t)ticks * 1000 * (APP_TIMER_CONFIG_RTC_FREQUENCY + 1), APP_TIMER_CLOCK_FREQ));
+            }
             break;
 
         case PM_EVT_CONN_SEC_CONFIG_REQ: {
@@ -697,11 +967,17 @@ static void pm_evt_handler(pm_evt_t const *p_evt) {
 
         case PM_EVT_PEER_DATA_UPDATE_SUCCEEDED:
             if (p_evt->params.peer_data_update_succeeded.flash_changed && p_evt->params.peer_data_update_succeeded.data_id == PM_PEER_DATA_ID_BONDING) {
-                // Set peer id for current device.
-                m_device_connection.peer_ids[m_device_connection.current_device] = p_evt->peer_id;
+                uint16_t conn_handle;
+                uint8_t device = m_device_connection.current_device;
 
-                err_code = fds_record_update(&m_device_connection_record_desc, &m_device_connection_record);
-                APP_ERROR_CHECK(err_code);
+                // Set peer id for device of bonded host.
+                if (pm_conn_handle_get(p_evt->peer_id, &conn_handle) == NRF_SUCCESS && host_device_find(conn_handle) < DEVICE_NUM) {
+                    device = host_device_find(conn_handle);
+                }
+
+                m_device_connection.peer_ids[device] = p_evt->peer_id;
+
+                config_cache_record_dirty(m_device_connection_cache_id);
             }
             break;
 
@@ -714,17 +990,14 @@ static void pm_evt_handler(pm_evt_t const *p_evt) {
     }
 }
 
-static void gap_address_init(void) {
+static void device_address_set(uint8_t device) {
     ret_code_t err_code;
-
-    flash_data_init();
-
     ble_gap_addr_t gap_addr;
 
     err_code = sd_ble_gap_addr_get(&gap_addr);
     APP_ERROR_CHECK(err_code);
 
-    gap_addr.addr[3] = m_device_connection.addrs[m_device_connection.current_device];
+    gap_addr.addr[3] = m_device_connection.addrs[device];
 
     err_code = sd_ble_gap_addr_set(&gap_addr);
     APP_ERROR_CHECK(err_code);
@@ -733,14 +1006,24 @@ static void gap_address_init(void) {
 static void flash_data_init(void) {
     ret_code_t err_code;
 
+    config_cache_init();
+
     err_code = fds_register(fds_evt_handler);
     APP_ERROR_CHECK(err_code);
 
     err_code = fds_init();
     APP_ERROR_CHECK(err_code);
+}
 
-    while (!m_fds_initialized) {
-        idle_state_handle();
+static void flash_data_load_task(void *p_data, uint16_t size) {
+    UNUSED_PARAMETER(p_data);
+    UNUSED_PARAMETER(size);
+
+    ret_code_t err_code;
+
+    if (m_flash_data_loaded) {
+        // FDS init event is sent to every user, peer manager's included.
+        return;
     }
 
     // Device connection init.
@@ -775,29 +1058,80 @@ static void flash_data_init(void) {
 
         uint8_t bytes_available;
 
-        do {
-            err_code = sd_rand_application_bytes_available_get(&bytes_available);
-            APP_ERROR_CHECK(err_code);
+        err_code = sd_rand_application_bytes_available_get(&bytes_available);
+        APP_ERROR_CHECK(err_code);
 
-            while (bytes_available < 3) {
-                nrf_delay_ms(OPERATION_DELAY);
+        if (bytes_available < 3) {
+            // Let pool fill up while main loop runs, instead of waiting here.
+            err_code = app_sched_event_put(NULL, 0, flash_data_load_task);
+            APP_ERROR_CHECK(err_code);
+            return;
+        }
 
-                err_code = sd_rand_application_bytes_available_get(&bytes_available);
-                APP_ERROR_CHECK(err_code);
-            }
+        err_code = sd_rand_application_vector_get(&m_device_connection.addrs[0], 3);
+        APP_ERROR_CHECK(err_code);
 
-            err_code = sd_rand_application_vector_get(&m_device_connection.addrs[0], 3);
+        if (m_device_connection.addrs[0] == m_device_connection.addrs[1] || m_device_connection.addrs[1] == m_device_connection.addrs[2] || m_device_connection.addrs[2] == m_device_connection.addrs[0]) {
+            // To ensure unique addresses, draw again.
+            err_code = app_sched_event_put(NULL, 0, flash_data_load_task);
             APP_ERROR_CHECK(err_code);
-        } while (m_device_connection.addrs[0] == m_device_connection.addrs[1] || m_device_connection.addrs[1] == m_device_connection.addrs[2] || m_device_connection.addrs[2] == m_device_connection.addrs[0]); // To ensure unique addresses.
+            return;
+        }
 
         NRF_LOG_INFO("Addrs; 0x%X, 0x%X, 0x%X.", m_device_connection.addrs[0], m_device_connection.addrs[1], m_device_connection.addrs[2]);
+    }
 
-        m_reset_device_connection_update = true;
-        err_code = fds_record_write(&m_device_connection_record_desc, &m_device_connection_record);
-        APP_ERROR_CHECK(err_code);
+    m_device_connection_cache_id = config_cache_record_add(&m_device_connection_record, generate_new_device_connection ? NULL : &m_device_connection_record_desc);
+
+    if (generate_new_device_connection) {
+        // Write right away, device restarts once it's done.
+        config_cache_record_dirty(m_device_connection_cache_id);
+        reset_device();
 
         NRF_LOG_INFO("New device connection config is written, device will restart soon.");
     }
+
+#if defined(HAS_SLAVE) && defined(KB_LINK_GATT)
+    // Slave handles init.
+    memset(&token, 0, sizeof(token));
+
+    err_code = fds_record_find(CONFIG_FILE_ID, SLAVE_HANDLES_KEY, &m_slave_handles_record_desc, &token);
+
+    m_slave_handles_cache_id = config_cache_record_add(&m_slave_handles_record, err_code == FDS_SUCCESS ? &m_slave_handles_record_desc : NULL);
+
+    if (err_code == FDS_SUCCESS) {
+        fds_flash_record_t slave_handles_record;
+
+        err_code = fds_record_open(&m_slave_handles_record_desc, &slave_handles_record);
+
+        if (err_code == FDS_SUCCESS) {
+            NRF_LOG_INFO("Found slave handles record.");
+
+            // Record may be shorter if it was written with less slaves.
+            memcpy(m_slave_handles, slave_handles_record.p_data, MIN(sizeof(m_slave_handles), slave_handles_record.p_header->length_words * sizeof(uint32_t)));
+
+            err_code = fds_record_close(&m_slave_handles_record_desc);
+            APP_ERROR_CHECK(err_code);
+        }
+    }
+#endif
+
+    m_flash_data_loaded = true;
+    boot_stage_mark("flash data");
+
+    m_adv_device = m_device_connection.current_device;
+    device_address_set(m_adv_device);
+    set_whitelist(m_adv_device); // Set whitelist once when device newly started.
+
+    advertising_start();
+#if defined(HAS_SLAVE) && defined(KB_LINK_GATT)
+    scan_start();
+#endif
+    boot_stage_mark("advertising");
+
+    // Bonds of other peers don't gate advertising, whitelist only holds peer of device.
+    err_code = app_sched_event_put(NULL, 0, peers_refresh_task);
+    APP_ERROR_CHECK(err_code);
 }
 
 static void fds_evt_handler(fds_evt_t const * p_evt) {
@@ -805,17 +1139,10 @@ static void fds_evt_handler(fds_evt_t const * p_evt) {
         case FDS_EVT_INIT:
             NRF_LOG_INFO("FDS initialized.");
 
-            if (p_evt->result == FDS_SUCCESS) {
-                m_fds_initialized = true;
-            }
-            break;
-
-        case FDS_EVT_WRITE:
-        case FDS_EVT_UPDATE:
-            NRF_LOG_INFO("FDS record write.");
-
-            if (p_evt->result == FDS_SUCCESS && p_evt->write.file_id == CONFIG_FILE_ID && p_evt->write.record_key == DEVICE_CONNECTION_KEY && m_reset_device_connection_update) {
-                reset_device();
+            if (p_evt->result == FDS_SUCCESS && !m_flash_data_loaded) {
+                // Init event may come from within fds_init, load records from main loop.
+                ret_code_t err_code = app_sched_event_put(NULL, 0, flash_data_load_task);
+                APP_ERROR_CHECK(err_code);
             }
             break;
 
@@ -825,7 +1152,14 @@ static void fds_evt_handler(fds_evt_t const * p_evt) {
     }
 }
 
+// Restarts once config changes made so far are written.
 static void reset_device(void) {
+    NRF_LOG_INFO("Restart requested.");
+
+    config_cache_sync(system_reset);
+}
+
+static void system_reset(void) {
     NRF_LOG_INFO("Restarting.");
     NRF_LOG_FINAL_FLUSH();
 
@@ -835,8 +1169,124 @@ static void reset_device(void) {
     APP_ERROR_CHECK(err_code);
 }
 
-static void peers_refresh(void) {
-    // ret_code_t err_code;
+static void device_switch(uint8_t device) {
+    uint8_t prev_device = m_device_connection.current_device;
+
+    NRF_LOG_INFO("Live switch to device %u.", device);
+
+    // Reports queued for previous host are dropped, it gets a release of every key so nothing stays held there.
+    m_buffer.start = 0;
+    m_buffer.end = 0;
+    m_buffer.count = 0;
+    hids_send_release_report(prev_device);
+
+    m_device_connection.current_device = device;
+    m_device_switch_tick = app_timer_cnt_get();
+    m_device_switch_timing = false;
+
+    // Written on idle, quick switches between devices cost one flash write.
+    config_cache_record_dirty(m_device_connection_cache_id);
+
+    // Previous host stays connected, parked.
+    host_conn_params_set(prev_device, true);
+
+    m_conn_handle = m_host_conn_handles[device];
+    m_peer_id = PM_PEER_ID_INVALID;
+    conn_latency_host_set(m_conn_handle, NULL);
+
+    if (m_conn_handle != BLE_CONN_HANDLE_INVALID) {
+        // Host is already connected, reports just go to its link from now on.
+        m_peer_id = m_device_connection.peer_ids[device];
+        host_conn_params_set(device, false);
+
+        NRF_LOG_INFO("Device switch time: %d ms.", ROUNDED_DIV((uint64_t)app_timer_cnt_diff_compute(app_timer_cnt_get(), m_device_switch_tick) * 1000 * (APP_TIMER_CONFIG_RTC_FREQUENCY + 1), APP_TIMER_CLOCK_FREQ));
+    } else {
+        m_device_switch_timing = true;
+        device_advertise(device);
+    }
+
+    // New host has reports of its own from now on, its LEDs go to slave.
+    m_host_release_pending[device] = false;
+#ifdef HAS_SLAVE
+    slave_state_send();
+#endif
+}
+
+static void device_advertise(uint8_t device) {
+    // Address can't be changed while advertising or scanning. Advertising may be restarted on disconnection already.
+    reconnect_stop();
+
+#if defined(HAS_SLAVE) && defined(KB_LINK_GATT)
+    slave_scan_stop();
+#endif
+
+    NRF_LOG_INFO("Advertise for device %u.", device);
+
+    m_adv_device = device;
+    device_address_set(device);
+    set_whitelist(device);
+
+    // Whitelist is applied on whitelist request of advertising, directed advertising goes to bonded host of device.
+    advertising_start();
+#if defined(HAS_SLAVE) && defined(KB_LINK_GATT)
+    scan_start();
+#endif
+}
+
+static void device_advertise_next(void) {
+    uint8_t current_device = m_device_connection.current_device;
+
+    // Current device first, then bonded hosts which are not connected.
+    for (int i = 0; i < DEVICE_NUM; i++) {
+        uint8_t device = (current_device + i) % DEVICE_NUM;
+
+        if (m_host_conn_handles[device] != BLE_CONN_HANDLE_INVALID) {
+            continue;
+        }
+
+        if (device == current_device || m_device_connection.peer_ids[device] != PM_PEER_ID_INVALID) {
+            device_advertise(device);
+            return;
+        }
+    }
+
+    // Every host is connected.
+    reconnect_stop();
+}
+
+static uint8_t host_device_find(uint16_t conn_handle) {
+    for (uint8_t i = 0; i < DEVICE_NUM; i++) {
+        if (conn_handle != BLE_CONN_HANDLE_INVALID && m_host_conn_handles[i] == conn_handle) {
+            return i;
+        }
+    }
+
+    return DEVICE_NUM;
+}
+
+static void host_conn_params_set(uint8_t device, bool parked) {
+    ret_code_t err_code;
+    ble_gap_conn_params_t conn_params = {
+        .min_conn_interval = parked ? PARKED_MIN_CONN_INTERVAL : MASTER_MIN_CONN_INTERVAL,
+        .max_conn_interval = parked ? PARKED_MAX_CONN_INTERVAL : MASTER_MAX_CONN_INTERVAL,
+        .slave_latency = parked ? PARKED_SLAVE_LATENCY : SLAVE_LATENCY,
+        .conn_sup_timeout = parked ? PARKED_CONN_SUP_TIMEOUT : CONN_SUP_TIMEOUT
+    };
+
+    if (m_host_conn_handles[device] == BLE_CONN_HANDLE_INVALID) {
+        return;
+    }
+
+    // Conn params module keeps negotiating these parameters for the link.
+    err_code = ble_conn_params_change_conn_params(m_host_conn_handles[device], &conn_params);
+
+    NRF_LOG_INFO("Host conn params; device: %u, parked: %d, ret: 0x%X.", device, parked, err_code);
+}
+
+static void peers_refresh_task(void *p_data, uint16_t size) {
+    UNUSED_PARAMETER(p_data);
+    UNUSED_PARAMETER(size);
+
     pm_peer_id_t peer_id;
 
     // Delete not old peers.
@@ -848,11 +1298,13 @@ static void peers_refresh(void) {
 
         peer_id = pm_next_peer_id_get(peer_id);
     }
+
+    boot_stage_mark("peers");
 }
 
-static void set_whitelist() {
+static void set_whitelist(uint8_t device) {
     ret_code_t err_code;
-    pm_peer_id_t peer_id = m_device_connection.peer_ids[m_device_connection.current_device];
+    pm_peer_id_t peer_id = m_device_connection.peer_ids[device];
 
     if (peer_id != PM_PEER_ID_INVALID) {
         err_code = pm_whitelist_set(&peer_id, 1);
@@ -864,10 +1316,7 @@ static void set_whitelist() {
 }
 
 static void advertising_start(void) {
-    ret_code_t err_code;
-
-    err_code = ble_advertising_start(&m_advertising, BLE_ADV_MODE_FAST);
-    APP_ERROR_CHECK(err_code);
+    reconnect_start(m_device_connection.peer_ids[m_adv_device]);
 }
 
 static void timers_start(void) {
@@ -892,13 +1341,17 @@ static void hids_send_keyboard_report(uint8_t *p_report) {
         }
 
         while (m_buffer.count > 0) {
-            if (m_hids_in_boot_mode) {
+            if (m_hids_in_boot_mode[m_device_connection.current_device]) {
                 err_code = ble_hids_boot_kb_inp_rep_send(&m_hids, INPUT_REPORT_KEYS_MAX_LEN, &m_buffer.reports[m_buffer.start][0], m_conn_handle);
             } else {
                 err_code = ble_hids_inp_rep_send(&m_hids, INPUT_REPORT_KEYS_INDEX, INPUT_REPORT_KEYS_MAX_LEN, &m_buffer.reports[m_buffer.start][0], m_conn_handle);
             }
 
-            NRF_LOG_INFO("HIDs report; ret: 0x%X.", err_code);
+            BIN_LOG_1(BIN_LOG_HIDS_REPORT, err_code);
+
+            if (err_code == NRF_SUCCESS) {
+                low_power_wake_report_sent();
+            }
 
             if (err_code != NRF_ERROR_RESOURCES) {
                 m_buffer.count--;
@@ -911,7 +1364,7 @@ static void hids_send_keyboard_report(uint8_t *p_report) {
                 break;
             }
 
-            NRF_LOG_INFO("HIDs report queue: %i", m_buffer.count);
+            BIN_LOG_1(BIN_LOG_HIDS_QUEUE, m_buffer.count);
 
             if (err_code != NRF_SUCCESS && err_code != NRF_ERROR_INVALID_STATE && err_code != NRF_ERROR_RESOURCES && err_code != NRF_ERROR_BUSY && err_code != BLE_ERROR_GATTS_SYS_ATTR_MISSING && err_code != NRF_ERROR_FORBIDDEN) {
                 APP_ERROR_CHECK(err_code);
@@ -920,17 +1373,49 @@ static void hids_send_keyboard_report(uint8_t *p_report) {
     }
 }
 
-#ifdef HAS_SLAVE
-void db_discovery_init(void) {
+// Empty report to a host which is no longer current, retried on TX complete of its link while its queue is full.
+static void hids_send_release_report(uint8_t device) {
     ret_code_t err_code;
+    uint8_t report[INPUT_REPORT_KEYS_MAX_LEN] = {0};
+    uint16_t conn_handle = m_host_conn_handles[device];
 
-    err_code = ble_db_discovery_init(db_disc_handler);
-    APP_ERROR_CHECK(err_code);
-}
+    m_host_release_pending[device] = false;
 
-static void db_disc_handler(ble_db_discovery_evt_t *p_evt) {
-    kb_link_c_on_db_disc_evt(&m_kb_link_c, p_evt);
-}
+    if (conn_handle == BLE_CONN_HANDLE_INVALID) {
+        return;
+    }
+
+    if (m_hids_in_boot_mode[device]) {
+        err_code = ble_hids_boot_kb_inp_rep_send(&m_hids, INPUT_REPORT_KEYS_MAX_LEN, report, conn_handle);
+    } else {
+        err_code = ble_hids_inp_rep_send(&m_hids, INPUT_REPORT_KEYS_INDEX, INPUT_REPORT_KEYS_MAX_LEN, report, conn_handle);
+    }
+
+    BIN_LOG_1(BIN_LOG_HIDS_REPORT, err_code);
+
+    m_host_release_pending[device] = err_code == NRF_ERROR_RESOURCES;
+
+    if (err_code != NRF_SUCCESS && err_code != NRF_ERROR_INVALID_STATE && err_code != NRF_ERROR_RESOURCES && err_code != NRF_ERROR_BUSY && err_code != BLE_ERROR_GATTS_SYS_ATTR_MISSING && err_code != NRF_ERROR_FORBIDDEN) {
+        APP_ERROR_CHECK(err_code);
+    }
+}
+
+#ifdef HAS_SLAVE
+#ifdef KB_LINK_GATT
+void db_discovery_init(void) {
+    ret_code_t err_code;
+
+    err_code = ble_db_discovery_init(db_disc_handler);
+    APP_ERROR_CHECK(err_code);
+}
+
+static void db_disc_handler(ble_db_discovery_evt_t *p_evt) {
+    kb_link_c_t *p_kb_link_c = kbl_c_find(p_evt->conn_handle);
+
+    if (p_kb_link_c != NULL) {
+        kb_link_c_on_db_disc_evt(p_kb_link_c, p_evt);
+    }
+}
 
 static void kbl_c_init(void) {
     ret_code_t err_code;
@@ -938,41 +1423,135 @@ static void kbl_c_init(void) {
 
     init.evt_handler = kbl_c_evt_handler;
 
-    err_code = kb_link_c_init(&m_kb_link_c, &init);
-    APP_ERROR_CHECK(err_code);
+    for (int i = 0; i < SLAVE_NUM; i++) {
+        err_code = kb_link_c_init(&m_kb_link_c[i], &init);
+        APP_ERROR_CHECK(err_code);
+
+        m_slave_handles[i].handles.key_index_handle = BLE_CONN_HANDLE_INVALID;
+    }
 }
 
 static void kbl_c_evt_handler(kb_link_c_t *p_kb_link_c, kb_link_c_evt_t const * p_evt) {
     ret_code_t err_code;
+    uint8_t link = p_kb_link_c - m_kb_link_c;
+    slave_handles_t *p_slave_handles;
 
     switch (p_evt->evt_type) {
         case KB_LINK_C_EVT_DISCOVERY_COMPLETE:
-            NRF_LOG_INFO("KB link discovery complete.");
+            NRF_LOG_INFO("KB link discovery complete; link: %d.", link);
 
-            err_code = kb_link_c_handles_assign(p_kb_link_c, p_evt->conn_handle, &p_evt->handles);
-            APP_ERROR_CHECK(err_code);
+            m_slave_links[link].handles_from_cache = false;
+            slave_handles_save(link, &m_slave_links[link].addr, &p_evt->handles);
 
-            NRF_LOG_INFO("Enable notification.");
+            kbl_c_handles_ready(p_kb_link_c, p_evt->conn_handle, &p_evt->handles);
+            break;
 
-            err_code = kb_link_c_key_index_notif_enable(p_kb_link_c);
-            APP_ERROR_CHECK(err_code);
+        case KB_LINK_C_EVT_HANDLES_INVALID:
+            NRF_LOG_INFO("KB link handles invalid.");
+
+            if (m_slave_links[link].handles_from_cache) {
+                // Cache is stale, fall back to discovery.
+                m_slave_links[link].handles_from_cache = false;
+
+                p_slave_handles = slave_handles_find(&m_slave_links[link].addr);
+
+                if (p_slave_handles != NULL) {
+                    p_slave_handles->handles.key_index_handle = BLE_CONN_HANDLE_INVALID;
+                }
+
+                err_code = ble_db_discovery_start(&m_db_disc[link], p_evt->conn_handle);
+                APP_ERROR_CHECK(err_code);
+            } else {
+                err_code = sd_ble_gap_disconnect(p_evt->conn_handle, BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION);
+                APP_ERROR_CHECK(err_code);
+            }
             break;
 
-        case KB_LINK_C_EVT_KEY_INDEX_UPDATE:
-            NRF_LOG_INFO("Receive notification from KB link; len: %d.", p_evt->len);
+        case KB_LINK_C_EVT_KEY_INDEX_NOTIF_ENABLED:
+            // Notifications are on, so no update can be missed from now; read current state of slave.
+            err_code = kb_link_c_key_state_read(p_kb_link_c);
 
-            app_sched_event_put(p_evt->p_data, p_evt->len, process_slave_key_index_task);
+            if (err_code != NRF_ERROR_INVALID_STATE) {
+                APP_ERROR_CHECK(err_code);
+            }
             break;
 
         case KB_LINK_C_EVT_DISCONNECTED:
-            NRF_LOG_INFO("KB link disconnected.");
-
-            // Clear all keys that have been registered by slave.
-            app_sched_event_put(NULL, 0, clear_slave_key_index_task);
+            // Link is free again, look for slave.
+            scan_start();
+            break;
 
-            // Scan for slave will start automatically.
+        default:
             break;
     }
+
+    // Pass link state & data to the transport.
+    kb_link_transport_gatt_on_kbl_c_evt(p_kb_link_c, p_evt);
+}
+
+// Find client by its connection, BLE_CONN_HANDLE_INVALID finds a free one.
+static kb_link_c_t *kbl_c_find(uint16_t conn_handle) {
+    for (int i = 0; i < SLAVE_NUM; i++) {
+        if (m_kb_link_c[i].conn_handle == conn_handle) {
+            return &m_kb_link_c[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void kbl_c_handles_ready(kb_link_c_t *p_kb_link_c, uint16_t conn_handle, kb_link_c_handles_t const *p_handles) {
+    ret_code_t err_code;
+
+    err_code = kb_link_c_handles_assign(p_kb_link_c, conn_handle, p_handles);
+    APP_ERROR_CHECK(err_code);
+
+    if (p_handles->key_state_handle == BLE_CONN_HANDLE_INVALID) {
+        uint8_t link = p_kb_link_c - m_kb_link_c;
+
+        // Slave can't be resynced, drop everything it had registered.
+        err_code = app_timer_stop(m_slave_links[link].resync_timer_id);
+        APP_ERROR_CHECK(err_code);
+
+        err_code = app_sched_event_put(&link, sizeof(link), clear_slave_key_index_task);
+        APP_ERROR_CHECK(err_code);
+    }
+
+    NRF_LOG_INFO("Enable notification.");
+
+    err_code = kb_link_c_key_index_notif_enable(p_kb_link_c);
+    APP_ERROR_CHECK(err_code);
+}
+
+static slave_handles_t *slave_handles_find(ble_gap_addr_t const *p_addr) {
+    for (int i = 0; i < SLAVE_NUM; i++) {
+        if (m_slave_handles[i].handles.key_index_handle != BLE_CONN_HANDLE_INVALID && m_slave_handles[i].addr.addr_type == p_addr->addr_type && memcmp(m_slave_handles[i].addr.addr, p_addr->addr, BLE_GAP_ADDR_LEN) == 0) {
+            return &m_slave_handles[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void slave_handles_save(uint8_t link, ble_gap_addr_t const *p_addr, kb_link_c_handles_t const *p_handles) {
+    slave_handles_t *p_slave_handles = slave_handles_find(p_addr);
+
+    if (p_slave_handles != NULL && memcmp(&p_slave_handles->handles, p_handles, sizeof(kb_link_c_handles_t)) == 0) {
+        return;
+    }
+
+    if (p_slave_handles == NULL) {
+        // New slave takes cache entry of its link.
+        p_slave_handles = &m_slave_handles[link];
+    }
+
+    p_slave_handles->addr = *p_addr;
+    p_slave_handles->handles = *p_handles;
+
+    // Written on idle, slaves usually connect together after boot.
+    config_cache_record_dirty(m_slave_handles_cache_id);
+
+    NRF_LOG_INFO("Save KB link handles; link: %u.", link);
 }
 
 static void scan_init(void) {
@@ -997,7 +1576,7 @@ static void scan_init(void) {
     init.p_scan_param = &scan_params;
     init.p_conn_param = &conn_params;
 
-    err_code = nrf_ble_scan_init(&m_scan, &init, NULL);
+    err_code = nrf_ble_scan_init(&m_scan, &init, scan_evt_handler);
     APP_ERROR_CHECK(err_code);
 
     err_code = nrf_ble_scan_filter_set(&m_scan, SCAN_UUID_FILTER, &scan_uuid);
@@ -1005,16 +1584,131 @@ static void scan_init(void) {
 
     err_code = nrf_ble_scan_filters_enable(&m_scan, NRF_BLE_SCAN_UUID_FILTER, true);
     APP_ERROR_CHECK(err_code);
+
+    slave_scan_init(&m_scan, &scan_params);
+}
+
+static void scan_evt_handler(scan_evt_t const *p_scan_evt) {
+    // Restart on timeout with backoff.
+    slave_scan_on_scan_evt(p_scan_evt);
 }
 
 static void scan_start(void) {
+    if (kbl_c_find(BLE_CONN_HANDLE_INVALID) == NULL) {
+        // All slaves are connected.
+        return;
+    }
+
     NRF_LOG_INFO("scan_start.");
 
+    slave_scan_start();
+}
+#endif
+
+static void slave_link_init(void) {
     ret_code_t err_code;
+    void *p_context = NULL;
+
+    slave_sync_init();
 
-    err_code = nrf_ble_scan_start(&m_scan);
+#ifdef KB_LINK_GATT
+    p_context = m_kb_link_c;
+#endif
+
+    err_code = m_p_slave_link->init(p_context, slave_link_evt_handler);
     APP_ERROR_CHECK(err_code);
 }
+
+static void slave_link_evt_handler(kb_link_transport_evt_t const *p_evt) {
+    ret_code_t err_code;
+    slave_link_t *p_slave_link = &m_slave_links[p_evt->link];
+
+    switch (p_evt->evt_type) {
+        case KB_LINK_TRANSPORT_EVT_CONNECTED:
+            NRF_LOG_INFO("Slave link connected; link: %d.", p_evt->link);
+
+            slave_sync_connected(p_evt->link);
+
+            // Bring slave up to date with master state.
+            slave_state_send();
+            break;
+
+        case KB_LINK_TRANSPORT_EVT_RX:
+            if (p_evt->msg == KB_LINK_MSG_KEY_INDEX) {
+                BIN_LOG_2(BIN_LOG_SLAVE_KEY_INDEX_RX, p_evt->link, p_evt->len);
+
+                // Key events go after their link, to be registered with source of that link.
+                key_event_t data[SLAVE_KEY_NUM + 1];
+                uint8_t len = MIN(p_evt->len / sizeof(key_event_t), SLAVE_KEY_NUM);
+
+                data[0] = p_evt->link;
+                memcpy(&data[1], p_evt->p_data, len * sizeof(key_event_t));
+
+                err_code = app_sched_event_put(data, (len + 1) * sizeof(key_event_t), process_slave_key_index_task);
+                APP_ERROR_CHECK(err_code);
+            } else if (p_evt->msg == KB_LINK_MSG_KEY_STATE) {
+                BIN_LOG_2(BIN_LOG_SLAVE_KEY_STATE_RX, p_evt->link, p_evt->len);
+
+                // Key events of link carry every change after connection, later snapshots are not resynced.
+                if (!slave_sync_key_state_set(p_evt->link, p_evt->p_data, p_evt->len)) {
+                    break;
+                }
+
+                err_code = app_timer_stop(p_slave_link->resync_timer_id);
+                APP_ERROR_CHECK(err_code);
+
+                err_code = app_sched_event_put(&p_evt->link, sizeof(p_evt->link), process_slave_key_state_task);
+                APP_ERROR_CHECK(err_code);
+            }
+            break;
+
+        case KB_LINK_TRANSPORT_EVT_DISCONNECTED:
+            NRF_LOG_INFO("Slave link disconnected; link: %d.", p_evt->link);
+
+            slave_sync_disconnected(p_evt->link);
+
+            // Keep keys registered by slave for a while, they are resynced if slave comes back in time.
+            err_code = app_timer_start(p_slave_link->resync_timer_id, APP_TIMER_TICKS(SLAVE_RESYNC_TIMEOUT), p_slave_link);
+            APP_ERROR_CHECK(err_code);
+            break;
+    }
+}
+
+static void slave_resync_timeout_handler(void *p_context) {
+    ret_code_t err_code;
+    uint8_t link = (slave_link_t *)p_context - m_slave_links;
+
+    NRF_LOG_INFO("Slave resync timeout; link: %d.", link);
+
+    // Slave didn't come back, clear all keys that have been registered by slave.
+    err_code = app_sched_event_put(&link, sizeof(link), clear_slave_key_index_task);
+    APP_ERROR_CHECK(err_code);
+}
+
+static void slave_state_send(void) {
+    uint8_t leds = m_caps_lock_on[m_device_connection.current_device] ? OUTPUT_REPORT_BIT_MASK_CAPS_LOCK : 0;
+    uint8_t data[] = {KB_LINK_CONTROL_CMD_STATE, m_layer, leds};
+
+    for (int i = 0; i < SLAVE_NUM; i++) {
+        if (!slave_sync_state_pending(i, m_layer, leds)) {
+            continue;
+        }
+
+        // Write command may not fit in queue, state will be resent on next change.
+        if (m_p_slave_link->send(i, KB_LINK_MSG_CONTROL, data, sizeof(data)) == NRF_SUCCESS) {
+            slave_sync_state_sent(i, m_layer, leds);
+        }
+    }
+}
+
+static void slave_sleep_send(void) {
+    uint8_t data[] = {KB_LINK_CONTROL_CMD_SLEEP};
+
+    // Best effort, slave falls back to its own low power mode delay.
+    for (int i = 0; i < SLAVE_NUM; i++) {
+        m_p_slave_link->send(i, KB_LINK_MSG_CONTROL, data, sizeof(data));
+    }
+}
 #endif
 
 /*
@@ -1023,94 +1717,180 @@ static void scan_start(void) {
 static void firmware_init(void) {
     NRF_LOG_INFO("firmware_init.");
 
+    combo_init_t combo_init_params = {
+        .p_buffer = m_combo_buffer,
+        .combo_term = COMBO_TERM,
+        .evt_handler = combo_evt_handler
+    };
+
+    tap_hold_init_t tap_hold_init_params = {
+        .tapping_term = TAPPING_TERM,
+        .policy = TAP_HOLD_POLICY,
+        .key_check = tap_hold_key_check,
+        .evt_handler = tap_hold_evt_handler
+    };
+
     // Init m_keys array.
     memset(&m_keys, 0, sizeof(m_keys));
 
-    for (int i = 0; i < MATRIX_ROW_NUM; i++) {
-        for (int j = 0; j < MATRIX_COL_NUM; j++) {
-            m_debounce[i][j] = KEY_PRESS_DEBOUNCE;
-        }
-    }
+    keymap_store_combos_get(&combo_init_params.p_combos, &combo_init_params.combo_num);
+    combo_init(&combo_init_params);
+    tap_hold_init(&tap_hold_init_params);
+
+    matrix_init(&MATRIX_BACKEND_INSTANCE);
 }
 
 static void scan_matrix_task(void *p_data, uint16_t size) {
     UNUSED_PARAMETER(p_data);
-    UNUSED_PARAMETER(size);
 
-    // ret_code_t err_code;
-    bool has_key_press = false;
-    bool has_key_release = false;
+    PROFILER_BEGIN();
 
-    for (int col = 0; col < MATRIX_COL_NUM; col++) {
-        nrf_gpio_pin_set(COLS[col]);
-        nrf_delay_us(100);
+    static bool first_key_marked = false;
+    matrix_scan_t scan;
+    uint32_t time = time_ms_get();
 
-        for (int row = 0; row < MATRIX_ROW_NUM; row++) {
-            bool pressed = nrf_gpio_pin_read(ROWS[row]) > 0;
+    // Keys pressed on wake up were already qualified by the PORT event.
+    matrix_scan(size > 0, &scan);
 
-            if (m_key_pressed[row][col] == pressed) {
-                if (pressed) {
-                    m_debounce[row][col] = KEY_RELEASE_DEBOUNCE;
-                } else {
-                    m_debounce[row][col] = KEY_PRESS_DEBOUNCE;
-                }
-            } else {
-                if (m_debounce[row][col] <= 0) {
-                    if (pressed) {
-                        // On key press
-                        m_key_pressed[row][col] = true;
-                        m_debounce[row][col] = KEY_RELEASE_DEBOUNCE;
-
-                        has_key_press = true;
-                        update_key_index(MATRIX[row][col], SOURCE);
-                    } else {
-                        // On key release
-                        m_key_pressed[row][col] = false;
-                        m_debounce[row][col] = KEY_PRESS_DEBOUNCE;
+    for (int i = 0; i < scan.key_num; i++) {
+        combo_process(scan.keys[i], SOURCE, time);
+    }
 
-                        has_key_release = true;
-                        update_key_index(-MATRIX[row][col], SOURCE);
-                    }
-                } else {
-                    m_debounce[row][col] -= SCAN_DELAY;
-                }
-            }
-        }
+    if (scan.key_num > 0) {
+        key_timer_update();
+    }
 
-        nrf_gpio_pin_clear(COLS[col]);
+    if (scan.has_press && !first_key_marked) {
+        first_key_marked = true;
+        boot_stage_mark("first key");
     }
 
-    if (has_key_press) {
+    if (scan.has_press) {
         // If has key press, translate it first.
         put_translate_key_index_task();
-    } else if (has_key_release) {
+    } else if (scan.has_release) {
         // If has only key release, just sent it to device.
         put_generate_hid_report_task();
     }
 
-    if (has_key_press || has_key_release) {
-        m_low_power_mode_counter = LOW_POWER_MODE_DELAY;
-    } else {
-        m_low_power_mode_counter -= SCAN_DELAY;
+    if (scan.has_activity) {
+        // Report follows once debounce is done, make host link listen on next connection event.
+        conn_latency_key_edge();
     }
 
-    if (m_low_power_mode_counter <= 0) {
-        m_low_power_mode_counter = LOW_POWER_MODE_DELAY;
-        low_power_mode_start();
+    if (scan.has_press && m_conn_handle == BLE_CONN_HANDLE_INVALID) {
+        // Typing while disconnected, advertise again if reconnection gave up.
+        reconnect_activity();
     }
+
+#if defined(HAS_SLAVE) && defined(KB_LINK_GATT)
+    if (scan.has_press) {
+        // Slave is likely being used too, look for it at base duty for a while.
+        slave_scan_activity();
+    }
+#endif
+
+    low_power_mode_scan_done(scan.has_activity);
+
+    PROFILER_END(PROFILER_SCAN);
 }
 
-static void update_key_index(int8_t index, uint8_t source) {
+// In ms since boot. RTC counter wraps every 512 s, which is only followed while it's read more often; key
+// timing only needs differences while a tap-hold key is undecided.
+static uint32_t time_ms_get(void) {
+    static uint32_t last_ticks = 0;
+    static uint64_t ticks = 0;
+    uint32_t now = app_timer_cnt_get();
+
+    ticks += app_timer_cnt_diff_compute(now, last_ticks);
+    last_ticks = now;
+
+    return ticks * 1000 * (APP_TIMER_CONFIG_RTC_FREQUENCY + 1) / APP_TIMER_CLOCK_FREQ;
+}
+
+static void combo_evt_handler(combo_evt_t const *p_evt) {
+    tap_hold_process(p_evt->event, p_evt->source, p_evt->time);
+
+    if (p_evt->is_replay) {
+        // Same as tap-hold replay, unless tap-hold holds event back in turn.
+        key_index_translate();
+        hid_report_generate();
+    }
+}
+
+// Pressed key is tap-hold key on layer of keys held before it, with transparency followed.
+static bool tap_hold_key_check(key_index_t index, uint8_t source) {
+    UNUSED_PARAMETER(source);
+
+    int layer = layer_resolve();
+    uint32_t code = keymap_store_code(layer, index - 1);
+
+    while (code == KC_TRANSPARENT && layer > 0) {
+        code = keymap_store_code(--layer, index - 1);
+    }
+
+    return IS_TAP_HOLD(code);
+}
+
+static void tap_hold_evt_handler(tap_hold_evt_t const *p_evt) {
+    update_key_index(p_evt->event, p_evt->source, p_evt->is_hold);
+
+    if (p_evt->is_replay) {
+        // Held back events come out together, report each on its own so host sees every edge in order.
+        key_index_translate();
+        hid_report_generate();
+    }
+}
+
+// One timer serves both engines, it runs to the earlier deadline.
+static void key_timer_update(void) {
+    ret_code_t err_code;
+    uint32_t deadline;
+    uint32_t combo_deadline;
+    bool has_deadline = tap_hold_deadline_get(&deadline);
+
+    if (combo_deadline_get(&combo_deadline) && (!has_deadline || (int32_t)(combo_deadline - deadline) < 0)) {
+        deadline = combo_deadline;
+        has_deadline = true;
+    }
+
+    err_code = app_timer_stop(m_key_timer_id);
+    APP_ERROR_CHECK(err_code);
+
+    if (has_deadline) {
+        int32_t time_left = deadline - time_ms_get();
+
+        err_code = app_timer_start(m_key_timer_id, MAX(APP_TIMER_TICKS(MAX(time_left, 0)), APP_TIMER_MIN_TIMEOUT_TICKS), NULL);
+        APP_ERROR_CHECK(err_code);
+    }
+}
+
+static void key_timeout_task(void *p_data, uint16_t size) {
+    UNUSED_PARAMETER(p_data);
+    UNUSED_PARAMETER(size);
+
+    uint32_t time = time_ms_get();
+
+    combo_timeout(time);
+    tap_hold_timeout(time);
+    key_timer_update();
+}
+
+static void update_key_index(key_event_t event, uint8_t source, bool is_hold) {
     key_t2 key = {0};
 
-    key.index = index;
+    key.index = KEY_EVENT_INDEX(event);
     key.source = source;
+    key.is_hold = is_hold;
 
-    if (m_key_count < KEY_NUM && key.index > 0) {
+    if (key.index == 0) {
+        return;
+    }
+
+    if (m_key_count < KEY_NUM && KEY_EVENT_IS_PRESS(event)) {
         m_keys[m_key_count++] = key;
-    } else if (m_key_count > 0 && key.index < 0) {
+    } else if (m_key_count > 0 && !KEY_EVENT_IS_PRESS(event)) {
         int i = 0;
-        key.index = -key.index;
 
         while (i < m_key_count) {
             while (!(m_keys[i].index == key.index && m_keys[i].source == key.source) && i < m_key_count) {
@@ -1139,12 +1919,46 @@ static void put_translate_key_index_task(void) {
     }
 }
 
+// Layer of held layer keys, as translation walks them.
+static uint8_t layer_resolve(void) {
+    uint8_t layer = _BASE_LAYER;
+
+    for (int i = 0; i < m_key_count; i++) {
+        if (m_keys[i].translated) {
+            continue;
+        }
+
+        uint32_t code = keymap_store_code(layer, m_keys[i].index - 1);
+
+        if (IS_TAP_HOLD(code) && m_keys[i].is_hold) {
+            code = HOLD_CODE(code);
+        }
+
+        if (IS_LAYER(code)) {
+            layer = LAYER(code);
+        }
+    }
+
+    return layer;
+}
+
 static void translate_key_index_task(void *p_data, uint16_t size) {
     UNUSED_PARAMETER(p_data);
     UNUSED_PARAMETER(size);
 
     m_translate_key_index_task_queued = false;
 
+    PROFILER_BEGIN();
+
+    key_index_translate();
+
+    // Schedule hid report task
+    put_generate_hid_report_task();
+
+    PROFILER_END(PROFILER_TRANSLATE);
+}
+
+static void key_index_translate(void) {
     ret_code_t err_code;
     uint8_t layer = _BASE_LAYER;
 
@@ -1153,8 +1967,12 @@ static void translate_key_index_task(void *p_data, uint16_t size) {
             continue;
         }
 
-        int8_t index = m_keys[i].index - 1;
-        uint32_t code = KEYMAP[layer][index];
+        key_index_t index = m_keys[i].index - 1;
+        uint32_t code = keymap_store_code(layer, index);
+
+        if (IS_TAP_HOLD(code)) {
+            code = m_keys[i].is_hold ? HOLD_CODE(code) : TAP_CODE(code);
+        }
 
         if (IS_LAYER(code)) {
             layer = LAYER(code);
@@ -1165,14 +1983,18 @@ static void translate_key_index_task(void *p_data, uint16_t size) {
             m_keys[i].translated = true;
             uint8_t temp_layer = layer;
 
-            while (temp_layer >= 0 && KEYMAP[temp_layer][index] == KC_TRANSPARENT) {
+            while (temp_layer >= 0 && keymap_store_code(temp_layer, index) == KC_TRANSPARENT) {
                 temp_layer--;
             }
 
             if (temp_layer < 0) {
                 continue;
             } else {
-                code = KEYMAP[temp_layer][index];
+                code = keymap_store_code(temp_layer, index);
+            }
+
+            if (IS_TAP_HOLD(code)) {
+                code = m_keys[i].is_hold ? HOLD_CODE(code) : TAP_CODE(code);
             }
         }
 
@@ -1192,22 +2014,22 @@ static void translate_key_index_task(void *p_data, uint16_t size) {
             continue;
         }
 
-        if (IS_DEVICE_CONNECTION(code)) {
+        if (IS_DEVICE_CONNECTION(code) && m_flash_data_loaded) {
             NRF_LOG_INFO("Device connection.");
 
+            // Act once per press, later translations while key is held skip it.
+            m_keys[i].translated = true;
+
             if (IS_DEVICE_SWITCHING(code)) {
                 uint8_t device = DEVICE(code);
 
                 NRF_LOG_INFO("Switching to device %u.", device);
 
                 if (device != m_device_connection.current_device) {
-                    m_device_connection.current_device = device;
-
-                    m_reset_device_connection_update = true;
-                    err_code = fds_record_update(&m_device_connection_record_desc, &m_device_connection_record);
-                    APP_ERROR_CHECK(err_code);
-                } else {
-                    reset_device();
+                    device_switch(device);
+                } else if (m_conn_handle == BLE_CONN_HANDLE_INVALID) {
+                    // Current device is not connected, advertise for it again.
+                    device_advertise(device);
                 }
             }
 
@@ -1239,15 +2061,17 @@ static void translate_key_index_task(void *p_data, uint16_t size) {
                 // Reset peer id for current device.
                 m_device_connection.peer_ids[m_device_connection.current_device] = PM_PEER_ID_INVALID;
 
-                m_reset_device_connection_update = true;
-                err_code = fds_record_update(&m_device_connection_record_desc, &m_device_connection_record);
-                APP_ERROR_CHECK(err_code);
+                // Write right away, device restarts once it's done.
+                config_cache_record_dirty(m_device_connection_cache_id);
+                reset_device();
             }
         }
     }
 
-    // Schedule hid report task
-    put_generate_hid_report_task();
+    m_layer = layer;
+#ifdef HAS_SLAVE
+    slave_state_send();
+#endif
 }
 
 static void put_generate_hid_report_task(void) {
@@ -1267,6 +2091,14 @@ static void generate_hid_report_task(void *p_data, uint16_t size) {
 
     m_generate_hid_report_task_queued = false;
 
+    PROFILER_BEGIN();
+
+    hid_report_generate();
+
+    PROFILER_END(PROFILER_REPORT);
+}
+
+static void hid_report_generate(void) {
     static bool empty_report_sent = true;
     int report_index = 2;
     uint8_t report[INPUT_REPORT_KEYS_MAX_LEN] = {0};
@@ -1295,34 +2127,48 @@ static void generate_hid_report_task(void *p_data, uint16_t size) {
         empty_report_sent = false;
     }
 
-    NRF_LOG_INFO("generate_hid_report_task; len: %d", report_index - 2);
+    BIN_LOG_1(BIN_LOG_REPORT_GENERATE, report_index - 2);
 
     hids_send_keyboard_report((uint8_t *)report);
 }
 
 #ifdef HAS_SLAVE
 static void process_slave_key_index_task(void *p_data, uint16_t size) {
-    int8_t *key_index = (int8_t *)p_data;
+    key_event_t const *p_events = p_data;
+    uint8_t source = SLAVE_SOURCE(p_events[0]);
+    uint32_t time = time_ms_get();
 
-    for (int i = 0; i < size; i++) {
-        NRF_LOG_INFO("process_slave_key_index_task; key: %i.", key_index[i]);
+    for (int i = 1; i < size / sizeof(key_event_t); i++) {
+        BIN_LOG_3(BIN_LOG_SLAVE_KEY_EVENT, source, KEY_EVENT_INDEX(p_events[i]), KEY_EVENT_IS_PRESS(p_events[i]));
 
-        update_key_index(key_index[i], SOURCE_SLAVE);
+        combo_process(p_events[i], source, time);
     }
 
+    key_timer_update();
+
+    // Slave activity keeps whole keyboard awake.
+    low_power_mode_activity();
+    conn_latency_key_edge();
+
     put_translate_key_index_task();
 }
 
 static void clear_slave_key_index_task(void *p_data, uint16_t size) {
-    UNUSED_PARAMETER(p_data);
     UNUSED_PARAMETER(size);
 
-    NRF_LOG_INFO("clear_slave_key_index_task.");
+    uint8_t source = SLAVE_SOURCE(*(uint8_t *)p_data);
+
+    NRF_LOG_INFO("clear_slave_key_index_task; source: %d.", source);
+
+    // Keys are removed behind combo & tap-hold engines, let their held back events out first.
+    combo_flush();
+    tap_hold_flush();
+    key_timer_update();
 
     int i = 0;
 
     while (i < m_key_count) {
-        while (m_keys[i].source != SOURCE_SLAVE && i < m_key_count) {
+        while (m_keys[i].source != source && i < m_key_count) {
             i++;
         }
 
@@ -1338,4 +2184,53 @@ static void clear_slave_key_index_task(void *p_data, uint16_t size) {
     // Only remove keys, so no translation needed.
     put_generate_hid_report_task();
 }
+
+static void process_slave_key_state_task(void *p_data, uint16_t size) {
+    UNUSED_PARAMETER(size);
+
+    uint8_t link = *(uint8_t *)p_data;
+    uint8_t source = SLAVE_SOURCE(link);
+    key_index_t registered[KEY_NUM];
+    key_event_t events[SLAVE_SYNC_EVENT_MAX];
+    uint8_t registered_num = 0;
+    uint8_t event_num;
+
+    BIN_LOG_2(BIN_LOG_SLAVE_KEY_STATE, source, slave_sync_key_state_len(link));
+
+    // Registered keys are compared with slave, so nothing may be held back in engines. Fired combos are released,
+    // their keys still held are pressed again as plain keys, which go past combo engine.
+    combo_flush();
+    tap_hold_flush();
+
+    for (int i = 0; i < m_key_count; i++) {
+        if (m_keys[i].source == source) {
+            registered[registered_num++] = m_keys[i].index;
+        }
+    }
+
+    uint32_t time = time_ms_get();
+
+    bool has_key_press = false;
+    bool has_key_release = false;
+
+    event_num = slave_sync_resync(link, registered, registered_num, events);
+
+    for (int i = 0; i < event_num; i++) {
+        if (KEY_EVENT_IS_PRESS(events[i])) {
+            has_key_press = true;
+        } else {
+            has_key_release = true;
+        }
+
+        tap_hold_process(events[i], source, time);
+    }
+
+    key_timer_update();
+
+    if (has_key_press) {
+        put_translate_key_index_task();
+    } else if (has_key_release) {
+        put_generate_hid_report_task();
+    }
+}
 #endif
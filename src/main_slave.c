@@ -1,3 +1,6 @@
+#define NRF_LOG_MODULE_NAME main
+#define NRF_LOG_LEVEL       MAIN_LOG_LEVEL
+
 #include <stdint.h>
 
 #include "app_error.h"
@@ -10,21 +13,25 @@
 #include "nordic_common.h"
 #include "nrf_assert.h"
 #include "nrf_ble_gatt.h"
-#include "nrf_delay.h"
-#include "nrf_gpio.h"
 #include "nrf_log.h"
 #include "nrf_sdh_ble.h"
 #include "nrf_sdh_soc.h"
 #include "nrf_sdh.h"
 #include "nrf.h"
 
-#include "config/keyboard.h"
+#include "keyboard.h"
+#include "bin_log/bin_log.h"
 #include "error_handler/error_handler.h"
 #include "firmware_config.h"
 #include "kb_link/kb_link.h"
+#include "kb_link/kb_link_transport.h"
 #include "low_power/low_power.h"
+#include "matrix/matrix.h"
+#include "profiler/profiler.h"
 #include "shared/shared.h"
 
+NRF_LOG_MODULE_REGISTER();
+
 /*
  * Variables declaration.
  */
@@ -34,17 +41,14 @@ NRF_BLE_GATT_DEF(m_gatt);
 BLE_ADVERTISING_DEF(m_advertising);
 KB_LINK_DEF(m_kb_link);
 
+static const kb_link_transport_t *m_p_master_link = &KB_LINK_TRANSPORT_INSTANCE;
+
 static uint16_t m_conn_handle = BLE_CONN_HANDLE_INVALID; // Handle of the current connection.
 static ble_uuid_t m_adv_uuid = {SLAVE_UUID, BLE_UUID_TYPE_VENDOR_BEGIN};
 
-// Firmware variables.
-const uint8_t ROWS[MATRIX_ROW_NUM] = MATRIX_ROW_PINS;
-const uint8_t COLS[MATRIX_COL_NUM] = MATRIX_COL_PINS;
-const int8_t MATRIX[MATRIX_ROW_NUM][MATRIX_COL_NUM] = MATRIX_DEFINE;
-
-static bool m_key_pressed[MATRIX_ROW_NUM][MATRIX_COL_NUM] = {0};
-static int m_debounce[MATRIX_ROW_NUM][MATRIX_COL_NUM];
-static int m_low_power_mode_counter = LOW_POWER_MODE_DELAY;
+// State pushed by master.
+static uint8_t m_layer = 0;
+static uint8_t m_host_leds = 0;
 
 /*
  * Functions declaration.
@@ -59,18 +63,25 @@ static void advertising_init(void);
 static void adv_evt_handler(ble_adv_evt_t ble_adv_evt);
 static void dis_init(void);
 static void kbl_init(void);
+static void kbl_evt_handler(kb_link_t *p_kb_link, kb_link_evt_t const *p_evt);
+static void master_link_init(void);
+static void master_link_evt_handler(kb_link_transport_evt_t const *p_evt);
 static void advertising_start(void);
 static void timers_start(void);
 
 // Firmware functions.
 static void firmware_init(void);
 static void scan_matrix_task(void *p_data, uint16_t size);
+static void update_key_state(void);
+static void sleep_task(void *p_data, uint16_t size);
 
 int main(void) {
     // Initialize.
     // nRF52.
     log_init();
+    bin_log_init();
     timers_init();
+    profiler_init(NULL); // No keymap service on slave, counters go to RTT log.
     power_management_init();
     ble_stack_init();
     conn_evt_length_ext_init();
@@ -79,6 +90,7 @@ int main(void) {
     gatt_init();
     dis_init();
     kbl_init();
+    master_link_init();
 
     // Init advertising after all services.
     advertising_init();
@@ -86,11 +98,12 @@ int main(void) {
 
     // Firmware.
     firmware_init();
-    pins_init();
-    low_power_mode_init(&m_scan_timer_id);
+    low_power_mode_init(&m_scan_timer_id, scan_matrix_task, NULL);
 
     // Start.
+#ifdef KB_LINK_GATT
     advertising_start();
+#endif
     timers_start();
 
     NRF_LOG_INFO("main; started.");
@@ -134,10 +147,15 @@ static void ble_stack_init(void) {
     err_code = nrf_sdh_ble_default_cfg_set(APP_BLE_CONN_CFG_TAG, &ram_start);
     APP_ERROR_CHECK(err_code);
 
+    uint32_t app_ram_start = ram_start;
+
     // Enable BLE stack.
     err_code = nrf_sdh_ble_enable(&ram_start);
     APP_ERROR_CHECK(err_code);
 
+    // SoftDevice returns RAM start it needs for link counts of sdk_config.h, RAM_START of linker script is trimmed to it.
+    NRF_LOG_INFO("RAM start; app: 0x%X, SoftDevice needs: 0x%X.", app_ram_start, ram_start);
+
     // Register a handler for BLE events.
     NRF_SDH_BLE_OBSERVER(m_ble_observer, APP_BLE_OBSERVER_PRIO, ble_evt_handler, NULL);
 }
@@ -145,7 +163,7 @@ static void ble_stack_init(void) {
 static void ble_evt_handler(ble_evt_t const *p_ble_evt, void *p_context) {
     ret_code_t err_code;
 
-    NRF_LOG_INFO("BLE evt; evt: 0x%X.", p_ble_evt->header.evt_id);
+    NRF_LOG_DEBUG("BLE evt; evt: 0x%X.", p_ble_evt->header.evt_id);
 
     switch (p_ble_evt->header.evt_id) {
         case BLE_GAP_EVT_CONNECTED:
@@ -228,11 +246,58 @@ static void kbl_init(void) {
 
     init.len = 0;
     init.key_index = NULL;
+    init.evt_handler = kbl_evt_handler;
 
     err_code = kb_link_init(&m_kb_link, &init);
     APP_ERROR_CHECK(err_code);
 }
 
+static void kbl_evt_handler(kb_link_t *p_kb_link, kb_link_evt_t const *p_evt) {
+    UNUSED_PARAMETER(p_kb_link);
+
+    // Pass link data to the transport.
+    kb_link_transport_gatt_on_kbl_evt(p_evt);
+}
+
+static void master_link_init(void) {
+    ret_code_t err_code;
+
+    err_code = m_p_master_link->init(&m_kb_link, master_link_evt_handler);
+    APP_ERROR_CHECK(err_code);
+}
+
+static void master_link_evt_handler(kb_link_transport_evt_t const *p_evt) {
+    if (p_evt->evt_type == KB_LINK_TRANSPORT_EVT_CONNECTED) {
+        // Master has to know what is held right now.
+        update_key_state();
+        return;
+    }
+
+    if (p_evt->evt_type != KB_LINK_TRANSPORT_EVT_RX || p_evt->msg != KB_LINK_MSG_CONTROL || p_evt->len == 0) {
+        return;
+    }
+
+    switch (p_evt->p_data[0]) {
+        case KB_LINK_CONTROL_CMD_STATE:
+            if (p_evt->len >= 3) {
+                m_layer = p_evt->p_data[1];
+                m_host_leds = p_evt->p_data[2];
+
+                NRF_LOG_DEBUG("Master state; layer: %d, leds: 0x%X.", m_layer, m_host_leds);
+            }
+            break;
+
+        case KB_LINK_CONTROL_CMD_SLEEP:
+            NRF_LOG_INFO("Master requests sleep.");
+
+            app_sched_event_put(NULL, 0, sleep_task);
+            break;
+
+        default:
+            break;
+    }
+}
+
 static void advertising_init(void) {
     uint32_t err_code;
     ble_advertising_init_t init = {0};
@@ -296,76 +361,50 @@ static void timers_start(void) {
 static void firmware_init(void) {
     NRF_LOG_INFO("firmware_init.");
 
-    for (int i = 0; i < MATRIX_ROW_NUM; i++) {
-        for (int j = 0; j < MATRIX_COL_NUM; j++) {
-            m_debounce[i][j] = KEY_PRESS_DEBOUNCE;
-        }
-    }
+    matrix_init(&MATRIX_BACKEND_INSTANCE);
 }
 
 static void scan_matrix_task(void *p_data, uint16_t size) {
     UNUSED_PARAMETER(p_data);
-    UNUSED_PARAMETER(size);
 
-    ret_code_t err_code;
-    bool buffer_changed = false;
-    int buffer_len = 0;
-    int8_t buffer[SLAVE_KEY_NUM] = {0};
-
-    for (int col = 0; col < MATRIX_COL_NUM; col++) {
-        nrf_gpio_pin_set(COLS[col]);
-        nrf_delay_us(PIN_SET_DELAY);
-
-        for (int row = 0; row < MATRIX_ROW_NUM; row++) {
-            bool pressed = nrf_gpio_pin_read(ROWS[row]) > 0;
-
-            if (m_key_pressed[row][col] == pressed) {
-                if (pressed) {
-                    m_debounce[row][col] = KEY_RELEASE_DEBOUNCE;
-                } else {
-                    m_debounce[row][col] = KEY_PRESS_DEBOUNCE;
-                }
-            } else {
-                if (m_debounce[row][col] <= 0) {
-                    if (pressed) {
-                        // On key press
-                        m_key_pressed[row][col] = true;
-                        m_debounce[row][col] = KEY_RELEASE_DEBOUNCE;
-
-                        if (buffer_len < SLAVE_KEY_NUM) {
-                            buffer_changed = true;
-                            buffer[buffer_len++] = MATRIX[row][col];
-                        }
-                    } else {
-                        // On key release
-                        m_key_pressed[row][col] = false;
-                        m_debounce[row][col] = KEY_PRESS_DEBOUNCE;
-
-                        if (buffer_len < SLAVE_KEY_NUM) {
-                            buffer_changed = true;
-                            buffer[buffer_len++] = -MATRIX[row][col];
-                        }
-                    }
-                } else {
-                    m_debounce[row][col] -= SCAN_DELAY;
-                }
+    PROFILER_BEGIN();
+
+    matrix_scan_t scan;
+
+    // Keys pressed on wake up were already qualified by the PORT event.
+    matrix_scan(size > 0, &scan);
+
+    if (scan.key_num > 0) {
+#ifdef KB_LINK_GATT
+        // Update key state snapshot before notifying, so master never reads an older state than it was notified.
+        // Framed transports send key state only on (re)connection, master would take each one as resync.
+        update_key_state();
+#endif
+
+        // Send key index to master, SLAVE_KEY_NUM edges per message.
+        for (uint16_t i = 0; i < scan.key_num; i += SLAVE_KEY_NUM) {
+            if (m_p_master_link->send(0, KB_LINK_MSG_KEY_INDEX, (uint8_t *)&scan.keys[i], MIN(scan.key_num - i, SLAVE_KEY_NUM) * sizeof(key_event_t)) == NRF_SUCCESS && i == 0) {
+                low_power_wake_report_sent();
             }
         }
-
-        nrf_gpio_pin_clear(COLS[col]);
     }
 
-    if (buffer_changed) {
-        m_low_power_mode_counter = LOW_POWER_MODE_DELAY;
+    low_power_mode_scan_done(scan.has_activity);
 
-        // Set key index characteristics
-        kb_link_key_index_update(&m_kb_link, (uint8_t *)buffer, buffer_len);
-    } else {
-        m_low_power_mode_counter -= SCAN_DELAY;
-    }
+    PROFILER_END(PROFILER_SCAN);
+}
 
-    if (m_low_power_mode_counter <= 0) {
-        m_low_power_mode_counter = LOW_POWER_MODE_DELAY;
-        low_power_mode_start();
-    }
+static void update_key_state(void) {
+    key_index_t key_state[SLAVE_KEY_NUM] = {0};
+    uint16_t key_state_len = matrix_pressed_get(key_state, SLAVE_KEY_NUM);
+
+    m_p_master_link->send(0, KB_LINK_MSG_KEY_STATE, (uint8_t *)key_state, key_state_len * sizeof(key_index_t));
+}
+
+static void sleep_task(void *p_data, uint16_t size) {
+    UNUSED_PARAMETER(p_data);
+    UNUSED_PARAMETER(size);
+
+    // Keeps scanning slowly while a key is held.
+    low_power_mode_start();
 }
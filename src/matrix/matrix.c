@@ -0,0 +1,125 @@
+#include "matrix.h"
+
+#include <string.h>
+
+#include "../firmware_config.h"
+
+_Static_assert(MATRIX_ROW_NUM <= sizeof(matrix_col_t) * 8, "Rows don't fit in matrix column.");
+_Static_assert(MATRIX_KEY_NUM <= KEY_POSITION_NUM, "Half has more keys than keyboard has key positions.");
+_Static_assert(KEY_POSITION_NUM <= KEY_INDEX_MAX, "Key positions don't fit key event.");
+
+const key_index_t MATRIX[MATRIX_ROW_NUM][MATRIX_COL_NUM] = MATRIX_DEFINE;
+
+static matrix_backend_t const *m_p_backend;
+static matrix_col_t m_pressed[MATRIX_COL_NUM];  // Debounced state.
+static matrix_col_t m_bouncing[MATRIX_COL_NUM]; // Switch differs from debounced state, debounce is counting.
+static int m_debounce[MATRIX_ROW_NUM][MATRIX_COL_NUM];
+
+void matrix_init(matrix_backend_t const *p_backend) {
+    m_p_backend = p_backend;
+
+    memset(m_pressed, 0, sizeof(m_pressed));
+    memset(m_bouncing, 0, sizeof(m_bouncing));
+
+    for (int row = 0; row < MATRIX_ROW_NUM; row++) {
+        for (int col = 0; col < MATRIX_COL_NUM; col++) {
+            m_debounce[row][col] = KEY_PRESS_DEBOUNCE;
+        }
+    }
+
+    m_p_backend->init();
+}
+
+void matrix_scan(bool is_wake_scan, matrix_scan_t *p_scan) {
+    matrix_col_t cols[MATRIX_COL_NUM];
+
+    p_scan->key_num = 0;
+    p_scan->has_press = false;
+    p_scan->has_release = false;
+    p_scan->has_activity = false;
+
+    m_p_backend->read(cols);
+
+    for (int col = 0; col < MATRIX_COL_NUM; col++) {
+        matrix_col_t changed = cols[col] ^ m_pressed[col];
+
+        // Settled column needs no work, which is every column of idle matrix.
+        if ((changed | m_bouncing[col]) == 0) {
+            continue;
+        }
+
+        for (int row = 0; row < MATRIX_ROW_NUM; row++) {
+            matrix_col_t bit = (matrix_col_t)1 << row;
+            bool pressed = (cols[col] & bit) != 0;
+
+            if ((changed & bit) == 0) {
+                if (m_bouncing[col] & bit) {
+                    // Bounced back, debounce starts over on next change.
+                    m_bouncing[col] &= ~bit;
+                    m_debounce[row][col] = pressed ? KEY_RELEASE_DEBOUNCE : KEY_PRESS_DEBOUNCE;
+                }
+                continue;
+            }
+
+            if (m_debounce[row][col] <= 0 || (is_wake_scan && pressed)) {
+                m_pressed[col] ^= bit;
+                m_bouncing[col] &= ~bit;
+
+                if (pressed) {
+                    m_debounce[row][col] = KEY_RELEASE_DEBOUNCE;
+                    p_scan->keys[p_scan->key_num++] = KEY_EVENT(MATRIX[row][col], true);
+                    p_scan->has_press = true;
+                } else {
+                    m_debounce[row][col] = KEY_PRESS_DEBOUNCE;
+                    p_scan->keys[p_scan->key_num++] = KEY_EVENT(MATRIX[row][col], false);
+                    p_scan->has_release = true;
+                }
+            } else {
+                m_bouncing[col] |= bit;
+                m_debounce[row][col] -= SCAN_DELAY;
+            }
+
+            p_scan->has_activity = true;
+        }
+    }
+}
+
+uint16_t matrix_pressed_get(key_index_t *p_keys, uint16_t max_len) {
+    uint16_t len = 0;
+
+    for (int row = 0; row < MATRIX_ROW_NUM; row++) {
+        for (int col = 0; col < MATRIX_COL_NUM; col++) {
+            if ((m_pressed[col] & ((matrix_col_t)1 << row)) && len < max_len) {
+                p_keys[len++] = MATRIX[row][col];
+            }
+        }
+    }
+
+    return len;
+}
+
+bool matrix_pressed_any(void) {
+    for (int col = 0; col < MATRIX_COL_NUM; col++) {
+        if (m_pressed[col] != 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool matrix_sense_available(void) {
+    return m_p_backend->sense_arm != NULL;
+}
+
+void matrix_sense_arm(void) {
+    m_p_backend->sense_arm();
+}
+
+bool matrix_sense_missed(void) {
+    return m_p_backend->sense_missed();
+}
+
+void matrix_sense_disarm(void) {
+    m_p_backend->sense_disarm();
+}
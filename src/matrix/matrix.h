@@ -0,0 +1,81 @@
+#ifndef _MATRIX_H_
+#define _MATRIX_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "keyboard.h"
+#include "../key_event.h"
+
+/*
+ * Key matrix of either half. Backend reads raw switch state of whole matrix, matrix debounces it and
+ * reports key edges as key events of MATRIX_DEFINE key indexes.
+ */
+#define MATRIX_KEY_NUM (MATRIX_ROW_NUM * MATRIX_COL_NUM)
+
+// Matrix backends, keyboard selects one by defining MATRIX_BACKEND in keyboard.h.
+#define MATRIX_BACKEND_GPIO 0 // Direct GPIO, MATRIX_COL_PINS driven high one at a time, MATRIX_ROW_PINS read with pull down.
+#define MATRIX_BACKEND_SIM  1 // Host simulator, switches are set by host harness.
+#define MATRIX_BACKEND_SPIM 2 // 74HC165 chain over SPIM, needs MATRIX_SPIM_SCK_PIN, MATRIX_SPIM_MISO_PIN & MATRIX_SPIM_LOAD_PIN.
+#define MATRIX_BACKEND_TWIM 3 // MCP23017 over TWIM, needs MATRIX_TWIM_SCL_PIN, MATRIX_TWIM_SDA_PIN, MATRIX_TWIM_INT_PIN & MATRIX_TWIM_ADDRESS.
+// SPIM & TWIM drivers are enabled by armgcc Makefile for backend defined in keyboard.h.
+// SPIM backend senses keys only with MATRIX_SPIM_SENSE_PIN, a wired OR of all keys; without it matrix never stops scanning.
+
+#ifndef MATRIX_BACKEND
+#define MATRIX_BACKEND MATRIX_BACKEND_GPIO
+#endif
+
+// Raw or debounced switches of one column, bit n is row n.
+typedef uint32_t matrix_col_t;
+
+typedef struct matrix_backend_s {
+    void (*init)(void);
+    // Whole matrix, bit of row is set for closed switch.
+    void (*read)(matrix_col_t cols[MATRIX_COL_NUM]);
+    // Low power sense, any switch change raises GPIOTE PORT event while armed. NULL if backend can't sense.
+    void (*sense_arm)(void);
+    bool (*sense_missed)(void); // Switch changed while sense was being armed, so no event will come.
+    void (*sense_disarm)(void);
+} matrix_backend_t;
+
+typedef struct matrix_scan_s {
+    key_event_t keys[MATRIX_KEY_NUM]; // Key edges in scan order.
+    uint16_t key_num;
+    bool has_press;
+    bool has_release;
+    bool has_activity; // Key state differs from switches, i.e. change is being debounced.
+} matrix_scan_t;
+
+extern const key_index_t MATRIX[MATRIX_ROW_NUM][MATRIX_COL_NUM];
+
+extern const matrix_backend_t matrix_backend_gpio;
+extern const matrix_backend_t matrix_backend_sim;
+extern const matrix_backend_t matrix_backend_spim;
+extern const matrix_backend_t matrix_backend_twim;
+
+#if MATRIX_BACKEND == MATRIX_BACKEND_SIM
+#define MATRIX_BACKEND_INSTANCE matrix_backend_sim
+#elif MATRIX_BACKEND == MATRIX_BACKEND_SPIM
+#define MATRIX_BACKEND_INSTANCE matrix_backend_spim
+#elif MATRIX_BACKEND == MATRIX_BACKEND_TWIM
+#define MATRIX_BACKEND_INSTANCE matrix_backend_twim
+#else
+#define MATRIX_BACKEND_INSTANCE matrix_backend_gpio
+#endif
+
+void matrix_init(matrix_backend_t const *p_backend);
+// Keys pressed on wake scan were already qualified by sense, so they skip debounce.
+void matrix_scan(bool is_wake_scan, matrix_scan_t *p_scan);
+// Held keys in row order, up to max_len.
+uint16_t matrix_pressed_get(key_index_t *p_keys, uint16_t max_len);
+bool matrix_pressed_any(void);
+bool matrix_sense_available(void);
+void matrix_sense_arm(void);
+bool matrix_sense_missed(void);
+void matrix_sense_disarm(void);
+
+// Simulator backend, host harness sets switches and counts reads.
+void matrix_backend_sim_set(uint8_t row, uint8_t col, bool closed);
+uint32_t matrix_backend_sim_read_count(void);
+
+#endif
@@ -0,0 +1,98 @@
+#define NRF_LOG_MODULE_NAME matrix
+#define NRF_LOG_LEVEL       MATRIX_LOG_LEVEL
+
+#include "matrix.h"
+
+#include "nrf_delay.h"
+#include "nrf_gpio.h"
+#include "nrf_log.h"
+
+#include "../firmware_config.h"
+
+#if MATRIX_BACKEND == MATRIX_BACKEND_GPIO
+
+NRF_LOG_MODULE_REGISTER();
+
+const uint8_t ROWS[MATRIX_ROW_NUM] = MATRIX_ROW_PINS;
+const uint8_t COLS[MATRIX_COL_NUM] = MATRIX_COL_PINS;
+
+static uint32_t m_row_mask = 0;     // Row pins in port.
+static uint32_t m_sense_high = 0;   // Row pins high when sense was armed.
+
+static void gpio_init(void) {
+    NRF_LOG_INFO("matrix_backend_gpio init.");
+
+    for (int i = 0; i < MATRIX_COL_NUM; i++) {
+        nrf_gpio_cfg_output(COLS[i]);
+        nrf_gpio_pin_clear(COLS[i]);
+    }
+
+    m_row_mask = 0;
+
+    for (int i = 0; i < MATRIX_ROW_NUM; i++) {
+        nrf_gpio_cfg_input(ROWS[i], NRF_GPIO_PIN_PULLDOWN);
+
+        m_row_mask |= 1UL << ROWS[i];
+    }
+}
+
+static void gpio_read(matrix_col_t cols[MATRIX_COL_NUM]) {
+    for (int col = 0; col < MATRIX_COL_NUM; col++) {
+        nrf_gpio_pin_set(COLS[col]);
+        nrf_delay_us(PIN_SET_DELAY);
+
+        // All rows in one port read, nRF52832 has only P0.
+        uint32_t port = nrf_gpio_port_in_read(NRF_P0);
+
+        nrf_gpio_pin_clear(COLS[col]);
+
+        cols[col] = 0;
+
+        for (int row = 0; row < MATRIX_ROW_NUM; row++) {
+            if (port & (1UL << ROWS[row])) {
+                cols[col] |= (matrix_col_t)1 << row;
+            }
+        }
+    }
+}
+
+static void gpio_sense_arm(void) {
+    for (int i = 0; i < MATRIX_COL_NUM; i++) {
+        nrf_gpio_pin_set(COLS[i]);
+    }
+
+    nrf_delay_us(PIN_SET_DELAY);
+
+    m_sense_high = nrf_gpio_port_in_read(NRF_P0) & m_row_mask;
+
+    // DETECT is a level shared by all rows, so row held high by a key would mask every other row.
+    // Such row senses key release instead, other rows sense key press.
+    for (int i = 0; i < MATRIX_ROW_NUM; i++) {
+        nrf_gpio_cfg_sense_set(ROWS[i], (m_sense_high & (1UL << ROWS[i])) ? NRF_GPIO_PIN_SENSE_LOW : NRF_GPIO_PIN_SENSE_HIGH);
+    }
+}
+
+static bool gpio_sense_missed(void) {
+    // nRF52832 has no latch, a row that changed while sense was being set up would be missed.
+    return (nrf_gpio_port_in_read(NRF_P0) & m_row_mask) != m_sense_high;
+}
+
+static void gpio_sense_disarm(void) {
+    for (int i = 0; i < MATRIX_ROW_NUM; i++) {
+        nrf_gpio_cfg_sense_set(ROWS[i], NRF_GPIO_PIN_NOSENSE);
+    }
+
+    for (int i = 0; i < MATRIX_COL_NUM; i++) {
+        nrf_gpio_pin_clear(COLS[i]);
+    }
+}
+
+const matrix_backend_t matrix_backend_gpio = {
+    .init = gpio_init,
+    .read = gpio_read,
+    .sense_arm = gpio_sense_arm,
+    .sense_missed = gpio_sense_missed,
+    .sense_disarm = gpio_sense_disarm
+};
+
+#endif
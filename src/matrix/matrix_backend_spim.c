@@ -0,0 +1,103 @@
+#define NRF_LOG_MODULE_NAME matrix
+#define NRF_LOG_LEVEL       MATRIX_LOG_LEVEL
+
+#include "matrix.h"
+
+#include "app_error.h"
+#include "nrf_gpio.h"
+#include "nrf_log.h"
+#include "nrfx_spim.h"
+
+#include "../firmware_config.h"
+
+#if MATRIX_BACKEND == MATRIX_BACKEND_SPIM
+
+NRF_LOG_MODULE_REGISTER();
+
+/*
+ * Chain of 74HC165 parallel in, serial out shift registers, one input per key, closed switch pulls input high.
+ * Chain is latched by pulsing MATRIX_SPIM_LOAD_PIN low, then clocked out by one EasyDMA transfer.
+ * Key n (row * MATRIX_COL_NUM + col) is bit 7 - n % 8 of byte n / 8, i.e. first bit out of chain is key 0.
+ */
+#define CHAIN_BITS_LEN ((MATRIX_KEY_NUM + 7) / 8)
+// nRF52832 anomaly 58: one byte SPIM transfer may clock twice, chain is read as two bytes at least.
+#define CHAIN_LEN      (CHAIN_BITS_LEN > 1 ? CHAIN_BITS_LEN : 2)
+
+_Static_assert(CHAIN_LEN <= UINT8_MAX, "Chain is longer than SPIM EasyDMA transfer.");
+
+static const nrfx_spim_t m_spim = NRFX_SPIM_INSTANCE(MATRIX_SPIM_INSTANCE);
+static uint8_t m_chain[CHAIN_LEN]; // EasyDMA target, must be in RAM.
+
+static void spim_init(void) {
+    ret_code_t err_code;
+    nrfx_spim_config_t config = NRFX_SPIM_DEFAULT_CONFIG;
+
+    NRF_LOG_INFO("matrix_backend_spim init; chain: %d bytes.", CHAIN_LEN);
+
+    nrf_gpio_cfg_output(MATRIX_SPIM_LOAD_PIN);
+    nrf_gpio_pin_set(MATRIX_SPIM_LOAD_PIN);
+
+    config.sck_pin = MATRIX_SPIM_SCK_PIN;
+    config.miso_pin = MATRIX_SPIM_MISO_PIN;
+    config.mosi_pin = NRFX_SPIM_PIN_NOT_USED;
+    config.ss_pin = NRFX_SPIM_PIN_NOT_USED;
+    config.frequency = MATRIX_SPIM_FREQUENCY;
+    config.mode = NRF_SPIM_MODE_0;
+    config.bit_order = NRF_SPIM_BIT_ORDER_MSB_FIRST;
+
+    // No handler, so transfer blocks; whole chain takes a few us, less than the ISR round trip.
+    err_code = nrfx_spim_init(&m_spim, &config, NULL, NULL);
+    APP_ERROR_CHECK(err_code);
+
+#ifdef MATRIX_SPIM_SENSE_PIN
+    nrf_gpio_cfg_input(MATRIX_SPIM_SENSE_PIN, NRF_GPIO_PIN_PULLDOWN);
+#endif
+}
+
+static void spim_read(matrix_col_t cols[MATRIX_COL_NUM]) {
+    ret_code_t err_code;
+    nrfx_spim_xfer_desc_t xfer = NRFX_SPIM_XFER_RX(m_chain, CHAIN_LEN);
+
+    // Latch all inputs, pulse is far longer than 74HC165 needs.
+    nrf_gpio_pin_clear(MATRIX_SPIM_LOAD_PIN);
+    nrf_gpio_pin_set(MATRIX_SPIM_LOAD_PIN);
+
+    err_code = nrfx_spim_xfer(&m_spim, &xfer, 0);
+    APP_ERROR_CHECK(err_code);
+
+    for (int col = 0; col < MATRIX_COL_NUM; col++) {
+        cols[col] = 0;
+    }
+
+    for (int key = 0; key < MATRIX_KEY_NUM; key++) {
+        if (m_chain[key / 8] & (0x80 >> (key % 8))) {
+            cols[key % MATRIX_COL_NUM] |= (matrix_col_t)1 << (key / MATRIX_COL_NUM);
+        }
+    }
+}
+
+#ifdef MATRIX_SPIM_SENSE_PIN
+static void spim_sense_arm(void) {
+    nrf_gpio_cfg_sense_set(MATRIX_SPIM_SENSE_PIN, NRF_GPIO_PIN_SENSE_HIGH);
+}
+
+static bool spim_sense_missed(void) {
+    return nrf_gpio_pin_read(MATRIX_SPIM_SENSE_PIN) > 0;
+}
+
+static void spim_sense_disarm(void) {
+    nrf_gpio_cfg_sense_set(MATRIX_SPIM_SENSE_PIN, NRF_GPIO_PIN_NOSENSE);
+}
+#endif
+
+const matrix_backend_t matrix_backend_spim = {
+    .init = spim_init,
+    .read = spim_read,
+#ifdef MATRIX_SPIM_SENSE_PIN
+    .sense_arm = spim_sense_arm,
+    .sense_missed = spim_sense_missed,
+    .sense_disarm = spim_sense_disarm
+#endif
+};
+
+#endif
@@ -0,0 +1,202 @@
+#define NRF_LOG_MODULE_NAME matrix
+#define NRF_LOG_LEVEL       MATRIX_LOG_LEVEL
+
+#include "matrix.h"
+
+#include "app_error.h"
+#include "nrf.h"
+#include "nrf_gpio.h"
+#include "nrf_log.h"
+#include "nrfx_twim.h"
+
+#include "../firmware_config.h"
+
+#if MATRIX_BACKEND == MATRIX_BACKEND_TWIM
+
+NRF_LOG_MODULE_REGISTER();
+
+/*
+ * MCP23017 I/O expander, columns on port A driven low one at a time, rows on port B read with pull up.
+ * IOCON puts it in byte mode, so register pointer toggles between A & B of a pair: one TXRX writes
+ * GPIOA and reads GPIOB, i.e. one column. Column transfers are chained from TWIM interrupt, CPU never
+ * touches single bytes. INTB (mirrored to INTA) goes low on any row change, it is the sense pin.
+ */
+#define MCP_IODIRA   0x00
+#define MCP_GPINTENB 0x05
+#define MCP_IOCON    0x0A
+#define MCP_GPPUA    0x0C
+#define MCP_GPIOA    0x12
+
+#define MCP_IOCON_MIRROR 0x40
+#define MCP_IOCON_SEQOP  0x20 // Sequential operation disabled, pointer toggles within pair.
+#define MCP_IOCON_ODR    0x04 // Open drain INT, pulled up by MATRIX_TWIM_INT_PIN.
+
+#define ROW_MASK ((uint8_t)((1U << MATRIX_ROW_NUM) - 1))
+
+_Static_assert(MATRIX_ROW_NUM <= 8, "MCP23017 port B has 8 rows at most.");
+_Static_assert(MATRIX_COL_NUM <= 8, "MCP23017 port A has 8 columns at most.");
+
+static const nrfx_twim_t m_twim = NRFX_TWIM_INSTANCE(MATRIX_TWIM_INSTANCE);
+
+// EasyDMA buffers, must be in RAM.
+static uint8_t m_tx[MATRIX_COL_NUM][2];
+static uint8_t m_rx[MATRIX_COL_NUM];
+static uint8_t m_cmd[3];
+
+static volatile bool m_busy = false;
+static volatile bool m_xfer_failed = false;
+static volatile uint8_t m_col = 0;
+
+static void col_xfer_start(uint8_t col) {
+    ret_code_t err_code;
+    nrfx_twim_xfer_desc_t xfer = NRFX_TWIM_XFER_DESC_TXRX(MATRIX_TWIM_ADDRESS, m_tx[col], sizeof(m_tx[col]), &m_rx[col], 1);
+
+    err_code = nrfx_twim_xfer(&m_twim, &xfer, 0);
+    APP_ERROR_CHECK(err_code);
+}
+
+static void twim_event_handler(nrfx_twim_evt_t const *p_event, void *p_context) {
+    if (p_event->type != NRFX_TWIM_EVT_DONE) {
+        m_xfer_failed = true;
+        m_busy = false;
+        return;
+    }
+
+    // Next column, or pass is done. Plain command transfers have m_col past last column.
+    if (++m_col < MATRIX_COL_NUM) {
+        col_xfer_start(m_col);
+    } else {
+        m_busy = false;
+    }
+}
+
+static void twim_wait(void) {
+    while (m_busy) {
+        __WFE();
+    }
+}
+
+static bool cmd_write(uint8_t len) {
+    ret_code_t err_code;
+    nrfx_twim_xfer_desc_t xfer = NRFX_TWIM_XFER_DESC_TX(MATRIX_TWIM_ADDRESS, m_cmd, len);
+
+    m_col = MATRIX_COL_NUM;
+    m_xfer_failed = false;
+    m_busy = true;
+
+    err_code = nrfx_twim_xfer(&m_twim, &xfer, 0);
+    APP_ERROR_CHECK(err_code);
+
+    twim_wait();
+
+    return !m_xfer_failed;
+}
+
+static void twim_init(void) {
+    ret_code_t err_code;
+    nrfx_twim_config_t config = NRFX_TWIM_DEFAULT_CONFIG;
+    bool ok = true;
+
+    NRF_LOG_INFO("matrix_backend_twim init; address: 0x%02x.", MATRIX_TWIM_ADDRESS);
+
+    config.scl = MATRIX_TWIM_SCL_PIN;
+    config.sda = MATRIX_TWIM_SDA_PIN;
+    config.frequency = MATRIX_TWIM_FREQUENCY;
+
+    err_code = nrfx_twim_init(&m_twim, &config, twim_event_handler, NULL);
+    APP_ERROR_CHECK(err_code);
+
+    nrfx_twim_enable(&m_twim);
+
+    nrf_gpio_cfg_input(MATRIX_TWIM_INT_PIN, NRF_GPIO_PIN_PULLUP);
+
+    for (int col = 0; col < MATRIX_COL_NUM; col++) {
+        m_tx[col][0] = MCP_GPIOA;
+        m_tx[col][1] = (uint8_t)~(1U << col);
+    }
+
+    m_cmd[0] = MCP_IOCON;
+    m_cmd[1] = MCP_IOCON_MIRROR | MCP_IOCON_SEQOP | MCP_IOCON_ODR;
+    ok &= cmd_write(2);
+
+    // Port A outputs, port B inputs.
+    m_cmd[0] = MCP_IODIRA;
+    m_cmd[1] = 0x00;
+    m_cmd[2] = 0xFF;
+    ok &= cmd_write(3);
+
+    m_cmd[0] = MCP_GPPUA;
+    m_cmd[1] = 0x00;
+    m_cmd[2] = ROW_MASK;
+    ok &= cmd_write(3);
+
+    m_cmd[0] = MCP_GPIOA;
+    m_cmd[1] = 0xFF;
+    ok &= cmd_write(2);
+
+    // Interrupt on change from previous value, cleared by reading GPIOB.
+    m_cmd[0] = MCP_GPINTENB;
+    m_cmd[1] = ROW_MASK;
+    ok &= cmd_write(2);
+
+    if (!ok) {
+        NRF_LOG_ERROR("MCP23017 doesn't respond.");
+    }
+}
+
+static void twim_read(matrix_col_t cols[MATRIX_COL_NUM]) {
+    m_col = 0;
+    m_xfer_failed = false;
+    m_busy = true;
+
+    col_xfer_start(0);
+    twim_wait();
+
+    if (m_xfer_failed) {
+        // Last good pass is kept, so a glitch on bus can't release held keys.
+        NRF_LOG_WARNING("Matrix read failed.");
+        return;
+    }
+
+    for (int col = 0; col < MATRIX_COL_NUM; col++) {
+        cols[col] = (uint8_t)~m_rx[col] & ROW_MASK;
+    }
+}
+
+static void twim_sense_arm(void) {
+    nrfx_twim_xfer_desc_t xfer = NRFX_TWIM_XFER_DESC_TXRX(MATRIX_TWIM_ADDRESS, m_cmd, 2, &m_rx[0], 1);
+    ret_code_t err_code;
+
+    // All columns low, then reading GPIOB clears INT, so it goes low on next row change.
+    m_cmd[0] = MCP_GPIOA;
+    m_cmd[1] = 0x00;
+
+    m_col = MATRIX_COL_NUM;
+    m_xfer_failed = false;
+    m_busy = true;
+
+    err_code = nrfx_twim_xfer(&m_twim, &xfer, 0);
+    APP_ERROR_CHECK(err_code);
+
+    twim_wait();
+
+    nrf_gpio_cfg_sense_set(MATRIX_TWIM_INT_PIN, NRF_GPIO_PIN_SENSE_LOW);
+}
+
+static bool twim_sense_missed(void) {
+    return nrf_gpio_pin_read(MATRIX_TWIM_INT_PIN) == 0;
+}
+
+static void twim_sense_disarm(void) {
+    nrf_gpio_cfg_sense_set(MATRIX_TWIM_INT_PIN, NRF_GPIO_PIN_NOSENSE);
+}
+
+const matrix_backend_t matrix_backend_twim = {
+    .init = twim_init,
+    .read = twim_read,
+    .sense_arm = twim_sense_arm,
+    .sense_missed = twim_sense_missed,
+    .sense_disarm = twim_sense_disarm
+};
+
+#endif
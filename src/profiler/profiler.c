@@ -0,0 +1,61 @@
+#include "profiler.h"
+
+#if PROFILER_ENABLED
+#include <string.h>
+
+#include "app_util.h"
+#include "app_util_platform.h"
+
+#include "profiler_clock.h"
+
+typedef struct profiler_counter_s {
+    uint64_t cycles;
+    uint32_t calls;
+} profiler_counter_t;
+
+static profiler_counter_t m_counters[PROFILER_SUBSYS_NUM];
+
+uint32_t profiler_begin(void) {
+    return profiler_clock_get();
+}
+
+void profiler_end(profiler_subsys_t subsys, uint32_t begin) {
+    uint32_t cycles = profiler_clock_get() - begin;
+
+    CRITICAL_REGION_ENTER();
+
+    m_counters[subsys].cycles += cycles;
+    m_counters[subsys].calls++;
+
+    CRITICAL_REGION_EXIT();
+}
+
+void profiler_snapshot_take(profiler_snapshot_t *p_snapshot) {
+    profiler_counter_t counters[PROFILER_SUBSYS_NUM];
+
+    CRITICAL_REGION_ENTER();
+
+    memcpy(counters, m_counters, sizeof(counters));
+    memset(m_counters, 0, sizeof(m_counters));
+
+    CRITICAL_REGION_EXIT();
+
+    for (int i = 0; i < PROFILER_SUBSYS_NUM; i++) {
+        p_snapshot->active_us[i] = (uint32_t)(counters[i].cycles / PROFILER_CLOCK_PER_US);
+        p_snapshot->calls[i] = counters[i].calls;
+    }
+}
+
+uint16_t profiler_snapshot_encode(profiler_snapshot_t const *p_snapshot, uint8_t *p_data) {
+    uint16_t len = uint32_encode(p_snapshot->period_ms, p_data);
+
+    len += uint32_encode(p_snapshot->sched_peak, &p_data[len]);
+
+    for (int i = 0; i < PROFILER_SUBSYS_NUM; i++) {
+        len += uint32_encode(p_snapshot->active_us[i], &p_data[len]);
+        len += uint32_encode(p_snapshot->calls[i], &p_data[len]);
+    }
+
+    return len;
+}
+#endif
@@ -0,0 +1,53 @@
+#ifndef _PROFILER_H_
+#define _PROFILER_H_
+
+#include <stdint.h>
+
+#include "../firmware_config.h"
+
+/*
+ * CPU active time per subsystem, measured with DWT cycle counter (host clock in tools/profiler_bench).
+ * Counters are dumped to log (RTT) every PROFILER_DUMP_INTERVAL and handed to dump handler, enabled by PROFILER_ENABLED.
+ * DWT start, BLE observers & dump timer are in profiler_nrf.c.
+ */
+typedef enum profiler_subsys_e {
+    PROFILER_SCAN,      // Matrix scan.
+    PROFILER_TRANSLATE, // Key index translation.
+    PROFILER_REPORT,    // HID report generation & send.
+    PROFILER_BLE,       // SoftDevice BLE event observers.
+    PROFILER_LOG,       // Deferred log processing.
+    PROFILER_SUBSYS_NUM
+} profiler_subsys_t;
+
+typedef struct profiler_snapshot_s {
+    uint32_t period_ms;  // Time since previous snapshot.
+    uint32_t sched_peak; // Most scheduler events queued at once since boot, 0 without APP_SCHEDULER_WITH_PROFILER.
+    uint32_t active_us[PROFILER_SUBSYS_NUM];
+    uint32_t calls[PROFILER_SUBSYS_NUM];
+} profiler_snapshot_t;
+
+// Packed snapshot, all little endian: period_ms & sched_peak (uint32), then active_us & calls (uint32) of each subsystem.
+#define PROFILER_SNAPSHOT_LEN (8 + PROFILER_SUBSYS_NUM * 8)
+
+// Called in main context with counters of each dump period, e.g. to expose them over GATT.
+typedef void (*profiler_dump_handler_t)(profiler_snapshot_t const *p_snapshot);
+
+// Dump handler may be NULL, counters then go to log only.
+void profiler_init(profiler_dump_handler_t dump_handler);
+
+#if PROFILER_ENABLED
+uint32_t profiler_begin(void);
+void profiler_end(profiler_subsys_t subsys, uint32_t begin);
+// Counters since previous snapshot, which are cleared. Period & scheduler peak are left to caller.
+void profiler_snapshot_take(profiler_snapshot_t *p_snapshot);
+// Returns PROFILER_SNAPSHOT_LEN.
+uint16_t profiler_snapshot_encode(profiler_snapshot_t const *p_snapshot, uint8_t *p_data);
+
+#define PROFILER_BEGIN()     uint32_t profiler_begin_cycles = profiler_begin()
+#define PROFILER_END(subsys) profiler_end(subsys, profiler_begin_cycles)
+#else
+#define PROFILER_BEGIN()
+#define PROFILER_END(subsys)
+#endif
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef _PROFILER_CLOCK_H_
+#define _PROFILER_CLOCK_H_
+
+#include <stdint.h>
+
+/*
+ * Clock of profiler core. DWT cycle counter on chip, monotonic clock in ns when built on host with PROFILER_HOST_CLOCK.
+ * Both wrap at 32 bits, unsigned difference stays correct over one wrap (~67s at 64MHz, ~4s on host).
+ */
+#ifdef PROFILER_HOST_CLOCK
+#include <time.h>
+
+#define PROFILER_CLOCK_PER_US 1000
+
+static inline void profiler_clock_start(void) {
+}
+
+static inline uint32_t profiler_clock_get(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec);
+}
+#else
+#include "nrf.h"
+
+#define PROFILER_CLOCK_PER_US (SystemCoreClock / 1000000)
+
+static inline void profiler_clock_start(void) {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+static inline uint32_t profiler_clock_get(void) {
+    return DWT->CYCCNT;
+}
+#endif
+
+#endif
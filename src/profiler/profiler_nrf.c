@@ -0,0 +1,100 @@
+#include "profiler.h"
+
+#if PROFILER_ENABLED
+#include "app_error.h"
+#include "app_scheduler.h"
+#include "app_timer.h"
+#include "nrf_log.h"
+#include "nrf_sdh_ble.h"
+
+#include "profiler_clock.h"
+
+static const char *SUBSYS_NAMES[PROFILER_SUBSYS_NUM] = {"scan", "translate", "report", "ble", "log"};
+
+APP_TIMER_DEF(m_dump_timer_id);
+
+static profiler_dump_handler_t m_dump_handler;
+static uint32_t m_dump_tick;
+static uint32_t m_ble_begin;
+
+static void dump_timeout_handler(void *p_context);
+static void dump_task(void *p_data, uint16_t size);
+static void ble_begin_handler(ble_evt_t const *p_ble_evt, void *p_context);
+static void ble_end_handler(ble_evt_t const *p_ble_evt, void *p_context);
+
+// BLE events go through observers by priority, so observers at first and last priority enclose all others.
+// Observers sharing last priority may run after end observer, their time is not counted.
+NRF_SDH_BLE_OBSERVER(m_profiler_ble_begin_obs, 0, ble_begin_handler, NULL);
+NRF_SDH_BLE_OBSERVER(m_profiler_ble_end_obs, NRF_SDH_BLE_OBSERVER_PRIO_LEVELS - 1, ble_end_handler, NULL);
+#endif
+
+void profiler_init(profiler_dump_handler_t dump_handler) {
+#if PROFILER_ENABLED
+    ret_code_t err_code;
+
+    NRF_LOG_INFO("profiler_init.");
+
+    profiler_clock_start();
+
+    m_dump_handler = dump_handler;
+    m_dump_tick = app_timer_cnt_get();
+
+    err_code = app_timer_create(&m_dump_timer_id, APP_TIMER_MODE_REPEATED, dump_timeout_handler);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = app_timer_start(m_dump_timer_id, APP_TIMER_TICKS(PROFILER_DUMP_INTERVAL), NULL);
+    APP_ERROR_CHECK(err_code);
+#else
+    UNUSED_PARAMETER(dump_handler);
+#endif
+}
+
+#if PROFILER_ENABLED
+static void ble_begin_handler(ble_evt_t const *p_ble_evt, void *p_context) {
+    UNUSED_PARAMETER(p_ble_evt);
+    UNUSED_PARAMETER(p_context);
+
+    m_ble_begin = profiler_begin();
+}
+
+static void ble_end_handler(ble_evt_t const *p_ble_evt, void *p_context) {
+    UNUSED_PARAMETER(p_ble_evt);
+    UNUSED_PARAMETER(p_context);
+
+    profiler_end(PROFILER_BLE, m_ble_begin);
+}
+
+static void dump_timeout_handler(void *p_context) {
+    UNUSED_PARAMETER(p_context);
+
+    // Log in main context, not in timer interrupt.
+    app_sched_event_put(NULL, 0, dump_task);
+}
+
+static void dump_task(void *p_data, uint16_t size) {
+    UNUSED_PARAMETER(p_data);
+    UNUSED_PARAMETER(size);
+
+    profiler_snapshot_t snapshot;
+    uint32_t tick = app_timer_cnt_get();
+
+    profiler_snapshot_take(&snapshot);
+    snapshot.period_ms = ROUNDED_DIV((uint64_t)app_timer_cnt_diff_compute(tick, m_dump_tick) * 1000 * (APP_TIMER_CONFIG_RTC_FREQUENCY + 1), APP_TIMER_CLOCK_FREQ);
+    m_dump_tick = tick;
+#if APP_SCHEDULER_WITH_PROFILER
+    snapshot.sched_peak = app_sched_queue_utilization_get();
+#else
+    snapshot.sched_peak = 0;
+#endif
+
+    NRF_LOG_INFO("Profiler; period: %d ms, scheduler peak: %d of %d events.", snapshot.period_ms, snapshot.sched_peak, SCHED_QUEUE_SIZE);
+
+    for (int i = 0; i < PROFILER_SUBSYS_NUM; i++) {
+        NRF_LOG_INFO("Profiler; %s: %d us, %d calls.", SUBSYS_NAMES[i], snapshot.active_us[i], snapshot.calls[i]);
+    }
+
+    if (m_dump_handler != NULL) {
+        m_dump_handler(&snapshot);
+    }
+}
+#endif
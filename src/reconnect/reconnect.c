@@ -0,0 +1,167 @@
+#define NRF_LOG_MODULE_NAME reconnect
+#define NRF_LOG_LEVEL       RECONNECT_LOG_LEVEL
+
+#include "reconnect.h"
+
+#include "app_error.h"
+#include "app_timer.h"
+#include "nrf_log.h"
+
+#include "../firmware_config.h"
+
+NRF_LOG_MODULE_REGISTER();
+
+static ble_advertising_t *m_p_advertising;
+static ble_adv_modes_config_t m_modes_config;
+
+static pm_peer_id_t m_peer_id = PM_PEER_ID_INVALID;
+static bool m_active = false;      // Advertising per schedule, including backoff.
+static bool m_waiting = false;     // Backoff ran out, waiting for key activity.
+static uint8_t m_backoff_step = 0;
+static ble_adv_evt_t m_phase = BLE_ADV_EVT_IDLE;
+static uint32_t m_start_tick = 0;  // Start of reconnection.
+static uint32_t m_phase_tick = 0;  // Start of current phase.
+
+static void modes_config_set(uint32_t slow_interval);
+static void phase_set(ble_adv_evt_t phase);
+static uint32_t ticks_to_ms(uint32_t ticks);
+
+void reconnect_init(ble_advertising_t *p_advertising, ble_adv_modes_config_t const *p_modes_config) {
+    NRF_LOG_INFO("reconnect_init.");
+
+    m_p_advertising = p_advertising;
+    m_modes_config = *p_modes_config;
+}
+
+static void modes_config_set(uint32_t slow_interval) {
+    ble_adv_modes_config_t modes_config = m_modes_config;
+
+    modes_config.ble_adv_slow_interval = slow_interval;
+
+    ble_advertising_modes_config_set(m_p_advertising, &modes_config);
+}
+
+static uint32_t ticks_to_ms(uint32_t ticks) {
+    return ROUNDED_DIV((uint64_t)ticks * 1000 * (APP_TIMER_CONFIG_RTC_FREQUENCY + 1), APP_TIMER_CLOCK_FREQ);
+}
+
+static void phase_set(ble_adv_evt_t phase) {
+    uint32_t tick = app_timer_cnt_get();
+
+    if (m_phase != BLE_ADV_EVT_IDLE) {
+        NRF_LOG_INFO("Reconnect phase %d done; %d ms.", m_phase, ticks_to_ms(app_timer_cnt_diff_compute(tick, m_phase_tick)));
+    }
+
+    m_phase = phase;
+    m_phase_tick = tick;
+}
+
+void reconnect_start(pm_peer_id_t peer_id) {
+    ret_code_t err_code;
+
+    NRF_LOG_INFO("reconnect_start; peer: %d.", peer_id);
+
+    m_peer_id = peer_id;
+    m_active = true;
+    m_waiting = false;
+    m_backoff_step = 0;
+    m_phase = BLE_ADV_EVT_IDLE;
+    m_start_tick = app_timer_cnt_get();
+
+    modes_config_set(m_modes_config.ble_adv_slow_interval);
+
+    // Directed advertising falls back to fast advertising if there is no bonded peer to direct to.
+    err_code = ble_advertising_start(m_p_advertising, BLE_ADV_MODE_DIRECTED_HIGH_DUTY);
+    APP_ERROR_CHECK(err_code);
+}
+
+void reconnect_stop(void) {
+    ret_code_t err_code;
+
+    m_active = false;
+    m_waiting = false;
+    m_phase = BLE_ADV_EVT_IDLE;
+
+    err_code = sd_ble_gap_adv_stop(m_p_advertising->adv_handle);
+    if (err_code != NRF_ERROR_INVALID_STATE) {
+        APP_ERROR_CHECK(err_code);
+    }
+}
+
+void reconnect_on_adv_evt(ble_adv_evt_t adv_evt) {
+    ret_code_t err_code;
+
+    switch (adv_evt) {
+        case BLE_ADV_EVT_PEER_ADDR_REQUEST: {
+            pm_peer_data_bonding_t peer_bonding_data;
+
+            if (m_peer_id == PM_PEER_ID_INVALID) {
+                break;
+            }
+
+            err_code = pm_peer_data_bonding_load(m_peer_id, &peer_bonding_data);
+            if (err_code == NRF_ERROR_NOT_FOUND) {
+                break;
+            }
+            APP_ERROR_CHECK(err_code);
+
+            err_code = ble_advertising_peer_addr_reply(m_p_advertising, &peer_bonding_data.peer_ble_id.id_addr_info);
+            APP_ERROR_CHECK(err_code);
+        } break;
+
+        case BLE_ADV_EVT_DIRECTED_HIGH_DUTY:
+        case BLE_ADV_EVT_DIRECTED:
+        case BLE_ADV_EVT_FAST:
+        case BLE_ADV_EVT_FAST_WHITELIST:
+        case BLE_ADV_EVT_SLOW:
+        case BLE_ADV_EVT_SLOW_WHITELIST:
+            phase_set(adv_evt);
+            break;
+
+        case BLE_ADV_EVT_IDLE:
+            phase_set(BLE_ADV_EVT_IDLE);
+
+            if (!m_active) {
+                break;
+            }
+
+            if (m_backoff_step >= RECONNECT_BACKOFF_STEPS) {
+                // Wait for key activity.
+                NRF_LOG_INFO("Reconnect backoff done.");
+
+                m_active = false;
+                m_waiting = true;
+                break;
+            }
+
+            m_backoff_step++;
+            modes_config_set(MIN(m_modes_config.ble_adv_slow_interval << m_backoff_step, BLE_GAP_ADV_INTERVAL_MAX));
+
+            err_code = ble_advertising_start(m_p_advertising, BLE_ADV_MODE_SLOW);
+            APP_ERROR_CHECK(err_code);
+            break;
+
+        default:
+            break;
+    }
+}
+
+void reconnect_on_connected(void) {
+    if (!m_active) {
+        return;
+    }
+
+    NRF_LOG_INFO("Reconnected in phase %d; phase: %d ms, total: %d ms.", m_phase, ticks_to_ms(app_timer_cnt_diff_compute(app_timer_cnt_get(), m_phase_tick)), ticks_to_ms(app_timer_cnt_diff_compute(app_timer_cnt_get(), m_start_tick)));
+
+    m_active = false;
+    m_phase = BLE_ADV_EVT_IDLE;
+}
+
+void reconnect_activity(void) {
+    if (!m_waiting) {
+        return;
+    }
+
+    // Typing after backoff ran out, try directed advertising again right away.
+    reconnect_start(m_peer_id);
+}
@@ -0,0 +1,20 @@
+#ifndef _RECONNECT_H_
+#define _RECONNECT_H_
+
+#include "ble_advertising.h"
+#include "peer_manager.h"
+
+/*
+ * Reconnection schedule for host advertising:
+ * high duty directed to bonded peer, then fast and slow whitelist advertising,
+ * then slow advertising restarted RECONNECT_BACKOFF_STEPS times with doubled interval.
+ * After that advertising stays off until key activity.
+ */
+void reconnect_init(ble_advertising_t *p_advertising, ble_adv_modes_config_t const *p_modes_config);
+void reconnect_start(pm_peer_id_t peer_id);
+void reconnect_stop(void);
+void reconnect_on_adv_evt(ble_adv_evt_t adv_evt);
+void reconnect_on_connected(void);
+void reconnect_activity(void);
+
+#endif
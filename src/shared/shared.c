@@ -2,19 +2,27 @@
 
 #include "app_scheduler.h"
 #include "ble_conn_params.h"
-#include "nrf_gpio.h"
 #include "nrf_log_ctrl.h"
 #include "nrf_log_default_backends.h"
 #include "nrf_log.h"
 #include "nrf_pwr_mgmt.h"
 
-#include "../config/keyboard.h"
+#include "keyboard.h"
+#include "../bin_log/bin_log.h"
 #include "../error_handler/error_handler.h"
 #include "../firmware_config.h"
+#include "../profiler/profiler.h"
 
 /*
  * nRF52 section.
  */
+void boot_stage_mark(const char *p_stage) {
+    // RTC runs from timers init, so stages are timed from there.
+    uint32_t ticks = app_timer_cnt_get();
+
+    NRF_LOG_INFO("Boot stage; %s: %d ms.", p_stage, ROUNDED_DIV((uint64_t)ticks * 1000 * (APP_TIMER_CONFIG_RTC_FREQUENCY + 1), APP_TIMER_CLOCK_FREQ));
+}
+
 void conn_params_init(void) {
     ret_code_t err_code;
     ble_conn_params_init_t cp_init = {0};
@@ -72,7 +80,12 @@ void gap_params_init(void) {
 void idle_state_handle(void) {
     app_sched_execute();
 
-    if (NRF_LOG_PROCESS() == false) {
+    PROFILER_BEGIN();
+    bool log_pending = NRF_LOG_PROCESS();
+    log_pending = BIN_LOG_PROCESS() || log_pending;
+    PROFILER_END(PROFILER_LOG);
+
+    if (log_pending == false) {
         nrf_pwr_mgmt_run();
     }
 }
@@ -95,19 +108,3 @@ void power_management_init(void) {
 void scheduler_init(void) {
     APP_SCHED_INIT(SCHED_MAX_EVENT_DATA_SIZE, SCHED_QUEUE_SIZE);
 }
-
-/*
- * Firmware section.
- */
-void pins_init(void) {
-    NRF_LOG_INFO("pins_init.");
-
-    for (int i = 0; i < MATRIX_COL_NUM; i++) {
-        nrf_gpio_cfg_output(COLS[i]);
-        nrf_gpio_pin_clear(COLS[i]);
-    }
-
-    for (int i = 0; i < MATRIX_ROW_NUM; i++) {
-        nrf_gpio_cfg_input(ROWS[i], NRF_GPIO_PIN_PULLDOWN);
-    }
-}
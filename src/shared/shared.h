@@ -4,6 +4,7 @@
 /*
  * nRF52 section.
  */
+void boot_stage_mark(const char *p_stage);
 void conn_params_init(void);
 void conn_evt_length_ext_init(void);
 void gap_params_init(void);
@@ -12,9 +13,4 @@ void log_init(void);
 void power_management_init(void);
 void scheduler_init(void);
 
-/*
- * Firmware section.
- */
-void pins_init(void);
-
 #endif
@@ -0,0 +1,101 @@
+#define NRF_LOG_MODULE_NAME slave_scan
+#define NRF_LOG_LEVEL       SLAVE_SCAN_LOG_LEVEL
+
+#include "slave_scan.h"
+
+#include "app_error.h"
+#include "nrf_log.h"
+
+#include "../firmware_config.h"
+
+NRF_LOG_MODULE_REGISTER();
+
+static nrf_ble_scan_t *m_p_scan;
+static ble_gap_scan_params_t m_scan_params;
+
+static bool m_scanning = false;
+static bool m_burst = false;
+static uint8_t m_backoff_step = 0;
+
+static void scan_restart(uint8_t step, uint16_t timeout);
+
+void slave_scan_init(nrf_ble_scan_t *p_scan, ble_gap_scan_params_t const *p_scan_params) {
+    NRF_LOG_INFO("slave_scan_init.");
+
+    m_p_scan = p_scan;
+    m_scan_params = *p_scan_params;
+}
+
+static void scan_restart(uint8_t step, uint16_t timeout) {
+    ret_code_t err_code;
+    ble_gap_scan_params_t scan_params = m_scan_params;
+
+    // Window is kept, so each step halves duty cycle.
+    scan_params.interval = MIN(m_scan_params.interval << step, BLE_GAP_SCAN_INTERVAL_MAX);
+    scan_params.timeout = timeout;
+
+    NRF_LOG_INFO("Slave scan; interval: %d, window: %d, burst: %d.", scan_params.interval, scan_params.window, m_burst);
+
+    nrf_ble_scan_stop();
+
+    err_code = nrf_ble_scan_params_set(m_p_scan, &scan_params);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = nrf_ble_scan_start(m_p_scan);
+    APP_ERROR_CHECK(err_code);
+
+    m_scanning = true;
+}
+
+void slave_scan_start(void) {
+    // Slave was just lost or keyboard started, scan at base duty.
+    m_burst = false;
+    m_backoff_step = 0;
+
+    scan_restart(m_backoff_step, m_scan_params.timeout);
+}
+
+void slave_scan_stop(void) {
+    nrf_ble_scan_stop();
+
+    m_scanning = false;
+    m_burst = false;
+}
+
+void slave_scan_on_scan_evt(scan_evt_t const *p_scan_evt) {
+    switch (p_scan_evt->scan_evt_id) {
+        case NRF_BLE_SCAN_EVT_SCAN_TIMEOUT:
+            if (!m_scanning) {
+                break;
+            }
+
+            if (m_burst) {
+                // Back to backoff step reached before key activity.
+                m_burst = false;
+            } else if (m_backoff_step < SLAVE_SCAN_BACKOFF_STEPS) {
+                m_backoff_step++;
+            }
+
+            scan_restart(m_backoff_step, m_scan_params.timeout);
+            break;
+
+        case NRF_BLE_SCAN_EVT_CONNECTED:
+            // Scan stops on connection, owner restarts it while a link is free.
+            m_scanning = false;
+            m_burst = false;
+            break;
+
+        default:
+            break;
+    }
+}
+
+void slave_scan_activity(void) {
+    if (!m_scanning || m_burst || m_backoff_step == 0) {
+        return;
+    }
+
+    m_burst = true;
+
+    scan_restart(0, SLAVE_SCAN_BURST_DURATION);
+}
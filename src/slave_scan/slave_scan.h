@@ -0,0 +1,17 @@
+#ifndef _SLAVE_SCAN_H_
+#define _SLAVE_SCAN_H_
+
+#include "nrf_ble_scan.h"
+
+/*
+ * Scan schedule for slaves. Scan restarts on timeout with doubled interval (lower duty cycle),
+ * up to SLAVE_SCAN_BACKOFF_STEPS, so long lost slave is still found without scanning at full duty.
+ * Key activity scans at base duty (SCAN_WINDOW / SCAN_INTERVAL) for SLAVE_SCAN_BURST_DURATION, as slave is likely being used too.
+ */
+void slave_scan_init(nrf_ble_scan_t *p_scan, ble_gap_scan_params_t const *p_scan_params);
+void slave_scan_start(void);
+void slave_scan_stop(void);
+void slave_scan_on_scan_evt(scan_evt_t const *p_scan_evt);
+void slave_scan_activity(void);
+
+#endif
@@ -0,0 +1,92 @@
+#include "slave_sync.h"
+
+#include <string.h>
+
+typedef struct slave_sync_link_s {
+    // Snapshot of keys held on slave, read from slave after (re)connection.
+    key_index_t key_state[SLAVE_KEY_NUM];
+    uint8_t key_state_len;
+    bool key_state_expected; // Connected, key state not received yet.
+    // Last state pushed to slave, 0xFF forces resend.
+    uint8_t layer;
+    uint8_t leds;
+} slave_sync_link_t;
+
+static slave_sync_link_t m_links[SLAVE_NUM];
+
+void slave_sync_init(void) {
+    for (int i = 0; i < SLAVE_NUM; i++) {
+        m_links[i].key_state_len = 0;
+        slave_sync_disconnected(i);
+    }
+}
+
+void slave_sync_connected(uint8_t link) {
+    m_links[link].key_state_expected = true;
+}
+
+void slave_sync_disconnected(uint8_t link) {
+    m_links[link].key_state_expected = false;
+    m_links[link].layer = 0xFF;
+    m_links[link].leds = 0xFF;
+}
+
+bool slave_sync_key_state_set(uint8_t link, uint8_t const *p_data, uint8_t len) {
+    slave_sync_link_t *p_link = &m_links[link];
+
+    if (!p_link->key_state_expected) {
+        return false;
+    }
+
+    p_link->key_state_expected = false;
+    p_link->key_state_len = MIN(len / sizeof(key_index_t), SLAVE_KEY_NUM);
+    memcpy(p_link->key_state, p_data, p_link->key_state_len * sizeof(key_index_t));
+
+    return true;
+}
+
+uint8_t slave_sync_key_state_len(uint8_t link) {
+    return m_links[link].key_state_len;
+}
+
+uint8_t slave_sync_resync(uint8_t link, key_index_t const *p_registered, uint8_t registered_num, key_event_t *p_events) {
+    slave_sync_link_t const *p_link = &m_links[link];
+    uint8_t num = 0;
+
+    // Release slave keys that are no longer held.
+    for (int i = 0; i < registered_num; i++) {
+        bool held = false;
+
+        for (int j = 0; j < p_link->key_state_len && !held; j++) {
+            held = p_registered[i] == p_link->key_state[j];
+        }
+
+        if (!held) {
+            p_events[num++] = KEY_EVENT(p_registered[i], false);
+        }
+    }
+
+    // Press slave keys that are held but not registered yet.
+    for (int j = 0; j < p_link->key_state_len; j++) {
+        bool registered = false;
+
+        for (int i = 0; i < registered_num && !registered; i++) {
+            registered = p_registered[i] == p_link->key_state[j];
+        }
+
+        if (!registered && p_link->key_state[j] != 0) {
+            p_events[num++] = KEY_EVENT(p_link->key_state[j], true);
+        }
+    }
+
+    return num;
+}
+
+bool slave_sync_state_pending(uint8_t link, uint8_t layer, uint8_t leds) {
+    return m_links[link].layer != layer || m_links[link].leds != leds;
+}
+
+void slave_sync_state_sent(uint8_t link, uint8_t layer, uint8_t leds) {
+    m_links[link].layer = layer;
+    m_links[link].leds = leds;
+}
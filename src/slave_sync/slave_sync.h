@@ -0,0 +1,39 @@
+#ifndef _SLAVE_SYNC_H_
+#define _SLAVE_SYNC_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "keyboard.h"
+#include "../firmware_config.h"
+#include "../key_event.h"
+
+/*
+ * Master side state of each slave link, one per slave half or module. Keys from link n are registered with
+ * SLAVE_SOURCE(n). After link (re)connects, slave sends snapshot of keys it holds; resync gives events that bring keys
+ * registered from that link, and only that link, in line with it. Layer & LED state last pushed to slave is kept per
+ * link, so a link which comes back gets it again while others don't.
+ */
+#define SLAVE_SYNC_EVENT_MAX (KEY_NUM + SLAVE_KEY_NUM) // Events of a resync at most.
+
+void slave_sync_init(void);
+// Link is (re)connected, slave sends its key state next.
+void slave_sync_connected(uint8_t link);
+// Link is gone, its state is pushed again once it comes back.
+void slave_sync_disconnected(uint8_t link);
+/*
+ * Snapshot of keys held on slave, key indexes as sent over link. Only first snapshot after connection is taken,
+ * returns false for any other, which must not resync as key events of link already carry it.
+ */
+bool slave_sync_key_state_set(uint8_t link, uint8_t const *p_data, uint8_t len);
+uint8_t slave_sync_key_state_len(uint8_t link);
+/*
+ * Registered are key indexes registered from link. Releases of keys slave no longer holds come first, then presses of
+ * held keys not registered yet. Returns number of events.
+ */
+uint8_t slave_sync_resync(uint8_t link, key_index_t const *p_registered, uint8_t registered_num, key_event_t *p_events);
+// State differs from state last pushed to link.
+bool slave_sync_state_pending(uint8_t link, uint8_t layer, uint8_t leds);
+void slave_sync_state_sent(uint8_t link, uint8_t layer, uint8_t leds);
+
+#endif
@@ -0,0 +1,179 @@
+#include "tap_hold.h"
+
+#include "../firmware_config.h"
+
+typedef enum decision_e {
+    DECISION_NONE,
+    DECISION_TAP,
+    DECISION_HOLD
+} decision_t;
+
+typedef struct timed_evt_s {
+    key_event_t event;
+    uint8_t source;
+    uint32_t time;
+} timed_evt_t;
+
+static tap_hold_init_t m_init;
+
+static bool m_pending = false;  // Tap-hold key is undecided.
+static timed_evt_t m_pending_key; // Its press.
+
+// Events after press of undecided key, ring buffer.
+static timed_evt_t m_queue[TAP_HOLD_QUEUE_LEN];
+static uint8_t m_queue_start = 0;
+static uint8_t m_queue_len = 0;
+static uint8_t m_queue_peak = 0;
+
+void tap_hold_init(tap_hold_init_t const *p_init) {
+    m_init = *p_init;
+
+    m_pending = false;
+    m_queue_start = 0;
+    m_queue_len = 0;
+    m_queue_peak = 0;
+}
+
+static timed_evt_t const *queue_get(uint8_t i) {
+    return &m_queue[(m_queue_start + i) % TAP_HOLD_QUEUE_LEN];
+}
+
+static void queue_push(timed_evt_t const *p_evt) {
+    m_queue[(m_queue_start + m_queue_len) % TAP_HOLD_QUEUE_LEN] = *p_evt;
+    m_queue_len++;
+
+    if (m_queue_len > m_queue_peak) {
+        m_queue_peak = m_queue_len;
+    }
+}
+
+static timed_evt_t queue_pop(void) {
+    timed_evt_t evt = m_queue[m_queue_start];
+
+    m_queue_start = (m_queue_start + 1) % TAP_HOLD_QUEUE_LEN;
+    m_queue_len--;
+
+    return evt;
+}
+
+static bool is_same_key(timed_evt_t const *p_a, timed_evt_t const *p_b) {
+    return KEY_EVENT_INDEX(p_a->event) == KEY_EVENT_INDEX(p_b->event) && p_a->source == p_b->source;
+}
+
+static void evt_send(timed_evt_t const *p_evt, bool is_hold, bool is_replay) {
+    tap_hold_evt_t evt = {
+        .event = p_evt->event,
+        .source = p_evt->source,
+        .is_hold = is_hold,
+        .is_replay = is_replay
+    };
+
+    m_init.evt_handler(&evt);
+}
+
+// Tap-hold press becomes undecided, anything else goes out.
+static void key_enter(timed_evt_t const *p_evt, bool is_replay) {
+    if (KEY_EVENT_IS_PRESS(p_evt->event) && m_init.key_check(KEY_EVENT_INDEX(p_evt->event), p_evt->source)) {
+        m_pending = true;
+        m_pending_key = *p_evt;
+        return;
+    }
+
+    evt_send(p_evt, false, is_replay);
+}
+
+// Walks events held back by undecided key in order, as if each was processed when it happened.
+static decision_t decide(uint32_t time) {
+    for (uint8_t i = 0; i < m_queue_len; i++) {
+        timed_evt_t const *p_evt = queue_get(i);
+
+        if (p_evt->time - m_pending_key.time >= m_init.tapping_term) {
+            // Reached tapping term before this event.
+            return DECISION_HOLD;
+        }
+
+        if (is_same_key(p_evt, &m_pending_key)) {
+            return DECISION_TAP;
+        }
+
+        if (KEY_EVENT_IS_PRESS(p_evt->event)) {
+            if (m_init.policy & TAP_HOLD_POLICY_HOLD_ON_OTHER_KEY_PRESS) {
+                return DECISION_HOLD;
+            }
+        } else if (m_init.policy & TAP_HOLD_POLICY_PERMISSIVE_HOLD) {
+            // Release of key pressed after tap-hold key, i.e. within it.
+            for (uint8_t j = 0; j < i; j++) {
+                if (is_same_key(queue_get(j), p_evt)) {
+                    return DECISION_HOLD;
+                }
+            }
+        }
+    }
+
+    if (time - m_pending_key.time >= m_init.tapping_term) {
+        return DECISION_HOLD;
+    }
+
+    return DECISION_NONE;
+}
+
+static void pending_decide(bool is_hold) {
+    m_pending = false;
+    evt_send(&m_pending_key, is_hold, true);
+
+    // Held back events go through again, next tap-hold press among them is undecided in turn.
+    while (!m_pending && m_queue_len > 0) {
+        timed_evt_t evt = queue_pop();
+
+        key_enter(&evt, true);
+    }
+}
+
+static void queue_run(uint32_t time) {
+    decision_t decision;
+
+    while (m_pending && (decision = decide(time)) != DECISION_NONE) {
+        pending_decide(decision == DECISION_HOLD);
+    }
+}
+
+void tap_hold_process(key_event_t event, uint8_t source, uint32_t time) {
+    timed_evt_t evt = {.event = event, .source = source, .time = time};
+
+    if (m_pending && m_queue_len == TAP_HOLD_QUEUE_LEN) {
+        // Memory is bounded, key that held back a full queue is hold.
+        pending_decide(true);
+    }
+
+    if (m_pending) {
+        queue_push(&evt);
+    } else {
+        key_enter(&evt, false);
+    }
+
+    queue_run(time);
+}
+
+void tap_hold_timeout(uint32_t time) {
+    queue_run(time);
+}
+
+bool tap_hold_deadline_get(uint32_t *p_time) {
+    if (!m_pending) {
+        return false;
+    }
+
+    *p_time = m_pending_key.time + m_init.tapping_term;
+
+    return true;
+}
+
+void tap_hold_flush(void) {
+    while (m_pending) {
+        pending_decide(true);
+    }
+}
+
+uint8_t tap_hold_queue_peak(void) {
+    return m_queue_peak;
+}
@@ -0,0 +1,50 @@
+#ifndef _TAP_HOLD_H_
+#define _TAP_HOLD_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../key_event.h"
+
+/*
+ * Tap-hold engine, decides whether tap-hold key (MT & LT of keycodes.h) is tapped or held.
+ * Key events go in with their time and come out in the same order. While no tap-hold key is undecided, events come
+ * out right away, so plain keys get no latency. Undecided key holds back later events, up to TAP_HOLD_QUEUE_LEN
+ * (firmware_config.h); when queue is full, key is decided as hold.
+ * Tap-hold key held for tapping term is hold, released before it is tap. Policy may decide hold earlier.
+ */
+#define TAP_HOLD_POLICY_TAPPING_TERM            0x00 // Only tapping term decides hold.
+#define TAP_HOLD_POLICY_PERMISSIVE_HOLD         0x01 // Other key pressed & released within tap-hold key is hold.
+#define TAP_HOLD_POLICY_HOLD_ON_OTHER_KEY_PRESS 0x02 // Other key pressed while tap-hold key is held is hold.
+
+typedef struct tap_hold_evt_s {
+    key_event_t event;
+    uint8_t source;
+    bool is_hold;   // Press of tap-hold key decided as hold, else tap or plain key.
+    bool is_replay; // Event was held back for a decision, other events may come out with it at once.
+} tap_hold_evt_t;
+
+typedef void (*tap_hold_evt_handler_t)(tap_hold_evt_t const *p_evt);
+// True for tap-hold key, asked on press once every event before it came out.
+typedef bool (*tap_hold_key_check_t)(key_index_t index, uint8_t source);
+
+typedef struct tap_hold_init_s {
+    uint32_t tapping_term; // In ms.
+    uint8_t policy;        // TAP_HOLD_POLICY_* flags.
+    tap_hold_key_check_t key_check;
+    tap_hold_evt_handler_t evt_handler;
+} tap_hold_init_t;
+
+void tap_hold_init(tap_hold_init_t const *p_init);
+// Time is in ms of a clock wrapping at 32 bits, non-decreasing across calls.
+void tap_hold_process(key_event_t event, uint8_t source, uint32_t time);
+// Undecided key which reached tapping term by time is hold.
+void tap_hold_timeout(uint32_t time);
+// Time undecided key reaches tapping term, false if no key is undecided.
+bool tap_hold_deadline_get(uint32_t *p_time);
+// Every undecided key is hold and all events come out, e.g. before keys are changed behind engine.
+void tap_hold_flush(void);
+// Most events held back at once since init.
+uint8_t tap_hold_queue_peak(void);
+
+#endif
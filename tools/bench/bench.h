@@ -0,0 +1,34 @@
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+/*
+ * Helpers shared by host benches. A bench is one translation unit which includes this once; it returns non-zero
+ * when m_error_count is, and prints it last as 'errors: N'.
+ */
+static int m_error_count = 0;
+static int m_check_count = 0;
+
+static inline void check(bool ok, char const *p_what) {
+    m_check_count++;
+
+    if (!ok) {
+        printf("error: %s\n", p_what);
+        m_error_count++;
+    }
+}
+
+// Monotonic host clock.
+static inline uint64_t time_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef _BENCH_SCRIPT_H_
+#define _BENCH_SCRIPT_H_
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "../../src/key_event.h"
+
+/*
+ * Scripted cases of key engine benches. Input is times in ms & key edges, e.g. "0 a+ 20 b+": edge is key name and '+'
+ * for press or '-' for release, bench maps names to key indexes. Output is edges as they came out of engine, written
+ * the same way without times.
+ */
+#define BENCH_SCRIPT_LEN 256
+
+typedef key_event_t (*bench_token_event_t)(char const *p_token);
+typedef void (*bench_key_send_t)(key_event_t event, uint32_t time);
+
+// Sends edges of input in order, returns time of last one.
+static inline uint32_t bench_script_play(char const *p_input, bench_token_event_t token_event, bench_key_send_t key_send) {
+    char input[BENCH_SCRIPT_LEN];
+    char *p_token;
+    uint32_t time = 0;
+
+    strncpy(input, p_input, sizeof(input) - 1);
+    input[sizeof(input) - 1] = '\0';
+
+    for (p_token = strtok(input, " "); p_token != NULL; p_token = strtok(NULL, " ")) {
+        if ('0' <= p_token[0] && p_token[0] <= '9') {
+            time = strtoul(p_token, NULL, 10);
+        } else {
+            key_send(token_event(p_token), time);
+        }
+    }
+
+    return time;
+}
+
+// Appends edge to output, returns its new length.
+static inline size_t bench_script_append(char *p_output, size_t len, char name, bool is_press) {
+    if (len >= BENCH_SCRIPT_LEN) {
+        return len;
+    }
+
+    return len + snprintf(&p_output[len], BENCH_SCRIPT_LEN - len, "%s%c%c", len > 0 ? " " : "", name, is_press ? '+' : '-');
+}
+
+static inline void bench_script_check(char const *p_case, char const *p_output, char const *p_expected) {
+    if (strcmp(p_output, p_expected) != 0) {
+        fprintf(stderr, "error: case '%s': got '%s', expected '%s'.\n", p_case, p_output, p_expected);
+        m_error_count++;
+    }
+}
+
+#endif
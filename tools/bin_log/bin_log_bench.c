@@ -0,0 +1,215 @@
+/*
+ * Host test & benchmark of binary log (src/bin_log) and its decoder. Bench plays RTT: it drains ring through peek &
+ * consume, in chunks that cut across records, and decodes what it got.
+ * Checks that every format decodes to its text with args & tick, that only whole records leave ring, that records
+ * stay while RTT has no room, that full ring drops new records and reports their count, and that records stay in
+ * order across many wraps of ring. Reports CPU time of a 3 arg record against formatting its text.
+ * Build & run from this folder (or 'make bin_log_bench' in armgcc folder):
+ *   cc -O2 -DBIN_LOG_ENABLED=1 -I../matrix_bench/sdk_stub -I../../keyboards/ErgoTravel/default -I../../src/config \
+ *     -o bin_log_bench bin_log_bench.c bin_log_decode.c ../../src/bin_log/bin_log.c && ./bin_log_bench
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../bench/bench.h"
+#include "bin_log_decode.h"
+
+#if !BIN_LOG_ENABLED
+#error "Build with -DBIN_LOG_ENABLED=1."
+#endif
+
+#define DRAIN_MAX    (BIN_LOG_BUFSIZE * 2)
+#define WRAP_STEPS   20000
+#define TIME_REPEAT  1000000
+#define RECORD_3_LEN (4 * sizeof(uint32_t))
+
+typedef struct rec_s {
+    uint32_t tick;
+    char text[BIN_LOG_DECODE_TEXT_MAX];
+} rec_t;
+
+static uint32_t m_tick = 0;
+static rec_t m_recs[DRAIN_MAX / sizeof(uint32_t)];
+static int m_rec_num = 0;
+
+uint32_t app_timer_cnt_get(void) {
+    return m_tick;
+}
+
+// Drains ring as RTT would, chunk size cuts across records. Returns bytes drained.
+static uint32_t drain(uint32_t chunk_size) {
+    uint8_t data[DRAIN_MAX];
+    uint32_t total = 0;
+    uint32_t len;
+
+    m_rec_num = 0;
+
+    while ((len = bin_log_peek(&data[total], chunk_size)) > 0) {
+        bin_log_consume(len);
+        total += len;
+    }
+
+    for (uint32_t offset = 0; offset < total;) {
+        rec_t *p_rec = &m_recs[m_rec_num++];
+        int record_len = bin_log_decode(&data[offset], total - offset, &p_rec->tick, p_rec->text, sizeof(p_rec->text));
+
+        if (record_len <= 0) {
+            check(false, "drained data holds whole records only");
+            break;
+        }
+
+        offset += record_len;
+    }
+
+    return total;
+}
+
+static bool rec_is(int i, char const *p_text) {
+    return i < m_rec_num && strcmp(m_recs[i].text, p_text) == 0;
+}
+
+static void test_formats(void) {
+    m_tick = 0x1234567;
+
+    BIN_LOG_0(BIN_LOG_GPIOTE_PORT);
+    BIN_LOG_1(BIN_LOG_HIDS_REPORT, 0x3401);
+    BIN_LOG_2(BIN_LOG_SLAVE_KEY_INDEX_RX, 2, 6);
+    BIN_LOG_3(BIN_LOG_SLAVE_KEY_EVENT, 5, 41, 1);
+
+    check(drain(BIN_LOG_RECORD_MAX + 3) == (1 + 2 + 3 + 4) * sizeof(uint32_t), "drained length");
+    check(m_rec_num == 4, "record count");
+    check(rec_is(0, "GPIOTE PORT evt."), "0 arg record");
+    check(rec_is(1, "HIDs report; ret: 0x3401."), "1 arg record");
+    check(rec_is(2, "Receive key index from slave link; link: 2, len: 6."), "2 arg record");
+    check(rec_is(3, "process_slave_key_index_task; source: 5, key: 41, press: 1."), "3 arg record");
+    check(m_recs[0].tick == (0x1234567 & 0xFFFFFF), "tick is 24 bit RTC");
+
+    uint8_t unknown[] = {0, 0, 0, BIN_LOG_ID_NUM};
+    uint32_t tick;
+    char text[BIN_LOG_DECODE_TEXT_MAX];
+
+    check(bin_log_decode(unknown, sizeof(unknown), &tick, text, sizeof(text)) < 0, "unknown format ID");
+}
+
+// RTT without room: records are peeked again until taken.
+static void test_peek(void) {
+    uint8_t data[BIN_LOG_RECORD_MAX];
+
+    BIN_LOG_3(BIN_LOG_SLAVE_KEY_EVENT, 1, 2, 3);
+
+    check(bin_log_peek(data, RECORD_3_LEN - 1) == 0, "no partial record");
+    check(bin_log_peek(data, sizeof(data)) == RECORD_3_LEN, "peek gives record");
+    check(bin_log_peek(data, sizeof(data)) == RECORD_3_LEN, "peek keeps record");
+
+    bin_log_consume(RECORD_3_LEN);
+    check(bin_log_peek(data, sizeof(data)) == 0, "consume takes record");
+}
+
+static void test_overflow(void) {
+    int fit = BIN_LOG_BUFSIZE / RECORD_3_LEN;
+    char text[BIN_LOG_DECODE_TEXT_MAX];
+
+    for (int i = 0; i < fit + 8; i++) {
+        BIN_LOG_3(BIN_LOG_SLAVE_KEY_EVENT, i, 0, 0);
+    }
+
+    drain(BIN_LOG_BUFSIZE);
+    check(m_rec_num == fit, "full ring keeps old records");
+    snprintf(text, sizeof(text), "process_slave_key_index_task; source: %d, key: 0, press: 0.", fit - 1);
+    check(rec_is(fit - 1, text), "last kept record");
+
+    BIN_LOG_1(BIN_LOG_HIDS_QUEUE, 3);
+    drain(BIN_LOG_BUFSIZE);
+    check(m_rec_num == 2, "drop count comes first");
+    check(rec_is(0, "Binary log; dropped: 8 records."), "drop count");
+    check(rec_is(1, "HIDs report queue: 3"), "record after drops");
+
+    // Drop count needs its own room, it goes with next record that fits along with it.
+    for (int i = 0; i < fit; i++) {
+        BIN_LOG_3(BIN_LOG_SLAVE_KEY_EVENT, i, 0, 0);
+    }
+
+    BIN_LOG_0(BIN_LOG_GPIOTE_PORT);
+    bin_log_consume(bin_log_peek((uint8_t[RECORD_3_LEN]){0}, RECORD_3_LEN));
+    BIN_LOG_0(BIN_LOG_GPIOTE_PORT);
+    drain(BIN_LOG_BUFSIZE);
+    check(m_rec_num == fit + 1 && rec_is(fit - 1, "Binary log; dropped: 1 records.") && rec_is(fit, "GPIOTE PORT evt."), "drop count with small record");
+}
+
+// Random records & partial drains, args carry sequence number.
+static void test_wrap(void) {
+    uint32_t put_seq = 0;
+    uint32_t got_seq = 0;
+    char text[BIN_LOG_DECODE_TEXT_MAX];
+
+    for (int step = 0; step < WRAP_STEPS; step++) {
+        int num = rand() % 8;
+
+        for (int i = 0; i < num; i++) {
+            m_tick += rand() % 100;
+
+            if (rand() % 2) {
+                BIN_LOG_1(BIN_LOG_HIDS_QUEUE, put_seq++);
+            } else {
+                BIN_LOG_3(BIN_LOG_SLAVE_KEY_EVENT, put_seq++, 0, 1);
+            }
+        }
+
+        drain(BIN_LOG_RECORD_MAX + rand() % BIN_LOG_RECORD_MAX);
+
+        for (int i = 0; i < m_rec_num; i++, got_seq++) {
+            if (strncmp(m_recs[i].text, "HIDs", 4) == 0) {
+                snprintf(text, sizeof(text), "HIDs report queue: %u", got_seq);
+            } else {
+                snprintf(text, sizeof(text), "process_slave_key_index_task; source: %u, key: 0, press: 1.", got_seq);
+            }
+
+            if (!rec_is(i, text)) {
+                check(false, "records in order across wraps");
+                return;
+            }
+        }
+    }
+
+    check(got_seq == put_seq, "every record drained");
+}
+
+static void time_report(void) {
+    char text[BIN_LOG_DECODE_TEXT_MAX];
+    uint8_t data[BIN_LOG_RECORD_MAX];
+    uint64_t start = time_ns();
+
+    for (int i = 0; i < TIME_REPEAT; i++) {
+        BIN_LOG_3(BIN_LOG_SLAVE_KEY_EVENT, i, i & 0x3F, i & 1);
+        bin_log_consume(bin_log_peek(data, sizeof(data)));
+    }
+
+    printf("record_3_args_ns: %.1f\n", (double)(time_ns() - start) / TIME_REPEAT);
+
+    start = time_ns();
+
+    for (int i = 0; i < TIME_REPEAT; i++) {
+        snprintf(text, sizeof(text), "process_slave_key_index_task; source: %d, key: %d, press: %d.", i, i & 0x3F, i & 1);
+    }
+
+    printf("format_3_args_ns: %.1f\n", (double)(time_ns() - start) / TIME_REPEAT);
+}
+
+int main(void) {
+    srand(1);
+
+    test_formats();
+    test_peek();
+    test_overflow();
+    test_wrap();
+    time_report();
+
+    printf("formats: %d\n", BIN_LOG_ID_NUM);
+    printf("record_max: %d\n", (int)BIN_LOG_RECORD_MAX);
+    printf("errors: %d\n", m_error_count);
+
+    return m_error_count > 0 ? 1 : 0;
+}
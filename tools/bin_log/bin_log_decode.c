@@ -0,0 +1,49 @@
+#include "bin_log_decode.h"
+
+#include <stdio.h>
+
+typedef struct format_s {
+    uint8_t arg_num;
+    char const *p_format;
+} format_t;
+
+#define X(id, arg_num, format) {arg_num, format},
+static const format_t m_formats[BIN_LOG_ID_NUM] = {BIN_LOG_FORMATS};
+#undef X
+
+static uint32_t word_read(uint8_t const *p_data) {
+    return p_data[0] | (p_data[1] << 8) | (p_data[2] << 16) | ((uint32_t)p_data[3] << 24);
+}
+
+int bin_log_decode(uint8_t const *p_data, uint32_t len, uint32_t *p_tick, char *p_text, uint32_t text_size) {
+    uint32_t args[BIN_LOG_ARG_MAX] = {0};
+    uint32_t header;
+    uint32_t record_len;
+    format_t const *p_format;
+
+    if (len < sizeof(uint32_t)) {
+        return 0;
+    }
+
+    header = word_read(p_data);
+
+    if ((header >> 24) >= BIN_LOG_ID_NUM) {
+        return -1;
+    }
+
+    p_format = &m_formats[header >> 24];
+    record_len = (1 + p_format->arg_num) * sizeof(uint32_t);
+
+    if (len < record_len) {
+        return 0;
+    }
+
+    for (int i = 0; i < p_format->arg_num; i++) {
+        args[i] = word_read(&p_data[(1 + i) * sizeof(uint32_t)]);
+    }
+
+    *p_tick = header & 0xFFFFFF;
+    snprintf(p_text, text_size, p_format->p_format, args[0], args[1], args[2]);
+
+    return record_len;
+}
@@ -0,0 +1,14 @@
+#ifndef _BIN_LOG_DECODE_H_
+#define _BIN_LOG_DECODE_H_
+
+#include <stdint.h>
+
+#include "../../src/bin_log/bin_log.h"
+
+#define BIN_LOG_DECODE_TEXT_MAX 128
+
+// Decodes one record at start of data into text. Returns its length, 0 when data holds no whole record yet, or -1 on
+// unknown format ID, after which stream can't be followed.
+int bin_log_decode(uint8_t const *p_data, uint32_t len, uint32_t *p_tick, char *p_text, uint32_t text_size);
+
+#endif
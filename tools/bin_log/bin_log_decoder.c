@@ -0,0 +1,68 @@
+/*
+ * Host decoder of binary log (src/bin_log), reads raw bytes of its RTT channel from file or stdin and prints one line
+ * per record with time since first record. RTT tick wraps every 512 s, time keeps counting over it.
+ * Capture with e.g. 'JLinkRTTLogger -Device NRF52832_XXAA -If SWD -Speed 4000 -RTTChannel 1 bin_log.bin'.
+ * Build & run from this folder (or 'make bin_log_decoder' in armgcc folder):
+ *   cc -O2 -I../matrix_bench/sdk_stub -I../../keyboards/ErgoTravel/default -I../../src/config -o bin_log_decoder \
+ *     bin_log_decoder.c bin_log_decode.c && ./bin_log_decoder bin_log.bin
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bin_log_decode.h"
+
+#define TICK_FREQ 32768
+#define TICK_WRAP 0x1000000
+#define READ_SIZE 4096
+
+int main(int argc, char *argv[]) {
+    FILE *p_file = argc > 1 ? fopen(argv[1], "rb") : stdin;
+    uint8_t data[READ_SIZE + BIN_LOG_RECORD_MAX];
+    uint32_t len = 0;
+    uint32_t last_tick = 0;
+    uint64_t time_ticks = 0;
+    uint32_t records = 0;
+    size_t read_len;
+
+    if (p_file == NULL) {
+        fprintf(stderr, "error: can't open %s.\n", argv[1]);
+        return 1;
+    }
+
+    while ((read_len = fread(&data[len], 1, READ_SIZE, p_file)) > 0) {
+        uint32_t offset = 0;
+        int record_len;
+        uint32_t tick;
+        char text[BIN_LOG_DECODE_TEXT_MAX];
+
+        len += read_len;
+
+        while ((record_len = bin_log_decode(&data[offset], len - offset, &tick, text, sizeof(text))) > 0) {
+            if (records > 0) {
+                time_ticks += (tick - last_tick + TICK_WRAP) % TICK_WRAP;
+            }
+
+            last_tick = tick;
+            records++;
+            offset += record_len;
+
+            printf("[%10.3f] %s\n", (double)time_ticks / TICK_FREQ, text);
+        }
+
+        if (record_len < 0) {
+            fprintf(stderr, "error: unknown format ID 0x%02X after %u records, firmware has newer formats.\n", data[offset + 3], records);
+            return 1;
+        }
+
+        // Keep partial record for next read.
+        len -= offset;
+        memmove(data, &data[offset], len);
+    }
+
+    if (p_file != stdin) {
+        fclose(p_file);
+    }
+
+    return 0;
+}
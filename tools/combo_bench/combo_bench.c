@@ -0,0 +1,457 @@
+/*
+ * Host test & benchmark of combo engine (src/combo) on key positions of keyboard.
+ * Runs scripted typing against a few overlapping combos and checks combos fired, keys let out and event order.
+ * Then types random rolls & chords against hundreds of random combos, checks that keys in no combo come out at once,
+ * that a chord fires its combo, and that output keys are pressed & released in pairs. Reports held back events,
+ * RAM of index & CPU time per event of combo_process by number of combos.
+ * Build & run from this folder (or 'make combo_bench' in armgcc folder):
+ *   cc -O2 -I../../keyboards/ErgoTravel/default -I../../src/config -o combo_bench combo_bench.c \
+ *     ../../src/combo/combo.c && ./combo_bench
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../../src/combo/combo.h"
+#include "../bench/bench_script.h"
+
+#define TERM          50   // In ms, combo term of tests.
+#define COMBO_NUM_MAX 1024
+#define OUT_MAX       8192
+#define SOURCE_BENCH  1
+
+_Static_assert(KEY_POSITION_NUM >= 9, "Scripted cases need 9 key positions.");
+_Static_assert(KEY_POSITION_NUM + COMBO_NUM_MAX <= KEY_INDEX_MAX, "Combo key indexes don't fit key events.");
+
+typedef struct out_evt_s {
+    combo_evt_t evt;
+    uint32_t call; // Call it came out from.
+} out_evt_t;
+
+static combo_t m_combos[COMBO_NUM_MAX];
+static uint32_t m_buffer[COMBO_BUFFER_WORDS(COMBO_NUM_MAX)];
+static uint16_t m_combo_num = 0;
+
+typedef struct typing_stats_s {
+    uint32_t events;
+    uint32_t combo_key_events; // Events of keys in some combo, which may be held back.
+    uint32_t held_back;        // Presses which came out in a later call.
+    uint32_t held_back_max;    // In ms.
+    uint32_t chords;
+    uint32_t chords_fired;
+    uint64_t process_ns;
+    uint64_t combo_key_ns;
+} typing_stats_t;
+
+static out_evt_t m_out[OUT_MAX];
+static int m_out_num = 0;
+static uint32_t m_call = 0;
+
+// Presses of random typing, to find how long they were held back.
+static uint32_t m_press_time[KEY_POSITION_NUM + 1];
+static uint32_t m_press_call[KEY_POSITION_NUM + 1];
+static typing_stats_t *m_p_stats = NULL;
+
+static void evt_handler(combo_evt_t const *p_evt) {
+    key_index_t index = KEY_EVENT_INDEX(p_evt->event);
+
+    if (m_p_stats != NULL && KEY_EVENT_IS_PRESS(p_evt->event) && !IS_COMBO_KEY_INDEX(index) && m_press_call[index] != m_call) {
+        uint32_t held_back = p_evt->time - m_press_time[index];
+
+        m_p_stats->held_back++;
+
+        if (held_back > m_p_stats->held_back_max) {
+            m_p_stats->held_back_max = held_back;
+        }
+    }
+
+    if (m_out_num < OUT_MAX) {
+        m_out[m_out_num].evt = *p_evt;
+        m_out[m_out_num].call = m_call;
+        m_out_num++;
+    }
+}
+
+static void combo_mask_get(uint16_t combo, combo_mask_t mask) {
+    memset(mask, 0, sizeof(combo_mask_t));
+
+    for (int i = 0; i < COMBO_KEY_MAX; i++) {
+        key_index_t index = m_combos[combo].keys[i];
+
+        if (index > 0) {
+            mask[(index - 1) / 32] |= 1UL << ((index - 1) % 32);
+        }
+    }
+}
+
+static void engine_init(void) {
+    combo_init_t init = {
+        .p_combos = m_combos,
+        .combo_num = m_combo_num,
+        .p_buffer = m_buffer,
+        .combo_term = TERM,
+        .evt_handler = evt_handler
+    };
+
+    combo_init(&init);
+    m_out_num = 0;
+    m_call = 0;
+}
+
+// Timer of firmware, fires at deadline of held back keys unless an event comes first.
+static void time_advance(uint32_t time) {
+    uint32_t deadline;
+
+    while (combo_deadline_get(&deadline) && deadline <= time) {
+        m_call++;
+        combo_timeout(deadline);
+    }
+}
+
+static void key_send(key_event_t event, uint32_t time) {
+    time_advance(time);
+    m_call++;
+    combo_process(event, SOURCE_BENCH, time);
+}
+
+/*
+ * Scripted case, input is time & key edge, e.g. "0 a+ 20 b+": combo keys are a..e, keys in no combo j & k.
+ * Combos are X = a b, Y = c d, Z = c d e; output is key edges as they came out, combos by their letter.
+ */
+typedef struct bench_case_s {
+    char const *p_name;
+    char const *p_input;
+    char const *p_output;
+} bench_case_t;
+
+static combo_t const m_case_combos[] = {
+    COMBO('X', 1, 2),
+    COMBO('Y', 3, 4),
+    COMBO('Z', 3, 4, 5)
+};
+
+static bench_case_t const m_cases[] = {
+    {"combo", "0 a+ 20 b+ 100 a- 110 b-", "X+ X-"},
+    {"combo in other order", "0 b+ 10 a+ 80 b- 90 a-", "X+ X-"},
+    {"combo too slow", "0 a+ 80 b+ 120 a- 130 b-", "a+ b+ a- b-"},
+    {"combo key tapped", "0 a+ 30 a-", "a+ a-"},
+    {"combo key released early", "0 a+ 20 a- 30 b+ 60 b-", "a+ a- b+ b-"},
+    {"keys in no combo", "0 j+ 10 k+ 20 j- 30 k-", "j+ k+ j- k-"},
+    {"shift released in wait", "0 j+ 20 a+ 30 j- 60 a-", "j+ a+ j- a-"},
+    {"wait broken by key", "0 a+ 10 j+ 20 b+ 60 a- 70 b- 80 j-", "a+ j+ b+ a- b- j-"},
+    {"short of longer combo", "0 c+ 10 d+ 120 c- 130 d-", "Y+ Y-"},
+    {"longer combo", "0 c+ 10 d+ 20 e+ 100 e- 110 c- 120 d-", "Z+ Z-"},
+    {"shorter combo by key", "0 c+ 10 d+ 20 j+ 40 j- 100 c- 110 d-", "Y+ j+ j- Y-"},
+    {"shorter combo by release", "0 c+ 10 d+ 30 d- 60 c-", "Y+ Y-"},
+    {"key out of combo", "0 a+ 10 c+ 20 d+ 100 a- 110 c- 120 d-", "a+ Y+ a- Y-"},
+    {"combo released in wait", "0 a+ 10 b+ 20 c+ 30 a- 60 c- 100 b-", "X+ c+ X- c-"},
+    {"two combos held", "0 a+ 10 b+ 30 c+ 40 d+ 45 e+ 100 a- 110 c- 120 b- 130 d- 140 e-", "X+ Z+ X- Z-"},
+};
+
+static key_event_t token_event(char const *p_token) {
+    char name = p_token[0];
+    bool is_press = p_token[1] == '+';
+
+    if ('a' <= name && name <= 'e') {
+        return KEY_EVENT(name - 'a' + 1, is_press);
+    }
+
+    return KEY_EVENT(name - 'j' + 8, is_press);
+}
+
+static void out_format(char *p_output) {
+    size_t len = 0;
+
+    p_output[0] = '\0';
+
+    for (int i = 0; i < m_out_num; i++) {
+        key_event_t event = m_out[i].evt.event;
+        key_index_t index = KEY_EVENT_INDEX(event);
+        char name;
+
+        if (IS_COMBO_KEY_INDEX(index)) {
+            name = m_combos[COMBO_OF_KEY_INDEX(index)].code;
+        } else if (index < 8) {
+            name = 'a' + index - 1;
+        } else {
+            name = 'j' + index - 8;
+        }
+
+        len = bench_script_append(p_output, len, name, KEY_EVENT_IS_PRESS(event));
+    }
+}
+
+static int cases_run(void) {
+    int case_num = 0;
+
+    memcpy(m_combos, m_case_combos, sizeof(m_case_combos));
+    m_combo_num = sizeof(m_case_combos) / sizeof(m_case_combos[0]);
+
+    for (size_t c = 0; c < sizeof(m_cases) / sizeof(m_cases[0]); c++) {
+        char output[BENCH_SCRIPT_LEN];
+
+        engine_init();
+        time_advance(bench_script_play(m_cases[c].p_input, token_event, key_send) + TERM * 2);
+        out_format(output);
+        bench_script_check(m_cases[c].p_name, output, m_cases[c].p_output);
+
+        case_num++;
+    }
+
+    return case_num;
+}
+
+// Random combos of 2..COMBO_KEY_MAX distinct keys, a few keys are left out of all combos.
+static void combos_generate(uint16_t combo_num) {
+    m_combo_num = combo_num;
+
+    for (uint16_t combo = 0; combo < combo_num; combo++) {
+        int key_num = 2 + rand() % (COMBO_KEY_MAX - 1);
+
+        memset(&m_combos[combo], 0, sizeof(m_combos[combo]));
+        m_combos[combo].code = combo;
+
+        for (int i = 0; i < key_num; i++) {
+            key_index_t index;
+            bool is_new;
+
+            do {
+                index = 1 + rand() % (KEY_POSITION_NUM - KEY_POSITION_NUM / 8);
+                is_new = true;
+
+                for (int j = 0; j < i; j++) {
+                    is_new = is_new && m_combos[combo].keys[j] != index;
+                }
+            } while (!is_new);
+
+            m_combos[combo].keys[i] = index;
+        }
+    }
+}
+
+static bool is_combo_key(key_index_t index) {
+    for (uint16_t combo = 0; combo < m_combo_num; combo++) {
+        for (int i = 0; i < COMBO_KEY_MAX; i++) {
+            if (m_combos[combo].keys[i] == index) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+// Rolls of random keys, then every few strokes a chord of a random combo pressed within a few ms, held past term.
+static void typing_run(uint32_t stroke_num, typing_stats_t *p_stats) {
+    static bool is_pressed[KEY_POSITION_NUM + 1];
+    static bool is_out[KEY_INDEX_MAX + 1];
+    uint32_t time = 0;
+
+    engine_init();
+    m_p_stats = p_stats;
+    memset(is_pressed, 0, sizeof(is_pressed));
+    memset(is_out, 0, sizeof(is_out));
+
+    for (uint32_t stroke = 0; stroke < stroke_num && m_out_num < OUT_MAX - 4 * KEY_POSITION_NUM; stroke++) {
+        bool is_chord = stroke % 8 == 7 && m_combo_num > 0;
+        key_index_t keys[COMBO_KEY_MAX] = {0};
+        int key_num = 1;
+        uint16_t combo = 0;
+        int out_start;
+
+        if (is_chord) {
+            // Chord starts with nothing pressed, so no other combo or wait is around.
+            time += 200;
+
+            for (key_index_t k = 1; k <= KEY_POSITION_NUM; k++) {
+                if (is_pressed[k]) {
+                    key_send(KEY_EVENT(k, false), time);
+                    is_pressed[k] = false;
+                }
+            }
+
+            time += 200;
+            combo = rand() % m_combo_num;
+            memcpy(keys, m_combos[combo].keys, sizeof(keys));
+            key_num = COMBO_KEY_MAX;
+            p_stats->chords++;
+        } else {
+            keys[0] = 1 + rand() % KEY_POSITION_NUM;
+        }
+
+        out_start = m_out_num;
+
+        for (int i = 0; i < key_num; i++) {
+            key_index_t index = keys[i];
+            uint64_t start;
+            int out_num;
+
+            if (index == 0 || is_pressed[index]) {
+                continue;
+            }
+
+            time += is_chord ? rand() % 8 : 10 + rand() % 90;
+
+            // Release keys pressed long enough, rolls overlap a few keys.
+            for (key_index_t k = 1; k <= KEY_POSITION_NUM && !is_chord; k++) {
+                if (is_pressed[k] && time - m_press_time[k] > 60 + (uint32_t)(k * 37 % 120)) {
+                    key_send(KEY_EVENT(k, false), time);
+                    is_pressed[k] = false;
+                }
+            }
+
+            time_advance(time);
+            out_num = m_out_num;
+            m_call++;
+            m_press_time[index] = time;
+            m_press_call[index] = m_call;
+
+            start = time_ns();
+            combo_process(KEY_EVENT(index, true), SOURCE_BENCH, time);
+            start = time_ns() - start;
+
+            p_stats->process_ns += start;
+            p_stats->events++;
+            is_pressed[index] = true;
+
+            if (is_combo_key(index)) {
+                p_stats->combo_key_ns += start;
+                p_stats->combo_key_events++;
+            } else if (m_out_num == out_num || m_out[m_out_num - 1].evt.event != KEY_EVENT(index, true)) {
+                fprintf(stderr, "error: key %d in no combo was held back.\n", index);
+                m_error_count++;
+            }
+        }
+
+        if (is_chord) {
+            combo_mask_t mask;
+            combo_mask_t fired_mask;
+            bool is_fired = false;
+
+            combo_mask_get(combo, mask);
+
+            // Chord keys stay pressed past term, so a longer combo wait ends too.
+            time += TERM;
+            time_advance(time);
+
+            for (int i = out_start; i < m_out_num; i++) {
+                key_index_t index = KEY_EVENT_INDEX(m_out[i].evt.event);
+
+                if (IS_COMBO_KEY_INDEX(index)) {
+                    combo_mask_get(COMBO_OF_KEY_INDEX(index), fired_mask);
+                    is_fired = is_fired || memcmp(fired_mask, mask, sizeof(mask)) == 0;
+                }
+            }
+
+            if (!is_fired) {
+                fprintf(stderr, "error: chord of combo %u didn't fire it.\n", combo);
+                m_error_count++;
+            } else {
+                p_stats->chords_fired++;
+            }
+        }
+    }
+
+    time += 200;
+
+    for (key_index_t k = 1; k <= KEY_POSITION_NUM; k++) {
+        if (is_pressed[k]) {
+            key_send(KEY_EVENT(k, false), time);
+        }
+    }
+
+    time_advance(time + TERM);
+    combo_flush();
+
+    // Output keys are pressed & released in pairs, and none is left pressed.
+    for (int i = 0; i < m_out_num; i++) {
+        key_event_t event = m_out[i].evt.event;
+        key_index_t index = KEY_EVENT_INDEX(event);
+
+        if (is_out[index] == KEY_EVENT_IS_PRESS(event)) {
+            fprintf(stderr, "error: output key %d %s twice.\n", index, KEY_EVENT_IS_PRESS(event) ? "pressed" : "released");
+            m_error_count++;
+            break;
+        }
+
+        is_out[index] = KEY_EVENT_IS_PRESS(event);
+    }
+
+    for (int index = 1; index <= KEY_INDEX_MAX; index++) {
+        if (is_out[index]) {
+            fprintf(stderr, "error: output key %d left pressed.\n", index);
+            m_error_count++;
+            break;
+        }
+    }
+
+    m_p_stats = NULL;
+}
+
+int main(int argc, char *argv[]) {
+    static uint16_t const combo_nums[] = {32, 128, 512, 1024};
+    uint32_t stroke_num = 400;
+    uint32_t run_num = 100;
+    unsigned seed = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:r:s:")) != -1) {
+        switch (opt) {
+            case 'n':
+                stroke_num = strtoul(optarg, NULL, 0);
+                break;
+
+            case 'r':
+                run_num = strtoul(optarg, NULL, 0);
+                break;
+
+            case 's':
+                seed = strtoul(optarg, NULL, 0);
+                break;
+
+            default:
+                fprintf(stderr, "Usage: %s [-n <key strokes per run>] [-r <runs per combo number>] [-s <seed>]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    srand(seed);
+
+    int case_num = cases_run();
+
+    // One line per stat, for tracking across engine changes.
+    printf("cases: %d\n", case_num);
+    printf("combo_term_ms: %d\n", TERM);
+    printf("key_positions: %d\n", KEY_POSITION_NUM);
+    printf("mask_words: %d\n", COMBO_MASK_WORDS);
+
+    for (size_t n = 0; n < sizeof(combo_nums) / sizeof(combo_nums[0]); n++) {
+        typing_stats_t stats = {0};
+        uint8_t held_peak = 0;
+
+        for (uint32_t run = 0; run < run_num; run++) {
+            combos_generate(combo_nums[n]);
+            typing_run(stroke_num, &stats);
+
+            if (combo_held_peak() > held_peak) {
+                held_peak = combo_held_peak();
+            }
+        }
+
+        printf("combos_%u_index_words: %u\n", combo_nums[n], (unsigned)COMBO_BUFFER_WORDS(combo_nums[n]));
+        printf("combos_%u_events: %u\n", combo_nums[n], (unsigned)stats.events);
+        printf("combos_%u_held_back: %.1f%%\n", combo_nums[n], stats.events > 0 ? (double)stats.held_back * 100 / stats.events : 0.0);
+        printf("combos_%u_held_back_max_ms: %u\n", combo_nums[n], (unsigned)stats.held_back_max);
+        printf("combos_%u_held_peak: %u\n", combo_nums[n], held_peak);
+        printf("combos_%u_chords_fired: %u/%u\n", combo_nums[n], (unsigned)stats.chords_fired, (unsigned)stats.chords);
+        printf("combos_%u_process_ns: %.1f\n", combo_nums[n], stats.events > 0 ? (double)stats.process_ns / stats.events : 0.0);
+        printf("combos_%u_combo_key_process_ns: %.1f\n", combo_nums[n], stats.combo_key_events > 0 ? (double)stats.combo_key_ns / stats.combo_key_events : 0.0);
+    }
+
+    printf("errors: %d\n", m_error_count);
+
+    return m_error_count > 0 ? 1 : 0;
+}
@@ -0,0 +1,319 @@
+/*
+ * Host test & benchmark of wired KB link framing (src/kb_link) through loopback backend, which shares frame
+ * receiver with UARTE backend. Bench plays the other half: it fetches sent frames and injects frames or wire bytes.
+ * Checks round trip of every message and length, that any single bit error is rejected, that a lost byte on wire
+ * costs only its own frame, and that hello of a reset half comes out as disconnect & connect. Reports wire latency
+ * at UARTE baud rate and CPU time of encode & receive.
+ * Build & run from this folder (or 'make kb_link_bench' in armgcc folder):
+ *   cc -O2 -I../matrix_bench/sdk_stub -I../../keyboards/ErgoTravel/default -I../../src/config -o kb_link_bench \
+ *     kb_link_bench.c ../../src/kb_link/kb_link_frame.c ../../src/kb_link/kb_link_transport_loopback.c && ./kb_link_bench
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sdk_errors.h"
+
+#include "../../src/kb_link/kb_link_frame.h"
+#include "../../src/kb_link/kb_link_transport.h"
+#include "../bench/bench.h"
+
+#define BAUDRATE     250000 // KB_LINK_UARTE_BAUDRATE.
+#define BYTE_BITS    10     // Start, 8 data & stop bit.
+#define EVT_MAX      64
+#define STREAM_NUM   2000   // Frames of lost byte stream.
+#define DROP_NUM     500    // Lost bytes in it, one per frame at most.
+#define TIME_REPEAT  100000
+
+typedef struct rec_evt_s {
+    kb_link_transport_evt_type_t evt_type;
+    kb_link_msg_t msg;
+    uint8_t data[KB_LINK_FRAME_PAYLOAD_MAX];
+    uint8_t len;
+} rec_evt_t;
+
+static rec_evt_t m_evts[EVT_MAX];
+static int m_evt_num = 0;
+static uint32_t m_seqs[STREAM_NUM]; // Sequence numbers of stream frames received, in order.
+static uint32_t m_seq_num = 0;
+
+static const kb_link_msg_t m_msgs[] = {KB_LINK_MSG_KEY_INDEX, KB_LINK_MSG_KEY_STATE, KB_LINK_MSG_CONTROL};
+
+static void evt_handler(kb_link_transport_evt_t const *p_evt) {
+    if (p_evt->evt_type == KB_LINK_TRANSPORT_EVT_RX && p_evt->len >= sizeof(uint32_t) && m_seq_num < STREAM_NUM) {
+        memcpy(&m_seqs[m_seq_num++], p_evt->p_data, sizeof(uint32_t));
+    }
+
+    if (m_evt_num < EVT_MAX) {
+        rec_evt_t *p_rec = &m_evts[m_evt_num++];
+
+        p_rec->evt_type = p_evt->evt_type;
+        p_rec->msg = p_evt->msg;
+        p_rec->len = p_evt->len;
+
+        if (p_evt->len > 0) {
+            memcpy(p_rec->data, p_evt->p_data, p_evt->len);
+        }
+    }
+}
+
+static void evts_clear(void) {
+    m_evt_num = 0;
+    m_seq_num = 0;
+}
+
+static void random_fill(uint8_t *p_data, uint8_t len) {
+    for (uint8_t i = 0; i < len; i++) {
+        p_data[i] = rand();
+    }
+}
+
+static bool frame_get(uint8_t *p_frame, uint8_t *p_msg, uint8_t const **pp_data, uint8_t *p_len) {
+    return kb_link_transport_loopback_fetch(p_frame) == NRF_SUCCESS && kb_link_frame_decode(p_frame, p_msg, pp_data, p_len);
+}
+
+// Half is reset, it sends hello and connects on first frame of bench.
+static void test_hello(void) {
+    uint8_t frame[KB_LINK_FRAME_LEN];
+    uint8_t msg;
+    uint8_t len;
+    uint8_t const *p_data;
+
+    check(kb_link_transport_loopback.init(NULL, evt_handler) == NRF_SUCCESS, "init");
+    check(frame_get(frame, &msg, &p_data, &len) && msg == KB_LINK_MSG_HELLO && len == 0, "hello sent at init");
+    check(kb_link_transport_loopback_fetch(frame) == NRF_ERROR_NOT_FOUND, "only hello sent at init");
+
+    // Other half boots later, its hello connects.
+    evts_clear();
+    kb_link_frame_encode(frame, KB_LINK_MSG_HELLO, NULL, 0);
+    check(kb_link_transport_loopback_inject(frame) == NRF_SUCCESS, "hello accepted");
+    check(m_evt_num == 1 && m_evts[0].evt_type == KB_LINK_TRANSPORT_EVT_CONNECTED, "hello connects, no RX");
+
+    // Other half is reset while connected, its state is gone.
+    evts_clear();
+    kb_link_transport_loopback_inject(frame);
+    check(m_evt_num == 2 && m_evts[0].evt_type == KB_LINK_TRANSPORT_EVT_DISCONNECTED &&
+          m_evts[1].evt_type == KB_LINK_TRANSPORT_EVT_CONNECTED, "hello of reset half disconnects & connects");
+
+    // Reset half may miss hello of this half, its first frame still connects, no resync on other frames.
+    check(kb_link_transport_loopback.init(NULL, evt_handler) == NRF_SUCCESS, "init again");
+    evts_clear();
+    kb_link_frame_encode(frame, KB_LINK_MSG_KEY_STATE, NULL, 0);
+    kb_link_transport_loopback_inject(frame);
+    kb_link_transport_loopback_inject(frame);
+    check(m_evt_num == 3 && m_evts[0].evt_type == KB_LINK_TRANSPORT_EVT_CONNECTED &&
+          m_evts[1].evt_type == KB_LINK_TRANSPORT_EVT_RX && m_evts[2].evt_type == KB_LINK_TRANSPORT_EVT_RX,
+          "first frame connects");
+
+    kb_link_transport_loopback_fetch(frame);
+}
+
+// Every message and length is sent, fetched and injected back, as a frame and as bytes.
+static int test_round_trip(void) {
+    int cases = 0;
+    uint8_t frame[KB_LINK_FRAME_LEN];
+    uint8_t data[KB_LINK_FRAME_PAYLOAD_MAX + 1];
+
+    for (int m = 0; m < (int)(sizeof(m_msgs) / sizeof(m_msgs[0])); m++) {
+        for (uint8_t len = 0; len <= KB_LINK_FRAME_PAYLOAD_MAX; len++) {
+            for (int as_bytes = 0; as_bytes < 2; as_bytes++) {
+                random_fill(data, len);
+                evts_clear();
+                cases++;
+
+                check(kb_link_transport_loopback.send(0, m_msgs[m], data, len) == NRF_SUCCESS, "send");
+                check(kb_link_transport_loopback_fetch(frame) == NRF_SUCCESS, "fetch");
+
+                if (as_bytes) {
+                    kb_link_transport_loopback_inject_bytes(frame, sizeof(frame));
+                } else {
+                    check(kb_link_transport_loopback_inject(frame) == NRF_SUCCESS, "inject");
+                }
+
+                check(m_evt_num == 1 && m_evts[0].evt_type == KB_LINK_TRANSPORT_EVT_RX && m_evts[0].msg == m_msgs[m] &&
+                      m_evts[0].len == len && memcmp(m_evts[0].data, data, len) == 0, "frame round trip");
+            }
+        }
+    }
+
+    check(kb_link_transport_loopback.send(0, KB_LINK_MSG_KEY_INDEX, data, KB_LINK_FRAME_PAYLOAD_MAX + 1) ==
+          NRF_ERROR_INVALID_LENGTH, "too long payload rejected");
+    check(kb_link_transport_loopback.send(1, KB_LINK_MSG_KEY_INDEX, data, 1) == NRF_ERROR_INVALID_PARAM,
+          "link 1 rejected");
+
+    for (int i = 0; i < KB_LINK_LOOPBACK_QUEUE_SIZE; i++) {
+        check(kb_link_transport_loopback.send(0, KB_LINK_MSG_KEY_INDEX, data, 1) == NRF_SUCCESS, "send to outbox");
+    }
+
+    check(kb_link_transport_loopback.send(0, KB_LINK_MSG_KEY_INDEX, data, 1) == NRF_ERROR_RESOURCES,
+          "full outbox rejected");
+
+    while (kb_link_transport_loopback_fetch(frame) == NRF_SUCCESS) {
+    }
+
+    return cases;
+}
+
+// Each single bit error is rejected, frame after it on wire is still received.
+static int test_crc_reject(void) {
+    int cases = 0;
+    uint8_t good[KB_LINK_FRAME_LEN];
+    uint8_t data[KB_LINK_FRAME_PAYLOAD_MAX];
+
+    random_fill(data, sizeof(data));
+    kb_link_frame_encode(good, KB_LINK_MSG_KEY_INDEX, data, 4);
+
+    for (int byte = 0; byte < KB_LINK_FRAME_LEN; byte++) {
+        for (int bit = 0; bit < 8; bit++) {
+            uint8_t bad[KB_LINK_FRAME_LEN];
+
+            memcpy(bad, good, sizeof(bad));
+            bad[byte] ^= 1 << bit;
+            evts_clear();
+            cases++;
+
+            check(kb_link_transport_loopback_inject(bad) == NRF_ERROR_INVALID_DATA && m_evt_num == 0,
+                  "frame with bit error rejected");
+
+            kb_link_transport_loopback_inject_bytes(bad, sizeof(bad));
+            check(m_evt_num == 0, "bytes with bit error rejected");
+
+            kb_link_transport_loopback_inject_bytes(good, sizeof(good));
+            check(m_evt_num == 1 && m_evts[0].len == 4 && memcmp(m_evts[0].data, data, 4) == 0,
+                  "frame after bit error received");
+        }
+    }
+
+    return cases;
+}
+
+/*
+ * Stream of numbered frames with random payloads, some with a byte lost, is delivered in random chunks as DMA would.
+ * Every frame without a lost byte must be received in order, so a lost byte costs only its own frame; old receiver
+ * hunted through next frame too and lost it as well.
+ */
+static int test_lost_byte(void) {
+    static uint8_t stream[STREAM_NUM * KB_LINK_FRAME_LEN];
+    static bool drop[STREAM_NUM + 1];
+    uint32_t stream_len = 0;
+    uint32_t drop_num = 0;
+    uint32_t pos = 0;
+    uint32_t next = 0;
+    bool in_order = true;
+
+    memset(drop, 0, sizeof(drop));
+
+    for (int i = 0; i < DROP_NUM; i++) {
+        drop[1 + rand() % STREAM_NUM] = true;
+    }
+
+    for (uint32_t seq = 1; seq <= STREAM_NUM; seq++) {
+        uint8_t frame[KB_LINK_FRAME_LEN];
+        uint8_t data[KB_LINK_FRAME_PAYLOAD_MAX];
+        uint8_t len = sizeof(seq) + rand() % (KB_LINK_FRAME_PAYLOAD_MAX - sizeof(seq) + 1);
+        int lost_byte = drop[seq] ? rand() % KB_LINK_FRAME_LEN : -1;
+
+        // Payloads full of sync bytes make false frame starts.
+        random_fill(data, len);
+        for (uint8_t i = sizeof(seq); i < len; i++) {
+            data[i] = rand() % 4 == 0 ? KB_LINK_FRAME_SYNC : data[i];
+        }
+        memcpy(data, &seq, sizeof(seq));
+        kb_link_frame_encode(frame, KB_LINK_MSG_KEY_INDEX, data, len);
+
+        drop_num += drop[seq];
+
+        for (int b = 0; b < KB_LINK_FRAME_LEN; b++) {
+            if (b != lost_byte) {
+                stream[stream_len++] = frame[b];
+            }
+        }
+    }
+
+    evts_clear();
+
+    while (pos < stream_len) {
+        uint32_t chunk = 1 + rand() % (2 * KB_LINK_FRAME_LEN);
+
+        chunk = chunk < stream_len - pos ? chunk : stream_len - pos;
+        kb_link_transport_loopback_inject_bytes(&stream[pos], chunk);
+        pos += chunk;
+    }
+
+    for (uint32_t seq = 1; seq <= STREAM_NUM; seq++) {
+        if (drop[seq]) {
+            continue;
+        }
+
+        if (next >= m_seq_num || m_seqs[next] != seq) {
+            in_order = false;
+            break;
+        }
+
+        next++;
+    }
+
+    check(in_order && next == m_seq_num, "frames without lost byte received in order, no other frame received");
+
+    printf("lost_byte_frames: %d\n", STREAM_NUM);
+    printf("lost_byte_drops: %u\n", drop_num);
+    printf("lost_byte_frames_lost: %u\n", STREAM_NUM - m_seq_num);
+
+    return STREAM_NUM;
+}
+
+// Wire time of frames at UARTE baud rate & CPU time of encode and of byte receive on host.
+static void latency_report(void) {
+    uint8_t frame[KB_LINK_FRAME_LEN];
+    uint8_t data[KB_LINK_FRAME_PAYLOAD_MAX];
+    uint32_t frame_us = KB_LINK_FRAME_LEN * BYTE_BITS * 1000000 / BAUDRATE;
+    uint64_t start;
+    uint64_t encode_ns;
+    uint64_t receive_ns;
+
+    random_fill(data, sizeof(data));
+
+    start = time_ns();
+    for (int i = 0; i < TIME_REPEAT; i++) {
+        data[0] = i;
+        kb_link_frame_encode(frame, KB_LINK_MSG_KEY_INDEX, data, sizeof(data));
+    }
+    encode_ns = (time_ns() - start) / TIME_REPEAT;
+
+    evts_clear();
+    start = time_ns();
+    for (int i = 0; i < TIME_REPEAT; i++) {
+        kb_link_transport_loopback_inject_bytes(frame, sizeof(frame));
+        m_evt_num = 0;
+    }
+    receive_ns = (time_ns() - start) / TIME_REPEAT;
+
+    printf("frame_bytes: %d\n", KB_LINK_FRAME_LEN);
+    printf("key_events_per_frame: %d\n", (int)(KB_LINK_FRAME_PAYLOAD_MAX / sizeof(key_event_t)));
+    printf("wire_us_per_frame: %u\n", frame_us);
+    // Key event waits behind full TX queue at worst.
+    printf("wire_us_key_event_max: %u\n", frame_us * (KB_LINK_UARTE_TX_QUEUE_SIZE + 1));
+    // Reset half sends hello, other half answers with its state, reset half sends its key state.
+    printf("wire_us_resync: %u\n", frame_us * 3);
+    printf("encode_ns: %llu\n", (unsigned long long)encode_ns);
+    printf("receive_ns: %llu\n", (unsigned long long)receive_ns);
+}
+
+int main(void) {
+    int cases = 0;
+
+    srand(1);
+
+    test_hello();
+    cases += test_round_trip();
+    cases += test_crc_reject();
+    cases += test_lost_byte();
+
+    printf("cases: %d\n", cases);
+    latency_report();
+    printf("errors: %d\n", m_error_count);
+
+    return m_error_count > 0 ? 1 : 0;
+}
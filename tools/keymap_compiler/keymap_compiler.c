@@ -0,0 +1,379 @@
+/*
+ * Host keymap compiler, validates compiled KEYMAP & combos of keyboard and packs KEYMAP into keymap blob.
+ * Reports worst-case translation cost & flash size, fails on keymap errors so it can gate firmware build.
+ * Build & run from this folder (or 'make keymap' in armgcc folder):
+ *   cc -I../../keyboards/ErgoTravel/default -I../../src/config -o keymap_compiler keymap_compiler.c && ./keymap_compiler -o keymap.bin
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "keymap.h"
+#include "../../src/combo/combo.h"
+#include "../../src/keymap_store/keymap_blob.h"
+
+#define LAYER_NUM  (sizeof(KEYMAP) / sizeof(KEYMAP[0]))
+#define PAGE_SIZE  4096
+#define SLOT_SIZE  ((KEYMAP_BLOB_SIZE(KEYMAP_LAYER_MAX) + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE) // Flash slot of keymap store.
+#define KEY_NUM    20   // Keys held at once, as KEY_NUM of firmware_config.h.
+#define COMBO_MAX  32   // As COMBO_MAX of firmware_config.h.
+#define NO_LAYER   -1
+
+_Static_assert(sizeof(KEYMAP[0]) / sizeof(KEYMAP[0][0]) == KEYMAP_KEY_NUM, "Layer size differs from keymap store.");
+_Static_assert(LAYER_NUM <= KEYMAP_LAYER_MAX, "Too many layers for keymap store.");
+
+#ifdef COMBO_DEFINE
+static const combo_t m_combos[] = COMBO_DEFINE;
+#define COMBO_NUM (sizeof(m_combos) / sizeof(m_combos[0]))
+#else
+static const combo_t *const m_combos = NULL;
+#define COMBO_NUM 0
+#endif
+
+static int m_error_count = 0;
+static int m_warning_count = 0;
+
+static void key_report(bool is_error, int layer, int index, char const *p_message, uint32_t code) {
+    fprintf(stderr, "%s: layer %d, key %d: %s (code 0x%X).\n", is_error ? "error" : "warning", layer, index + 1, p_message, (unsigned)code);
+
+    if (is_error) {
+        m_error_count++;
+    } else {
+        m_warning_count++;
+    }
+}
+
+// Codes translate_key_index_task knows, anything else is dropped silently.
+static bool code_known(uint32_t code) {
+    if (code == KC_NO || code == KC_TRANSPARENT || IS_LAYER(code) || IS_DEVICE_CONNECTION(code)) {
+        return true;
+    }
+
+    if (IS_TAP_HOLD(code)) {
+        bool is_layer_tap = (code & KC_LAYER_TAP) != 0;
+
+        // Plain key tapped, modifiers or layer held, nothing above tap-hold flags.
+        if ((code & ~(uint32_t)(KC_MOD_TAP | KC_LAYER_TAP | 0xFFFF)) != 0 || (is_layer_tap && (code & KC_MOD_TAP))) {
+            return false;
+        }
+
+        return IS_KEY(TAP_CODE(code)) && (is_layer_tap ? IS_LAYER(HOLD_CODE(code)) : HOLD_CODE(code) != 0);
+    }
+
+    if (IS_MOD(code)) {
+        code = MOD_CODE(code);
+
+        // Modifier alone or modifier with key.
+        return code == KC_NO || IS_KEY(code);
+    }
+
+    return IS_KEY(code);
+}
+
+// Layer code of layer key or layer held by LT, else code itself.
+static uint32_t layer_code(uint32_t code) {
+    return IS_TAP_HOLD(code) && (code & KC_LAYER_TAP) ? HOLD_CODE(code) : code;
+}
+
+// Same walk as translation, returns layer the code resolves from, NO_LAYER when it falls off base layer.
+static int transparent_resolve(int layer, int index, int *p_reads) {
+    *p_reads = 1;
+
+    while (layer >= 0 && KEYMAP[layer][index] == KC_TRANSPARENT) {
+        layer--;
+
+        if (layer >= 0) {
+            (*p_reads)++;
+        }
+    }
+
+    return layer;
+}
+
+static void layers_reach(bool reachable[LAYER_NUM]) {
+    int stack[LAYER_NUM];
+    int depth = 0;
+
+    memset(reachable, 0, LAYER_NUM * sizeof(bool));
+
+    reachable[_BASE_LAYER] = true;
+    stack[depth++] = _BASE_LAYER;
+
+    // Combo works on every layer, so its layer is reachable from base layer.
+    for (int combo = 0; combo < (int)COMBO_NUM; combo++) {
+        uint32_t code = layer_code(m_combos[combo].code);
+
+        if (IS_LAYER(code) && LAYER(code) < LAYER_NUM && !reachable[LAYER(code)]) {
+            reachable[LAYER(code)] = true;
+            stack[depth++] = LAYER(code);
+        }
+    }
+
+    // Layer key is honored only as direct code of its layer, transparency to it is not followed.
+    while (depth > 0) {
+        int layer = stack[--depth];
+
+        for (int index = 0; index < KEYMAP_KEY_NUM; index++) {
+            uint32_t code = layer_code(KEYMAP[layer][index]);
+
+            if (IS_LAYER(code) && LAYER(code) < LAYER_NUM && !reachable[LAYER(code)]) {
+                reachable[LAYER(code)] = true;
+                stack[depth++] = LAYER(code);
+            }
+        }
+    }
+}
+
+static void keymap_validate(bool const reachable[LAYER_NUM], int *p_max_reads, int *p_total_reads, int *p_max_chain) {
+    *p_max_reads = 0;
+    *p_total_reads = 0;
+    *p_max_chain = 0;
+
+    for (int layer = 0; layer < (int)LAYER_NUM; layer++) {
+        for (int index = 0; index < KEYMAP_KEY_NUM; index++) {
+            uint32_t code = KEYMAP[layer][index];
+            int reads;
+            int resolved;
+
+            if (!code_known(code)) {
+                key_report(false, layer, index, "unknown code is ignored", code);
+            }
+
+            if (IS_LAYER(layer_code(code)) && LAYER(layer_code(code)) >= LAYER_NUM) {
+                key_report(true, layer, index, "layer key refers to missing layer", code);
+            }
+
+            resolved = transparent_resolve(layer, index, &reads);
+
+            if (resolved == NO_LAYER) {
+                key_report(true, layer, index, "transparency falls off base layer", code);
+            } else if (resolved != layer && IS_LAYER(layer_code(KEYMAP[resolved][index]))) {
+                key_report(false, layer, index, "transparency resolves to layer key, which is ignored", KEYMAP[resolved][index]);
+            }
+
+            if (!reachable[layer]) {
+                continue;
+            }
+
+            *p_total_reads += reads;
+
+            if (reads > *p_max_reads) {
+                *p_max_reads = reads;
+            }
+
+            if (resolved != NO_LAYER && layer - resolved > *p_max_chain) {
+                *p_max_chain = layer - resolved;
+            }
+        }
+    }
+
+    for (int layer = 0; layer < (int)LAYER_NUM; layer++) {
+        if (!reachable[layer]) {
+            fprintf(stderr, "warning: layer %d is not reachable from base layer.\n", layer);
+            m_warning_count++;
+        }
+    }
+}
+
+static void combo_report(bool is_error, int combo, char const *p_message) {
+    fprintf(stderr, "%s: combo %d: %s (code 0x%X).\n", is_error ? "error" : "warning", combo, p_message, (unsigned)m_combos[combo].code);
+
+    if (is_error) {
+        m_error_count++;
+    } else {
+        m_warning_count++;
+    }
+}
+
+// Combo keys as combo engine masks them, returns number of keys, or -1 on key out of range or repeated.
+static int combo_mask(int combo, combo_mask_t mask) {
+    int key_num = 0;
+
+    memset(mask, 0, sizeof(combo_mask_t));
+
+    for (int i = 0; i < COMBO_KEY_MAX; i++) {
+        key_index_t index = m_combos[combo].keys[i];
+
+        if (index == 0) {
+            continue;
+        }
+
+        if (index > KEY_POSITION_NUM || (mask[(index - 1) / 32] & (1UL << ((index - 1) % 32)))) {
+            return -1;
+        }
+
+        mask[(index - 1) / 32] |= 1UL << ((index - 1) % 32);
+        key_num++;
+    }
+
+    return key_num;
+}
+
+static void combos_validate(int *p_combo_key_num) {
+    combo_mask_t keys = {0};
+
+    *p_combo_key_num = 0;
+
+    if (COMBO_NUM > COMBO_MAX) {
+        fprintf(stderr, "error: %u combos, firmware takes %d.\n", (unsigned)COMBO_NUM, COMBO_MAX);
+        m_error_count++;
+    }
+
+    for (int combo = 0; combo < (int)COMBO_NUM; combo++) {
+        uint32_t code = m_combos[combo].code;
+        combo_mask_t mask;
+        int key_num = combo_mask(combo, mask);
+
+        if (key_num < 0) {
+            combo_report(true, combo, "key is out of range or repeated");
+            continue;
+        }
+
+        if (key_num < 2) {
+            combo_report(true, combo, "combo needs two keys at least");
+        }
+
+        // Combo code is same on every layer, so there is nothing to fall through to.
+        if (code == KC_NO || code == KC_TRANSPARENT || !code_known(code)) {
+            combo_report(true, combo, "combo code is empty or unknown");
+        }
+
+        if (IS_LAYER(layer_code(code)) && LAYER(layer_code(code)) >= LAYER_NUM) {
+            combo_report(true, combo, "layer combo refers to missing layer");
+        }
+
+        for (int other = 0; other < combo; other++) {
+            combo_mask_t other_mask;
+
+            if (combo_mask(other, other_mask) == key_num && memcmp(mask, other_mask, sizeof(mask)) == 0) {
+                combo_report(false, combo, "same keys as an earlier combo, it never fires");
+                break;
+            }
+        }
+
+        for (int w = 0; w < COMBO_MASK_WORDS; w++) {
+            keys[w] |= mask[w];
+        }
+    }
+
+    for (int index = 1; index <= KEY_POSITION_NUM; index++) {
+        *p_combo_key_num += (keys[(index - 1) / 32] >> ((index - 1) % 32)) & 1;
+    }
+}
+
+// Same CRC32 as crc32_compute of nRF5 SDK.
+static uint32_t crc32_compute(uint8_t const *p_data, uint32_t size) {
+    uint32_t crc = 0xFFFFFFFF;
+
+    for (uint32_t i = 0; i < size; i++) {
+        crc ^= p_data[i];
+
+        for (int j = 0; j < 8; j++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+
+    return ~crc;
+}
+
+static void uint16_put(uint8_t *p_data, uint16_t value) {
+    p_data[0] = value & 0xFF;
+    p_data[1] = value >> 8;
+}
+
+static void uint32_put(uint8_t *p_data, uint32_t value) {
+    uint16_put(&p_data[0], value & 0xFFFF);
+    uint16_put(&p_data[2], value >> 16);
+}
+
+static uint32_t blob_pack(uint8_t *p_blob) {
+    uint8_t *p_codes = &p_blob[sizeof(keymap_blob_header_t)];
+    uint32_t codes_size = LAYER_NUM * KEYMAP_KEY_NUM * sizeof(uint32_t);
+    uint32_t crc;
+
+    // Codes are little endian, as read by nRF52.
+    for (uint32_t layer = 0; layer < LAYER_NUM; layer++) {
+        for (uint32_t index = 0; index < KEYMAP_KEY_NUM; index++) {
+            uint32_put(&p_codes[(layer * KEYMAP_KEY_NUM + index) * sizeof(uint32_t)], KEYMAP[layer][index]);
+        }
+    }
+
+    crc = crc32_compute(p_codes, codes_size);
+
+    // Header, field by field in keymap_blob_header_t order. Sequence & magic are set by firmware on commit.
+    p_blob[0] = KEYMAP_BLOB_VERSION;
+    p_blob[1] = LAYER_NUM;
+    uint16_put(&p_blob[2], KEYMAP_KEY_NUM);
+    uint32_put(&p_blob[4], crc);
+    uint32_put(&p_blob[8], 0);
+    uint32_put(&p_blob[12], 0);
+
+    return crc;
+}
+
+int main(int argc, char *argv[]) {
+    static uint8_t blob[KEYMAP_BLOB_SIZE(KEYMAP_LAYER_MAX)];
+    bool reachable[LAYER_NUM];
+    char const *p_blob_path = NULL;
+    int max_reads, total_reads, max_chain, combo_key_num, reachable_num = 0;
+    uint32_t crc;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "o:")) != -1) {
+        switch (opt) {
+            case 'o':
+                p_blob_path = optarg;
+                break;
+
+            default:
+                fprintf(stderr, "Usage: %s [-o <blob file>]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    layers_reach(reachable);
+    keymap_validate(reachable, &max_reads, &total_reads, &max_chain);
+    combos_validate(&combo_key_num);
+
+    for (int layer = 0; layer < (int)LAYER_NUM; layer++) {
+        reachable_num += reachable[layer];
+    }
+
+    crc = blob_pack(blob);
+
+    // One line per stat, for tracking across keyboards.
+    printf("layers: %u\n", (unsigned)LAYER_NUM);
+    printf("reachable_layers: %d\n", reachable_num);
+    printf("keys_per_layer: %u\n", (unsigned)KEYMAP_KEY_NUM);
+    printf("max_transparent_chain: %d\n", max_chain);
+    printf("max_reads_per_key: %d\n", max_reads);
+    printf("mean_reads_per_key: %.2f\n", reachable_num > 0 ? (double)total_reads / (reachable_num * KEYMAP_KEY_NUM) : 0.0);
+    printf("max_reads_per_translation: %d\n", max_reads * KEY_NUM);
+    printf("combos: %u\n", (unsigned)COMBO_NUM);
+    printf("combo_keys: %d\n", combo_key_num);
+    printf("compiled_size: %u\n", (unsigned)sizeof(KEYMAP));
+    printf("blob_size: %u\n", (unsigned)KEYMAP_BLOB_SIZE(LAYER_NUM));
+    printf("slot_usage: %u%%\n", (unsigned)(KEYMAP_BLOB_SIZE(LAYER_NUM) * 100 / SLOT_SIZE));
+    printf("crc: 0x%08X\n", (unsigned)crc);
+    printf("errors: %d\n", m_error_count);
+    printf("warnings: %d\n", m_warning_count);
+
+    if (m_error_count > 0) {
+        return 1;
+    }
+
+    if (p_blob_path != NULL) {
+        FILE *p_file = fopen(p_blob_path, "wb");
+
+        if (p_file == NULL || fwrite(blob, 1, KEYMAP_BLOB_SIZE(LAYER_NUM), p_file) != KEYMAP_BLOB_SIZE(LAYER_NUM)) {
+            fprintf(stderr, "error: can't write %s.\n", p_blob_path);
+            return 1;
+        }
+
+        fclose(p_file);
+    }
+
+    return 0;
+}
@@ -0,0 +1,323 @@
+#include "chip_mock.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "app_scheduler.h"
+#include "app_timer.h"
+#include "nrf.h"
+#include "nrf_delay.h"
+#include "nrf_gpio.h"
+#include "nrf_gpiote.h"
+#include "nrf_pwr_mgmt.h"
+#include "sdk_errors.h"
+
+#include "../../src/matrix/matrix.h"
+
+#define PIN_NUM         32
+#define TIMER_MAX       8
+#define SCHED_MAX       64 // Deeper than firmware queue, peak is reported instead.
+#define SCHED_DATA_SIZE 32
+#define IRQ_RUN_MAX     16 // Interrupt that keeps firing is a bug of handler.
+
+void GPIOTE_IRQHandler(void);
+
+typedef struct sched_evt_s {
+    app_sched_event_handler_t handler;
+    uint8_t data[SCHED_DATA_SIZE];
+    uint16_t size;
+} sched_evt_t;
+
+static const uint8_t m_rows[MATRIX_ROW_NUM] = MATRIX_ROW_PINS;
+static const uint8_t m_cols[MATRIX_COL_NUM] = MATRIX_COL_PINS;
+
+static matrix_col_t m_switches[MATRIX_COL_NUM];
+static uint32_t m_out = 0; // Output pins driven high.
+static nrf_gpio_pin_sense_t m_sense[PIN_NUM];
+static bool m_detect = false;
+static bool m_port_event = false;
+static bool m_port_int = false;
+static bool m_irq_pending = false;
+static bool m_irq_enabled = false;
+
+static uint64_t m_tick = 0;
+static app_timer_t *m_timers[TIMER_MAX];
+static int m_timer_num = 0;
+
+static sched_evt_t m_sched[SCHED_MAX];
+static uint32_t m_sched_head = 0;
+static uint32_t m_sched_num = 0;
+
+static chip_mock_stats_t m_stats;
+
+static uint32_t port_read(void) {
+    uint32_t port = 0;
+
+    for (int row = 0; row < MATRIX_ROW_NUM; row++) {
+        for (int col = 0; col < MATRIX_COL_NUM; col++) {
+            if ((m_out & (1UL << m_cols[col])) && (m_switches[col] & ((matrix_col_t)1 << row))) {
+                port |= 1UL << m_rows[row];
+            }
+        }
+    }
+
+    return port;
+}
+
+// Switches closed on high columns, each sinks current into its row pull-down.
+static uint32_t pull_down_num(void) {
+    uint32_t num = 0;
+
+    for (int col = 0; col < MATRIX_COL_NUM; col++) {
+        if (m_out & (1UL << m_cols[col])) {
+            for (matrix_col_t bits = m_switches[col]; bits != 0; bits &= bits - 1) {
+                num++;
+            }
+        }
+    }
+
+    return num;
+}
+
+// DETECT is OR of every pin whose level matches its SENSE, PORT event comes on its rising edge only.
+static void detect_update(void) {
+    uint32_t port = port_read();
+    bool detect = false;
+
+    for (int pin = 0; pin < PIN_NUM; pin++) {
+        bool high = (port & (1UL << pin)) != 0;
+
+        if ((m_sense[pin] == NRF_GPIO_PIN_SENSE_HIGH && high) || (m_sense[pin] == NRF_GPIO_PIN_SENSE_LOW && !high)) {
+            detect = true;
+        }
+    }
+
+    if (detect && !m_detect) {
+        if (m_stats.is_off) {
+            m_stats.is_off_woken = true;
+        } else {
+            m_port_event = true;
+            m_stats.port_events++;
+        }
+    }
+
+    m_detect = detect;
+}
+
+void chip_mock_switch_set(uint8_t row, uint8_t col, bool closed) {
+    if (closed) {
+        m_switches[col] |= (matrix_col_t)1 << row;
+    } else {
+        m_switches[col] &= ~((matrix_col_t)1 << row);
+    }
+
+    detect_update();
+}
+
+void chip_mock_reset(void) {
+    m_out = 0;
+    memset(m_sense, 0, sizeof(m_sense));
+    m_detect = false;
+    m_port_event = false;
+    m_port_int = false;
+    m_irq_pending = false;
+    m_irq_enabled = false;
+    m_timer_num = 0;
+    m_sched_num = 0;
+    m_stats.is_off = false;
+    m_stats.is_off_woken = false;
+
+    detect_update();
+}
+
+void nrf_delay_us(uint32_t us_time) {
+    m_stats.busy_us += us_time;
+    m_stats.pull_down_us += (uint64_t)us_time * pull_down_num();
+}
+
+void nrf_gpio_cfg_output(uint32_t pin_number) {
+}
+
+void nrf_gpio_cfg_input(uint32_t pin_number, nrf_gpio_pin_pull_t pull_config) {
+}
+
+void nrf_gpio_cfg_sense_set(uint32_t pin_number, nrf_gpio_pin_sense_t sense_config) {
+    m_sense[pin_number] = sense_config;
+    detect_update();
+}
+
+void nrf_gpio_pin_set(uint32_t pin_number) {
+    m_out |= 1UL << pin_number;
+    detect_update();
+}
+
+void nrf_gpio_pin_clear(uint32_t pin_number) {
+    m_out &= ~(1UL << pin_number);
+    detect_update();
+}
+
+uint32_t nrf_gpio_pin_read(uint32_t pin_number) {
+    return (port_read() >> pin_number) & 1;
+}
+
+uint32_t nrf_gpio_port_in_read(NRF_GPIO_Type const *p_reg) {
+    return port_read();
+}
+
+void nrf_gpiote_int_enable(uint32_t mask) {
+    m_port_int = true;
+}
+
+void nrf_gpiote_int_disable(uint32_t mask) {
+    m_port_int = false;
+}
+
+void nrf_gpiote_event_clear(nrf_gpiote_events_t event) {
+    m_port_event = false;
+}
+
+void NVIC_SetPriority(IRQn_Type IRQn, uint32_t priority) {
+}
+
+void NVIC_ClearPendingIRQ(IRQn_Type IRQn) {
+    m_irq_pending = false;
+}
+
+void NVIC_SetPendingIRQ(IRQn_Type IRQn) {
+    m_irq_pending = true;
+}
+
+void NVIC_EnableIRQ(IRQn_Type IRQn) {
+    m_irq_enabled = true;
+}
+
+void nrf_pwr_mgmt_shutdown(nrf_pwr_mgmt_shutdown_t shutdown_type) {
+    m_stats.is_off = true;
+}
+
+ret_code_t app_timer_create(app_timer_id_t const *p_timer_id, app_timer_mode_t mode, app_timer_timeout_handler_t timeout_handler) {
+    if (m_timer_num >= TIMER_MAX) {
+        abort();
+    }
+
+    (*p_timer_id)->handler = timeout_handler;
+    (*p_timer_id)->mode = mode;
+    (*p_timer_id)->is_running = false;
+    m_timers[m_timer_num++] = *p_timer_id;
+
+    return NRF_SUCCESS;
+}
+
+ret_code_t app_timer_start(app_timer_id_t timer_id, uint32_t timeout_ticks, void *p_context) {
+    timer_id->is_running = true;
+    timer_id->due = m_tick + timeout_ticks;
+    timer_id->interval = timeout_ticks;
+    timer_id->p_context = p_context;
+
+    return NRF_SUCCESS;
+}
+
+ret_code_t app_timer_stop(app_timer_id_t timer_id) {
+    timer_id->is_running = false;
+
+    return NRF_SUCCESS;
+}
+
+// RTC counter is 24 bits.
+uint32_t app_timer_cnt_get(void) {
+    return (uint32_t)m_tick & 0xFFFFFF;
+}
+
+uint32_t app_timer_cnt_diff_compute(uint32_t ticks_to, uint32_t ticks_from) {
+    return (ticks_to - ticks_from) & 0xFFFFFF;
+}
+
+ret_code_t app_sched_event_put(void const *p_event_data, uint16_t event_size, app_sched_event_handler_t handler) {
+    sched_evt_t *p_evt;
+
+    if (m_sched_num >= SCHED_MAX || event_size > SCHED_DATA_SIZE) {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    p_evt = &m_sched[(m_sched_head + m_sched_num++) % SCHED_MAX];
+    p_evt->handler = handler;
+    p_evt->size = event_size;
+
+    if (event_size > 0) {
+        memcpy(p_evt->data, p_event_data, event_size);
+    }
+
+    if (m_sched_num > m_stats.sched_peak) {
+        m_stats.sched_peak = m_sched_num;
+    }
+
+    return NRF_SUCCESS;
+}
+
+// Columns left high between tasks, e.g. armed sense, keep closed switches sinking current.
+static void time_advance(uint64_t tick) {
+    m_stats.pull_down_us += (tick - m_tick) * 1000000 / APP_TIMER_CLOCK_FREQ * pull_down_num();
+    m_tick = tick;
+}
+
+static void irq_run(void) {
+    for (int i = 0; i < IRQ_RUN_MAX && m_irq_enabled && (m_irq_pending || (m_port_event && m_port_int)); i++) {
+        m_irq_pending = false;
+        m_stats.wakes++;
+        GPIOTE_IRQHandler();
+    }
+}
+
+static void sched_run(void) {
+    while (m_sched_num > 0 && !m_stats.is_off) {
+        sched_evt_t evt = m_sched[m_sched_head];
+
+        m_sched_head = (m_sched_head + 1) % SCHED_MAX;
+        m_sched_num--;
+
+        evt.handler(evt.size > 0 ? evt.data : NULL, evt.size);
+        irq_run();
+    }
+}
+
+void chip_mock_run_until(uint64_t tick) {
+    while (!m_stats.is_off) {
+        app_timer_t *p_next = NULL;
+
+        irq_run();
+        sched_run();
+
+        for (int i = 0; i < m_timer_num; i++) {
+            if (m_timers[i]->is_running && m_timers[i]->due <= tick && (p_next == NULL || m_timers[i]->due < p_next->due)) {
+                p_next = m_timers[i];
+            }
+        }
+
+        if (p_next == NULL) {
+            break;
+        }
+
+        time_advance(p_next->due);
+        m_stats.wakes++;
+
+        if (p_next->mode == APP_TIMER_MODE_REPEATED) {
+            p_next->due += p_next->interval;
+        } else {
+            p_next->is_running = false;
+        }
+
+        p_next->handler(p_next->p_context);
+    }
+
+    if (m_tick < tick) {
+        time_advance(tick);
+    }
+}
+
+uint64_t chip_mock_tick(void) {
+    return m_tick;
+}
+
+void chip_mock_stats_get(chip_mock_stats_t *p_stats) {
+    *p_stats = m_stats;
+}
@@ -0,0 +1,35 @@
+#ifndef _CHIP_MOCK_H_
+#define _CHIP_MOCK_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Host mock of chip under low power core (src/low_power) and GPIO matrix backend. P0 pins with SENSE and their shared
+ * DETECT level, GPIOTE PORT event, RTC of app_timer, app_scheduler queue and System OFF.
+ * Rows are pulled down, closed switch connects its column pin to its row pin. PORT event is raised on rising DETECT,
+ * its interrupt runs between tasks, as GPIOTE IRQ would preempt thread mode.
+ * For energy model it counts CPU busy wait, interrupts run, and time row pull-downs sink current through closed
+ * switches of high columns. Reset keeps time & counts, so a trace runs on across wake from System OFF.
+ */
+#define CHIP_MOCK_TICKS(ms) ((uint64_t)(ms) * APP_TIMER_CLOCK_FREQ / 1000)
+
+typedef struct chip_mock_stats_s {
+    uint32_t port_events;
+    uint32_t sched_peak;   // Most events in scheduler queue at once.
+    uint32_t wakes;        // Timer & GPIOTE interrupts, each wakes CPU from System ON idle.
+    uint64_t busy_us;      // CPU busy wait.
+    uint64_t pull_down_us; // Sum over closed switches of time their column was high.
+    bool is_off;           // System OFF entered.
+    bool is_off_woken;     // DETECT rose in System OFF, chip resets.
+} chip_mock_stats_t;
+
+// Chip resets, pins, timers & scheduler queue are cleared, firmware inits them again.
+void chip_mock_reset(void);
+void chip_mock_switch_set(uint8_t row, uint8_t col, bool closed);
+// Runs timers, GPIOTE interrupt & scheduled tasks in order up to tick, or until chip is off.
+void chip_mock_run_until(uint64_t tick);
+uint64_t chip_mock_tick(void);
+void chip_mock_stats_get(chip_mock_stats_t *p_stats);
+
+#endif
@@ -0,0 +1,477 @@
+/*
+ * Host test & energy model of power tiers (src/low_power) with GPIO matrix backend on chip mock, as scan task of either
+ * half drives them. Checks that idle matrix goes to sense and System OFF and that a press wakes it, and that keys held
+ * across the sleep transition keep matrix scanning, so another press on row of a held key, which sense can't see,
+ * still comes out. Sleep request of master, as slave gets it, is checked with keys held too.
+ * Then replays usage traces, built in or recorded, and estimates average current from time in each tier, CPU time,
+ * row pull-down current of held keys and boots after System OFF, so tier thresholds of firmware_config.h can be
+ * weighed. Trace file has a line per switch edge, '<ms> <row> <col> <+|->', '#' starts a comment.
+ * On master it also gives current of host links, with further hosts kept connected on parked parameters.
+ * Build & run from this folder (or 'make low_power_bench' in armgcc folder):
+ *   cc -O2 -DMASTER -I../matrix_bench/sdk_stub -I../../keyboards/ErgoTravel/default -I../../src/config \
+ *     -o low_power_bench low_power_bench.c chip_mock.c ../../src/low_power/low_power.c ../../src/matrix/matrix.c \
+ *     ../../src/matrix/matrix_backend_gpio.c && ./low_power_bench [-t <trace file>]
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "app_scheduler.h"
+#include "app_timer.h"
+
+#include "../../src/firmware_config.h"
+#include "../../src/low_power/low_power.h"
+#include "../../src/matrix/matrix.h"
+#include "../bench/bench.h"
+
+#include "chip_mock.h"
+
+_Static_assert(MATRIX_ROW_NUM >= 2 && MATRIX_COL_NUM >= 3, "Cases need 2 rows of 3 keys.");
+
+#define EDGE_WAIT_MAX 200 // In ms, press or release that takes longer is lost.
+
+// nRF52832 at 3 V with DC/DC regulator, typical figures of product specification unless marked as estimate.
+#define MODEL_IDLE_UA       1.9    // System ON, RAM retained, RTC running.
+#define MODEL_OFF_UA        0.3    // System OFF, wake on DETECT.
+#define MODEL_CPU_UA        3700.0 // CPU running from flash at 64 MHz.
+#define MODEL_PULL_DOWN_UA  231.0  // 3 V over 13 kOhm row pull-down, while closed switch ties it to a high column.
+#define MODEL_WAKE_US       30     // Estimate, CPU time of interrupt, scheduler & matrix core per wake.
+#define MODEL_LINK_EVENT_UC 3.0    // Estimate, empty connection event of host link.
+#define MODEL_BOOT_UC       2000.0 // Estimate, boot after System OFF and reconnection to host.
+// Empty events of a link on interval (in 1.25 ms units), peripheral skips latency events.
+#define MODEL_LINK_EVENT_UA(interval, latency) (MODEL_LINK_EVENT_UC * 1000000 / (((latency) + 1) * (interval) * 1250.0))
+// Host link while System ON, idle at SLAVE_LATENCY on longest interval; radio traffic of typing is not modelled.
+#define MODEL_LINK_UA MODEL_LINK_EVENT_UA(MASTER_MAX_CONN_INTERVAL, SLAVE_LATENCY)
+
+#define TRACE_MAX      5 // Built in & one trace file.
+#define TRACE_FILE_MAX 100000
+
+typedef struct trace_evt_s {
+    uint32_t time; // In ms from trace start.
+    uint8_t row;
+    uint8_t col;
+    bool closed;
+} trace_evt_t;
+
+typedef struct trace_s {
+    char const *p_name;
+    trace_evt_t *p_evts;
+    uint32_t evt_num;
+    uint32_t end; // In ms.
+} trace_t;
+
+APP_TIMER_DEF(m_scan_timer_id);
+
+static low_power_state_t m_state = LOW_POWER_STATE_ACTIVE;
+static uint64_t m_state_since = 0;
+static uint64_t m_state_ticks[LOW_POWER_STATE_OFF + 1];
+static uint32_t m_scan_count = 0;
+static bool m_reported[KEY_POSITION_NUM + 1]; // Last edge reported by matrix is a press.
+static uint64_t m_edge_tick[KEY_POSITION_NUM + 1];
+static int m_closed_num = 0;                  // Switches closed on chip mock.
+static uint32_t m_sense_held_count = 0;       // Sense or System OFF entered with a switch closed.
+
+static void scan_task(void *p_data, uint16_t size) {
+    matrix_scan_t scan;
+
+    matrix_scan(size > 0, &scan);
+    m_scan_count++;
+
+    for (uint16_t i = 0; i < scan.key_num; i++) {
+        key_index_t index = KEY_EVENT_INDEX(scan.keys[i]);
+
+        m_reported[index] = KEY_EVENT_IS_PRESS(scan.keys[i]);
+        m_edge_tick[index] = chip_mock_tick();
+    }
+
+    if (scan.key_num > 0) {
+        low_power_wake_report_sent();
+    }
+
+    low_power_mode_scan_done(scan.has_activity);
+}
+
+static void scan_timeout_handler(void *p_context) {
+    ret_code_t err_code;
+
+    err_code = app_sched_event_put(NULL, 0, scan_task);
+    APP_ERROR_CHECK(err_code);
+}
+
+// Master requests sleep, e.g. as it goes to sense itself.
+static void sleep_task(void *p_data, uint16_t size) {
+    low_power_mode_start();
+}
+
+static void state_account(void) {
+    m_state_ticks[m_state] += chip_mock_tick() - m_state_since;
+    m_state_since = chip_mock_tick();
+}
+
+static void state_handler(low_power_state_t state) {
+    if ((state == LOW_POWER_STATE_SENSE || state == LOW_POWER_STATE_OFF) && m_closed_num > 0) {
+        m_sense_held_count++;
+    }
+
+    state_account();
+    m_state = state;
+}
+
+// Power on or reset, firmware starts scanning.
+static void boot(void) {
+    ret_code_t err_code;
+
+    state_account();
+    m_state = LOW_POWER_STATE_ACTIVE;
+
+    chip_mock_reset();
+
+    err_code = app_timer_create(&m_scan_timer_id, APP_TIMER_MODE_REPEATED, scan_timeout_handler);
+    APP_ERROR_CHECK(err_code);
+
+    matrix_init(&matrix_backend_gpio);
+    low_power_mode_init(&m_scan_timer_id, scan_task, state_handler);
+
+    err_code = app_timer_start(m_scan_timer_id, SCAN_DELAY_TICKS, NULL);
+    APP_ERROR_CHECK(err_code);
+}
+
+static void run_ms(uint32_t ms) {
+    chip_mock_run_until(chip_mock_tick() + CHIP_MOCK_TICKS(ms));
+}
+
+static void key_set(int row, int col, bool closed) {
+    m_closed_num += closed ? 1 : -1;
+    chip_mock_switch_set(row, col, closed);
+}
+
+// Switch changes and matrix is run until it reports the edge, latency in ms, -1 if edge is lost.
+static int32_t key_edge(int row, int col, bool closed, char const *p_case) {
+    key_index_t index = MATRIX[row][col];
+    uint64_t start = chip_mock_tick();
+
+    key_set(row, col, closed);
+
+    for (int ms = 0; ms < EDGE_WAIT_MAX && m_reported[index] != closed; ms++) {
+        run_ms(1);
+    }
+
+    check(m_reported[index] == closed, p_case);
+
+    return m_reported[index] == closed ? (int32_t)((m_edge_tick[index] - start) * 1000 / APP_TIMER_CLOCK_FREQ) : -1;
+}
+
+static void held_keys_run(void) {
+    chip_mock_stats_t stats;
+    uint32_t scan_count;
+    int32_t wake_latency, held_row_latency, other_row_latency, sleep_request_latency;
+    uint32_t wake_report_us, wake_report_max_us;
+    ret_code_t err_code;
+
+    boot();
+
+    // Idle matrix stops scanning, then press on any row wakes it.
+    run_ms(2 * LOW_POWER_MODE_DELAY);
+    check(m_state == LOW_POWER_STATE_SENSE, "idle matrix didn't reach sense");
+
+    scan_count = m_scan_count;
+    run_ms(LOW_POWER_MODE_DELAY);
+    check(m_scan_count == scan_count, "matrix scanned in sense");
+
+    wake_latency = key_edge(0, 0, true, "press in sense was lost");
+    check(m_state == LOW_POWER_STATE_ACTIVE, "press didn't wake matrix");
+
+    // Key held across sleep transition, its row reads high, so only scanning sees another press on that row.
+    run_ms(3 * LOW_POWER_MODE_DELAY);
+    check(m_state == LOW_POWER_STATE_SLOW_SCAN, "matrix with held key didn't stay in slow scan");
+
+    held_row_latency = key_edge(0, 1, true, "press on row of held key was lost");
+    run_ms(3 * LOW_POWER_MODE_DELAY);
+    other_row_latency = key_edge(1, 0, true, "press on other row with held key was lost");
+
+    // Sleep request while keys are held.
+    run_ms(3 * LOW_POWER_MODE_DELAY);
+    err_code = app_sched_event_put(NULL, 0, sleep_task);
+    APP_ERROR_CHECK(err_code);
+    run_ms(3 * LOW_POWER_MODE_DELAY);
+    check(m_state == LOW_POWER_STATE_SLOW_SCAN, "sleep request with held key stopped scanning");
+
+    sleep_request_latency = key_edge(0, 2, true, "press on row of held key after sleep request was lost");
+
+    key_edge(0, 0, false, "release was lost");
+    key_edge(0, 1, false, "release was lost");
+    key_edge(1, 0, false, "release was lost");
+    key_edge(0, 2, false, "release was lost");
+
+    // All keys released, matrix goes to sense and then System OFF, which a press leaves through reset.
+    run_ms(2 * LOW_POWER_MODE_DELAY);
+    check(m_state == LOW_POWER_STATE_SENSE, "released matrix didn't reach sense");
+
+    if (SYSTEM_OFF_MODE_DELAY > 0) {
+        run_ms((SYSTEM_OFF_MODE_DELAY + 1) * 60000);
+        chip_mock_stats_get(&stats);
+        check(stats.is_off, "sense didn't reach System OFF");
+
+        key_set(1, 1, true);
+        chip_mock_stats_get(&stats);
+        check(stats.is_off_woken, "press in System OFF didn't wake chip");
+        key_set(1, 1, false);
+    }
+
+    check(m_sense_held_count == 0, "sense entered with a key held");
+
+    chip_mock_stats_get(&stats);
+    low_power_wake_latency_get(&wake_report_us, &wake_report_max_us);
+    check(wake_report_us <= wake_report_max_us, "wake to report latency above its max");
+
+    printf("wake_press_latency_ms: %d\n", wake_latency);
+    printf("held_row_press_latency_ms: %d\n", held_row_latency);
+    printf("other_row_press_latency_ms: %d\n", other_row_latency);
+    printf("sleep_request_press_latency_ms: %d\n", sleep_request_latency);
+    printf("wake_report_latency_max_us: %u\n", wake_report_max_us);
+    printf("sense_with_key_held: %u\n", m_sense_held_count);
+    printf("sched_peak: %u\n", stats.sched_peak);
+}
+
+// CPU time of a wake that scans matrix, from busy wait of backend.
+static double scan_us_measure(void) {
+    chip_mock_stats_t start, end;
+
+    boot();
+    chip_mock_stats_get(&start);
+    run_ms(SLOW_SCAN_MODE_DELAY / 2);
+    chip_mock_stats_get(&end);
+
+    return (double)(end.busy_us - start.busy_us) / (end.wakes - start.wakes) + MODEL_WAKE_US;
+}
+
+// Current of each tier on idle matrix, and what it takes for deeper tiers to pay off.
+static void tiers_print(double scan_us) {
+    double active_ua = MODEL_IDLE_UA + MODEL_LINK_UA + MODEL_CPU_UA * scan_us / (SCAN_DELAY * 1000);
+    double slow_scan_ua = MODEL_IDLE_UA + MODEL_LINK_UA + MODEL_CPU_UA * scan_us / (SLOW_SCAN_DELAY * 1000);
+    double sense_ua = MODEL_IDLE_UA + MODEL_LINK_UA;
+    // Charge of idle time until sense, spent after every burst of typing.
+    double idle_tail_uc = active_ua * SLOW_SCAN_MODE_DELAY / 1000 + slow_scan_ua * (LOW_POWER_MODE_DELAY - SLOW_SCAN_MODE_DELAY) / 1000;
+
+    printf("model_scan_us: %.0f\n", scan_us);
+    printf("model_link_ua: %.1f\n", MODEL_LINK_UA);
+    printf("tier_active_ua: %.1f\n", active_ua);
+    printf("tier_slow_scan_ua: %.1f\n", slow_scan_ua);
+    printf("tier_sense_ua: %.1f\n", sense_ua);
+    printf("tier_off_ua: %.1f\n", MODEL_OFF_UA);
+    printf("idle_tail_uc: %.0f\n", idle_tail_uc);
+    // Held key sinks pull-down current while its column is high, only during its column read when scanning.
+    printf("held_key_slow_scan_ua: %.1f\n", slow_scan_ua + MODEL_PULL_DOWN_UA * PIN_SET_DELAY / (SLOW_SCAN_DELAY * 1000));
+    printf("held_key_sense_ua: %.1f\n", sense_ua + MODEL_PULL_DOWN_UA);
+    printf("system_off_break_even_min: %.1f\n", MODEL_BOOT_UC / (sense_ua - MODEL_OFF_UA) / 60);
+}
+
+#ifdef MASTER
+/*
+ * Current of host links, hosts other than current one stay connected on parked parameters. Parked link is on
+ * interval host picks between PARKED_MIN & PARKED_MAX_CONN_INTERVAL, both ends are given.
+ */
+static void hosts_print(void) {
+    double typing_ua = MODEL_LINK_EVENT_UA(MASTER_MAX_CONN_INTERVAL, 0);
+    double parked_ua = MODEL_LINK_EVENT_UA(PARKED_MAX_CONN_INTERVAL, PARKED_SLAVE_LATENCY);
+    double parked_max_ua = MODEL_LINK_EVENT_UA(PARKED_MIN_CONN_INTERVAL, PARKED_SLAVE_LATENCY);
+
+    printf("host_link_typing_ua: %.1f\n", typing_ua);
+    printf("host_link_idle_ua: %.1f\n", MODEL_LINK_UA);
+    printf("host_link_parked_ua: %.1f\n", parked_ua);
+    printf("host_link_parked_max_ua: %.1f\n", parked_max_ua);
+
+    // Sense tier is where links weigh most, current host is idle there.
+    for (int hosts = 1; hosts <= DEVICE_NUM; hosts++) {
+        printf("hosts_%d_sense_ua: %.1f\n", hosts, MODEL_IDLE_UA + MODEL_LINK_UA + (hosts - 1) * parked_ua);
+        printf("hosts_%d_sense_max_ua: %.1f\n", hosts, MODEL_IDLE_UA + MODEL_LINK_UA + (hosts - 1) * parked_max_ua);
+    }
+}
+#endif
+
+static void trace_add(trace_t *p_trace, uint32_t time, uint8_t row, uint8_t col, bool closed) {
+    p_trace->p_evts = realloc(p_trace->p_evts, (p_trace->evt_num + 1) * sizeof(trace_evt_t));
+
+    if (p_trace->p_evts == NULL) {
+        abort();
+    }
+
+    p_trace->p_evts[p_trace->evt_num++] = (trace_evt_t){time, row, col, closed};
+}
+
+// Typing from start for duration, key strokes at 150..400 ms with pauses of 2..60 s now and then.
+static uint32_t typing_add(trace_t *p_trace, uint32_t start, uint32_t duration) {
+    uint32_t time = start;
+
+    while (time < start + duration) {
+        uint8_t row = rand() % MATRIX_ROW_NUM;
+        uint8_t col = rand() % MATRIX_COL_NUM;
+        uint32_t hold = 60 + rand() % 80;
+
+        trace_add(p_trace, time, row, col, true);
+        trace_add(p_trace, time + hold, row, col, false);
+
+        time += rand() % 50 == 0 ? 2000 + rand() % 58000 : 150 + rand() % 250;
+    }
+
+    return time;
+}
+
+static void traces_build(trace_t *p_traces) {
+    // Session of typing.
+    p_traces[0].p_name = "typing";
+    p_traces[0].end = typing_add(&p_traces[0], 0, 10 * 60000) + 60000;
+
+    // Work day at desk, a minute of typing every quarter of an hour.
+    p_traces[1].p_name = "desk";
+    p_traces[1].end = 8 * 3600000;
+
+    for (uint32_t time = 0; time < p_traces[1].end; time += 15 * 60000) {
+        typing_add(&p_traces[1], time, 60000);
+    }
+
+    // Keyboard in a bag, nothing pressed.
+    p_traces[2].p_name = "bag";
+    p_traces[2].end = 8 * 3600000;
+
+    // Keyboard in a bag, something holds a key down.
+    p_traces[3].p_name = "bag_held_key";
+    p_traces[3].end = 60 * 60000;
+    trace_add(&p_traces[3], 1000, 0, 0, true);
+    trace_add(&p_traces[3], p_traces[3].end - 1000, 0, 0, false);
+}
+
+static bool trace_load(trace_t *p_trace, char const *p_path) {
+    FILE *p_file = fopen(p_path, "r");
+    char line[128];
+
+    if (p_file == NULL) {
+        fprintf(stderr, "error: can't open trace '%s'.\n", p_path);
+        return false;
+    }
+
+    p_trace->p_name = "file";
+
+    while (fgets(line, sizeof(line), p_file) != NULL && p_trace->evt_num < TRACE_FILE_MAX) {
+        unsigned time, row, col;
+        char edge;
+
+        if (line[0] == '#' || sscanf(line, "%u %u %u %c", &time, &row, &col, &edge) != 4) {
+            continue;
+        }
+
+        if (row >= MATRIX_ROW_NUM || col >= MATRIX_COL_NUM || (edge != '+' && edge != '-') ||
+            (p_trace->evt_num > 0 && time < p_trace->p_evts[p_trace->evt_num - 1].time)) {
+            fprintf(stderr, "error: trace '%s': bad line '%s'.\n", p_path, line);
+            m_error_count++;
+            continue;
+        }
+
+        trace_add(p_trace, time, row, col, edge == '+');
+        p_trace->end = time + 2 * LOW_POWER_MODE_DELAY;
+    }
+
+    fclose(p_file);
+
+    return true;
+}
+
+// Replays trace from boot, through resets of System OFF, and prints its estimated average current.
+static void trace_run(trace_t const *p_trace) {
+    chip_mock_stats_t start, end;
+    uint64_t start_tick;
+    uint32_t boot_num = 0;
+    double on_s, off_s, total_s, cpu_s, pull_down_s, charge_uc;
+
+    boot();
+    start_tick = chip_mock_tick();
+    chip_mock_stats_get(&start);
+
+    for (int i = 0; i <= LOW_POWER_STATE_OFF; i++) {
+        m_state_ticks[i] = 0;
+    }
+
+    for (uint32_t i = 0; i < p_trace->evt_num; i++) {
+        trace_evt_t const *p_evt = &p_trace->p_evts[i];
+
+        chip_mock_run_until(start_tick + CHIP_MOCK_TICKS(p_evt->time));
+        key_set(p_evt->row, p_evt->col, p_evt->closed);
+
+        chip_mock_stats_get(&end);
+
+        if (end.is_off_woken) {
+            boot_num++;
+            boot();
+        }
+    }
+
+    chip_mock_run_until(start_tick + CHIP_MOCK_TICKS(p_trace->end));
+    state_account();
+    chip_mock_stats_get(&end);
+
+    on_s = (double)(m_state_ticks[LOW_POWER_STATE_ACTIVE] + m_state_ticks[LOW_POWER_STATE_SLOW_SCAN] +
+                    m_state_ticks[LOW_POWER_STATE_SENSE]) / APP_TIMER_CLOCK_FREQ;
+    off_s = (double)m_state_ticks[LOW_POWER_STATE_OFF] / APP_TIMER_CLOCK_FREQ;
+    total_s = on_s + off_s;
+    cpu_s = ((end.busy_us - start.busy_us) + (double)(end.wakes - start.wakes) * MODEL_WAKE_US) / 1000000;
+    pull_down_s = (double)(end.pull_down_us - start.pull_down_us) / 1000000;
+    charge_uc = (MODEL_IDLE_UA + MODEL_LINK_UA) * on_s + MODEL_OFF_UA * off_s + MODEL_CPU_UA * cpu_s +
+                MODEL_PULL_DOWN_UA * pull_down_s + MODEL_BOOT_UC * boot_num;
+
+    printf("trace_%s_min: %.1f\n", p_trace->p_name, total_s / 60);
+    printf("trace_%s_avg_ua: %.1f\n", p_trace->p_name, charge_uc / total_s);
+    printf("trace_%s_cpu_ua: %.1f\n", p_trace->p_name, MODEL_CPU_UA * cpu_s / total_s);
+    printf("trace_%s_pull_down_ua: %.1f\n", p_trace->p_name, MODEL_PULL_DOWN_UA * pull_down_s / total_s);
+    printf("trace_%s_boots: %u\n", p_trace->p_name, boot_num);
+    printf("trace_%s_active_pct: %.1f\n", p_trace->p_name, (double)m_state_ticks[LOW_POWER_STATE_ACTIVE] * 100 / APP_TIMER_CLOCK_FREQ / total_s);
+    printf("trace_%s_slow_scan_pct: %.1f\n", p_trace->p_name, (double)m_state_ticks[LOW_POWER_STATE_SLOW_SCAN] * 100 / APP_TIMER_CLOCK_FREQ / total_s);
+    printf("trace_%s_sense_pct: %.1f\n", p_trace->p_name, (double)m_state_ticks[LOW_POWER_STATE_SENSE] * 100 / APP_TIMER_CLOCK_FREQ / total_s);
+    printf("trace_%s_off_pct: %.1f\n", p_trace->p_name, off_s * 100 / total_s);
+}
+
+int main(int argc, char *argv[]) {
+    trace_t traces[TRACE_MAX] = {{0}};
+    int trace_num = 4;
+    unsigned seed = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:t:")) != -1) {
+        switch (opt) {
+            case 's':
+                seed = strtoul(optarg, NULL, 0);
+                break;
+
+            case 't':
+                if (trace_num == TRACE_MAX || !trace_load(&traces[trace_num], optarg)) {
+                    return 2;
+                }
+                trace_num++;
+                break;
+
+            default:
+                fprintf(stderr, "Usage: %s [-s <seed>] [-t <trace file>]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    srand(seed);
+    traces_build(traces);
+
+    // One line per stat, for tracking across power changes.
+    held_keys_run();
+    tiers_print(scan_us_measure());
+#ifdef MASTER
+    hosts_print();
+#endif
+
+    for (int i = 0; i < trace_num; i++) {
+        trace_run(&traces[i]);
+    }
+
+    printf("cases: %d\n", m_check_count);
+    printf("errors: %d\n", m_error_count);
+
+    return m_error_count > 0 ? 1 : 0;
+}
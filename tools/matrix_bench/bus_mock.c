@@ -0,0 +1,263 @@
+#include "bus_mock.h"
+
+#include <string.h>
+
+#include "nrf_gpio.h"
+#include "nrfx_spim.h"
+#include "nrfx_twim.h"
+
+#include "../../src/firmware_config.h"
+#include "../../src/matrix/matrix.h"
+
+static matrix_col_t m_switches[MATRIX_COL_NUM];
+static bus_mock_stats_t m_stats;
+
+static void bus_time_add(uint32_t bits, uint32_t frequency) {
+    m_stats.bus_ns += (uint64_t)bits * 1000000000 / frequency;
+}
+
+void bus_mock_stats_get(bus_mock_stats_t *p_stats) {
+    *p_stats = m_stats;
+}
+
+void bus_mock_stats_clear(void) {
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+/*
+ * 74HC165 chain, every key on its own input, closed switch reads 1. LOAD low copies inputs to chain,
+ * clocking shifts out key 0 first.
+ */
+static uint8_t m_chain[(MATRIX_KEY_NUM + 7) / 8];
+static uint32_t m_spim_frequency = NRF_SPIM_FREQ_4M;
+
+#ifdef MATRIX_SPIM_LOAD_PIN
+static void chain_load(void) {
+    memset(m_chain, 0, sizeof(m_chain));
+
+    for (int key = 0; key < MATRIX_KEY_NUM; key++) {
+        if (m_switches[key % MATRIX_COL_NUM] & ((matrix_col_t)1 << (key / MATRIX_COL_NUM))) {
+            m_chain[key / 8] |= 0x80 >> (key % 8);
+        }
+    }
+}
+#endif
+
+ret_code_t nrfx_spim_init(nrfx_spim_t const *p_instance, nrfx_spim_config_t const *p_config, nrfx_spim_evt_handler_t handler, void *p_context) {
+    m_spim_frequency = p_config->frequency;
+
+    return NRF_SUCCESS;
+}
+
+ret_code_t nrfx_spim_xfer(nrfx_spim_t const *p_instance, nrfx_spim_xfer_desc_t const *p_xfer_desc, uint32_t flags) {
+    size_t len = p_xfer_desc->rx_length > p_xfer_desc->tx_length ? p_xfer_desc->rx_length : p_xfer_desc->tx_length;
+
+    // Serial input of last register is tied low, so bits past chain read 0.
+    for (size_t i = 0; i < p_xfer_desc->rx_length; i++) {
+        p_xfer_desc->p_rx_buffer[i] = i < sizeof(m_chain) ? m_chain[i] : 0;
+    }
+
+    m_stats.transfers++;
+    m_stats.bytes += len;
+    bus_time_add(len * 8, m_spim_frequency);
+
+    return NRF_SUCCESS;
+}
+
+/*
+ * MCP23017, BANK 0 register map. Port A pins are columns, port B pins are rows, closed switch connects them.
+ * Port B input is low if any output-low column of its row is closed, else pulled up.
+ * INTB is latched on change of enabled rows against last GPIOB read and cleared by reading GPIOB.
+ */
+#define MCP_REG_NUM  0x16
+#define MCP_IODIRA   0x00
+#define MCP_GPINTENB 0x05
+#define MCP_IOCON    0x0A
+#define MCP_IOCONB   0x0B
+#define MCP_GPPUB    0x0D
+#define MCP_GPIOA    0x12
+#define MCP_GPIOB    0x13
+#define MCP_OLATA    0x14
+
+#define MCP_IOCON_SEQOP 0x20
+
+#ifndef MATRIX_TWIM_ADDRESS
+#define MATRIX_TWIM_ADDRESS 0x20 // Bus is idle unless TWIM backend is benched.
+#endif
+
+static uint8_t m_regs[MCP_REG_NUM];
+static uint8_t m_pointer = 0;
+static uint8_t m_int_ref = 0;  // Port B at last GPIOB read.
+static bool m_int = false;
+static nrfx_twim_evt_handler_t m_twim_handler;
+static uint32_t m_twim_frequency = NRF_TWIM_FREQ_100K;
+
+static uint8_t port_b_read(void) {
+    uint8_t port = 0;
+
+    for (int row = 0; row < 8; row++) {
+        bool low = false;
+
+        for (int col = 0; col < MATRIX_COL_NUM && row < MATRIX_ROW_NUM; col++) {
+            bool col_low = !(m_regs[MCP_IODIRA] & (1U << col)) && !(m_regs[MCP_OLATA] & (1U << col));
+
+            if (col_low && (m_switches[col] & ((matrix_col_t)1 << row))) {
+                low = true;
+            }
+        }
+
+        // Unconnected pin floats, read it as pulled up either way.
+        if (!low) {
+            port |= 1U << row;
+        }
+    }
+
+    return port;
+}
+
+static void int_update(void) {
+    if ((port_b_read() ^ m_int_ref) & m_regs[MCP_GPINTENB]) {
+        m_int = true;
+    }
+}
+
+static void pointer_advance(void) {
+    if (m_regs[MCP_IOCON] & MCP_IOCON_SEQOP) {
+        m_pointer ^= 1;
+    } else {
+        m_pointer = (m_pointer + 1) % MCP_REG_NUM;
+    }
+}
+
+static void mcp_write(uint8_t value) {
+    uint8_t reg = m_pointer;
+
+    // GPIO write goes to output latch, IOCON is mirrored in both addresses.
+    if (reg == MCP_GPIOA || reg == MCP_GPIOB) {
+        reg += MCP_OLATA - MCP_GPIOA;
+    } else if (reg == MCP_IOCONB) {
+        reg = MCP_IOCON;
+    }
+
+    m_regs[reg] = value;
+    pointer_advance();
+    int_update();
+}
+
+static uint8_t mcp_read(void) {
+    uint8_t value;
+
+    switch (m_pointer) {
+        case MCP_GPIOA:
+            value = m_regs[MCP_OLATA];
+            break;
+
+        case MCP_GPIOB:
+            value = port_b_read();
+            m_int_ref = value;
+            m_int = false;
+            break;
+
+        default:
+            value = m_regs[m_pointer];
+            break;
+    }
+
+    pointer_advance();
+
+    return value;
+}
+
+ret_code_t nrfx_twim_init(nrfx_twim_t const *p_instance, nrfx_twim_config_t const *p_config, nrfx_twim_evt_handler_t event_handler, void *p_context) {
+    // Power on reset state, all pins inputs.
+    memset(m_regs, 0, sizeof(m_regs));
+    m_regs[MCP_IODIRA] = 0xFF;
+    m_regs[MCP_IODIRA + 1] = 0xFF;
+    m_pointer = 0;
+    m_int = false;
+
+    m_twim_handler = event_handler;
+    m_twim_frequency = p_config->frequency;
+
+    return NRF_SUCCESS;
+}
+
+void nrfx_twim_enable(nrfx_twim_t const *p_instance) {
+}
+
+ret_code_t nrfx_twim_xfer(nrfx_twim_t const *p_instance, nrfx_twim_xfer_desc_t const *p_xfer_desc, uint32_t flags) {
+    nrfx_twim_evt_t event = {.type = NRFX_TWIM_EVT_DONE, .xfer_desc = *p_xfer_desc};
+    uint32_t bits = 2 + 9 * (1 + p_xfer_desc->primary_length); // Start, address, data & stop.
+
+    m_stats.transfers++;
+    m_stats.bytes += 1 + p_xfer_desc->primary_length;
+
+    if (p_xfer_desc->type == NRFX_TWIM_XFER_TXRX) {
+        bits += 1 + 9 * (1 + p_xfer_desc->secondary_length); // Repeated start, address & data.
+        m_stats.bytes += 1 + p_xfer_desc->secondary_length;
+    }
+
+    bus_time_add(bits, m_twim_frequency);
+
+    if (p_xfer_desc->address != MATRIX_TWIM_ADDRESS) {
+        event.type = NRFX_TWIM_EVT_ADDRESS_NACK;
+    } else {
+        if (p_xfer_desc->primary_length > 0) {
+            m_pointer = p_xfer_desc->p_primary_buf[0] % MCP_REG_NUM;
+        }
+
+        for (size_t i = 1; i < p_xfer_desc->primary_length; i++) {
+            mcp_write(p_xfer_desc->p_primary_buf[i]);
+        }
+
+        for (size_t i = 0; p_xfer_desc->type == NRFX_TWIM_XFER_TXRX && i < p_xfer_desc->secondary_length; i++) {
+            p_xfer_desc->p_secondary_buf[i] = mcp_read();
+        }
+    }
+
+    // Real transfer ends in TWIM interrupt, here it ends right away.
+    m_twim_handler(&event, NULL);
+
+    return NRF_SUCCESS;
+}
+
+void bus_mock_switch_set(uint8_t row, uint8_t col, bool closed) {
+    if (closed) {
+        m_switches[col] |= (matrix_col_t)1 << row;
+    } else {
+        m_switches[col] &= ~((matrix_col_t)1 << row);
+    }
+
+    int_update();
+}
+
+// Pins, SPIM LOAD latches chain, TWIM INT is open drain output of expander.
+void nrf_gpio_cfg_output(uint32_t pin_number) {
+}
+
+void nrf_gpio_cfg_input(uint32_t pin_number, nrf_gpio_pin_pull_t pull_config) {
+}
+
+void nrf_gpio_cfg_sense_set(uint32_t pin_number, nrf_gpio_pin_sense_t sense_config) {
+}
+
+void nrf_gpio_pin_set(uint32_t pin_number) {
+}
+
+void nrf_gpio_pin_clear(uint32_t pin_number) {
+#ifdef MATRIX_SPIM_LOAD_PIN
+    if (pin_number == MATRIX_SPIM_LOAD_PIN) {
+        chain_load();
+    }
+#endif
+}
+
+uint32_t nrf_gpio_pin_read(uint32_t pin_number) {
+#ifdef MATRIX_TWIM_INT_PIN
+    if (pin_number == MATRIX_TWIM_INT_PIN) {
+        return m_int ? 0 : 1;
+    }
+#endif
+
+    return 0;
+}
@@ -0,0 +1,21 @@
+#ifndef _BUS_MOCK_H_
+#define _BUS_MOCK_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Host mock of matrix buses, a 74HC165 chain on SPIM and an MCP23017 on TWIM, wired to a switch matrix.
+ * Decoding of SPIM & TWIM backends runs against it unchanged, and bus time is estimated from bytes clocked.
+ */
+typedef struct bus_mock_stats_s {
+    uint32_t transfers;
+    uint32_t bytes;      // Including I2C address bytes.
+    uint64_t bus_ns;     // Time bus is clocking, including I2C start, restart & stop.
+} bus_mock_stats_t;
+
+void bus_mock_switch_set(uint8_t row, uint8_t col, bool closed);
+void bus_mock_stats_get(bus_mock_stats_t *p_stats);
+void bus_mock_stats_clear(void);
+
+#endif
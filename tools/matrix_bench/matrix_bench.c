@@ -0,0 +1,261 @@
+/*
+ * Host benchmark of matrix core (src/matrix) with simulator backend, or with SPIM or TWIM backend on bus mock.
+ * Types random keys with contact bounce, checks that every key press comes out as exactly one press and
+ * one release edge, and reports debounce latency & CPU time of matrix_scan. Bus backends also report
+ * bus time per scan and check sense. MATRIX_DEFINE must number keys uniquely within 1..KEY_POSITION_NUM.
+ * Build & run from this folder (or 'make matrix_bench' in armgcc folder, MATRIX_BENCH_BACKEND=spim|twim for bus):
+ *   cc -O2 -DMASTER -Isdk_stub -I../../keyboards/ErgoTravel/default -I../../src/config -o matrix_bench \
+ *     matrix_bench.c bus_mock.c ../../src/matrix/matrix.c ../../src/matrix/matrix_backend_sim.c \
+ *     ../../src/matrix/matrix_backend_spim.c ../../src/matrix/matrix_backend_twim.c && ./matrix_bench
+ * Scaling up to 512 keys uses generated matrix of scale/keyboard.h ('make matrix_bench_scale').
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "../../src/firmware_config.h"
+#include "../../src/matrix/matrix.h"
+#include "../bench/bench.h"
+
+#include "bus_mock.h"
+
+// GPIO backend needs the chip, simulator stands in for it.
+#if MATRIX_BACKEND == MATRIX_BACKEND_SPIM || MATRIX_BACKEND == MATRIX_BACKEND_TWIM
+#define BENCH_BUS
+#define BENCH_BACKEND MATRIX_BACKEND_INSTANCE
+#else
+#define BENCH_BACKEND matrix_backend_sim
+#endif
+
+#define TYPE_CHANCE  4  // One in TYPE_CHANCE scans starts a key press.
+#define HOLD_MIN     6  // In scans, longer than debounce so every press is reported.
+#define HOLD_MAX     30 // In scans.
+#define BOUNCE_SCANS 2  // Scans after an edge that read random contact state.
+#define DRAIN_SCANS  64 // Scans after typing so every release is reported.
+
+typedef struct sim_key_s {
+    bool closed;       // Contact state, as settled.
+    bool reported;     // Last edge reported by matrix.
+    uint32_t edge;     // Scan of last contact edge.
+    uint32_t release;  // Scan contact opens, while closed.
+} sim_key_t;
+
+static sim_key_t m_keys[MATRIX_ROW_NUM][MATRIX_COL_NUM];
+
+static void contact_update(uint32_t scan, int row, int col) {
+    sim_key_t *p_key = &m_keys[row][col];
+    bool level = p_key->closed;
+
+    if (scan != p_key->edge && scan - p_key->edge <= BOUNCE_SCANS) {
+        level = rand() & 1;
+    }
+
+    matrix_backend_sim_set(row, col, level);
+    bus_mock_switch_set(row, col, level);
+}
+
+#ifdef BENCH_BUS
+// Armed sense must stay quiet on idle matrix and fire on key press.
+static void sense_check(void) {
+    matrix_sense_arm();
+
+    if (matrix_sense_missed()) {
+        fprintf(stderr, "error: sense fired on idle matrix.\n");
+        m_error_count++;
+    }
+
+    bus_mock_switch_set(MATRIX_ROW_NUM - 1, MATRIX_COL_NUM - 1, true);
+
+    if (!matrix_sense_missed()) {
+        fprintf(stderr, "error: sense missed key press.\n");
+        m_error_count++;
+    }
+
+    bus_mock_switch_set(MATRIX_ROW_NUM - 1, MATRIX_COL_NUM - 1, false);
+    matrix_sense_disarm();
+}
+#endif
+
+// Every key index in range and used once, so translation can't read past keymap layer.
+static void matrix_check(void) {
+    static bool used[KEY_POSITION_NUM + 1];
+
+    for (int row = 0; row < MATRIX_ROW_NUM; row++) {
+        for (int col = 0; col < MATRIX_COL_NUM; col++) {
+            key_index_t index = MATRIX[row][col];
+
+            if (index == 0 || index > KEY_POSITION_NUM) {
+                fprintf(stderr, "error: MATRIX[%d][%d]: key index %d out of 1..%d.\n", row, col, index, KEY_POSITION_NUM);
+                m_error_count++;
+            } else if (used[index]) {
+                fprintf(stderr, "error: MATRIX[%d][%d]: key index %d used twice.\n", row, col, index);
+                m_error_count++;
+            } else {
+                used[index] = true;
+            }
+        }
+    }
+}
+
+static bool key_find(key_index_t index, int *p_row, int *p_col) {
+    for (int row = 0; row < MATRIX_ROW_NUM; row++) {
+        for (int col = 0; col < MATRIX_COL_NUM; col++) {
+            if (MATRIX[row][col] == index) {
+                *p_row = row;
+                *p_col = col;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t scan_num = 100000;
+    unsigned seed = 1;
+    uint32_t press_num = 0, edge_num = 0;
+    uint32_t press_latency_max = 0, release_latency_max = 0;
+    uint64_t press_latency_total = 0, release_latency_total = 0;
+    uint64_t idle_ns = 0, typing_ns = 0;
+    uint32_t scan = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:s:")) != -1) {
+        switch (opt) {
+            case 'n':
+                scan_num = strtoul(optarg, NULL, 0);
+                break;
+
+            case 's':
+                seed = strtoul(optarg, NULL, 0);
+                break;
+
+            default:
+                fprintf(stderr, "Usage: %s [-n <scans>] [-s <seed>]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    srand(seed);
+    matrix_check();
+    matrix_init(&BENCH_BACKEND);
+
+    // Idle matrix, the common case between key strokes.
+    for (uint32_t i = 0; i < scan_num; i++) {
+        matrix_scan_t matrix_scan_result;
+        uint64_t start = time_ns();
+
+        matrix_scan(false, &matrix_scan_result);
+        idle_ns += time_ns() - start;
+    }
+
+    bus_mock_stats_clear();
+
+    for (scan = 0; scan < scan_num + DRAIN_SCANS; scan++) {
+        matrix_scan_t matrix_scan_result;
+        uint64_t start;
+
+        if (scan < scan_num && rand() % TYPE_CHANCE == 0) {
+            int row = rand() % MATRIX_ROW_NUM;
+            int col = rand() % MATRIX_COL_NUM;
+            sim_key_t *p_key = &m_keys[row][col];
+
+            // Bounce of last release must be over, or matrix rightly sees one longer press.
+            if (!p_key->closed && p_key->closed == p_key->reported && scan - p_key->edge > HOLD_MIN) {
+                p_key->closed = true;
+                p_key->edge = scan;
+                p_key->release = scan + HOLD_MIN + rand() % (HOLD_MAX - HOLD_MIN);
+                press_num++;
+            }
+        }
+
+        for (int row = 0; row < MATRIX_ROW_NUM; row++) {
+            for (int col = 0; col < MATRIX_COL_NUM; col++) {
+                sim_key_t *p_key = &m_keys[row][col];
+
+                if (p_key->closed && scan == p_key->release) {
+                    p_key->closed = false;
+                    p_key->edge = scan;
+                }
+
+                contact_update(scan, row, col);
+            }
+        }
+
+        start = time_ns();
+        matrix_scan(false, &matrix_scan_result);
+        typing_ns += time_ns() - start;
+
+        for (int i = 0; i < matrix_scan_result.key_num; i++) {
+            key_index_t index = KEY_EVENT_INDEX(matrix_scan_result.keys[i]);
+            bool pressed = KEY_EVENT_IS_PRESS(matrix_scan_result.keys[i]);
+            int row, col;
+
+            if (!key_find(index, &row, &col)) {
+                fprintf(stderr, "error: scan %u: unknown key index %d.\n", (unsigned)scan, index);
+                m_error_count++;
+                continue;
+            }
+
+            sim_key_t *p_key = &m_keys[row][col];
+            uint32_t latency = scan - p_key->edge;
+
+            if (pressed != p_key->closed || pressed == p_key->reported) {
+                fprintf(stderr, "error: scan %u: unexpected %s of key %d.\n", (unsigned)scan, pressed ? "press" : "release", index);
+                m_error_count++;
+            }
+
+            p_key->reported = pressed;
+            edge_num++;
+
+            if (pressed) {
+                press_latency_total += latency;
+                press_latency_max = latency > press_latency_max ? latency : press_latency_max;
+            } else {
+                release_latency_total += latency;
+                release_latency_max = latency > release_latency_max ? latency : release_latency_max;
+            }
+        }
+    }
+
+    if (edge_num != press_num * 2 || matrix_pressed_any()) {
+        fprintf(stderr, "error: %u key presses gave %u edges.\n", (unsigned)press_num, (unsigned)edge_num);
+        m_error_count++;
+    }
+
+#ifdef BENCH_BUS
+    bus_mock_stats_t bus_stats;
+
+    bus_mock_stats_get(&bus_stats);
+
+    if (matrix_sense_available()) {
+        sense_check();
+    }
+#endif
+
+    // One line per stat, for tracking across keyboards and scan changes.
+    printf("keys: %d\n", MATRIX_KEY_NUM);
+    printf("scans: %u\n", (unsigned)scan_num);
+    printf("key_presses: %u\n", (unsigned)press_num);
+#ifdef BENCH_BUS
+    printf("bus_transfers_per_scan: %.1f\n", (double)bus_stats.transfers / (scan_num + DRAIN_SCANS));
+    printf("bus_bytes_per_scan: %.1f\n", (double)bus_stats.bytes / (scan_num + DRAIN_SCANS));
+    printf("bus_us_per_scan: %.1f\n", (double)bus_stats.bus_ns / (scan_num + DRAIN_SCANS) / 1000);
+    printf("bus_ns_per_key: %.1f\n", (double)bus_stats.bus_ns / (scan_num + DRAIN_SCANS) / MATRIX_KEY_NUM);
+#else
+    printf("backend_reads: %u\n", (unsigned)matrix_backend_sim_read_count());
+#endif
+    printf("press_latency_mean_ms: %.1f\n", press_num > 0 ? (double)press_latency_total * SCAN_DELAY / press_num : 0.0);
+    printf("press_latency_max_ms: %u\n", (unsigned)(press_latency_max * SCAN_DELAY));
+    printf("release_latency_mean_ms: %.1f\n", press_num > 0 ? (double)release_latency_total * SCAN_DELAY / press_num : 0.0);
+    printf("release_latency_max_ms: %u\n", (unsigned)(release_latency_max * SCAN_DELAY));
+    printf("idle_scan_ns: %.1f\n", (double)idle_ns / scan_num);
+    printf("typing_scan_ns: %.1f\n", (double)typing_ns / (scan_num + DRAIN_SCANS));
+    printf("typing_key_ns: %.2f\n", (double)typing_ns / (scan_num + DRAIN_SCANS) / MATRIX_KEY_NUM);
+    printf("errors: %d\n", m_error_count);
+
+    return m_error_count > 0 ? 1 : 0;
+}
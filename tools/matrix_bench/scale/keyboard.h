@@ -0,0 +1,43 @@
+#ifndef _KEYBOARD_H_
+#define _KEYBOARD_H_
+
+#include <stdint.h>
+
+/*
+ * Generated matrix for scaling matrix core past a real keyboard, 16 rows by SCALE_COL_NUM columns, i.e. 64 to 512 keys.
+ * Built by 'make matrix_bench_scale', with simulator backend or SPIM backend on bus mock.
+ * Keys are numbered in row order, as on a keyboard with no slave.
+ */
+#ifndef SCALE_COL_NUM
+#define SCALE_COL_NUM 32 // 4, 8, 16 or 32.
+#endif
+
+#define MATRIX_ROW_NUM 16
+#define MATRIX_COL_NUM SCALE_COL_NUM
+
+#define KEY_POSITION_NUM (MATRIX_ROW_NUM * MATRIX_COL_NUM)
+
+#define SCALE_KEY(row, col) ((row) * SCALE_COL_NUM + (col) + 1)
+
+#define SCALE_COLS_4(row)  SCALE_KEY(row, 0), SCALE_KEY(row, 1), SCALE_KEY(row, 2), SCALE_KEY(row, 3)
+#define SCALE_COLS_8(row)  SCALE_COLS_4(row), SCALE_KEY(row, 4), SCALE_KEY(row, 5), SCALE_KEY(row, 6), SCALE_KEY(row, 7)
+#define SCALE_COLS_16(row)                                                                                           \
+    SCALE_COLS_8(row), SCALE_KEY(row, 8), SCALE_KEY(row, 9), SCALE_KEY(row, 10), SCALE_KEY(row, 11), SCALE_KEY(row, 12), \
+        SCALE_KEY(row, 13), SCALE_KEY(row, 14), SCALE_KEY(row, 15)
+#define SCALE_COLS_32(row)                                                                                                \
+    SCALE_COLS_16(row), SCALE_KEY(row, 16), SCALE_KEY(row, 17), SCALE_KEY(row, 18), SCALE_KEY(row, 19), SCALE_KEY(row, 20), \
+        SCALE_KEY(row, 21), SCALE_KEY(row, 22), SCALE_KEY(row, 23), SCALE_KEY(row, 24), SCALE_KEY(row, 25),             \
+        SCALE_KEY(row, 26), SCALE_KEY(row, 27), SCALE_KEY(row, 28), SCALE_KEY(row, 29), SCALE_KEY(row, 30), SCALE_KEY(row, 31)
+
+#define SCALE_COLS_(n, row) SCALE_COLS_##n(row)
+#define SCALE_COLS(n, row)  SCALE_COLS_(n, row)
+#define SCALE_ROW(row)      {SCALE_COLS(SCALE_COL_NUM, row)}
+
+#define MATRIX_DEFINE                                                                                              \
+    {                                                                                                              \
+        SCALE_ROW(0), SCALE_ROW(1), SCALE_ROW(2), SCALE_ROW(3), SCALE_ROW(4), SCALE_ROW(5), SCALE_ROW(6),          \
+            SCALE_ROW(7), SCALE_ROW(8), SCALE_ROW(9), SCALE_ROW(10), SCALE_ROW(11), SCALE_ROW(12), SCALE_ROW(13), \
+            SCALE_ROW(14), SCALE_ROW(15)                                                                           \
+    }
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef _APP_ERROR_H_
+#define _APP_ERROR_H_
+
+// Host stand-in for nRF5 SDK header, error aborts bench.
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "sdk_errors.h"
+
+#define APP_ERROR_CHECK(ERR_CODE)        \
+    do {                                 \
+        if ((ERR_CODE) != NRF_SUCCESS) { \
+            abort();                     \
+        }                                \
+    } while (0)
+
+#endif
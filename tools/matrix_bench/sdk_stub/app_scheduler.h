@@ -0,0 +1,14 @@
+#ifndef _APP_SCHEDULER_H_
+#define _APP_SCHEDULER_H_
+
+// Host stand-in for nRF5 SDK header, queue is kept by chip mock (tools/low_power_bench/chip_mock.c).
+
+#include <stdint.h>
+
+#include "app_error.h"
+
+typedef void (*app_sched_event_handler_t)(void *p_event_data, uint16_t event_size);
+
+ret_code_t app_sched_event_put(void const *p_event_data, uint16_t event_size, app_sched_event_handler_t handler);
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef _APP_TIMER_H_
+#define _APP_TIMER_H_
+
+// Host stand-in for nRF5 SDK header, timers run on simulated RTC of chip mock (tools/low_power_bench/chip_mock.c).
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "app_error.h"
+#include "app_util.h"
+
+#define APP_TIMER_CLOCK_FREQ            32768
+#define APP_TIMER_CONFIG_RTC_FREQUENCY  0
+#define APP_TIMER_SCHED_EVENT_DATA_SIZE sizeof(app_timer_event_t)
+
+#define APP_TIMER_TICKS(MS) \
+    ((uint32_t)ROUNDED_DIV((MS) * (uint64_t)APP_TIMER_CLOCK_FREQ, 1000 * (APP_TIMER_CONFIG_RTC_FREQUENCY + 1)))
+
+typedef void (*app_timer_timeout_handler_t)(void *p_context);
+
+typedef enum {
+    APP_TIMER_MODE_SINGLE_SHOT,
+    APP_TIMER_MODE_REPEATED
+} app_timer_mode_t;
+
+typedef struct app_timer_s {
+    app_timer_timeout_handler_t handler;
+    app_timer_mode_t mode;
+    bool is_running;
+    uint64_t due;      // In ticks of mock RTC, which doesn't wrap.
+    uint32_t interval; // In ticks.
+    void *p_context;
+} app_timer_t;
+
+typedef app_timer_t *app_timer_id_t;
+
+typedef struct {
+    app_timer_timeout_handler_t timeout_handler;
+    void *p_context;
+} app_timer_event_t;
+
+#define APP_TIMER_DEF(timer_id)                 \
+    static app_timer_t timer_id##_data = {0};   \
+    static const app_timer_id_t timer_id = &timer_id##_data
+
+ret_code_t app_timer_create(app_timer_id_t const *p_timer_id, app_timer_mode_t mode, app_timer_timeout_handler_t timeout_handler);
+ret_code_t app_timer_start(app_timer_id_t timer_id, uint32_t timeout_ticks, void *p_context);
+ret_code_t app_timer_stop(app_timer_id_t timer_id);
+uint32_t app_timer_cnt_get(void);
+uint32_t app_timer_cnt_diff_compute(uint32_t ticks_to, uint32_t ticks_from);
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef _APP_UTIL_H_
+#define _APP_UTIL_H_
+
+// Host stand-in for nRF5 SDK header included by firmware_config.h, macros used by low power & profiler cores and benches.
+
+#include <stdint.h>
+
+enum {
+    UNIT_0_625_MS = 625,
+    UNIT_1_25_MS  = 1250,
+    UNIT_10_MS    = 10000
+};
+
+#define UNUSED_PARAMETER(X)             ((void)(X))
+#define ROUNDED_DIV(A, B)               (((A) + ((B) / 2)) / (B))
+#define MSEC_TO_UNITS(TIME, RESOLUTION) (((TIME) * 1000) / (RESOLUTION))
+#define STATIC_ASSERT(EXPR)             _Static_assert(EXPR, #EXPR)
+
+#ifndef MIN
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+
+#ifndef MAX
+#define MAX(a, b) ((a) < (b) ? (b) : (a))
+#endif
+
+static inline uint8_t uint32_encode(uint32_t value, uint8_t *p_encoded_data) {
+    p_encoded_data[0] = (uint8_t)(value >> 0);
+    p_encoded_data[1] = (uint8_t)(value >> 8);
+    p_encoded_data[2] = (uint8_t)(value >> 16);
+    p_encoded_data[3] = (uint8_t)(value >> 24);
+
+    return sizeof(uint32_t);
+}
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef _APP_UTIL_PLATFORM_H_
+#define _APP_UTIL_PLATFORM_H_
+
+// Host stand-in for nRF5 SDK header, benches run on one thread so critical regions are empty.
+
+#include "app_util.h"
+
+#define APP_IRQ_PRIORITY_LOW 6
+
+#define CRITICAL_REGION_ENTER()
+#define CRITICAL_REGION_EXIT()
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef _NRF_H_
+#define _NRF_H_
+
+// Host stand-in for nRF5 SDK header, bus mock completes transfers before driver returns so there is nothing to wait for.
+// Interrupts of chip mock (tools/low_power_bench/chip_mock.c) are run by its harness between tasks.
+
+#include <stdint.h>
+
+#define __WFE()
+
+typedef enum {
+    GPIOTE_IRQn = 6
+} IRQn_Type;
+
+void NVIC_SetPriority(IRQn_Type IRQn, uint32_t priority);
+void NVIC_ClearPendingIRQ(IRQn_Type IRQn);
+void NVIC_SetPendingIRQ(IRQn_Type IRQn);
+void NVIC_EnableIRQ(IRQn_Type IRQn);
+
+#endif
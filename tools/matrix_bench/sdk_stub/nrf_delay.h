@@ -0,0 +1,10 @@
+#ifndef _NRF_DELAY_H_
+#define _NRF_DELAY_H_
+
+// Host stand-in for nRF5 SDK header, busy wait is counted as CPU time by chip mock (tools/low_power_bench/chip_mock.c).
+
+#include <stdint.h>
+
+void nrf_delay_us(uint32_t us_time);
+
+#endif
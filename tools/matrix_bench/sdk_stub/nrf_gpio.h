@@ -0,0 +1,35 @@
+#ifndef _NRF_GPIO_H_
+#define _NRF_GPIO_H_
+
+// Host stand-in for nRF5 SDK header, pins are implemented by bus mock (tools/matrix_bench/bus_mock.c), or by chip mock
+// (tools/low_power_bench/chip_mock.c) for GPIO backend.
+
+#include <stdint.h>
+
+typedef enum {
+    NRF_GPIO_PIN_NOPULL,
+    NRF_GPIO_PIN_PULLDOWN,
+    NRF_GPIO_PIN_PULLUP
+} nrf_gpio_pin_pull_t;
+
+typedef enum {
+    NRF_GPIO_PIN_NOSENSE,
+    NRF_GPIO_PIN_SENSE_LOW,
+    NRF_GPIO_PIN_SENSE_HIGH
+} nrf_gpio_pin_sense_t;
+
+typedef struct {
+    uint32_t IN;
+} NRF_GPIO_Type;
+
+#define NRF_P0 ((NRF_GPIO_Type *)0)
+
+void nrf_gpio_cfg_output(uint32_t pin_number);
+void nrf_gpio_cfg_input(uint32_t pin_number, nrf_gpio_pin_pull_t pull_config);
+void nrf_gpio_cfg_sense_set(uint32_t pin_number, nrf_gpio_pin_sense_t sense_config);
+void nrf_gpio_pin_set(uint32_t pin_number);
+void nrf_gpio_pin_clear(uint32_t pin_number);
+uint32_t nrf_gpio_pin_read(uint32_t pin_number);
+uint32_t nrf_gpio_port_in_read(NRF_GPIO_Type const *p_reg);
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef _NRF_GPIOTE_H_
+#define _NRF_GPIOTE_H_
+
+// Host stand-in for nRF5 SDK header, PORT event is raised by chip mock (tools/low_power_bench/chip_mock.c).
+
+#include <stdint.h>
+
+#include "nrf.h"
+
+#define NRF_GPIOTE_INT_PORT_MASK (1UL << 31)
+
+typedef enum {
+    NRF_GPIOTE_EVENTS_PORT = 0x17C
+} nrf_gpiote_events_t;
+
+void nrf_gpiote_int_enable(uint32_t mask);
+void nrf_gpiote_int_disable(uint32_t mask);
+void nrf_gpiote_event_clear(nrf_gpiote_events_t event);
+
+#endif
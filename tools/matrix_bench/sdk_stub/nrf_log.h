@@ -0,0 +1,12 @@
+#ifndef _NRF_LOG_H_
+#define _NRF_LOG_H_
+
+// Host stand-in for nRF5 SDK header, logs are dropped.
+
+#define NRF_LOG_MODULE_REGISTER()
+#define NRF_LOG_ERROR(...)
+#define NRF_LOG_WARNING(...)
+#define NRF_LOG_INFO(...)
+#define NRF_LOG_DEBUG(...)
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef _NRF_PWR_MGMT_H_
+#define _NRF_PWR_MGMT_H_
+
+// Host stand-in for nRF5 SDK header, System OFF is recorded by chip mock (tools/low_power_bench/chip_mock.c).
+
+typedef enum {
+    NRF_PWR_MGMT_SHUTDOWN_GOTO_SYSOFF
+} nrf_pwr_mgmt_shutdown_t;
+
+void nrf_pwr_mgmt_shutdown(nrf_pwr_mgmt_shutdown_t shutdown_type);
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef _NRFX_SPIM_H_
+#define _NRFX_SPIM_H_
+
+// Host stand-in for nRF5 SDK driver header, transfers are served by bus mock (tools/matrix_bench/bus_mock.c).
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "app_error.h"
+
+#define NRFX_SPIM_PIN_NOT_USED 0xFF
+
+// In Hz on host, so bus mock can estimate bus time.
+typedef enum {
+    NRF_SPIM_FREQ_125K = 125000,
+    NRF_SPIM_FREQ_250K = 250000,
+    NRF_SPIM_FREQ_500K = 500000,
+    NRF_SPIM_FREQ_1M = 1000000,
+    NRF_SPIM_FREQ_2M = 2000000,
+    NRF_SPIM_FREQ_4M = 4000000,
+    NRF_SPIM_FREQ_8M = 8000000
+} nrf_spim_frequency_t;
+
+typedef enum {
+    NRF_SPIM_MODE_0,
+    NRF_SPIM_MODE_1,
+    NRF_SPIM_MODE_2,
+    NRF_SPIM_MODE_3
+} nrf_spim_mode_t;
+
+typedef enum {
+    NRF_SPIM_BIT_ORDER_MSB_FIRST,
+    NRF_SPIM_BIT_ORDER_LSB_FIRST
+} nrf_spim_bit_order_t;
+
+typedef struct {
+    uint8_t drv_inst_idx;
+} nrfx_spim_t;
+
+typedef struct {
+    uint8_t sck_pin;
+    uint8_t mosi_pin;
+    uint8_t miso_pin;
+    uint8_t ss_pin;
+    nrf_spim_frequency_t frequency;
+    nrf_spim_mode_t mode;
+    nrf_spim_bit_order_t bit_order;
+} nrfx_spim_config_t;
+
+typedef struct {
+    uint8_t const *p_tx_buffer;
+    size_t tx_length;
+    uint8_t *p_rx_buffer;
+    size_t rx_length;
+} nrfx_spim_xfer_desc_t;
+
+typedef void (*nrfx_spim_evt_handler_t)(void const *p_event, void *p_context);
+
+#define NRFX_SPIM_INSTANCE(id) { .drv_inst_idx = (id) }
+
+#define NRFX_SPIM_DEFAULT_CONFIG                    \
+    {                                               \
+        .sck_pin = NRFX_SPIM_PIN_NOT_USED,          \
+        .mosi_pin = NRFX_SPIM_PIN_NOT_USED,         \
+        .miso_pin = NRFX_SPIM_PIN_NOT_USED,         \
+        .ss_pin = NRFX_SPIM_PIN_NOT_USED,           \
+        .frequency = NRF_SPIM_FREQ_4M,              \
+        .mode = NRF_SPIM_MODE_0,                    \
+        .bit_order = NRF_SPIM_BIT_ORDER_MSB_FIRST   \
+    }
+
+#define NRFX_SPIM_XFER_RX(p_buf, length) \
+    { .p_tx_buffer = NULL, .tx_length = 0, .p_rx_buffer = (p_buf), .rx_length = (length) }
+
+ret_code_t nrfx_spim_init(nrfx_spim_t const *p_instance, nrfx_spim_config_t const *p_config, nrfx_spim_evt_handler_t handler, void *p_context);
+ret_code_t nrfx_spim_xfer(nrfx_spim_t const *p_instance, nrfx_spim_xfer_desc_t const *p_xfer_desc, uint32_t flags);
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef _NRFX_TWIM_H_
+#define _NRFX_TWIM_H_
+
+// Host stand-in for nRF5 SDK driver header, transfers are served by bus mock (tools/matrix_bench/bus_mock.c).
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "app_error.h"
+
+// In Hz on host, so bus mock can estimate bus time.
+typedef enum {
+    NRF_TWIM_FREQ_100K = 100000,
+    NRF_TWIM_FREQ_250K = 250000,
+    NRF_TWIM_FREQ_400K = 400000
+} nrf_twim_frequency_t;
+
+typedef enum {
+    NRFX_TWIM_XFER_TX,
+    NRFX_TWIM_XFER_RX,
+    NRFX_TWIM_XFER_TXRX,
+    NRFX_TWIM_XFER_TXTX
+} nrfx_twim_xfer_type_t;
+
+typedef enum {
+    NRFX_TWIM_EVT_DONE,
+    NRFX_TWIM_EVT_ADDRESS_NACK,
+    NRFX_TWIM_EVT_DATA_NACK
+} nrfx_twim_evt_type_t;
+
+typedef struct {
+    uint8_t drv_inst_idx;
+} nrfx_twim_t;
+
+typedef struct {
+    uint32_t scl;
+    uint32_t sda;
+    nrf_twim_frequency_t frequency;
+} nrfx_twim_config_t;
+
+typedef struct {
+    nrfx_twim_xfer_type_t type;
+    uint8_t address;
+    size_t primary_length;
+    size_t secondary_length;
+    uint8_t *p_primary_buf;
+    uint8_t *p_secondary_buf;
+} nrfx_twim_xfer_desc_t;
+
+typedef struct {
+    nrfx_twim_evt_type_t type;
+    nrfx_twim_xfer_desc_t xfer_desc;
+} nrfx_twim_evt_t;
+
+typedef void (*nrfx_twim_evt_handler_t)(nrfx_twim_evt_t const *p_event, void *p_context);
+
+#define NRFX_TWIM_INSTANCE(id) { .drv_inst_idx = (id) }
+
+#define NRFX_TWIM_DEFAULT_CONFIG        \
+    {                                   \
+        .scl = 31,                      \
+        .sda = 31,                      \
+        .frequency = NRF_TWIM_FREQ_100K \
+    }
+
+#define NRFX_TWIM_XFER_DESC_TX(addr, p_data, length) \
+    { .type = NRFX_TWIM_XFER_TX, .address = (addr), .primary_length = (length), .secondary_length = 0, \
+      .p_primary_buf = (p_data), .p_secondary_buf = NULL }
+
+#define NRFX_TWIM_XFER_DESC_TXRX(addr, p_tx, tx_len, p_rx, rx_len) \
+    { .type = NRFX_TWIM_XFER_TXRX, .address = (addr), .primary_length = (tx_len), .secondary_length = (rx_len), \
+      .p_primary_buf = (p_tx), .p_secondary_buf = (p_rx) }
+
+// Handler is called before nrfx_twim_xfer returns.
+ret_code_t nrfx_twim_init(nrfx_twim_t const *p_instance, nrfx_twim_config_t const *p_config, nrfx_twim_evt_handler_t event_handler, void *p_context);
+void nrfx_twim_enable(nrfx_twim_t const *p_instance);
+ret_code_t nrfx_twim_xfer(nrfx_twim_t const *p_instance, nrfx_twim_xfer_desc_t const *p_xfer_desc, uint32_t flags);
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef _SDK_ERRORS_H_
+#define _SDK_ERRORS_H_
+
+// Host stand-in for nRF5 SDK header, error codes of SDK with same values.
+
+#include <stdint.h>
+
+typedef uint32_t ret_code_t;
+
+#define NRF_SUCCESS              0
+#define NRF_ERROR_NO_MEM         4
+#define NRF_ERROR_NOT_FOUND      5
+#define NRF_ERROR_INVALID_PARAM  7
+#define NRF_ERROR_INVALID_STATE  8
+#define NRF_ERROR_INVALID_LENGTH 9
+#define NRF_ERROR_INVALID_DATA   11
+#define NRF_ERROR_TIMEOUT        13
+#define NRF_ERROR_RESOURCES      19
+
+#endif
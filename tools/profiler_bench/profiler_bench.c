@@ -0,0 +1,123 @@
+/*
+ * Host test & benchmark of profiler core (src/profiler) on host clock of profiler_clock.h.
+ * Checks that busy time of known length lands on its own subsystem with right call count, that snapshot clears
+ * counters, and that packed snapshot read from keymap service decodes back. Reports cost of PROFILER_BEGIN & END pair.
+ * Build & run from this folder (or 'make profiler_bench' in armgcc folder):
+ *   cc -O2 -DPROFILER_ENABLED=1 -DPROFILER_HOST_CLOCK -I../matrix_bench/sdk_stub -I../../keyboards/ErgoTravel/default \
+ *     -I../../src/config -o profiler_bench profiler_bench.c ../../src/profiler/profiler.c && ./profiler_bench
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../../src/profiler/profiler.h"
+#include "../bench/bench.h"
+
+#if !PROFILER_ENABLED
+#error "Build with -DPROFILER_ENABLED=1."
+#endif
+
+#define BUSY_US     200
+#define BUSY_CALLS  25
+#define SLACK       1.5 // Host may preempt bench, counted time is only checked not to be short or far too long.
+#define TIME_REPEAT 1000000
+
+
+static void busy_wait_us(uint32_t us) {
+    uint64_t end = time_ns() + (uint64_t)us * 1000;
+
+    while (time_ns() < end) {
+    }
+}
+
+static uint32_t uint32_read(uint8_t const *p_data) {
+    return p_data[0] | (p_data[1] << 8) | (p_data[2] << 16) | ((uint32_t)p_data[3] << 24);
+}
+
+static void test_accounting(void) {
+    profiler_snapshot_t snapshot;
+    uint32_t expected_us = BUSY_US * BUSY_CALLS;
+
+    profiler_snapshot_take(&snapshot);
+
+    for (int i = 0; i < BUSY_CALLS; i++) {
+        PROFILER_BEGIN();
+        busy_wait_us(BUSY_US);
+        PROFILER_END(PROFILER_SCAN);
+    }
+
+    {
+        PROFILER_BEGIN();
+        PROFILER_END(PROFILER_REPORT);
+    }
+
+    profiler_snapshot_take(&snapshot);
+    printf("busy_expected_us: %u\n", expected_us);
+    printf("busy_counted_us: %u\n", snapshot.active_us[PROFILER_SCAN]);
+
+    check(snapshot.calls[PROFILER_SCAN] == BUSY_CALLS, "calls of busy subsystem");
+    check(snapshot.active_us[PROFILER_SCAN] >= expected_us, "busy time not short");
+    check(snapshot.active_us[PROFILER_SCAN] <= expected_us * SLACK, "busy time not far too long");
+    check(snapshot.calls[PROFILER_REPORT] == 1 && snapshot.active_us[PROFILER_REPORT] < BUSY_US, "empty section");
+    check(snapshot.calls[PROFILER_TRANSLATE] == 0 && snapshot.active_us[PROFILER_TRANSLATE] == 0, "idle subsystem");
+
+    profiler_snapshot_take(&snapshot);
+
+    for (int i = 0; i < PROFILER_SUBSYS_NUM; i++) {
+        check(snapshot.calls[i] == 0 && snapshot.active_us[i] == 0, "snapshot clears counters");
+    }
+}
+
+static void test_encode(void) {
+    profiler_snapshot_t snapshot;
+    uint8_t data[PROFILER_SNAPSHOT_LEN + 1];
+    uint16_t len;
+
+    snapshot.period_ms = 10000;
+    snapshot.sched_peak = 17;
+
+    for (int i = 0; i < PROFILER_SUBSYS_NUM; i++) {
+        snapshot.active_us[i] = 0x01020304 * (i + 1);
+        snapshot.calls[i] = 0x80000000 | i;
+    }
+
+    memset(data, 0xA5, sizeof(data));
+    len = profiler_snapshot_encode(&snapshot, data);
+
+    check(len == PROFILER_SNAPSHOT_LEN, "packed length");
+    check(data[PROFILER_SNAPSHOT_LEN] == 0xA5, "no write past packed length");
+    check(uint32_read(data) == snapshot.period_ms, "packed period");
+    check(uint32_read(&data[4]) == snapshot.sched_peak, "packed scheduler peak");
+
+    for (int i = 0; i < PROFILER_SUBSYS_NUM; i++) {
+        check(uint32_read(&data[8 + i * 8]) == snapshot.active_us[i], "packed active time");
+        check(uint32_read(&data[12 + i * 8]) == snapshot.calls[i], "packed calls");
+    }
+}
+
+static void time_report(void) {
+    profiler_snapshot_t snapshot;
+    uint64_t start = time_ns();
+
+    for (int i = 0; i < TIME_REPEAT; i++) {
+        PROFILER_BEGIN();
+        PROFILER_END(PROFILER_LOG);
+    }
+
+    printf("begin_end_ns: %.1f\n", (double)(time_ns() - start) / TIME_REPEAT);
+
+    profiler_snapshot_take(&snapshot);
+    check(snapshot.calls[PROFILER_LOG] == TIME_REPEAT, "calls of timed sections");
+}
+
+int main(void) {
+    test_accounting();
+    test_encode();
+    time_report();
+
+    printf("snapshot_len: %d\n", PROFILER_SNAPSHOT_LEN);
+    printf("errors: %d\n", m_error_count);
+
+    return m_error_count > 0 ? 1 : 0;
+}
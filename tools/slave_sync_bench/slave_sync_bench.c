@@ -0,0 +1,573 @@
+/*
+ * Host simulation of master with several slave links (src/slave_sync), SLAVE_NUM of keyboard.h is raised by -D.
+ * Bench keeps key registry of master as main_master.c does: key events of link n are registered with SLAVE_SOURCE(n),
+ * disconnect arms resync timeout, key state snapshot stops it and resyncs that link, timeout clears keys of that link.
+ * Scripted case checks that same key index on two links stays apart and that resync, timeout & state push of one
+ * link leave others alone. Then random presses, releases, disconnects & timeouts on all links check that registry
+ * of each link matches keys its slave holds after every resync. Link 0 then runs over loopback transport: key events
+ * of slave frames go through combo & tap-hold engines as on master, each scan followed by a key state snapshot as GATT
+ * keeps it; only snapshot after (re)connection may resync, so combos fire, tap-hold keys are decided by time and each
+ * press comes out once. Reports resync events & CPU time of slave_sync_resync.
+ * Build & run from this folder (or 'make slave_sync_bench' in armgcc folder):
+ *   cc -O2 -DMASTER -DSLAVE_NUM=3 -I../matrix_bench/sdk_stub -I../../keyboards/ErgoTravel/default -I../../src/config \
+ *     -o slave_sync_bench slave_sync_bench.c ../../src/slave_sync/slave_sync.c ../../src/combo/combo.c \
+ *     ../../src/tap_hold/tap_hold.c ../../src/kb_link/kb_link_frame.c ../../src/kb_link/kb_link_transport_loopback.c \
+ *     && ./slave_sync_bench
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sdk_errors.h"
+
+#include "../../src/combo/combo.h"
+#include "../../src/kb_link/kb_link_frame.h"
+#include "../../src/kb_link/kb_link_transport.h"
+#include "../../src/slave_sync/slave_sync.h"
+#include "../../src/tap_hold/tap_hold.h"
+#include "../bench/bench.h"
+
+#define STEP_NUM     200000
+#define MASTER_HELD  4
+// Keys held on a slave at most, all links fit KEY_NUM with master keys.
+#define SLAVE_HELD   ((KEY_NUM - MASTER_HELD) / SLAVE_NUM < 4 ? (KEY_NUM - MASTER_HELD) / SLAVE_NUM : 4)
+#define KEY_SPAN     12 // Key indexes 1..KEY_SPAN on every half, so links share indexes.
+#define TIME_REPEAT  1000000
+#define COMBO_CODE   0x1234 // Combo of keys 1 & 2.
+#define TH_KEY       3      // Tap-hold key.
+#define OUT_MAX      64
+
+#ifndef HAS_SLAVE
+#error "Keyboard has no slave half."
+#endif
+
+_Static_assert(SLAVE_NUM >= 3, "Build with -DSLAVE_NUM=3 or more.");
+_Static_assert(SLAVE_HELD > 0, "Links don't fit key registry.");
+_Static_assert(SLAVE_HELD <= SLAVE_KEY_NUM, "Held keys don't fit key state.");
+
+typedef struct key_s {
+    key_index_t index;
+    uint8_t source;
+} key_t2;
+
+typedef struct sim_link_s {
+    key_index_t held[SLAVE_HELD]; // Keys slave holds.
+    uint8_t held_num;
+    bool connected;
+    bool resync_armed; // Resync timeout runs.
+    uint32_t sends;    // State pushes.
+} sim_link_t;
+
+static key_t2 m_keys[KEY_NUM];
+static int m_key_count = 0;
+static sim_link_t m_links[SLAVE_NUM];
+static uint8_t m_layer = 0;
+static uint8_t m_leds = 0;
+
+static uint32_t m_resyncs = 0;
+static uint32_t m_resync_events = 0;
+static uint32_t m_resync_events_max = 0;
+static uint32_t m_timeouts = 0;
+
+static const combo_t m_combos[] = {COMBO(COMBO_CODE, 1, 2)};
+static uint32_t m_combo_buffer[COMBO_BUFFER_WORDS(1)];
+static tap_hold_evt_t m_outs[OUT_MAX]; // Events out of engines on loopback link.
+static int m_out_num = 0;
+static uint32_t m_time = 0;
+static uint32_t m_loopback_resyncs = 0;
+
+// Same as update_key_index of master.
+static void key_register(key_event_t event, uint8_t source) {
+    key_index_t index = KEY_EVENT_INDEX(event);
+
+    if (KEY_EVENT_IS_PRESS(event)) {
+        check(m_key_count < KEY_NUM, "key registry full");
+
+        if (m_key_count < KEY_NUM) {
+            m_keys[m_key_count].index = index;
+            m_keys[m_key_count].source = source;
+            m_key_count++;
+        }
+        return;
+    }
+
+    for (int i = 0; i < m_key_count;) {
+        if (m_keys[i].index == index && m_keys[i].source == source) {
+            memmove(&m_keys[i], &m_keys[i + 1], (m_key_count - i - 1) * sizeof(m_keys[0]));
+            m_key_count--;
+        } else {
+            i++;
+        }
+    }
+}
+
+static bool key_registered(key_index_t index, uint8_t source) {
+    for (int i = 0; i < m_key_count; i++) {
+        if (m_keys[i].index == index && m_keys[i].source == source) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static int key_count_of(uint8_t source) {
+    int num = 0;
+
+    for (int i = 0; i < m_key_count; i++) {
+        num += m_keys[i].source == source;
+    }
+
+    return num;
+}
+
+// Registry of link holds exactly keys its slave holds.
+static bool link_in_sync(uint8_t link) {
+    sim_link_t const *p_link = &m_links[link];
+
+    if (key_count_of(SLAVE_SOURCE(link)) != p_link->held_num) {
+        return false;
+    }
+
+    for (int i = 0; i < p_link->held_num; i++) {
+        if (!key_registered(p_link->held[i], SLAVE_SOURCE(link))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Master pushes layer & LEDs to links whose state differs, as slave_state_send.
+static void state_send(void) {
+    for (int i = 0; i < SLAVE_NUM; i++) {
+        if (m_links[i].connected && slave_sync_state_pending(i, m_layer, m_leds)) {
+            m_links[i].sends++;
+            slave_sync_state_sent(i, m_layer, m_leds);
+        }
+    }
+}
+
+// Slave presses or releases a key, event goes over link only while connected.
+static void slave_key(uint8_t link, key_index_t index, bool is_press) {
+    sim_link_t *p_link = &m_links[link];
+
+    if (is_press) {
+        p_link->held[p_link->held_num++] = index;
+    } else {
+        for (int i = 0; i < p_link->held_num; i++) {
+            if (p_link->held[i] == index) {
+                p_link->held[i] = p_link->held[--p_link->held_num];
+                break;
+            }
+        }
+    }
+
+    if (p_link->connected) {
+        key_register(KEY_EVENT(index, is_press), SLAVE_SOURCE(link));
+    }
+}
+
+static void link_disconnect(uint8_t link) {
+    m_links[link].connected = false;
+    m_links[link].resync_armed = true;
+    slave_sync_disconnected(link);
+}
+
+// Master brings registry of link in line with key state snapshot, as process_slave_key_state_task.
+static void link_resync(uint8_t link) {
+    key_index_t registered[KEY_NUM];
+    key_event_t events[SLAVE_SYNC_EVENT_MAX];
+    uint8_t registered_num = 0;
+    uint8_t event_num;
+
+    m_links[link].resync_armed = false;
+
+    for (int i = 0; i < m_key_count; i++) {
+        if (m_keys[i].source == SLAVE_SOURCE(link)) {
+            registered[registered_num++] = m_keys[i].index;
+        }
+    }
+
+    event_num = slave_sync_resync(link, registered, registered_num, events);
+
+    for (int i = 0; i < event_num; i++) {
+        key_register(events[i], SLAVE_SOURCE(link));
+    }
+
+    m_resyncs++;
+    m_resync_events += event_num;
+    m_resync_events_max = event_num > m_resync_events_max ? event_num : m_resync_events_max;
+}
+
+// Link (re)connects, master pushes state, slave sends key state and master resyncs that link.
+static void link_connect(uint8_t link) {
+    sim_link_t *p_link = &m_links[link];
+
+    p_link->connected = true;
+    slave_sync_connected(link);
+    state_send();
+
+    check(slave_sync_key_state_set(link, (uint8_t const *)p_link->held, p_link->held_num * sizeof(key_index_t)),
+          "key state after connection taken");
+    link_resync(link);
+    check(!slave_sync_key_state_set(link, (uint8_t const *)p_link->held, p_link->held_num * sizeof(key_index_t)),
+          "second key state not taken");
+}
+
+// Slave didn't come back in time, keys of its link are cleared.
+static void link_timeout(uint8_t link) {
+    for (int i = 0; i < m_key_count;) {
+        if (m_keys[i].source == SLAVE_SOURCE(link)) {
+            memmove(&m_keys[i], &m_keys[i + 1], (m_key_count - i - 1) * sizeof(m_keys[0]));
+            m_key_count--;
+        } else {
+            i++;
+        }
+    }
+
+    m_links[link].resync_armed = false;
+    m_timeouts++;
+}
+
+static void sim_init(void) {
+    memset(m_links, 0, sizeof(m_links));
+    m_key_count = 0;
+    slave_sync_init();
+
+    for (int i = 0; i < SLAVE_NUM; i++) {
+        link_connect(i);
+    }
+}
+
+static void test_scripted(void) {
+    uint32_t sends[SLAVE_NUM];
+
+    sim_init();
+
+    check(SLAVE_SOURCE(0) != SOURCE_MASTER && SLAVE_SOURCE(1) != SLAVE_SOURCE(0), "sources of links differ");
+
+    // Same key index on master and two links.
+    key_register(KEY_EVENT(5, true), SOURCE_MASTER);
+    slave_key(0, 5, true);
+    slave_key(1, 5, true);
+    slave_key(2, 3, true);
+    check(m_key_count == 4, "same index on links registered apart");
+
+    // Link 1 drops out, its slave releases 5 and presses 7 & 9 meanwhile.
+    link_disconnect(1);
+    slave_key(1, 5, false);
+    slave_key(1, 7, true);
+    slave_key(1, 9, true);
+    check(key_registered(5, SLAVE_SOURCE(1)), "key of lost link kept until resync");
+
+    link_connect(1);
+    check(link_in_sync(1), "resync of link 1");
+    check(key_registered(5, SOURCE_MASTER) && key_registered(5, SLAVE_SOURCE(0)), "resync of link 1 keeps key 5 of others");
+    check(link_in_sync(0) && link_in_sync(2), "other links untouched by resync");
+
+    // Link 2 doesn't come back.
+    link_disconnect(2);
+    link_timeout(2);
+    check(key_count_of(SLAVE_SOURCE(2)) == 0, "timeout clears keys of link 2");
+    check(link_in_sync(0) && link_in_sync(1) && key_registered(5, SOURCE_MASTER), "timeout of link 2 leaves others");
+
+    // State goes to each connected link once, link which comes back gets it again.
+    for (int i = 0; i < SLAVE_NUM; i++) {
+        sends[i] = m_links[i].sends;
+    }
+
+    m_layer = 1;
+    state_send();
+    state_send();
+    check(m_links[0].sends == sends[0] + 1 && m_links[1].sends == sends[1] + 1, "state pushed once per link");
+    check(m_links[2].sends == sends[2], "no state pushed to lost link");
+
+    link_disconnect(0);
+    link_connect(0);
+    link_connect(2);
+    check(m_links[0].sends == sends[0] + 2 && m_links[1].sends == sends[1] + 1 && m_links[2].sends == sends[2] + 1,
+          "state pushed again only to links which came back");
+}
+
+static void test_random(void) {
+    sim_init();
+
+    for (int step = 0; step < STEP_NUM; step++) {
+        uint8_t link = rand() % SLAVE_NUM;
+        sim_link_t *p_link = &m_links[link];
+        int op = rand() % 16;
+
+        if (op < 10) {
+            // Typing on slave, connected or not.
+            if (p_link->held_num > 0 && (p_link->held_num == SLAVE_HELD || rand() % 2 == 0)) {
+                slave_key(link, p_link->held[rand() % p_link->held_num], false);
+            } else {
+                key_index_t index = 1 + rand() % KEY_SPAN;
+                bool held = false;
+
+                for (int i = 0; i < p_link->held_num; i++) {
+                    held |= p_link->held[i] == index;
+                }
+
+                if (!held) {
+                    slave_key(link, index, true);
+                }
+            }
+        } else if (op < 12) {
+            // Typing on master with same key indexes.
+            key_index_t index = 1 + rand() % KEY_SPAN;
+
+            if (key_registered(index, SOURCE_MASTER)) {
+                key_register(KEY_EVENT(index, false), SOURCE_MASTER);
+            } else if (key_count_of(SOURCE_MASTER) < MASTER_HELD) {
+                key_register(KEY_EVENT(index, true), SOURCE_MASTER);
+            }
+        } else if (op < 13) {
+            if (p_link->connected) {
+                link_disconnect(link);
+            }
+        } else if (op < 14) {
+            if (p_link->resync_armed) {
+                link_timeout(link);
+            }
+        } else if (op < 15) {
+            if (!p_link->connected) {
+                int others[SLAVE_NUM];
+
+                for (int i = 0; i < SLAVE_NUM; i++) {
+                    others[i] = key_count_of(SLAVE_SOURCE(i));
+                }
+
+                link_connect(link);
+                check(link_in_sync(link), "link in sync after resync");
+
+                for (int i = 0; i < SLAVE_NUM; i++) {
+                    check(i == link || others[i] == key_count_of(SLAVE_SOURCE(i)), "resync of link leaves others");
+                }
+            }
+        } else {
+            m_leds ^= 1;
+            state_send();
+        }
+
+        if (p_link->connected) {
+            check(link_in_sync(link), "connected link in sync");
+        }
+    }
+}
+
+static void tap_hold_evt_handler(tap_hold_evt_t const *p_evt) {
+    if (m_out_num < OUT_MAX) {
+        m_outs[m_out_num++] = *p_evt;
+    }
+
+    key_register(p_evt->event, p_evt->source);
+}
+
+static void combo_evt_handler(combo_evt_t const *p_evt) {
+    tap_hold_process(p_evt->event, p_evt->source, p_evt->time);
+}
+
+static bool tap_hold_key_check(key_index_t index, uint8_t source) {
+    (void)source;
+
+    return index == TH_KEY;
+}
+
+// Master end of loopback link 0, as slave_link_evt_handler & its tasks of main_master.c.
+static void loopback_evt_handler(kb_link_transport_evt_t const *p_evt) {
+    switch (p_evt->evt_type) {
+        case KB_LINK_TRANSPORT_EVT_CONNECTED:
+            m_links[0].connected = true;
+            slave_sync_connected(0);
+            break;
+
+        case KB_LINK_TRANSPORT_EVT_RX:
+            if (p_evt->msg == KB_LINK_MSG_KEY_INDEX) {
+                for (int i = 0; i < p_evt->len / sizeof(key_event_t); i++) {
+                    key_event_t event;
+
+                    memcpy(&event, &p_evt->p_data[i * sizeof(key_event_t)], sizeof(event));
+                    combo_process(event, SLAVE_SOURCE(0), m_time);
+                }
+            } else if (p_evt->msg == KB_LINK_MSG_KEY_STATE && slave_sync_key_state_set(0, p_evt->p_data, p_evt->len)) {
+                combo_flush();
+                tap_hold_flush();
+                link_resync(0);
+                m_loopback_resyncs++;
+            }
+            break;
+
+        case KB_LINK_TRANSPORT_EVT_DISCONNECTED:
+            link_disconnect(0);
+            break;
+    }
+}
+
+static void slave_frame_send(kb_link_msg_t msg, void const *p_data, uint8_t len) {
+    uint8_t frame[KB_LINK_FRAME_LEN];
+
+    kb_link_frame_encode(frame, msg, p_data, len);
+    check(kb_link_transport_loopback_inject(frame) == NRF_SUCCESS, "frame of slave received");
+
+    // State pushed by master goes to slave, nothing to check here.
+    while (kb_link_transport_loopback_fetch(frame) == NRF_SUCCESS) {
+    }
+}
+
+static void slave_key_state_send(void) {
+    slave_frame_send(KB_LINK_MSG_KEY_STATE, m_links[0].held, m_links[0].held_num * sizeof(key_index_t));
+}
+
+// Scan of slave with edges; key events go to master, key state snapshot follows as GATT keeps it.
+static void slave_scan(key_index_t index, bool is_press) {
+    key_event_t event = KEY_EVENT(index, is_press);
+    sim_link_t *p_link = &m_links[0];
+
+    m_time += 10;
+
+    if (is_press) {
+        p_link->held[p_link->held_num++] = index;
+    } else {
+        for (int i = 0; i < p_link->held_num; i++) {
+            if (p_link->held[i] == index) {
+                p_link->held[i] = p_link->held[--p_link->held_num];
+                break;
+            }
+        }
+    }
+
+    slave_frame_send(KB_LINK_MSG_KEY_INDEX, &event, sizeof(event));
+    slave_key_state_send();
+}
+
+static int out_presses(key_index_t index) {
+    int num = 0;
+
+    for (int i = 0; i < m_out_num; i++) {
+        num += KEY_EVENT_IS_PRESS(m_outs[i].event) && KEY_EVENT_INDEX(m_outs[i].event) == index;
+    }
+
+    return num;
+}
+
+static void test_loopback(void) {
+    combo_init_t combo_init_params = {
+        .p_combos = m_combos,
+        .combo_num = 1,
+        .p_buffer = m_combo_buffer,
+        .combo_term = COMBO_TERM,
+        .evt_handler = combo_evt_handler
+    };
+    tap_hold_init_t tap_hold_init_params = {
+        .tapping_term = TAPPING_TERM,
+        .policy = TAP_HOLD_POLICY_TAPPING_TERM,
+        .key_check = tap_hold_key_check,
+        .evt_handler = tap_hold_evt_handler
+    };
+    uint8_t frame[KB_LINK_FRAME_LEN];
+
+    memset(m_links, 0, sizeof(m_links));
+    m_key_count = 0;
+    slave_sync_init();
+    combo_init(&combo_init_params);
+    tap_hold_init(&tap_hold_init_params);
+
+    // Master boots, slave answers its hello with hello and key state.
+    check(kb_link_transport_loopback.init(NULL, loopback_evt_handler) == NRF_SUCCESS, "loopback init");
+    kb_link_transport_loopback_fetch(frame);
+    slave_frame_send(KB_LINK_MSG_HELLO, NULL, 0);
+    slave_key_state_send();
+    check(m_links[0].connected && m_loopback_resyncs == 1, "slave connects and resyncs once");
+
+    // Plain key.
+    slave_scan(5, true);
+    slave_scan(5, false);
+    check(out_presses(5) == 1 && m_key_count == 0, "plain key pressed once");
+
+    // Keys of combo in separate scans, snapshot between them doesn't flush combo.
+    slave_scan(1, true);
+    slave_scan(2, true);
+    check(out_presses(COMBO_KEY_INDEX(0)) == 1 && out_presses(1) == 0 && out_presses(2) == 0, "combo fires over link");
+    slave_scan(1, false);
+    slave_scan(2, false);
+    check(m_key_count == 0, "combo released");
+
+    // Tap-hold key released within tapping term is tap, held past it is hold.
+    slave_scan(TH_KEY, true);
+    slave_scan(TH_KEY, false);
+    check(m_out_num > 0 && out_presses(TH_KEY) == 1 && !m_outs[m_out_num - 2].is_hold, "tap-hold key tapped");
+
+    slave_scan(TH_KEY, true);
+    slave_scan(5, true);
+    check(out_presses(TH_KEY) == 1, "tap-hold key undecided while other key pressed");
+    m_time += TAPPING_TERM;
+    tap_hold_timeout(m_time);
+    check(out_presses(TH_KEY) == 2 && out_presses(5) == 2, "tap-hold key held, each press out once");
+    slave_scan(5, false);
+    slave_scan(TH_KEY, false);
+    check(m_key_count == 0 && m_loopback_resyncs == 1, "no resync while typing");
+
+    // Slave resets holding 7, presses 9 before master hears from it again.
+    slave_scan(7, true);
+    m_links[0].held[m_links[0].held_num++] = 9;
+    slave_frame_send(KB_LINK_MSG_HELLO, NULL, 0);
+    slave_key_state_send();
+    check(m_loopback_resyncs == 2 && link_in_sync(0) && out_presses(7) == 1, "reset slave resyncs once");
+    slave_scan(7, false);
+    slave_scan(9, false);
+    check(m_key_count == 0 && m_loopback_resyncs == 2, "keys of reset slave released");
+}
+
+static void time_report(void) {
+    key_index_t registered[KEY_NUM];
+    key_index_t held[SLAVE_KEY_NUM];
+    key_event_t events[SLAVE_SYNC_EVENT_MAX];
+    uint64_t start;
+    uint32_t sum = 0;
+
+    // Worst case, registry full of keys of link none of which is held any more, and full snapshot of new keys.
+    for (int i = 0; i < KEY_NUM; i++) {
+        registered[i] = 1 + i;
+    }
+
+    for (int i = 0; i < SLAVE_KEY_NUM; i++) {
+        held[i] = KEY_NUM + 1 + i;
+    }
+
+    slave_sync_connected(0);
+    slave_sync_key_state_set(0, (uint8_t const *)held, sizeof(held));
+
+    start = time_ns();
+    for (int i = 0; i < TIME_REPEAT; i++) {
+        registered[0] = 1 + (i & 1);
+        sum += slave_sync_resync(0, registered, KEY_NUM, events);
+    }
+
+    printf("resync_worst_events: %u\n", sum / TIME_REPEAT);
+    printf("resync_worst_ns: %llu\n", (unsigned long long)((time_ns() - start) / TIME_REPEAT));
+}
+
+int main(void) {
+    srand(1);
+
+    test_scripted();
+    test_random();
+    test_loopback();
+
+    printf("links: %d\n", SLAVE_NUM);
+    printf("steps: %d\n", STEP_NUM);
+    printf("resyncs: %u\n", m_resyncs);
+    printf("resync_timeouts: %u\n", m_timeouts);
+    printf("resync_events_avg: %.2f\n", m_resyncs > 0 ? (double)m_resync_events / m_resyncs : 0.0);
+    printf("resync_events_max: %u\n", m_resync_events_max);
+    printf("loopback_events_out: %d\n", m_out_num);
+    printf("loopback_resyncs: %u\n", m_loopback_resyncs);
+    time_report();
+    printf("errors: %d\n", m_error_count);
+
+    return m_error_count > 0 ? 1 : 0;
+}
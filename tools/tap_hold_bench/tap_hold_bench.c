@@ -0,0 +1,380 @@
+/*
+ * Host test & benchmark of tap-hold engine (src/tap_hold).
+ * Runs scripted typing, fast rolls mostly, under every policy and checks decisions and event order. Overflows
+ * queue, which must decide hold. Then types random rolls of home row mods and plain keys, checks that events come
+ * out in order, that plain keys pressed with nothing undecided come out at once, and that tap decisions only follow
+ * release within tapping term. Reports held back events, queue peak & CPU time of tap_hold_process.
+ * Build & run from this folder (or 'make tap_hold_bench' in armgcc folder):
+ *   cc -O2 -I../matrix_bench/sdk_stub -I../../src/config -o tap_hold_bench tap_hold_bench.c \
+ *     ../../src/tap_hold/tap_hold.c && ./tap_hold_bench
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../../src/firmware_config.h"
+#include "../../src/tap_hold/tap_hold.h"
+#include "../bench/bench_script.h"
+
+#define TERM          200 // In ms, tapping term of tests.
+#define TAP_HOLD_NUM  4   // Keys 1..TAP_HOLD_NUM are tap-hold keys, home row mods.
+#define KEY_MAX       12  // Keys TAP_HOLD_NUM + 1..KEY_MAX are plain keys.
+#define OUT_MAX       4096
+#define SOURCE_BENCH  1
+
+typedef struct out_evt_s {
+    tap_hold_evt_t evt;
+    uint32_t time; // Of call it came out from.
+} out_evt_t;
+
+static out_evt_t m_out[OUT_MAX];
+static int m_out_num = 0;
+static uint32_t m_time = 0;
+
+static bool key_check(key_index_t index, uint8_t source) {
+    return index <= TAP_HOLD_NUM;
+}
+
+static void evt_handler(tap_hold_evt_t const *p_evt) {
+    if (m_out_num < OUT_MAX) {
+        m_out[m_out_num].evt = *p_evt;
+        m_out[m_out_num].time = m_time;
+        m_out_num++;
+    }
+}
+
+static void engine_init(uint8_t policy) {
+    tap_hold_init_t init = {
+        .tapping_term = TERM,
+        .policy = policy,
+        .key_check = key_check,
+        .evt_handler = evt_handler
+    };
+
+    tap_hold_init(&init);
+    m_out_num = 0;
+    m_time = 0;
+}
+
+// Timer of firmware, fires at deadline of undecided key unless an event comes first.
+static void time_advance(uint32_t time) {
+    uint32_t deadline;
+
+    while (tap_hold_deadline_get(&deadline) && deadline <= time) {
+        m_time = deadline;
+        tap_hold_timeout(deadline);
+    }
+
+    m_time = time;
+}
+
+static void key_send(key_event_t event, uint32_t time) {
+    time_advance(time);
+    tap_hold_process(event, SOURCE_BENCH, time);
+}
+
+/*
+ * Scripted case, input is time & key edge, e.g. "0 A+ 40 j+": tap-hold keys are A..D, plain keys j..q.
+ * Output is key edges as they came out, tap-hold key in lower case for tap and upper case for hold.
+ */
+typedef struct bench_case_s {
+    char const *p_name;
+    char const *p_input;
+    char const *p_output[3]; // By policy: tapping term, permissive hold, hold on other key press.
+} bench_case_t;
+
+static uint8_t const m_policies[] = {
+    TAP_HOLD_POLICY_TAPPING_TERM,
+    TAP_HOLD_POLICY_PERMISSIVE_HOLD,
+    TAP_HOLD_POLICY_HOLD_ON_OTHER_KEY_PRESS
+};
+
+static bench_case_t const m_cases[] = {
+    {"tap", "0 A+ 50 A-", {"a+ a-", "a+ a-", "a+ a-"}},
+    {"hold", "0 A+ 300 A-", {"A+ A-", "A+ A-", "A+ A-"}},
+    {"hold then key", "0 A+ 250 j+ 300 j- 350 A-", {"A+ j+ j- A-", "A+ j+ j- A-", "A+ j+ j- A-"}},
+    {"roll into plain key", "0 A+ 40 j+ 70 A- 110 j-", {"a+ j+ a- j-", "a+ j+ a- j-", "A+ j+ A- j-"}},
+    {"nested plain key", "0 A+ 40 j+ 80 j- 120 A-", {"a+ j+ j- a-", "A+ j+ j- A-", "A+ j+ j- A-"}},
+    {"roll of two mods", "0 A+ 30 B+ 60 A- 90 B-", {"a+ b+ a- b-", "a+ b+ a- b-", "A+ b+ A- b-"}},
+    {"roll through mod", "0 j+ 20 A+ 35 k+ 50 j- 65 A- 80 k-", {"j+ a+ k+ j- a- k-", "j+ a+ k+ j- a- k-", "j+ A+ k+ j- A- k-"}},
+    {"three key roll", "0 A+ 25 j+ 45 k+ 60 A- 75 j- 95 k-", {"a+ j+ k+ a- j- k-", "a+ j+ k+ a- j- k-", "A+ j+ k+ A- j- k-"}},
+    {"mod held over roll", "0 A+ 30 j+ 50 k+ 70 j- 90 k- 150 A-", {"a+ j+ k+ j- k- a-", "A+ j+ k+ j- k- A-", "A+ j+ k+ j- k- A-"}},
+    {"second mod pressed late", "0 A+ 150 B+ 230 B- 260 A-", {"A+ b+ b- A-", "A+ b+ b- A-", "A+ b+ b- A-"}},
+    {"double tap then hold", "0 A+ 50 A- 80 A+ 400 A-", {"a+ a- A+ A-", "a+ a- A+ A-", "a+ a- A+ A-"}},
+    {"plain key released inside", "0 j+ 20 A+ 40 j- 60 A-", {"j+ a+ j- a-", "j+ a+ j- a-", "j+ a+ j- a-"}},
+    {"plain keys alone", "0 j+ 10 k+ 20 j- 30 k-", {"j+ k+ j- k-", "j+ k+ j- k-", "j+ k+ j- k-"}},
+};
+
+static key_event_t token_event(char const *p_token) {
+    char name = p_token[0];
+    bool is_press = p_token[1] == '+';
+
+    if ('A' <= name && name <= 'D') {
+        return KEY_EVENT(name - 'A' + 1, is_press);
+    }
+
+    return KEY_EVENT(name - 'j' + TAP_HOLD_NUM + 1, is_press);
+}
+
+static void out_format(char *p_output) {
+    static bool is_hold[KEY_MAX + 1];
+    size_t len = 0;
+
+    p_output[0] = '\0';
+
+    for (int i = 0; i < m_out_num; i++) {
+        key_event_t event = m_out[i].evt.event;
+        key_index_t index = KEY_EVENT_INDEX(event);
+        char name;
+
+        if (index <= TAP_HOLD_NUM) {
+            if (KEY_EVENT_IS_PRESS(event)) {
+                is_hold[index] = m_out[i].evt.is_hold;
+            }
+
+            name = (is_hold[index] ? 'A' : 'a') + index - 1;
+        } else {
+            name = 'j' + index - TAP_HOLD_NUM - 1;
+        }
+
+        len = bench_script_append(p_output, len, name, KEY_EVENT_IS_PRESS(event));
+    }
+}
+
+static int cases_run(void) {
+    int case_num = 0;
+
+    for (size_t c = 0; c < sizeof(m_cases) / sizeof(m_cases[0]); c++) {
+        for (size_t p = 0; p < sizeof(m_policies); p++) {
+            char name[64];
+            char output[BENCH_SCRIPT_LEN];
+
+            engine_init(m_policies[p]);
+            time_advance(bench_script_play(m_cases[c].p_input, token_event, key_send) + TERM * 2);
+            out_format(output);
+            snprintf(name, sizeof(name), "%s, policy %u", m_cases[c].p_name, m_policies[p]);
+            bench_script_check(name, output, m_cases[c].p_output[p]);
+
+            case_num++;
+        }
+    }
+
+    return case_num;
+}
+
+// Plain key taps inside undecided key overflow queue, key must be hold and events still come out in order.
+static void queue_full_run(void) {
+    int in_num = 0;
+
+    engine_init(TAP_HOLD_POLICY_TAPPING_TERM);
+    key_send(KEY_EVENT(1, true), 0);
+
+    while (in_num <= TAP_HOLD_QUEUE_LEN) {
+        key_send(KEY_EVENT(TAP_HOLD_NUM + 1, in_num % 2 == 0), 1 + in_num);
+        in_num++;
+    }
+
+    if (tap_hold_queue_peak() != TAP_HOLD_QUEUE_LEN || m_out_num < 1 || !m_out[0].evt.is_hold) {
+        fprintf(stderr, "error: full queue; peak %u, %d events out, first is %s.\n", tap_hold_queue_peak(), m_out_num, m_out_num > 0 && m_out[0].evt.is_hold ? "hold" : "not hold");
+        m_error_count++;
+    }
+
+    for (int i = 1; i < m_out_num; i++) {
+        if (m_out[i].evt.event != KEY_EVENT(TAP_HOLD_NUM + 1, i % 2 == 1)) {
+            fprintf(stderr, "error: full queue; event %d out of order.\n", i);
+            m_error_count++;
+            break;
+        }
+    }
+}
+
+typedef struct typing_stats_s {
+    uint32_t events;
+    uint32_t held_back;     // Events which came out later than they went in.
+    uint32_t held_back_max; // In ms.
+    uint64_t process_ns;
+} typing_stats_t;
+
+// Random rolls, key presses overlap by a random part of their length.
+static void typing_run(uint8_t policy, uint32_t stroke_num, typing_stats_t *p_stats) {
+    static key_event_t in[OUT_MAX];
+    static uint32_t in_time[OUT_MAX];
+    uint32_t release[KEY_MAX + 1] = {0};
+    bool held[KEY_MAX + 1] = {false};
+    uint32_t tap_press[KEY_MAX + 1] = {0};
+    int in_num = 0;
+    uint32_t time = 0;
+
+    engine_init(policy);
+
+    for (uint32_t stroke = 0; stroke < stroke_num && in_num < OUT_MAX - 2 * (KEY_MAX + 1); stroke++) {
+        key_index_t index = 1 + rand() % KEY_MAX;
+        uint32_t next = time + 10 + rand() % 90;
+
+        // Release keys due before next press, in time order.
+        for (uint32_t t = time; t <= next; t++) {
+            for (key_index_t k = 1; k <= KEY_MAX; k++) {
+                if (held[k] && release[k] == t) {
+                    in[in_num] = KEY_EVENT(k, false);
+                    in_time[in_num++] = t;
+                    held[k] = false;
+                }
+            }
+        }
+
+        time = next;
+
+        if (!held[index]) {
+            in[in_num] = KEY_EVENT(index, true);
+            in_time[in_num++] = time;
+            held[index] = true;
+            // Mostly taps shorter than tapping term, some holds.
+            release[index] = time + 30 + (rand() % 8 == 0 ? TERM + rand() % 300 : rand() % (TERM - 40));
+        }
+    }
+
+    for (key_index_t k = 1; k <= KEY_MAX; k++) {
+        if (held[k]) {
+            in[in_num] = KEY_EVENT(k, false);
+            in_time[in_num++] = release[k] > time ? release[k] : time;
+        }
+    }
+
+    // Sort releases appended last by time, stable.
+    for (int i = 1; i < in_num; i++) {
+        for (int j = i; j > 0 && in_time[j] < in_time[j - 1]; j--) {
+            key_event_t event = in[j];
+            uint32_t event_time = in_time[j];
+
+            in[j] = in[j - 1];
+            in_time[j] = in_time[j - 1];
+            in[j - 1] = event;
+            in_time[j - 1] = event_time;
+        }
+    }
+
+    for (int i = 0; i < in_num; i++) {
+        uint32_t deadline;
+        bool was_pending;
+        int out_num;
+        uint64_t start;
+
+        time_advance(in_time[i]);
+        was_pending = tap_hold_deadline_get(&deadline);
+        out_num = m_out_num;
+
+        start = time_ns();
+        tap_hold_process(in[i], SOURCE_BENCH, in_time[i]);
+        p_stats->process_ns += time_ns() - start;
+        p_stats->events++;
+
+        if (!was_pending && KEY_EVENT_INDEX(in[i]) > TAP_HOLD_NUM && m_out_num == out_num) {
+            fprintf(stderr, "error: plain key %d was held back with no key undecided.\n", KEY_EVENT_INDEX(in[i]));
+            m_error_count++;
+        }
+    }
+
+    time_advance(time + TERM * 4);
+    tap_hold_flush();
+
+    if (m_out_num != in_num) {
+        fprintf(stderr, "error: policy %u: %d events in, %d out.\n", policy, in_num, m_out_num);
+        m_error_count++;
+    }
+
+    // Same order out as in, tap decided only for release within tapping term.
+    for (int i = 0; i < in_num && i < m_out_num; i++) {
+        key_event_t event = m_out[i].evt.event;
+        key_index_t index = KEY_EVENT_INDEX(event);
+        uint32_t held_back = m_out[i].time - in_time[i];
+
+        if (event != in[i]) {
+            fprintf(stderr, "error: policy %u: event %d out of order.\n", policy, i);
+            m_error_count++;
+            break;
+        }
+
+        if (index <= TAP_HOLD_NUM && KEY_EVENT_IS_PRESS(event) && !m_out[i].evt.is_hold) {
+            tap_press[index] = in_time[i];
+        } else if (index <= TAP_HOLD_NUM && !KEY_EVENT_IS_PRESS(event) && tap_press[index] > 0) {
+            if (in_time[i] - tap_press[index] >= TERM) {
+                fprintf(stderr, "error: policy %u: key %d held %u ms was tap.\n", policy, index, (unsigned)(in_time[i] - tap_press[index]));
+                m_error_count++;
+            }
+
+            tap_press[index] = 0;
+        }
+
+        if (held_back > 0) {
+            p_stats->held_back++;
+        }
+
+        if (held_back > p_stats->held_back_max) {
+            p_stats->held_back_max = held_back;
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t stroke_num = 200;
+    uint32_t run_num = 200;
+    unsigned seed = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:r:s:")) != -1) {
+        switch (opt) {
+            case 'n':
+                stroke_num = strtoul(optarg, NULL, 0);
+                break;
+
+            case 'r':
+                run_num = strtoul(optarg, NULL, 0);
+                break;
+
+            case 's':
+                seed = strtoul(optarg, NULL, 0);
+                break;
+
+            default:
+                fprintf(stderr, "Usage: %s [-n <key strokes per run>] [-r <runs per policy>] [-s <seed>]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    srand(seed);
+
+    int case_num = cases_run();
+
+    queue_full_run();
+
+    // One line per stat, for tracking across engine changes.
+    printf("cases: %d\n", case_num);
+    printf("tapping_term_ms: %d\n", TERM);
+    printf("queue_len: %d\n", TAP_HOLD_QUEUE_LEN);
+
+    for (size_t p = 0; p < sizeof(m_policies); p++) {
+        typing_stats_t stats = {0};
+        uint8_t queue_peak = 0;
+
+        for (uint32_t run = 0; run < run_num; run++) {
+            typing_run(m_policies[p], stroke_num, &stats);
+
+            if (tap_hold_queue_peak() > queue_peak) {
+                queue_peak = tap_hold_queue_peak();
+            }
+        }
+
+        printf("policy_%u_events: %u\n", m_policies[p], (unsigned)stats.events);
+        printf("policy_%u_held_back: %.1f%%\n", m_policies[p], stats.events > 0 ? (double)stats.held_back * 100 / stats.events : 0.0);
+        printf("policy_%u_held_back_max_ms: %u\n", m_policies[p], (unsigned)stats.held_back_max);
+        printf("policy_%u_queue_peak: %u\n", m_policies[p], queue_peak);
+        printf("policy_%u_process_ns: %.1f\n", m_policies[p], stats.events > 0 ? (double)stats.process_ns / stats.events : 0.0);
+    }
+
+    printf("errors: %d\n", m_error_count);
+
+    return m_error_count > 0 ? 1 : 0;
+}